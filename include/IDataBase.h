@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <system_error>
 
@@ -34,5 +35,8 @@ public:
   virtual std::error_code writeSync(IWriteBatch& batch) = 0;
 
   virtual std::error_code read(IReadBatch& batch) = 0;
+
+  // Visits the entries whose keys start with prefix, in key order, until visitor returns false
+  virtual std::error_code iterate(const std::string& prefix, const std::function<bool(const std::string& key, const std::string& value)>& visitor) = 0;
 };
 }
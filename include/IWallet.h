@@ -128,6 +128,28 @@ struct TransactionsInBlockInfo {
   std::vector<WalletTransactionWithTransfers> transactions;
 };
 
+struct TransactionsQuery {
+  uint32_t blockIndex;
+  size_t blockCount;
+  // Skips transactions of blockIndex up to this one, to resume a truncated query
+  size_t afterTransactionId = WALLET_INVALID_TRANSACTION_ID;
+  // Transactions with a transfer for any of these addresses, all if empty
+  std::vector<std::string> addresses;
+  bool havePaymentId = false;
+  Crypto::Hash paymentId;
+  // Maximum number of transactions returned, 0 for no limit
+  size_t limit = 0;
+};
+
+struct TransactionsQueryResult {
+  // Only blocks that have matching transactions, ordered by block and transaction id
+  std::vector<TransactionsInBlockInfo> blocks;
+  // Set if limit cut the result short, the query continues after this transaction
+  bool truncated = false;
+  uint32_t lastBlockIndex = 0;
+  size_t lastTransactionId = WALLET_INVALID_TRANSACTION_ID;
+};
+
 class IWallet {
 public:
   virtual ~IWallet() {}
@@ -170,6 +192,8 @@ public:
   virtual WalletTransactionWithTransfers getTransaction(const Crypto::Hash& transactionHash) const = 0;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t count) const = 0;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const = 0;
+  virtual TransactionsQueryResult queryTransactions(const TransactionsQuery& query) const = 0;
+  virtual bool getBlockIndex(const Crypto::Hash& blockHash, uint32_t& blockIndex) const = 0;
   virtual std::vector<Crypto::Hash> getBlockHashes(uint32_t blockIndex, size_t count) const = 0;
   virtual uint32_t getBlockCount() const  = 0;
   virtual std::vector<WalletTransactionWithTransfers> getUnconfirmedTransactions() const = 0;
@@ -27,6 +27,10 @@ class IWriteBatch {
 public:
   virtual std::vector<std::pair<std::string, std::string>> extractRawDataToInsert() = 0;
   virtual std::vector<std::string> extractRawKeysToRemove() = 0;
+  //merge operands, see DB::applyMergeOperand()
+  virtual std::vector<std::pair<std::string, std::string>> extractRawDataToMerge() {
+    return {};
+  }
 };
 
 } //namespace CryptoNote
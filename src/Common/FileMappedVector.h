@@ -290,6 +290,9 @@ public:
   uint8_t* suffix();
   uint64_t suffixSize() const;
   void resizeSuffix(uint64_t newSuffixSize);
+  // Grows the file in place instead of copying it, so unlike the other
+  // modifications it is not atomic: a crash can leave part of data behind
+  void appendSuffix(const uint8_t* data, uint64_t size);
 
   void rename(const std::string& newPath, std::error_code& ec);
   void rename(const std::string& newPath);
@@ -742,6 +745,21 @@ void FileMappedVector<T>::resizeSuffix(uint64_t newSuffixSize) {
   }
 }
 
+template<class T>
+void FileMappedVector<T>::appendSuffix(const uint8_t* data, uint64_t size) {
+  assert(isOpened());
+
+  uint64_t oldFileSize = m_file.size();
+  m_file.resize(oldFileSize + size);
+  m_suffixSize += size;
+
+  std::copy(data, data + size, m_file.data() + oldFileSize);
+
+  if (m_autoFlush) {
+    m_file.flush(m_file.data() + oldFileSize, size);
+  }
+}
+
 template<class T>
 void FileMappedVector<T>::rename(const std::string& newPath, std::error_code& ec) {
   m_file.rename(newPath, ec);
@@ -0,0 +1,101 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Common {
+
+namespace {
+
+const uint64_t MAX_VALUE = (uint64_t(1) << (LatencyHistogram::MAX_EXPONENT + 1)) - 1;
+
+unsigned highestBit(uint64_t value) {
+  unsigned bit = 0;
+  while (value >>= 1) {
+    ++bit;
+  }
+
+  return bit;
+}
+
+}
+
+LatencyHistogram::LatencyHistogram() : count(0), sum(0) {
+  for (auto& bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::record(uint64_t microseconds) {
+  buckets[bucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+  sum.fetch_add(microseconds, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getCount() const {
+  return count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getSum() const {
+  return sum.load(std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> LatencyHistogram::getQuantiles(const std::vector<double>& fractions) const {
+  std::vector<uint64_t> snapshot(BUCKETS);
+  uint64_t total = 0;
+  for (unsigned i = 0; i < BUCKETS; ++i) {
+    snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+    total += snapshot[i];
+  }
+
+  std::vector<uint64_t> quantiles;
+  quantiles.reserve(fractions.size());
+  for (double fraction : fractions) {
+    if (total == 0) {
+      quantiles.push_back(0);
+      continue;
+    }
+
+    // rank of the duration the fraction falls on, counting from 1
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::min(std::max(fraction, 0.0), 1.0) * total)));
+    uint64_t seen = 0;
+    unsigned index = 0;
+    while (index + 1 < BUCKETS && seen + snapshot[index] < rank) {
+      seen += snapshot[index];
+      ++index;
+    }
+
+    quantiles.push_back(bucketUpperBound(index));
+  }
+
+  return quantiles;
+}
+
+// values below SUB_BUCKETS are counted exactly, each power of two above gets SUB_BUCKETS buckets of its own
+unsigned LatencyHistogram::bucketIndex(uint64_t value) {
+  value = std::min(value, MAX_VALUE);
+  if (value < SUB_BUCKETS) {
+    return static_cast<unsigned>(value);
+  }
+
+  const unsigned exponent = highestBit(value);
+  const unsigned subBucket = static_cast<unsigned>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(unsigned index) {
+  if (index < SUB_BUCKETS) {
+    return index;
+  }
+
+  const unsigned exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+  const uint64_t subBucket = index % SUB_BUCKETS;
+  const unsigned shift = exponent - SUB_BUCKET_BITS;
+  return ((SUB_BUCKETS + subBucket + 1) << shift) - 1;
+}
+
+}
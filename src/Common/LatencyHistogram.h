@@ -0,0 +1,48 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace Common {
+
+/* Histogram of durations in microseconds in the manner of HdrHistogram:
+   every power of two is split into SUB_BUCKETS buckets, so a quantile read
+   back is within 1/SUB_BUCKETS of the true value at any magnitude. Recording
+   is three relaxed atomic increments and safe from any thread; a reader
+   racing them sees a snapshot that is off by the few durations in flight. */
+class LatencyHistogram {
+public:
+  static const unsigned SUB_BUCKET_BITS = 4;
+  static const unsigned SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  // durations of 2^37 us, about 38 hours, and more share the top bucket
+  static const unsigned MAX_EXPONENT = 36;
+  static const unsigned BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+  LatencyHistogram();
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void record(uint64_t microseconds);
+
+  uint64_t getCount() const;
+  uint64_t getSum() const;
+
+  /* Upper bound of the bucket holding each fraction of the durations,
+     0 when nothing was recorded */
+  std::vector<uint64_t> getQuantiles(const std::vector<double>& fractions) const;
+
+private:
+  static unsigned bucketIndex(uint64_t value);
+  static uint64_t bucketUpperBound(unsigned index);
+
+  std::atomic<uint64_t> buckets[BUCKETS];
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> sum;
+};
+
+}
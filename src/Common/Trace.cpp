@@ -0,0 +1,199 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "JsonValue.h"
+
+namespace Common {
+namespace Trace {
+
+namespace {
+
+struct Event {
+  const char* name;
+  // steady clock nanoseconds
+  int64_t start;
+  int64_t duration;
+};
+
+/* Ring buffer written only by the thread it is lent to. Readers copy the
+   slots while they may be overwritten and keep the ones begun shows were
+   not, the way a seqlock works, so the writer never waits */
+struct ThreadEvents {
+  struct Slot {
+    std::atomic<const char*> name;
+    std::atomic<int64_t> start;
+    std::atomic<int64_t> duration;
+  };
+
+  explicit ThreadEvents(uint32_t id) : id(id), inUse(true), begun(0), recorded(0) {
+    for (auto& slot : slots) {
+      slot.name.store(nullptr, std::memory_order_relaxed);
+      slot.start.store(0, std::memory_order_relaxed);
+      slot.duration.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  const uint32_t id;
+  // cleared when the thread exits, the next new thread takes the buffer over
+  std::atomic<bool> inUse;
+  // events the writer has started and finished writing
+  std::atomic<uint64_t> begun;
+  std::atomic<uint64_t> recorded;
+  Slot slots[THREAD_EVENTS];
+};
+
+std::mutex registryMutex;
+// never shrinks, buffers are lent out again instead
+std::vector<std::unique_ptr<ThreadEvents>> registry;
+
+ThreadEvents* acquireThreadEvents() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (auto& events : registry) {
+    bool inUse = false;
+    if (events->inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+      return events.get();
+    }
+  }
+
+  registry.emplace_back(new ThreadEvents(static_cast<uint32_t>(registry.size() + 1)));
+  return registry.back().get();
+}
+
+struct ThreadEventsLease {
+  ThreadEventsLease() : events(acquireThreadEvents()) {
+  }
+
+  ~ThreadEventsLease() {
+    events->inUse.store(false, std::memory_order_release);
+  }
+
+  ThreadEvents* const events;
+};
+
+ThreadEvents& threadEvents() {
+  thread_local ThreadEventsLease lease;
+  return *lease.events;
+}
+
+int64_t toNanoseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+std::vector<Event> copyEvents(const ThreadEvents& events) {
+  const uint64_t end = events.recorded.load(std::memory_order_acquire);
+  const uint64_t begin = end > THREAD_EVENTS ? end - THREAD_EVENTS : 0;
+
+  std::vector<Event> copied;
+  copied.reserve(end - begin);
+  for (uint64_t i = begin; i < end; ++i) {
+    const ThreadEvents::Slot& slot = events.slots[i % THREAD_EVENTS];
+    copied.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                      slot.duration.load(std::memory_order_relaxed)});
+  }
+
+  // writing event n overwrites event n - THREAD_EVENTS, the ones up to there may be torn
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t begun = events.begun.load(std::memory_order_relaxed);
+  const uint64_t firstIntact = begun > THREAD_EVENTS ? begun - THREAD_EVENTS : 0;
+  if (firstIntact > begin) {
+    copied.erase(copied.begin(), copied.begin() + std::min<uint64_t>(firstIntact - begin, copied.size()));
+  }
+
+  return copied;
+}
+
+// Copies of the buffers lent out so far, with their thread ids
+std::vector<std::pair<uint32_t, std::vector<Event>>> copyAllEvents() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  std::vector<std::pair<uint32_t, std::vector<Event>>> all;
+  for (const auto& events : registry) {
+    all.emplace_back(events->id, copyEvents(*events));
+  }
+
+  return all;
+}
+
+}
+
+void Span::record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+  ThreadEvents& events = threadEvents();
+  const uint64_t index = events.recorded.load(std::memory_order_relaxed);
+  events.begun.store(index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  ThreadEvents::Slot& slot = events.slots[index % THREAD_EVENTS];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.start.store(toNanoseconds(start.time_since_epoch()), std::memory_order_relaxed);
+  slot.duration.store(toNanoseconds(end - start), std::memory_order_relaxed);
+  events.recorded.store(index + 1, std::memory_order_release);
+}
+
+std::vector<StageStatistics> getStageStatistics() {
+  std::map<std::string, StageStatistics> stages;
+  for (const auto& thread : copyAllEvents()) {
+    for (const Event& event : thread.second) {
+      auto it = stages.find(event.name);
+      if (it == stages.end()) {
+        it = stages.emplace(event.name, StageStatistics{event.name, 0, 0, 0, 0}).first;
+      }
+
+      const double microseconds = event.duration / 1000.0;
+      StageStatistics& stage = it->second;
+      ++stage.count;
+      stage.totalMicroseconds += microseconds;
+      stage.maxMicroseconds = std::max(stage.maxMicroseconds, microseconds);
+    }
+  }
+
+  std::vector<StageStatistics> result;
+  for (auto& stage : stages) {
+    stage.second.averageMicroseconds = stage.second.totalMicroseconds / stage.second.count;
+    result.push_back(std::move(stage.second));
+  }
+
+  return result;
+}
+
+void writeChromeTrace(std::ostream& out) {
+  auto all = copyAllEvents();
+
+  // timestamps start from the first span, the steady clock has no meaningful epoch
+  int64_t origin = std::numeric_limits<int64_t>::max();
+  for (const auto& thread : all) {
+    for (const Event& event : thread.second) {
+      origin = std::min(origin, event.start);
+    }
+  }
+
+  JsonValue traceEvents(JsonValue::ARRAY);
+  for (const auto& thread : all) {
+    for (const Event& event : thread.second) {
+      JsonValue traceEvent(JsonValue::OBJECT);
+      traceEvent.insert("name", std::string(event.name));
+      traceEvent.insert("ph", std::string("X"));
+      traceEvent.insert("ts", (event.start - origin) / 1000.0);
+      traceEvent.insert("dur", event.duration / 1000.0);
+      traceEvent.insert("pid", static_cast<JsonValue::Integer>(1));
+      traceEvent.insert("tid", static_cast<JsonValue::Integer>(thread.first));
+      traceEvents.pushBack(std::move(traceEvent));
+    }
+  }
+
+  JsonValue trace(JsonValue::OBJECT);
+  trace.insert("traceEvents", std::move(traceEvents));
+  trace.insert("displayTimeUnit", std::string("ms"));
+  out << trace;
+}
+
+}
+}
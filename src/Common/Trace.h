@@ -0,0 +1,69 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Spans timing the stages of block and transaction processing. A span
+   records its name, start and duration into a ring buffer of the thread it
+   ran on when it goes out of scope; nothing is locked or allocated on the
+   way, so they can sit on hot paths. Built without ENABLE_TRACING the
+   macros expand to nothing and no clock is read. */
+#ifdef ENABLE_TRACING
+#define TRACE_SPAN_CONCAT_(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT_(a, b)
+// name must be a string literal, only the pointer is kept
+#define TRACE_SPAN(name) Common::Trace::Span TRACE_SPAN_CONCAT(traceSpan, __LINE__)(name)
+#else
+#define TRACE_SPAN(name) static_cast<void>(0)
+#endif
+
+namespace Common {
+namespace Trace {
+
+// spans each thread keeps, older ones are overwritten
+const size_t THREAD_EVENTS = 8192;
+
+class Span {
+public:
+  explicit Span(const char* name) : name(name), start(std::chrono::steady_clock::now()) {
+  }
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+  ~Span() {
+    record(name, start, std::chrono::steady_clock::now());
+  }
+
+  static void record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+private:
+  const char* name;
+  std::chrono::steady_clock::time_point start;
+};
+
+struct StageStatistics {
+  std::string name;
+  // spans still in the ring buffers, the most recent of each thread
+  uint64_t count;
+  double averageMicroseconds;
+  double maxMicroseconds;
+  double totalMicroseconds;
+};
+
+// Per stage statistics of the spans in the ring buffers, by name
+std::vector<StageStatistics> getStageStatistics();
+
+/* Writes the spans in the ring buffers in the Chrome trace event format,
+   for chrome://tracing or Perfetto */
+void writeChromeTrace(std::ostream& out);
+
+}
+}
@@ -0,0 +1,455 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CryptoTypes.h"
+#include "Common/JsonValue.h"
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+namespace Crypto {
+  extern "C" {
+#include "crypto/crypto-ops.h"
+  }
+}
+
+using namespace Crypto;
+using Common::JsonValue;
+
+namespace {
+
+/* Timing samples are taken over a group of calls, so that very cheap
+   operations are not dominated by the clock itself */
+const uint64_t TARGET_SAMPLE_NANOSECONDS = 20000;
+const size_t RING_SIZES[] = {1, 2, 4, 8, 16, 32, 64};
+const size_t TREE_HASH_LEAVES = 64;
+const size_t FAST_HASH_INPUT_SIZE = 76;
+
+struct Options {
+  bool json = false;
+  bool scaling = true;
+  size_t maxThreads = 1;
+  double seconds = 1.0;
+  std::string filter;
+};
+
+struct Benchmark {
+  std::string name;
+  // called with an increasing counter, so operations can cycle through inputs
+  std::function<void(size_t)> operation;
+};
+
+struct Result {
+  std::string name;
+  uint64_t operations;
+  double mean;
+  double min;
+  double p50;
+  double p90;
+  double p99;
+  double max;
+  // operations per second for 1, 2, 4, ... threads
+  std::vector<std::pair<size_t, double>> scaling;
+};
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+double percentile(const std::vector<double>& sorted, double fraction)
+{
+  const size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+/* Calls per sample, doubling until one sample takes TARGET_SAMPLE_NANOSECONDS */
+size_t calibrate(const Benchmark& benchmark)
+{
+  size_t calls = 1;
+
+  while (true)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; i++)
+    {
+      benchmark.operation(i);
+    }
+
+    if (nanosecondsSince(start) >= TARGET_SAMPLE_NANOSECONDS || calls >= (1 << 20))
+    {
+      return calls;
+    }
+
+    calls *= 2;
+  }
+}
+
+/* Runs the operation on the given number of threads for roughly the given
+   time and returns the combined operations per second */
+double throughput(const Benchmark& benchmark, size_t threads, size_t callsPerSample, double seconds)
+{
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> operations(0);
+  std::vector<std::thread> workers;
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (size_t t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&, t] {
+      uint64_t done = 0;
+      size_t counter = t * callsPerSample;
+      while (!stop)
+      {
+        for (size_t i = 0; i < callsPerSample; i++)
+        {
+          benchmark.operation(counter++);
+        }
+        done += callsPerSample;
+      }
+      operations += done;
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  stop = true;
+
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+
+  return operations * 1e9 / nanosecondsSince(start);
+}
+
+Result run(const Benchmark& benchmark, const Options& options)
+{
+  Result result;
+  result.name = benchmark.name;
+
+  const size_t callsPerSample = calibrate(benchmark);
+  const uint64_t budget = static_cast<uint64_t>(options.seconds * 1e9);
+  std::vector<double> samples;
+  size_t counter = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  while (nanosecondsSince(start) < budget || samples.size() < 5)
+  {
+    auto sampleStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < callsPerSample; i++)
+    {
+      benchmark.operation(counter++);
+    }
+    samples.push_back(static_cast<double>(nanosecondsSince(sampleStart)) / callsPerSample);
+  }
+
+  result.operations = counter;
+
+  double total = 0;
+  for (double sample : samples)
+  {
+    total += sample;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  result.mean = total / samples.size();
+  result.min = samples.front();
+  result.p50 = percentile(samples, 0.50);
+  result.p90 = percentile(samples, 0.90);
+  result.p99 = percentile(samples, 0.99);
+  result.max = samples.back();
+
+  if (options.scaling)
+  {
+    for (size_t threads = 1; threads <= options.maxThreads; threads *= 2)
+    {
+      result.scaling.emplace_back(threads, throughput(benchmark, threads, callsPerSample, options.seconds / 2));
+    }
+  }
+
+  return result;
+}
+
+std::vector<Benchmark> makeBenchmarks()
+{
+  std::vector<Benchmark> benchmarks;
+
+  /* Block hashing blob sized input, the slow hash variants need at least 43 bytes */
+  auto input = std::make_shared<std::vector<uint8_t>>(FAST_HASH_INPUT_SIZE);
+  for (size_t i = 0; i < input->size(); i++)
+  {
+    (*input)[i] = static_cast<uint8_t>(i);
+  }
+
+  typedef void (*HashFunction)(const void*, size_t, Hash&);
+  const std::pair<const char*, HashFunction> hashes[] = {
+    {"cn_fast_hash", cn_fast_hash},
+    {"cn_slow_hash_v0", cn_slow_hash_v0},
+    {"cn_slow_hash_v1", cn_slow_hash_v1},
+    {"cn_slow_hash_v2", cn_slow_hash_v2},
+    {"cn_lite_slow_hash_v0", cn_lite_slow_hash_v0},
+    {"cn_lite_slow_hash_v1", cn_lite_slow_hash_v1},
+    {"cn_lite_slow_hash_v2", cn_lite_slow_hash_v2},
+  };
+
+  for (const auto& hash : hashes)
+  {
+    HashFunction function = hash.second;
+    benchmarks.push_back({hash.first, [input, function](size_t) {
+      Hash result;
+      function(input->data(), input->size(), result);
+    }});
+  }
+
+  auto leaves = std::make_shared<std::vector<Hash>>(TREE_HASH_LEAVES);
+  for (size_t i = 0; i < leaves->size(); i++)
+  {
+    cn_fast_hash(&i, sizeof(i), (*leaves)[i]);
+  }
+
+  benchmarks.push_back({"tree_hash_" + std::to_string(TREE_HASH_LEAVES), [leaves](size_t) {
+    Hash root;
+    tree_hash(leaves->data(), leaves->size(), root);
+  }});
+
+  /* Keys for the crypto_ops benchmarks, shared read-only between threads */
+  const size_t maxRing = RING_SIZES[sizeof(RING_SIZES) / sizeof(RING_SIZES[0]) - 1];
+
+  struct Keys {
+    std::vector<PublicKey> publicKeys;
+    std::vector<SecretKey> secretKeys;
+    std::vector<KeyDerivation> derivations;
+  };
+
+  auto keys = std::make_shared<Keys>();
+  keys->publicKeys.resize(maxRing);
+  keys->secretKeys.resize(maxRing);
+  keys->derivations.resize(maxRing);
+
+  for (size_t i = 0; i < maxRing; i++)
+  {
+    generate_keys(keys->publicKeys[i], keys->secretKeys[i]);
+  }
+
+  for (size_t i = 0; i < maxRing; i++)
+  {
+    generate_key_derivation(keys->publicKeys[(i + 1) % maxRing], keys->secretKeys[i], keys->derivations[i]);
+  }
+
+  benchmarks.push_back({"generate_key_derivation", [keys, maxRing](size_t i) {
+    KeyDerivation derivation;
+    generate_key_derivation(keys->publicKeys[i % maxRing], keys->secretKeys[0], derivation);
+  }});
+
+  benchmarks.push_back({"derive_public_key", [keys, maxRing](size_t i) {
+    PublicKey derived;
+    derive_public_key(keys->derivations[i % maxRing], i, keys->publicKeys[0], derived);
+  }});
+
+  benchmarks.push_back({"underive_public_key", [keys, maxRing](size_t i) {
+    PublicKey underived;
+    underive_public_key(keys->derivations[i % maxRing], i, keys->publicKeys[0], underived);
+  }});
+
+  benchmarks.push_back({"generate_key_image", [keys, maxRing](size_t i) {
+    KeyImage image;
+    generate_key_image(keys->publicKeys[i % maxRing], keys->secretKeys[i % maxRing], image);
+  }});
+
+  for (size_t ringSize : RING_SIZES)
+  {
+    struct Ring {
+      Hash prefixHash;
+      KeyImage image;
+      std::vector<const PublicKey*> publicKeys;
+      std::vector<Signature> signatures;
+    };
+
+    auto ring = std::make_shared<Ring>();
+    ring->prefixHash = cn_fast_hash(&ringSize, sizeof(ringSize));
+    ring->signatures.resize(ringSize);
+
+    for (size_t i = 0; i < ringSize; i++)
+    {
+      ring->publicKeys.push_back(&keys->publicKeys[i]);
+    }
+
+    const size_t realIndex = ringSize / 2;
+    generate_key_image(keys->publicKeys[realIndex], keys->secretKeys[realIndex], ring->image);
+    generate_ring_signature(ring->prefixHash, ring->image, ring->publicKeys, keys->secretKeys[realIndex], realIndex, ring->signatures.data());
+
+    if (!check_ring_signature(ring->prefixHash, ring->image, ring->publicKeys, ring->signatures.data(), true))
+    {
+      throw std::runtime_error("Generated ring signature does not verify");
+    }
+
+    benchmarks.push_back({"check_ring_signature_" + std::to_string(ringSize), [keys, ring](size_t) {
+      check_ring_signature(ring->prefixHash, ring->image, ring->publicKeys, ring->signatures.data(), true);
+    }});
+  }
+
+  return benchmarks;
+}
+
+void printText(const Result& result)
+{
+  std::cout << std::left << std::setw(26) << result.name << std::right << std::fixed << std::setprecision(0)
+    << " mean " << std::setw(10) << result.mean
+    << " p50 " << std::setw(10) << result.p50
+    << " p90 " << std::setw(10) << result.p90
+    << " p99 " << std::setw(10) << result.p99
+    << " ns/op";
+
+  for (const auto& point : result.scaling)
+  {
+    std::cout << std::setprecision(2) << "  " << point.first << "t x" << point.second / result.scaling.front().second;
+  }
+
+  std::cout << std::endl;
+}
+
+JsonValue toJson(const Result& result)
+{
+  JsonValue value(JsonValue::OBJECT);
+  value.insert("name", result.name);
+  value.insert("operations", static_cast<JsonValue::Integer>(result.operations));
+  value.insert("mean_ns", result.mean);
+  value.insert("min_ns", result.min);
+  value.insert("p50_ns", result.p50);
+  value.insert("p90_ns", result.p90);
+  value.insert("p99_ns", result.p99);
+  value.insert("max_ns", result.max);
+
+  JsonValue scaling(JsonValue::ARRAY);
+  for (const auto& point : result.scaling)
+  {
+    JsonValue entry(JsonValue::OBJECT);
+    entry.insert("threads", static_cast<JsonValue::Integer>(point.first));
+    entry.insert("ops_per_second", point.second);
+    scaling.pushBack(std::move(entry));
+  }
+  value.insert("scaling", std::move(scaling));
+
+  return value;
+}
+
+void printUsage()
+{
+  std::cout << "Usage: cryptobench [options]\n\n"
+    << "  --json              Print the results as JSON\n"
+    << "  --threads <n>       Highest thread count for the scaling runs (default: all cores)\n"
+    << "  --no-scaling        Skip the multi-threaded runs\n"
+    << "  --seconds <s>       Time spent on each measurement (default: 1)\n"
+    << "  --filter <text>     Only run benchmarks whose name contains text\n"
+    << "  --backend <name>    crypto_ops backend, ref10 or fe51\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  options.maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  try
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--json")
+      {
+        options.json = true;
+      }
+      else if (arg == "--no-scaling")
+      {
+        options.scaling = false;
+      }
+      else if (arg == "--threads" && hasValue)
+      {
+        options.maxThreads = std::max(1, std::stoi(argv[++i]));
+      }
+      else if (arg == "--seconds" && hasValue)
+      {
+        options.seconds = std::stod(argv[++i]);
+      }
+      else if (arg == "--filter" && hasValue)
+      {
+        options.filter = argv[++i];
+      }
+      else if (arg == "--backend" && hasValue)
+      {
+        const std::string name = argv[++i];
+        const int backend = name == "fe51" ? CRYPTO_OPS_BACKEND_FE51 : CRYPTO_OPS_BACKEND_REF10;
+        if ((name != "fe51" && name != "ref10") || crypto_ops_set_backend(backend) != 0)
+        {
+          throw std::runtime_error("Backend " + name + " is not available");
+        }
+      }
+      else
+      {
+        printUsage();
+        return arg == "--help" ? 0 : 1;
+      }
+    }
+
+    const std::string backend = crypto_ops_get_backend() == CRYPTO_OPS_BACKEND_FE51 ? "fe51" : "ref10";
+    JsonValue results(JsonValue::ARRAY);
+
+    if (!options.json)
+    {
+      std::cout << "crypto_ops backend: " << backend << ", hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+    }
+
+    for (const auto& benchmark : makeBenchmarks())
+    {
+      if (benchmark.name.find(options.filter) == std::string::npos)
+      {
+        continue;
+      }
+
+      const Result result = run(benchmark, options);
+
+      if (options.json)
+      {
+        results.pushBack(toJson(result));
+      }
+      else
+      {
+        printText(result);
+      }
+    }
+
+    if (options.json)
+    {
+      JsonValue report(JsonValue::OBJECT);
+      report.insert("crypto_ops_backend", backend);
+      report.insert("hardware_threads", static_cast<JsonValue::Integer>(std::thread::hardware_concurrency()));
+      report.insert("benchmarks", std::move(results));
+      std::cout << report << std::endl;
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::cout << "Something went terribly wrong...\n" << e.what() << "\n\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -14,6 +14,7 @@
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Common/ShuffleGenerator.h"
+#include "Common/Trace.h"
 
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
 #include "CryptoNoteCore/CryptoNoteSerialization.h"
@@ -130,6 +131,7 @@ void BlockchainCache::pushBlock(const CachedBlock& cachedBlock,
                                 const std::vector<CachedTransaction>& cachedTransactions,
                                 const TransactionValidatorState& validatorState, size_t blockSize,
                                 uint64_t generatedCoins, uint64_t blockDifficulty, RawBlock&& rawBlock) {
+  TRACE_SPAN("BlockchainCache::pushBlock");
   //we have to call this function from constructor so it has to be non-virtual
   doPushBlock(cachedBlock, cachedTransactions, validatorState, blockSize, generatedCoins, blockDifficulty, std::move(rawBlock));
 }
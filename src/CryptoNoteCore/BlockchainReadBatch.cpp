@@ -117,6 +117,11 @@ BlockchainReadBatch& BlockchainReadBatch::requestTransactionsCount() {
   return *this;
 }
 
+BlockchainReadBatch& BlockchainReadBatch::requestRawBlocksCount() {
+  state.rawBlocksCount.second = true;
+  return *this;
+}
+
 BlockchainReadBatch& BlockchainReadBatch::requestKeyOutputInfo(IBlockchainCache::Amount amount, IBlockchainCache::GlobalOutputIndex globalIndex) {
   state.keyOutputKeys.emplace(std::make_pair(amount, globalIndex), KeyOutputInfo{});
   return *this;
@@ -127,6 +132,7 @@ BlockchainReadResult BlockchainReadBatch::extractResult() {
   auto st = std::move(state);
   state.lastBlockIndex = {0, false};
   state.keyOutputAmountsCount = {{}, false};
+  state.rawBlocksCount = {0, false};
 
   resultSubmitted = false;
   return BlockchainReadResult(st);
@@ -164,6 +170,10 @@ std::vector<std::string> BlockchainReadBatch::getRawKeys() const {
     rawKeys.emplace_back(DB::serializeKey(DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX, DB::TRANSACTIONS_COUNT_KEY));
   }
 
+  if (state.rawBlocksCount.second) {
+    rawKeys.emplace_back(DB::serializeKey(DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, DB::RAW_BLOCKS_COUNT_KEY));
+  }
+
   assert(!rawKeys.empty());
   return rawKeys;
 }
@@ -212,6 +222,10 @@ const std::unordered_map<uint32_t, RawBlock>& BlockchainReadResult::getRawBlocks
   return state.rawBlocks;
 }
 
+std::unordered_map<uint32_t, RawBlock> BlockchainReadResult::extractRawBlocks() {
+  return std::move(state.rawBlocks);
+}
+
 const std::pair<uint32_t, bool>& BlockchainReadResult::getLastBlockIndex() const {
   return state.lastBlockIndex;
 }
@@ -244,6 +258,10 @@ const std::pair<uint64_t, bool>& BlockchainReadResult::getTransactionsCount() co
   return state.transactionsCount;
 }
 
+const std::pair<uint32_t, bool>& BlockchainReadResult::getRawBlocksCount() const {
+  return state.rawBlocksCount;
+}
+
 const KeyOutputKeyResult& BlockchainReadResult::getKeyOutputInfo() const {
   return state.keyOutputKeys;
 }
@@ -273,6 +291,7 @@ void BlockchainReadBatch::submitRawResult(const std::vector<std::string>& values
   DB::deserializeValue(state.lastBlockIndex, iter, DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX);
   DB::deserializeValue(state.keyOutputAmountsCount, iter, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX);
   DB::deserializeValue(state.transactionsCount, iter, DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX);
+  DB::deserializeValue(state.rawBlocksCount, iter, DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX);
 
   assert(iter == range.end());
   
@@ -297,7 +316,8 @@ keyOutputAmountsCount(std::move(state.keyOutputAmountsCount)),
 keyOutputAmounts(std::move(state.keyOutputAmounts)),
 transactionCountsByPaymentIds(std::move(state.transactionCountsByPaymentIds)),
 transactionHashesByPaymentIds(std::move(state.transactionHashesByPaymentIds)),
-transactionsCount(std::move(state.transactionsCount)) {
+transactionsCount(std::move(state.transactionsCount)),
+rawBlocksCount(std::move(state.rawBlocksCount)) {
 }
 
 size_t BlockchainReadState::size() const {
@@ -318,7 +338,8 @@ size_t BlockchainReadState::size() const {
     keyOutputKeys.size() +
     (lastBlockIndex.second ? 1 : 0) +
     (keyOutputAmountsCount.second ? 1 : 0) +
-    (transactionsCount.second ? 1 : 0);
+    (transactionsCount.second ? 1 : 0) +
+    (rawBlocksCount.second ? 1 : 0);
 }
 
 BlockchainReadResult::BlockchainReadResult(BlockchainReadResult&& result) : state(std::move(result.state)) {
@@ -72,6 +72,7 @@ struct BlockchainReadState {
   std::pair<uint32_t, bool> lastBlockIndex = { 0, false };
   std::pair<uint32_t, bool> keyOutputAmountsCount = { {}, false };
   std::pair<uint64_t, bool> transactionsCount = { 0, false };
+  std::pair<uint32_t, bool> rawBlocksCount = { 0, false };
 
   BlockchainReadState() = default;
   BlockchainReadState(const BlockchainReadState&) = default;
@@ -96,6 +97,8 @@ public:
   const std::unordered_map<IBlockchainCache::Amount, uint32_t>& getKeyOutputGlobalIndexesCountForAmounts() const;
   const std::unordered_map<std::pair<IBlockchainCache::Amount, uint32_t>, PackedOutIndex>& getKeyOutputGlobalIndexesForAmounts() const;
   const std::unordered_map<uint32_t, RawBlock>& getRawBlocks() const;
+  //moves the raw blocks out of the result, which has none afterwards
+  std::unordered_map<uint32_t, RawBlock> extractRawBlocks();
   const std::pair<uint32_t, bool>& getLastBlockIndex() const;
   const std::unordered_map<uint64_t, uint32_t>& getClosestTimestampBlockIndex() const;
   uint32_t getKeyOutputAmountsCount() const;
@@ -104,6 +107,7 @@ public:
   const std::unordered_map<std::pair<Crypto::Hash, uint32_t>, Crypto::Hash>& getTransactionHashesByPaymentIds() const;
   const std::unordered_map<uint64_t, std::vector<Crypto::Hash> >& getBlockHashesByTimestamp() const;
   const std::pair<uint64_t, bool>& getTransactionsCount() const;
+  const std::pair<uint32_t, bool>& getRawBlocksCount() const;
   const KeyOutputKeyResult& getKeyOutputInfo() const;
 
 private:
@@ -132,6 +136,7 @@ public:
   BlockchainReadBatch& requestTransactionHashByPaymentId(const Crypto::Hash& paymentId, uint32_t transactionIndexWithinPaymentId);
   BlockchainReadBatch& requestBlockHashesByTimestamp(uint64_t timestamp);
   BlockchainReadBatch& requestTransactionsCount();
+  BlockchainReadBatch& requestRawBlocksCount();
   BlockchainReadBatch& requestKeyOutputInfo(IBlockchainCache::Amount amount, IBlockchainCache::GlobalOutputIndex globalIndex);
 
   std::vector<std::string> getRawKeys() const override;
@@ -44,9 +44,10 @@ BlockchainWriteBatch& BlockchainWriteBatch::insertCachedTransaction(const Extend
   return *this;
 }
 
-BlockchainWriteBatch& BlockchainWriteBatch::insertPaymentId(const Crypto::Hash& transactionHash, const Crypto::Hash paymentId, uint32_t totalTxsCountForPaymentId) {
-  rawDataToInsert.emplace_back(DB::serialize(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, paymentId, totalTxsCountForPaymentId));
-  rawDataToInsert.emplace_back(DB::serialize(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, std::make_pair(paymentId, totalTxsCountForPaymentId - 1), transactionHash));
+BlockchainWriteBatch& BlockchainWriteBatch::insertPaymentId(const Crypto::Hash& transactionHash, const Crypto::Hash paymentId, uint32_t writtenTxsCountForPaymentId) {
+  uint32_t index = writtenTxsCountForPaymentId + insertedTxsCountsForPaymentIds[paymentId]++;
+  rawDataToMerge.emplace_back(DB::serializeKey(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, paymentId), DB::addOperand(1));
+  rawDataToInsert.emplace_back(DB::serialize(DB::PAYMENT_ID_TO_TX_HASH_PREFIX, std::make_pair(paymentId, index), transactionHash));
   return *this;
 }
 
@@ -76,8 +77,14 @@ BlockchainWriteBatch& BlockchainWriteBatch::insertRawBlock(uint32_t blockIndex,
   return *this;
 }
 
+BlockchainWriteBatch& BlockchainWriteBatch::insertRawBlocksCount(uint32_t rawBlocksCount) {
+  rawDataToInsert.emplace_back(DB::serialize(DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, DB::RAW_BLOCKS_COUNT_KEY, rawBlocksCount));
+  return *this;
+}
+
 BlockchainWriteBatch& BlockchainWriteBatch::insertClosestTimestampBlockIndex(uint64_t timestamp, uint32_t blockIndex) {
-  rawDataToInsert.emplace_back(DB::serialize(DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, timestamp, blockIndex));
+  rawDataToMerge.emplace_back(DB::serializeKey(DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, timestamp),
+    DB::keepFirstOperand(DB::serialize(blockIndex, DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX)));
   return *this;
 }
 
@@ -99,6 +106,12 @@ BlockchainWriteBatch& BlockchainWriteBatch::insertTimestamp(uint64_t timestamp,
   return *this;
 }
 
+BlockchainWriteBatch& BlockchainWriteBatch::insertTimestampBlockHash(uint64_t timestamp, const Crypto::Hash& blockHash) {
+  rawDataToMerge.emplace_back(DB::serializeKey(DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX, timestamp),
+    DB::appendOperand(DB::serialize(blockHash, DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX)));
+  return *this;
+}
+
 BlockchainWriteBatch& BlockchainWriteBatch::insertKeyOutputInfo(IBlockchainCache::Amount amount, IBlockchainCache::GlobalOutputIndex globalIndex,
                                                             const KeyOutputInfo& outputInfo) {
   rawDataToInsert.emplace_back(DB::serialize(DB::KEY_OUTPUT_KEY_PREFIX, std::make_pair(amount, globalIndex), outputInfo));
@@ -150,6 +163,11 @@ BlockchainWriteBatch& BlockchainWriteBatch::removeRawBlock(uint32_t blockIndex)
   return *this;
 }
 
+BlockchainWriteBatch& BlockchainWriteBatch::removeRawBlocksCount() {
+  rawKeysToRemove.emplace_back(DB::serializeKey(DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, DB::RAW_BLOCKS_COUNT_KEY));
+  return *this;
+}
+
 BlockchainWriteBatch& BlockchainWriteBatch::removeClosestTimestampBlockIndex(uint64_t timestamp) {
   rawKeysToRemove.emplace_back(DB::serializeKey(DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, timestamp));
   return *this;
@@ -182,3 +200,7 @@ std::vector<std::pair<std::string, std::string>> BlockchainWriteBatch::extractRa
 std::vector<std::string> BlockchainWriteBatch::extractRawKeysToRemove() {
   return std::move(rawKeysToRemove);
 }
+
+std::vector<std::pair<std::string, std::string>> BlockchainWriteBatch::extractRawDataToMerge() {
+  return std::move(rawDataToMerge);
+}
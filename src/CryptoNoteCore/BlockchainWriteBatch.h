@@ -32,13 +32,18 @@ public:
 
   BlockchainWriteBatch& insertSpentKeyImages(uint32_t blockIndex, const std::unordered_set<Crypto::KeyImage>& spentKeyImages);
   BlockchainWriteBatch& insertCachedTransaction(const ExtendedTransactionInfo& transaction, uint64_t totalTxsCount);
-  BlockchainWriteBatch& insertPaymentId(const Crypto::Hash& transactionHash, const Crypto::Hash paymentId, uint32_t totalTxsCountForPaymentId);
+  //writtenTxsCountForPaymentId doesn't count the transactions inserted in this batch
+  BlockchainWriteBatch& insertPaymentId(const Crypto::Hash& transactionHash, const Crypto::Hash paymentId, uint32_t writtenTxsCountForPaymentId);
   BlockchainWriteBatch& insertCachedBlock(const CachedBlockInfo& block, uint32_t blockIndex, const std::vector<Crypto::Hash>& blockTxs);
   BlockchainWriteBatch& insertKeyOutputGlobalIndexes(IBlockchainCache::Amount amount, const std::vector<PackedOutIndex>& outputs, uint32_t totalOutputsCountForAmount);
   BlockchainWriteBatch& insertRawBlock(uint32_t blockIndex, const RawBlock& block);
+  BlockchainWriteBatch& insertRawBlocksCount(uint32_t rawBlocksCount);
+  //keeps the block index already written for timestamp, if there is one
   BlockchainWriteBatch& insertClosestTimestampBlockIndex(uint64_t timestamp, uint32_t blockIndex);
   BlockchainWriteBatch& insertKeyOutputAmounts(const std::set<IBlockchainCache::Amount>& amounts, uint32_t totalKeyOutputAmountsCount);
   BlockchainWriteBatch& insertTimestamp(uint64_t timestamp, const std::vector<Crypto::Hash>& blockHashes);
+  //appends to the block hashes already written for timestamp
+  BlockchainWriteBatch& insertTimestampBlockHash(uint64_t timestamp, const Crypto::Hash& blockHash);
   BlockchainWriteBatch& insertKeyOutputInfo(IBlockchainCache::Amount amount, IBlockchainCache::GlobalOutputIndex globalIndex, const KeyOutputInfo& outputInfo);
 
   BlockchainWriteBatch& removeSpentKeyImages(uint32_t blockIndex, const std::vector<Crypto::KeyImage>& spentKeyImages);
@@ -47,6 +52,7 @@ public:
   BlockchainWriteBatch& removeCachedBlock(const Crypto::Hash& blockHash, uint32_t blockIndex);
   BlockchainWriteBatch& removeKeyOutputGlobalIndexes(IBlockchainCache::Amount amount, uint32_t outputsToRemoveCount, uint32_t totalOutputsCountForAmount);
   BlockchainWriteBatch& removeRawBlock(uint32_t blockIndex);
+  BlockchainWriteBatch& removeRawBlocksCount();
   BlockchainWriteBatch& removeClosestTimestampBlockIndex(uint64_t timestamp);
   BlockchainWriteBatch& removeTimestamp(uint64_t timestamp);
   BlockchainWriteBatch& removeKeyOutputAmounts(uint32_t keyOutputAmountsToRemoveCount, uint32_t totalKeyOutputAmountsCount);
@@ -54,9 +60,12 @@ public:
 
   std::vector<std::pair<std::string, std::string>> extractRawDataToInsert() override;
   std::vector<std::string> extractRawKeysToRemove() override;
+  std::vector<std::pair<std::string, std::string>> extractRawDataToMerge() override;
 private:
   std::vector<std::pair<std::string, std::string>> rawDataToInsert;
   std::vector<std::string> rawKeysToRemove;
+  std::vector<std::pair<std::string, std::string>> rawDataToMerge;
+  std::unordered_map<Crypto::Hash, uint32_t> insertedTxsCountsForPaymentIds;
 };
 
 }
@@ -46,28 +46,90 @@ const Crypto::Hash& CachedBlock::getBlockHash() const {
   return blockHash.get();
 }
 
+const BinaryArray& CachedBlock::getLongHashingBinaryArray(int& light, int& variant) const {
+  if (block.majorVersion == BLOCK_MAJOR_VERSION_1) {
+    light = 0;
+    variant = 0;
+    return getBlockHashingBinaryArray();
+  } else if ((block.majorVersion == BLOCK_MAJOR_VERSION_2) || (block.majorVersion == BLOCK_MAJOR_VERSION_3)) {
+    light = 0;
+    variant = 0;
+    return getParentBlockHashingBinaryArray(true);
+  } else if (block.majorVersion >= BLOCK_MAJOR_VERSION_4) {
+    light = 1;
+    variant = 1;
+    return getParentBlockHashingBinaryArray(true);
+  } else {
+    throw std::runtime_error("Unknown block major version.");
+  }
+}
+
 const Crypto::Hash& CachedBlock::getBlockLongHash() const {
   if (!blockLongHash.is_initialized()) {
-    if (block.majorVersion == BLOCK_MAJOR_VERSION_1) {
-      const auto& rawHashingBlock = getBlockHashingBinaryArray();
-      blockLongHash = Hash();
-      cn_slow_hash_v0(rawHashingBlock.data(), rawHashingBlock.size(), blockLongHash.get());
-    } else if ((block.majorVersion == BLOCK_MAJOR_VERSION_2) || (block.majorVersion == BLOCK_MAJOR_VERSION_3)) {
-      const auto& rawHashingBlock = getParentBlockHashingBinaryArray(true);
-      blockLongHash = Hash();
-      cn_slow_hash_v0(rawHashingBlock.data(), rawHashingBlock.size(), blockLongHash.get());
-    } else if (block.majorVersion >= BLOCK_MAJOR_VERSION_4) {
-      const auto& rawHashingBlock = getParentBlockHashingBinaryArray(true);
-      blockLongHash = Hash();
-      cn_lite_slow_hash_v1(rawHashingBlock.data(), rawHashingBlock.size(), blockLongHash.get());
-    } else {
-      throw std::runtime_error("Unknown block major version.");
-    }
+    int light;
+    int variant;
+    const auto& rawHashingBlock = getLongHashingBinaryArray(light, variant);
+    blockLongHash = Hash();
+    cn_slow_hash(rawHashingBlock.data(), rawHashingBlock.size(), reinterpret_cast<char *>(&blockLongHash.get()), light, variant, 0);
   }
 
   return blockLongHash.get();
 }
 
+const Crypto::Hash& CachedBlock::getBlockLongHash(Crypto::SlowHashContext& context) const {
+  const CachedBlock* self = this;
+  getBlockLongHashes(&self, 1, context);
+  return blockLongHash.get();
+}
+
+void CachedBlock::getBlockLongHashes(const CachedBlock* const* blocks, size_t count, Crypto::SlowHashContext& context) {
+  std::vector<const CachedBlock*> pending;
+  std::vector<const void*> data;
+  std::vector<size_t> lengths;
+  std::vector<Hash> hashes;
+  int pendingLight = 0;
+  int pendingVariant = 0;
+
+  auto flush = [&] {
+    if (pending.empty()) {
+      return;
+    }
+
+    hashes.resize(pending.size());
+    cn_slow_hash_multi(context, data.data(), lengths.data(), hashes.data(), pending.size(), pendingLight, pendingVariant);
+    for (size_t i = 0; i < pending.size(); ++i) {
+      pending[i]->blockLongHash = hashes[i];
+    }
+
+    pending.clear();
+    data.clear();
+    lengths.clear();
+  };
+
+  // blocks can only share a call when they use the same hash variant
+  for (size_t i = 0; i < count; ++i) {
+    const CachedBlock& cachedBlock = *blocks[i];
+    if (cachedBlock.blockLongHash.is_initialized()) {
+      continue;
+    }
+
+    int light;
+    int variant;
+    const auto& rawHashingBlock = cachedBlock.getLongHashingBinaryArray(light, variant);
+    if (!pending.empty() && (light != pendingLight || variant != pendingVariant || pending.size() == context.ways())) {
+      flush();
+    }
+
+    pending.push_back(&cachedBlock);
+    data.push_back(rawHashingBlock.data());
+    lengths.push_back(rawHashingBlock.size());
+    pendingLight = light;
+    pendingVariant = variant;
+  }
+
+  flush();
+}
+
 const Crypto::Hash& CachedBlock::getAuxiliaryBlockHeaderHash() const {
   if (!auxiliaryBlockHeaderHash.is_initialized()) {
     auxiliaryBlockHeaderHash = getObjectHash(getBlockHashingBinaryArray());
@@ -9,6 +9,8 @@
 #include <boost/optional.hpp>
 #include <CryptoNote.h>
 
+#include "crypto/hash.h"
+
 namespace CryptoNote {
 
 class CachedBlock {
@@ -18,6 +20,9 @@ public:
   const Crypto::Hash& getTransactionTreeHash() const;
   const Crypto::Hash& getBlockHash() const;
   const Crypto::Hash& getBlockLongHash() const;
+  const Crypto::Hash& getBlockLongHash(Crypto::SlowHashContext& context) const;
+  /* Computes the long hashes of several blocks, up to context.ways() at a time */
+  static void getBlockLongHashes(const CachedBlock* const* blocks, size_t count, Crypto::SlowHashContext& context);
   const Crypto::Hash& getAuxiliaryBlockHeaderHash() const;
   const BinaryArray& getBlockHashingBinaryArray() const;
   const BinaryArray& getParentBlockBinaryArray(bool headerOnly) const;
@@ -25,6 +30,8 @@ public:
   uint32_t getBlockIndex() const;
 
 private:
+  const BinaryArray& getLongHashingBinaryArray(int& light, int& variant) const;
+
   const BlockTemplate& block;
   mutable boost::optional<BinaryArray> blockHashingBinaryArray;
   mutable boost::optional<BinaryArray> parentBlockBinaryArray;
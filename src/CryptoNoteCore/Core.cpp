@@ -13,6 +13,7 @@
 #include "Common/ShuffleGenerator.h"
 #include "Common/Math.h"
 #include "Common/MemoryInputStream.h"
+#include "Common/Trace.h"
 #include "CryptoNoteTools.h"
 #include "CryptoNoteFormatUtils.h"
 #include "BlockchainCache.h"
@@ -185,7 +186,8 @@ Core::Core(const Currency& currency, Logging::ILogger& logger, Checkpoints&& che
            std::unique_ptr<IBlockchainCacheFactory>&& blockchainCacheFactory, std::unique_ptr<IMainChainStorage>&& mainchainStorage)
     : currency(currency), dispatcher(dispatcher), contextGroup(dispatcher), logger(logger, "Core"), checkpoints(std::move(checkpoints)),
       upgradeManager(new UpgradeManager()), blockchainCacheFactory(std::move(blockchainCacheFactory)),
-      mainChainStorage(std::move(mainchainStorage)), initialized(false) {
+      mainChainStorage(std::move(mainchainStorage)), initialized(false),
+      signatureCache(TRANSACTION_SIGNATURE_CACHE_SIZE) {
 
   upgradeManager->addMajorBlockVersion(BLOCK_MAJOR_VERSION_2, currency.upgradeHeight(BLOCK_MAJOR_VERSION_2));
   upgradeManager->addMajorBlockVersion(BLOCK_MAJOR_VERSION_3, currency.upgradeHeight(BLOCK_MAJOR_VERSION_3));
@@ -212,6 +214,7 @@ bool Core::removeMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) {
 }
 
 bool Core::notifyObservers(BlockchainMessage&& msg) /* noexcept */ {
+  TRACE_SPAN("Core::notifyObservers");
   try {
     for (auto& queue : queueList) {
       queue.push(std::move(msg));
@@ -531,6 +534,7 @@ std::vector<Crypto::Hash> Core::findBlockchainSupplement(const std::vector<Crypt
 }
 
 std::error_code Core::addBlock(const CachedBlock& cachedBlock, RawBlock&& rawBlock) {
+  TRACE_SPAN("Core::addBlock");
   throwIfNotInitialized();
   uint32_t blockIndex = cachedBlock.getBlockIndex();
   Crypto::Hash blockHash = cachedBlock.getBlockHash();
@@ -774,18 +778,20 @@ void Core::actualizePoolTransactions() {
 }
 
 void Core::actualizePoolTransactionsLite(const TransactionValidatorState& validatorState) {
+  TRACE_SPAN("Core::actualizePoolTransactionsLite");
   auto& pool = *transactionPool;
-  auto hashes = pool.getTransactionHashes();
+  auto hashes = pool.getConflictingTransactionHashes(validatorState);
+  auto oversizedHashes = pool.getTransactionHashesLargerThan(getMaximumTransactionAllowedSize(blockMedianSize, currency));
+  hashes.insert(hashes.end(), oversizedHashes.begin(), oversizedHashes.end());
 
   for (auto& hash : hashes) {
-    auto tx = pool.getTransaction(hash);
-
-    auto txState = extractSpentOutputs(tx);
-
-    if (hasIntersections(validatorState, txState) || tx.getTransactionBinaryArray().size() > getMaximumTransactionAllowedSize(blockMedianSize, currency)) {
-      pool.removeTransaction(hash);
-      notifyObservers(makeDelTransactionMessage({ hash }, Messages::DeleteTransaction::Reason::NotActual));
+    // a transaction can be both conflicting and oversized
+    if (!pool.checkIfTransactionPresent(hash)) {
+      continue;
     }
+
+    pool.removeTransaction(hash);
+    notifyObservers(makeDelTransactionMessage({ hash }, Messages::DeleteTransaction::Reason::NotActual));
   }
 }
 
@@ -1279,6 +1285,7 @@ std::vector<Transaction> Core::getPoolTransactions() const {
 
 bool Core::extractTransactions(const std::vector<BinaryArray>& rawTransactions,
                                std::vector<CachedTransaction>& transactions, uint64_t& cumulativeSize) {
+  TRACE_SPAN("Core::extractTransactions");
   try {
     for (auto& rawTransaction : rawTransactions) {
       if (rawTransaction.size() > currency.maxTxSize()) {
@@ -1299,6 +1306,7 @@ bool Core::extractTransactions(const std::vector<BinaryArray>& rawTransactions,
 
 std::error_code Core::validateTransaction(const CachedTransaction& cachedTransaction, TransactionValidatorState& state,
                                           IBlockchainCache* cache, uint64_t& fee, uint32_t blockIndex) {
+  TRACE_SPAN("Core::validateTransaction");
   // TransactionValidatorState currentState;
   const auto& transaction = cachedTransaction.getTransaction();
 auto error = validateSemantic(transaction, fee, blockIndex);
@@ -1306,17 +1314,33 @@ auto error = validateSemantic(transaction, fee, blockIndex);
     return error;
   }
 
+  /* Ring signatures are collected and checked together once the rest of the
+     inputs are validated. Checking stops at the first input that fails for
+     another reason, and only the rings before it are verified, so the error
+     returned is the same as checking every input in turn. */
+  std::vector<std::vector<PublicKey>> ringKeys;
+  std::vector<std::vector<const PublicKey*>> ringKeyPointers;
+  std::vector<Crypto::RingSignatureInput> rings;
+  ringKeys.reserve(transaction.inputs.size());
+  ringKeyPointers.reserve(transaction.inputs.size());
+  rings.reserve(transaction.inputs.size());
+
+  const bool checkKeyImage = blockIndex > parameters::KEY_IMAGE_CHECKING_BLOCK_INDEX;
+  std::error_code inputError = error::TransactionValidationError::VALIDATION_SUCCESS;
+
   size_t inputIndex = 0;
   for (const auto& input : transaction.inputs) {
     if (input.type() == typeid(KeyInput)) {
       const KeyInput& in = boost::get<KeyInput>(input);
       if (!state.spentKeyImages.insert(in.keyImage).second) {
-        return error::TransactionValidationError::INPUT_KEYIMAGE_ALREADY_SPENT;
+        inputError = error::TransactionValidationError::INPUT_KEYIMAGE_ALREADY_SPENT;
+        break;
       }
 
       if (!checkpoints.isInCheckpointZone(blockIndex + 1)) {
         if (cache->checkIfSpent(in.keyImage, blockIndex)) {
-          return error::TransactionValidationError::INPUT_KEYIMAGE_ALREADY_SPENT;
+          inputError = error::TransactionValidationError::INPUT_KEYIMAGE_ALREADY_SPENT;
+          break;
         }
 
         std::vector<PublicKey> outputKeys;
@@ -1330,32 +1354,58 @@ auto error = validateSemantic(transaction, fee, blockIndex);
 
         auto result = cache->extractKeyOutputKeys(in.amount, blockIndex, {globalIndexes.data(), globalIndexes.size()}, outputKeys);
         if (result == ExtractOutputKeysResult::INVALID_GLOBAL_INDEX) {
-          return error::TransactionValidationError::INPUT_INVALID_GLOBAL_INDEX;
+          inputError = error::TransactionValidationError::INPUT_INVALID_GLOBAL_INDEX;
+          break;
         }
 
         if (result == ExtractOutputKeysResult::OUTPUT_LOCKED) {
-          return error::TransactionValidationError::INPUT_SPEND_LOCKED_OUT;
+          inputError = error::TransactionValidationError::INPUT_SPEND_LOCKED_OUT;
+          break;
         }
 
-        std::vector<const Crypto::PublicKey*> outputKeyPointers;
-        outputKeyPointers.reserve(outputKeys.size());
-        std::for_each(outputKeys.begin(), outputKeys.end(), [&outputKeyPointers] (const Crypto::PublicKey& key) { outputKeyPointers.push_back(&key); });
-        if (!Crypto::check_ring_signature(cachedTransaction.getTransactionPrefixHash(), in.keyImage, outputKeyPointers.data(),
-                                          outputKeyPointers.size(), transaction.signatures[inputIndex].data(),
-                                          blockIndex > parameters::KEY_IMAGE_CHECKING_BLOCK_INDEX)) {
-          return error::TransactionValidationError::INPUT_INVALID_SIGNATURES;
-        }
+        ringKeys.push_back(std::move(outputKeys));
+        ringKeyPointers.emplace_back();
+        std::vector<const Crypto::PublicKey*>& outputKeyPointers = ringKeyPointers.back();
+        outputKeyPointers.reserve(ringKeys.back().size());
+        std::for_each(ringKeys.back().begin(), ringKeys.back().end(), [&outputKeyPointers] (const Crypto::PublicKey& key) { outputKeyPointers.push_back(&key); });
+        rings.push_back({&cachedTransaction.getTransactionPrefixHash(), &in.keyImage, outputKeyPointers.data(),
+                         outputKeyPointers.size(), transaction.signatures[inputIndex].data(), checkKeyImage});
       }
 
     } else {
       assert(false);
-      return error::TransactionValidationError::INPUT_UNKNOWN_TYPE;
+      inputError = error::TransactionValidationError::INPUT_UNKNOWN_TYPE;
+      break;
     }
 
     inputIndex++;
   }
 
-  return error::TransactionValidationError::VALIDATION_SUCCESS;
+  if (rings.empty()) {
+    return inputError;
+  }
+
+  /* Only a transaction whose every ring was collected can be remembered as
+     correctly signed; key images and outputs were still checked above */
+  const bool allRings = inputError == error::TransactionValidationError::VALIDATION_SUCCESS;
+  Crypto::Hash signatureKey;
+  if (allRings) {
+    signatureKey = SignatureCache::getKey(cachedTransaction.getTransactionHash(), ringKeys, checkKeyImage);
+    if (signatureCache.contains(signatureKey)) {
+      return inputError;
+    }
+  }
+
+  size_t failedRing;
+  if (!Crypto::check_ring_signatures(rings, failedRing)) {
+    return error::TransactionValidationError::INPUT_INVALID_SIGNATURES;
+  }
+
+  if (allRings) {
+    signatureCache.insert(signatureKey);
+  }
+
+  return inputError;
 }
 
 std::error_code Core::validateSemantic(const Transaction& transaction, uint64_t& fee, uint32_t blockIndex) {
@@ -1453,6 +1503,7 @@ std::vector<Crypto::Hash> CryptoNote::Core::getBlockHashes(uint32_t startBlockIn
 }
 
 std::error_code Core::validateBlock(const CachedBlock& cachedBlock, IBlockchainCache* cache, uint64_t& minerReward) {
+  TRACE_SPAN("Core::validateBlock");
   const auto& block = cachedBlock.getBlock();
   auto previousBlockIndex = cache->getBlockIndex(block.previousBlockHash);
   // assert(block.previousBlockHash == cache->getBlockHash(previousBlockIndex));
@@ -1535,6 +1586,10 @@ const Currency& Core::getCurrency() const {
   return currency;
 }
 
+const Checkpoints& Core::getCheckpoints() const {
+  return checkpoints;
+}
+
 void Core::save() {
   throwIfNotInitialized();
 
@@ -23,6 +23,7 @@
 #include "IUpgradeManager.h"
 #include <Logging/LoggerMessage.h>
 #include "MessageQueue.h"
+#include "SignatureCache.h"
 #include "TransactionValidatiorState.h"
 #include "SwappedVector.h"
 
@@ -96,6 +97,7 @@ public:
   virtual std::vector<Transaction> getPoolTransactions() const override;
 
   const Currency& getCurrency() const;
+  const Checkpoints& getCheckpoints() const;
 
   virtual void save() override;
   virtual void load() override;
@@ -127,6 +129,7 @@ private:
   std::unique_ptr<IBlockchainCacheFactory> blockchainCacheFactory;
   std::unique_ptr<IMainChainStorage> mainChainStorage;
   bool initialized;
+  SignatureCache signatureCache;
 
   time_t start_time;
 
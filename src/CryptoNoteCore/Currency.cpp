@@ -11,6 +11,7 @@
 #include "../Common/Base58.h"
 #include "../Common/int-util.h"
 #include "../Common/StringTools.h"
+#include "../Common/Trace.h"
 
 #include "Account.h"
 #include "CheckDifficulty.h"
@@ -610,6 +611,7 @@ bool Currency::checkProofOfWorkV2(const CachedBlock& cachedBlock, uint64_t curre
 }
 
 bool Currency::checkProofOfWork(const CachedBlock& block, uint64_t currentDiffic) const {
+  TRACE_SPAN("Currency::checkProofOfWork");
   switch (block.getBlock().majorVersion) {
   case BLOCK_MAJOR_VERSION_1:
     return checkProofOfWorkV1(block, currentDiffic);
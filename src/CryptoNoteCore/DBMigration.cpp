@@ -0,0 +1,266 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "DBMigration.h"
+
+#include <system_error>
+
+#include "Common/MemoryInputStream.h"
+#include "Common/StringOutputStream.h"
+#include "CryptoNoteCore/DBUtils.h"
+#include "IWriteBatch.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/KVBinaryCommon.h"
+#include "Serialization/KVBinaryInputStreamSerializer.h"
+#include "Serialization/KVBinaryOutputStreamSerializer.h"
+
+#include <Logging/LoggerRef.h>
+
+using namespace Logging;
+
+namespace CryptoNote {
+namespace DB {
+
+namespace {
+
+const size_t MIGRATION_BATCH_SIZE = 10000;
+
+// The name of the only entry of the root section, which is the key prefix,
+// follows the header and the entry count
+const size_t LEGACY_PREFIX_OFFSET = sizeof(KVBinaryStorageBlockHeader) + 2;
+
+class MigrationWriteBatch : public IWriteBatch {
+public:
+  virtual std::vector<std::pair<std::string, std::string>> extractRawDataToInsert() override {
+    return std::move(rawDataToInsert);
+  }
+
+  virtual std::vector<std::string> extractRawKeysToRemove() override {
+    return std::move(rawKeysToRemove);
+  }
+
+  size_t size() const {
+    return rawKeysToRemove.size();
+  }
+
+  std::vector<std::pair<std::string, std::string>> rawDataToInsert;
+  std::vector<std::string> rawKeysToRemove;
+};
+
+std::string legacyHeader() {
+  KVBinaryStorageBlockHeader header;
+  header.m_signature_a = PORTABLE_STORAGE_SIGNATUREA;
+  header.m_signature_b = PORTABLE_STORAGE_SIGNATUREB;
+  header.m_ver = PORTABLE_STORAGE_FORMAT_VER;
+  return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+template <class Value>
+std::string legacySerialize(const Value& value, const std::string& name) {
+  std::string serialized;
+  Common::StringOutputStream stream(serialized);
+  KVBinaryOutputStreamSerializer serializer;
+  serializer(const_cast<Value&>(value), name);
+  serializer.dump(stream);
+  return serialized;
+}
+
+template <class Value>
+void legacyDeserialize(const std::string& serialized, Value& value, const std::string& name) {
+  Common::MemoryInputStream stream(serialized.data(), serialized.size());
+  KVBinaryInputStreamSerializer serializer(stream);
+  serializer(value, name);
+}
+
+// Several key types share a prefix; the one that encodes back to exactly the
+// same bytes is the one the key was written with
+template <class Key>
+bool legacyDeserializeKey(const std::string& rawKey, const std::string& prefix, Key& key) {
+  std::pair<std::string, Key> decoded;
+  try {
+    legacyDeserialize(rawKey, decoded, prefix);
+  } catch (std::exception&) {
+    return false;
+  }
+
+  if (decoded.first != prefix || legacySerialize(decoded, prefix) != rawKey) {
+    return false;
+  }
+
+  key = decoded.second;
+  return true;
+}
+
+template <class Key, class Value>
+bool convert(const std::string& prefix, const std::string& rawKey, const std::string& rawValue, MigrationWriteBatch& batch) {
+  Key key;
+  if (!legacyDeserializeKey(rawKey, prefix, key)) {
+    return false;
+  }
+
+  Value value;
+  legacyDeserialize(rawValue, value, prefix);
+  batch.rawDataToInsert.emplace_back(DB::serialize(prefix, key, value));
+  return true;
+}
+
+// Raw blocks were already written with the binary serializer
+bool convertRawBlock(const std::string& rawKey, const std::string& rawValue, MigrationWriteBatch& batch) {
+  uint32_t blockIndex;
+  if (!legacyDeserializeKey(rawKey, BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, blockIndex)) {
+    return false;
+  }
+
+  batch.rawDataToInsert.emplace_back(DB::serializeKey(BLOCK_INDEX_TO_RAW_BLOCK_PREFIX, blockIndex), rawValue);
+  return true;
+}
+
+bool convert(const std::string& rawKey, const std::string& rawValue, MigrationWriteBatch& batch) {
+  if (rawKey.size() <= LEGACY_PREFIX_OFFSET) {
+    return false;
+  }
+
+  const std::string prefix = rawKey.substr(LEGACY_PREFIX_OFFSET, 1);
+  if (prefix == BLOCK_INDEX_TO_KEY_IMAGE_PREFIX) {
+    return convert<uint32_t, std::vector<Crypto::KeyImage>>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == BLOCK_INDEX_TO_TX_HASHES_PREFIX) {
+    return convert<uint32_t, std::vector<Crypto::Hash>>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == BLOCK_INDEX_TO_RAW_BLOCK_PREFIX) {
+    return convertRawBlock(rawKey, rawValue, batch);
+  } else if (prefix == BLOCK_HASH_TO_BLOCK_INDEX_PREFIX) {
+    return convert<Crypto::Hash, uint32_t>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == BLOCK_INDEX_TO_BLOCK_INFO_PREFIX) {
+    return convert<uint32_t, CachedBlockInfo>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == KEY_IMAGE_TO_BLOCK_INDEX_PREFIX) {
+    return convert<Crypto::KeyImage, uint32_t>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == BLOCK_INDEX_TO_BLOCK_HASH_PREFIX) {
+    return convert<std::string, uint32_t>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX) {
+    return convert<Crypto::Hash, ExtendedTransactionInfo>(prefix, rawKey, rawValue, batch) ||
+      convert<std::string, uint64_t>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == KEY_OUTPUT_AMOUNT_PREFIX) {
+    return convert<uint64_t, uint32_t>(prefix, rawKey, rawValue, batch) ||
+      convert<std::pair<uint64_t, uint32_t>, PackedOutIndex>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX) {
+    return convert<uint64_t, uint32_t>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == PAYMENT_ID_TO_TX_HASH_PREFIX) {
+    return convert<Crypto::Hash, uint32_t>(prefix, rawKey, rawValue, batch) ||
+      convert<std::pair<Crypto::Hash, uint32_t>, Crypto::Hash>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == TIMESTAMP_TO_BLOCKHASHES_PREFIX) {
+    return convert<uint64_t, std::vector<Crypto::Hash>>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == KEY_OUTPUT_AMOUNTS_COUNT_PREFIX) {
+    return convert<std::string, uint32_t>(prefix, rawKey, rawValue, batch) ||
+      convert<uint32_t, uint64_t>(prefix, rawKey, rawValue, batch);
+  } else if (prefix == KEY_OUTPUT_KEY_PREFIX) {
+    return convert<std::pair<uint64_t, uint32_t>, KeyOutputInfo>(prefix, rawKey, rawValue, batch);
+  }
+
+  return false;
+}
+
+}
+
+void migrateFromKVBinaryScheme(IDataBase& database, Logging::ILogger& _logger) {
+  LoggerRef logger(_logger, "DBMigration");
+
+  MigrationWriteBatch batch;
+  size_t migrated = 0;
+  size_t skipped = 0;
+  std::error_code writeError;
+
+  auto flush = [&] {
+    size_t count = batch.size();
+    writeError = database.write(batch);
+    batch = MigrationWriteBatch();
+    if (!writeError) {
+      migrated += count;
+      logger(INFO) << "Migrated " << migrated << " DB entries";
+    }
+  };
+
+  // Every legacy key starts with the KV binary header, no current key does
+  auto ec = database.iterate(legacyHeader(), [&] (const std::string& rawKey, const std::string& rawValue) {
+    if (!convert(rawKey, rawValue, batch)) {
+      // not something this scheme wrote, it stays where it is
+      ++skipped;
+      return true;
+    }
+
+    batch.rawKeysToRemove.push_back(rawKey);
+    if (batch.size() >= MIGRATION_BATCH_SIZE) {
+      flush();
+    }
+
+    return !writeError;
+  });
+
+  if (!ec && !writeError && batch.size() > 0) {
+    flush();
+  }
+
+  if (ec || writeError) {
+    throw std::system_error(ec ? ec : writeError);
+  }
+
+  if (skipped != 0) {
+    logger(WARNING) << "Left " << skipped << " DB entries the migration does not know alone";
+  }
+
+  logger(INFO) << "DB migration finished, " << migrated << " entries rewritten";
+}
+
+void migrateSizePrefixedHashes(IDataBase& database, Logging::ILogger& _logger) {
+  LoggerRef logger(_logger, "DBMigration");
+
+  MigrationWriteBatch batch;
+  size_t migrated = 0;
+  std::error_code writeError;
+
+  auto flush = [&] {
+    size_t count = batch.rawDataToInsert.size();
+    writeError = database.write(batch);
+    batch = MigrationWriteBatch();
+    if (!writeError) {
+      migrated += count;
+      logger(INFO) << "Migrated " << migrated << " DB entries";
+    }
+  };
+
+  for (const std::string& prefix : {BLOCK_INDEX_TO_TX_HASHES_PREFIX, TIMESTAMP_TO_BLOCKHASHES_PREFIX}) {
+    auto ec = database.iterate(prefix, [&] (const std::string& rawKey, const std::string& rawValue) {
+      // the size prefix is never a multiple of the hash size long
+      if (rawValue.size() % sizeof(Crypto::Hash) == 0) {
+        return true;
+      }
+
+      std::vector<Crypto::Hash> hashes;
+      Common::MemoryInputStream stream(rawValue.data(), rawValue.size());
+      BinaryInputStreamSerializer serializer(stream);
+      serializer(hashes, prefix);
+
+      batch.rawDataToInsert.emplace_back(rawKey, DB::serialize(hashes, prefix));
+      if (batch.rawDataToInsert.size() >= MIGRATION_BATCH_SIZE) {
+        flush();
+      }
+
+      return !writeError;
+    });
+
+    if (ec || writeError) {
+      throw std::system_error(ec ? ec : writeError);
+    }
+  }
+
+  if (!batch.rawDataToInsert.empty()) {
+    flush();
+    if (writeError) {
+      throw std::system_error(writeError);
+    }
+  }
+
+  logger(INFO) << "DB migration finished, " << migrated << " entries rewritten";
+}
+
+}
+}
@@ -0,0 +1,27 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include "IDataBase.h"
+
+#include <Logging/ILogger.h>
+
+namespace CryptoNote {
+namespace DB {
+
+/* Rewrites the entries of a scheme 2 database, whose keys and values went
+   through the KV binary serializer, in the encoding of DBUtils.h. Every
+   batch of entries is rewritten and its old keys deleted in one write, so a
+   migration that gets interrupted picks up where it stopped next time. */
+void migrateFromKVBinaryScheme(IDataBase& database, Logging::ILogger& logger);
+
+/* Rewrites the hash lists of a scheme 3 database, which the binary
+   serializer prefixed with their size, as the flat hashes DBUtils.h writes
+   now. Lists already flat are left alone, so an interrupted migration
+   simply runs again. */
+void migrateSizePrefixedHashes(IDataBase& database, Logging::ILogger& logger);
+
+}
+}
@@ -17,30 +17,236 @@
 
 #include "DBUtils.h"
 
+#include <cstring>
+#include <stdexcept>
+
 namespace {
   const std::string RAW_BLOCK_NAME = "raw_block";
   const std::string RAW_TXS_NAME = "raw_txs";
+
+  const char APPEND_OPERAND = 'A';
+  const char ADD_OPERAND = '+';
+  const char KEEP_FIRST_OPERAND = 'F';
+
+  const size_t CACHED_BLOCK_INFO_SIZE = sizeof(Crypto::Hash) + 4 * sizeof(uint64_t) + sizeof(uint32_t);
+
+  template <class T>
+  void appendBigEndian(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      bytes[i] = static_cast<char>(value >> (8 * (sizeof(T) - 1 - i)));
+    }
+
+    out.append(bytes, sizeof(T));
+  }
+
+  template <class T>
+  void appendLittleEndian(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      bytes[i] = static_cast<char>(value >> (8 * i));
+    }
+
+    out.append(bytes, sizeof(T));
+  }
+
+  template <class T>
+  T readLittleEndian(const char* in) {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      value |= static_cast<T>(static_cast<uint8_t>(in[i])) << (8 * i);
+    }
+
+    return value;
+  }
+
+  void checkSize(const std::string& serialized, size_t size, const std::string& name) {
+    if (serialized.size() != size) {
+      throw std::runtime_error("Unexpected size of DB value " + name + ": " + std::to_string(serialized.size()) + ", expected " + std::to_string(size));
+    }
+  }
 }
 
 namespace CryptoNote {
 namespace DB {
+  void appendKey(std::string& rawKey, uint32_t value) {
+    appendBigEndian(rawKey, value);
+  }
+
+  void appendKey(std::string& rawKey, uint64_t value) {
+    appendBigEndian(rawKey, value);
+  }
+
+  void appendKey(std::string& rawKey, const Crypto::Hash& value) {
+    rawKey.append(reinterpret_cast<const char*>(value.data), sizeof(value.data));
+  }
+
+  void appendKey(std::string& rawKey, const Crypto::KeyImage& value) {
+    rawKey.append(reinterpret_cast<const char*>(value.data), sizeof(value.data));
+  }
+
+  void appendKey(std::string& rawKey, const std::string& value) {
+    rawKey.append(value);
+  }
+
+  std::string serialize(uint32_t value, const std::string& name) {
+    std::string rawValue;
+    appendLittleEndian(rawValue, value);
+    return rawValue;
+  }
+
+  std::string serialize(uint64_t value, const std::string& name) {
+    std::string rawValue;
+    appendLittleEndian(rawValue, value);
+    return rawValue;
+  }
+
+  std::string serialize(const Crypto::Hash& value, const std::string& name) {
+    return std::string(reinterpret_cast<const char*>(value.data), sizeof(value.data));
+  }
+
+  std::string serialize(const CachedBlockInfo& value, const std::string& name) {
+    std::string rawValue;
+    rawValue.reserve(CACHED_BLOCK_INFO_SIZE);
+    rawValue.append(reinterpret_cast<const char*>(value.blockHash.data), sizeof(value.blockHash.data));
+    appendLittleEndian(rawValue, value.timestamp);
+    appendLittleEndian(rawValue, value.cumulativeDifficulty);
+    appendLittleEndian(rawValue, value.alreadyGeneratedCoins);
+    appendLittleEndian(rawValue, value.alreadyGeneratedTransactions);
+    appendLittleEndian(rawValue, value.blockSize);
+    return rawValue;
+  }
+
+  std::string serialize(const PackedOutIndex& value, const std::string& name) {
+    std::string rawValue;
+    appendLittleEndian(rawValue, value.blockIndex);
+    appendLittleEndian(rawValue, value.transactionIndex);
+    appendLittleEndian(rawValue, value.outputIndex);
+    return rawValue;
+  }
+
   std::string serialize(const RawBlock& value, const std::string& name) {
-    std::stringstream ss;
-    Common::StdOutputStream stream(ss);
+    std::string rawValue;
+    Common::StringOutputStream stream(rawValue);
     CryptoNote::BinaryOutputStreamSerializer serializer(stream);
     
     serializer(const_cast<RawBlock&>(value).block, RAW_BLOCK_NAME);
     serializer(const_cast<RawBlock&>(value).transactions, RAW_TXS_NAME);
 
-    return ss.str();
+    return rawValue;
+  }
+
+  std::string serialize(const std::vector<Crypto::Hash>& value, const std::string& name) {
+    std::string rawValue;
+    rawValue.reserve(value.size() * sizeof(Crypto::Hash));
+    for (const Crypto::Hash& hash : value) {
+      rawValue.append(reinterpret_cast<const char*>(hash.data), sizeof(hash.data));
+    }
+
+    return rawValue;
+  }
+
+  void deserialize(const std::string& serialized, uint32_t& value, const std::string& name) {
+    checkSize(serialized, sizeof(value), name);
+    value = readLittleEndian<uint32_t>(serialized.data());
+  }
+
+  void deserialize(const std::string& serialized, uint64_t& value, const std::string& name) {
+    checkSize(serialized, sizeof(value), name);
+    value = readLittleEndian<uint64_t>(serialized.data());
+  }
+
+  void deserialize(const std::string& serialized, Crypto::Hash& value, const std::string& name) {
+    checkSize(serialized, sizeof(value.data), name);
+    std::memcpy(value.data, serialized.data(), sizeof(value.data));
+  }
+
+  void deserialize(const std::string& serialized, CachedBlockInfo& value, const std::string& name) {
+    checkSize(serialized, CACHED_BLOCK_INFO_SIZE, name);
+    const char* in = serialized.data();
+    std::memcpy(value.blockHash.data, in, sizeof(value.blockHash.data));
+    in += sizeof(value.blockHash.data);
+    value.timestamp = readLittleEndian<uint64_t>(in);
+    value.cumulativeDifficulty = readLittleEndian<uint64_t>(in + 8);
+    value.alreadyGeneratedCoins = readLittleEndian<uint64_t>(in + 16);
+    value.alreadyGeneratedTransactions = readLittleEndian<uint64_t>(in + 24);
+    value.blockSize = readLittleEndian<uint32_t>(in + 32);
+  }
+
+  void deserialize(const std::string& serialized, PackedOutIndex& value, const std::string& name) {
+    checkSize(serialized, sizeof(value.packedValue), name);
+    value.blockIndex = readLittleEndian<uint32_t>(serialized.data());
+    value.transactionIndex = readLittleEndian<uint16_t>(serialized.data() + 4);
+    value.outputIndex = readLittleEndian<uint16_t>(serialized.data() + 6);
   }
 
   void deserialize(const std::string& serialized, RawBlock& value, const std::string& name) {
-    std::stringstream ss(serialized);
-    Common::StdInputStream stream(ss);
+    Common::MemoryInputStream stream(serialized.data(), serialized.size());
     CryptoNote::BinaryInputStreamSerializer serializer(stream);
     serializer(value.block, RAW_BLOCK_NAME);
     serializer(value.transactions, RAW_TXS_NAME);
   }
+  void deserialize(const std::string& serialized, std::vector<Crypto::Hash>& value, const std::string& name) {
+    if (serialized.size() % sizeof(Crypto::Hash) != 0) {
+      throw std::runtime_error("Unexpected size of DB value " + name + ": " + std::to_string(serialized.size()) + ", not a multiple of the hash size");
+    }
+
+    value.resize(serialized.size() / sizeof(Crypto::Hash));
+    if (!value.empty()) {
+      std::memcpy(value.data(), serialized.data(), serialized.size());
+    }
+  }
+
+  std::string appendOperand(const std::string& rawValue) {
+    return APPEND_OPERAND + rawValue;
+  }
+
+  std::string addOperand(uint32_t delta) {
+    std::string operand(1, ADD_OPERAND);
+    appendLittleEndian(operand, delta);
+    return operand;
+  }
+
+  std::string keepFirstOperand(const std::string& rawValue) {
+    return KEEP_FIRST_OPERAND + rawValue;
+  }
+
+  bool applyMergeOperand(std::string& rawValue, bool& exists, const char* operand, size_t operandSize) {
+    if (operandSize == 0) {
+      return false;
+    }
+
+    switch (operand[0]) {
+      case APPEND_OPERAND:
+        if (!exists) {
+          rawValue.clear();
+        }
+
+        rawValue.append(operand + 1, operandSize - 1);
+        break;
+      case ADD_OPERAND: {
+        if (operandSize != 1 + sizeof(uint32_t) || (exists && rawValue.size() != sizeof(uint32_t))) {
+          return false;
+        }
+
+        uint32_t value = exists ? readLittleEndian<uint32_t>(rawValue.data()) : 0;
+        value += readLittleEndian<uint32_t>(operand + 1);
+        rawValue.clear();
+        appendLittleEndian(rawValue, value);
+        break;
+      }
+      case KEEP_FIRST_OPERAND:
+        if (!exists) {
+          rawValue.assign(operand + 1, operandSize - 1);
+        }
+
+        break;
+      default:
+        return false;
+    }
+
+    exists = true;
+    return true;
+  }
 }
 }
@@ -18,15 +18,17 @@
 #pragma once
 
 #include <string>
-#include <sstream>
+#include <utility>
+#include <vector>
 
-#include "Common/StdOutputStream.h"
-#include "Serialization/KVBinaryOutputStreamSerializer.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/StringOutputStream.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
 #include "Serialization/SerializationOverloads.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/CryptoNoteSerialization.h"
-#include "Common/StdInputStream.h"
-#include "Serialization/KVBinaryInputStreamSerializer.h"
+#include "CryptoNoteCore/DatabaseCacheData.h"
 
 namespace CryptoNote {
 namespace DB {
@@ -59,41 +61,86 @@ namespace DB {
 
   const std::string TRANSACTIONS_COUNT_KEY = "txs_count";
 
+  const std::string RAW_BLOCKS_COUNT_KEY = "raw_blocks_count";
+
   const std::string KEY_OUTPUT_KEY_PREFIX = "j";
 
+  /* Keys are the prefix followed by each field at a fixed width: integers
+     big endian, so that they sort numerically within a prefix, hashes and
+     keys as their 32 bytes, and the few named keys as their text, whose
+     lengths never match a numeric key under the same prefix. */
+  void appendKey(std::string& rawKey, uint32_t value);
+  void appendKey(std::string& rawKey, uint64_t value);
+  void appendKey(std::string& rawKey, const Crypto::Hash& value);
+  void appendKey(std::string& rawKey, const Crypto::KeyImage& value);
+  void appendKey(std::string& rawKey, const std::string& value);
+
+  template <class First, class Second>
+  void appendKey(std::string& rawKey, const std::pair<First, Second>& value) {
+    appendKey(rawKey, value.first);
+    appendKey(rawKey, value.second);
+  }
+
+  template <class Key>
+  std::string serializeKey(const std::string& keyPrefix, const Key& key) {
+    std::string rawKey;
+    rawKey.reserve(keyPrefix.size() + 2 * sizeof(Crypto::Hash));
+    rawKey.append(keyPrefix);
+    appendKey(rawKey, key);
+    return rawKey;
+  }
+
+  /* Values read on every block and output lookup are stored flat, little
+     endian at fixed offsets; everything else goes through the binary
+     serializer, which writes no field names or type tags. */
   template <class Value>
   std::string serialize(const Value& value, const std::string& name) {
-    CryptoNote::KVBinaryOutputStreamSerializer serializer;
-    std::stringstream ss;
-    Common::StdOutputStream stream(ss);
-
+    std::string rawValue;
+    Common::StringOutputStream stream(rawValue);
+    CryptoNote::BinaryOutputStreamSerializer serializer(stream);
     serializer(const_cast<Value&>(value), name);
-    serializer.dump(stream);
-
-    return ss.str();
+    return rawValue;
   }
 
+  std::string serialize(uint32_t value, const std::string& name);
+  std::string serialize(uint64_t value, const std::string& name);
+  std::string serialize(const Crypto::Hash& value, const std::string& name);
+  std::string serialize(const CachedBlockInfo& value, const std::string& name);
+  std::string serialize(const PackedOutIndex& value, const std::string& name);
   std::string serialize(const RawBlock& value, const std::string& name);
+  // the hashes back to back, so that a merge can append to them
+  std::string serialize(const std::vector<Crypto::Hash>& value, const std::string& name);
 
   template <class Key, class Value>
   std::pair<std::string, std::string> serialize(const std::string& keyPrefix, const Key& key, const Value& value) {
-    return{ DB::serialize(std::make_pair(keyPrefix, key), keyPrefix), DB::serialize(value, keyPrefix) };
-  }
-
-  template <class Key>
-  std::string serializeKey(const std::string& keyPrefix, const Key& key) {
-    return DB::serialize(std::make_pair(keyPrefix, key), keyPrefix);
+    return{ DB::serializeKey(keyPrefix, key), DB::serialize(value, keyPrefix) };
   }
 
   template <class Value>
   void deserialize(const std::string& serialized, Value& value, const std::string& name) {
-    std::stringstream ss(serialized);
-    Common::StdInputStream stream(ss);
-    CryptoNote::KVBinaryInputStreamSerializer serializer(stream);
+    Common::MemoryInputStream stream(serialized.data(), serialized.size());
+    CryptoNote::BinaryInputStreamSerializer serializer(stream);
     serializer(value, name);
   }
 
+  void deserialize(const std::string& serialized, uint32_t& value, const std::string& name);
+  void deserialize(const std::string& serialized, uint64_t& value, const std::string& name);
+  void deserialize(const std::string& serialized, Crypto::Hash& value, const std::string& name);
+  void deserialize(const std::string& serialized, CachedBlockInfo& value, const std::string& name);
+  void deserialize(const std::string& serialized, PackedOutIndex& value, const std::string& name);
   void deserialize(const std::string& serialized, RawBlock& value, const std::string& name);
+  void deserialize(const std::string& serialized, std::vector<Crypto::Hash>& value, const std::string& name);
+
+  /* Merge operands update a value without reading it first. They are
+     applied in the order they were written, on top of the value under them
+     if there is one, by RocksDB through RocksDBWrapper's merge operator and
+     by RocksDBWrapper itself for writes it has not committed yet. */
+  std::string appendOperand(const std::string& rawValue); //appends rawValue
+  std::string addOperand(uint32_t delta); //adds delta to a uint32_t value
+  std::string keepFirstOperand(const std::string& rawValue); //rawValue, unless there is a value already
+
+  //false if operand is not one of the above
+  bool applyMergeOperand(std::string& rawValue, bool& exists, const char* operand, size_t operandSize);
 
   template <class Key, class Value>
   void serializeKeys(std::vector<std::string>& rawKeys, const std::string keyPrefix, const std::unordered_map<Key, Value>& map) {
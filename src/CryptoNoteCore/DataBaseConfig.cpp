@@ -33,6 +33,8 @@ const uint64_t WRITE_BUFFER_MB_DEFAULT_SIZE = 256;
 const uint64_t READ_BUFFER_MB_DEFAULT_SIZE = 10;
 const uint32_t DEFAULT_MAX_OPEN_FILES = 100;
 const uint16_t DEFAULT_BACKGROUND_THREADS_COUNT = 2;
+const uint32_t DEFAULT_SYNC_COMMIT_BLOCKS = 500;
+const uint64_t SYNC_COMMIT_MB_DEFAULT_SIZE = 64;
 
 const uint64_t MEGABYTE = 1024 * 1024;
 
@@ -40,6 +42,9 @@ const command_line::arg_descriptor<uint16_t>    argBackgroundThreadsCount = { "d
 const command_line::arg_descriptor<uint32_t>    argMaxOpenFiles = { "db-max-open-files", "Number of open files that can be used by the DB", DEFAULT_MAX_OPEN_FILES};
 const command_line::arg_descriptor<uint64_t>    argWriteBufferSize = { "db-write-buffer-size", "Size of data base write buffer in megabytes", WRITE_BUFFER_MB_DEFAULT_SIZE};
 const command_line::arg_descriptor<uint64_t>    argReadCacheSize = { "db-read-cache-size", "Size of data base read cache in megabytes", READ_BUFFER_MB_DEFAULT_SIZE};
+const command_line::arg_descriptor<uint32_t>    argSyncCommitBlocks = { "db-sync-commit-blocks", "Number of blocks written to the data base at once while syncing, 1 writes every block on its own", DEFAULT_SYNC_COMMIT_BLOCKS};
+const command_line::arg_descriptor<uint64_t>    argSyncCommitSize = { "db-sync-commit-size", "Size in megabytes of the blocks pending while syncing that makes the data base write them", SYNC_COMMIT_MB_DEFAULT_SIZE};
+const command_line::arg_descriptor<bool>        argStoreBlocks = { "db-store-blocks", "Keep raw blocks in the data base only, instead of in blocks.bin and again in the data base. Existing blocks.bin is imported once" };
 
 } //namespace
 
@@ -48,6 +53,9 @@ void DataBaseConfig::initOptions(boost::program_options::options_description& de
   command_line::add_arg(desc, argMaxOpenFiles);
   command_line::add_arg(desc, argWriteBufferSize);
   command_line::add_arg(desc, argReadCacheSize);
+  command_line::add_arg(desc, argSyncCommitBlocks);
+  command_line::add_arg(desc, argSyncCommitSize);
+  command_line::add_arg(desc, argStoreBlocks);
 }
 
 DataBaseConfig::DataBaseConfig() :
@@ -56,6 +64,9 @@ DataBaseConfig::DataBaseConfig() :
   maxOpenFiles(DEFAULT_MAX_OPEN_FILES),
   writeBufferSize(WRITE_BUFFER_MB_DEFAULT_SIZE * MEGABYTE),
   readCacheSize(READ_BUFFER_MB_DEFAULT_SIZE * MEGABYTE),
+  syncCommitBlocks(DEFAULT_SYNC_COMMIT_BLOCKS),
+  syncCommitSize(SYNC_COMMIT_MB_DEFAULT_SIZE * MEGABYTE),
+  storeBlocks(false),
   testnet(false) {
 }
 
@@ -76,6 +87,18 @@ bool DataBaseConfig::init(const boost::program_options::variables_map& vm) {
     readCacheSize = command_line::get_arg(vm, argReadCacheSize) * MEGABYTE;
   }
 
+  if (vm.count(argSyncCommitBlocks.name) != 0 && (!vm[argSyncCommitBlocks.name].defaulted() || syncCommitBlocks == 0)) {
+    syncCommitBlocks = command_line::get_arg(vm, argSyncCommitBlocks);
+  }
+
+  if (vm.count(argSyncCommitSize.name) != 0 && (!vm[argSyncCommitSize.name].defaulted() || syncCommitSize == 0)) {
+    syncCommitSize = command_line::get_arg(vm, argSyncCommitSize) * MEGABYTE;
+  }
+
+  if (command_line::has_arg(vm, argStoreBlocks)) {
+    storeBlocks = true;
+  }
+
   if (vm.count(command_line::arg_data_dir.name) != 0 && (!vm[command_line::arg_data_dir.name].defaulted() || dataDir == Tools::getDefaultDataDirectory())) {
     dataDir = command_line::get_arg(vm, command_line::arg_data_dir);
   }
@@ -109,6 +132,18 @@ uint64_t DataBaseConfig::getReadCacheSize() const {
   return readCacheSize;
 }
 
+uint32_t DataBaseConfig::getSyncCommitBlocks() const {
+  return syncCommitBlocks;
+}
+
+uint64_t DataBaseConfig::getSyncCommitSize() const {
+  return syncCommitSize;
+}
+
+bool DataBaseConfig::getStoreBlocks() const {
+  return storeBlocks;
+}
+
 bool DataBaseConfig::getTestnet() const {
   return testnet;
 }
@@ -137,6 +172,18 @@ void DataBaseConfig::setReadCacheSize(uint64_t readCacheSize) {
   this->readCacheSize = readCacheSize;
 }
 
+void DataBaseConfig::setSyncCommitBlocks(uint32_t syncCommitBlocks) {
+  this->syncCommitBlocks = syncCommitBlocks;
+}
+
+void DataBaseConfig::setSyncCommitSize(uint64_t syncCommitSize) {
+  this->syncCommitSize = syncCommitSize;
+}
+
+void DataBaseConfig::setStoreBlocks(bool storeBlocks) {
+  this->storeBlocks = storeBlocks;
+}
+
 void DataBaseConfig::setTestnet(bool testnet) {
   this->testnet = testnet;
 }
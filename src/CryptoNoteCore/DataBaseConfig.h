@@ -37,6 +37,9 @@ public:
   uint32_t getMaxOpenFiles() const;
   uint64_t getWriteBufferSize() const; //Bytes
   uint64_t getReadCacheSize() const; //Bytes
+  uint32_t getSyncCommitBlocks() const;
+  uint64_t getSyncCommitSize() const; //Bytes
+  bool getStoreBlocks() const;
   bool getTestnet() const;
 
   void setConfigFolderDefaulted(bool defaulted);
@@ -45,6 +48,9 @@ public:
   void setMaxOpenFiles(uint32_t maxOpenFiles);
   void setWriteBufferSize(uint64_t writeBufferSize); //Bytes
   void setReadCacheSize(uint64_t readCacheSize); //Bytes
+  void setSyncCommitBlocks(uint32_t syncCommitBlocks);
+  void setSyncCommitSize(uint64_t syncCommitSize); //Bytes
+  void setStoreBlocks(bool storeBlocks);
   void setTestnet(bool testnet);
 
 private:
@@ -54,6 +60,9 @@ private:
   uint32_t maxOpenFiles;
   uint64_t writeBufferSize;
   uint64_t readCacheSize;
+  uint32_t syncCommitBlocks;
+  uint64_t syncCommitSize;
+  bool storeBlocks;
   bool testnet;
 };
 } //namespace CryptoNote
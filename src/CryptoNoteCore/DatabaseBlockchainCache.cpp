@@ -12,6 +12,7 @@
 #include <boost/iterator/iterator_facade.hpp>
 
 #include <Common/ShuffleGenerator.h>
+#include <Common/Trace.h>
 
 #include "BlockchainUtils.h"
 
@@ -20,6 +21,7 @@
 #include <CryptoNoteCore/BlockchainStorage.h>
 #include <CryptoNoteCore/CryptoNoteTools.h>
 #include <CryptoNoteCore/CryptoNoteBasicImpl.h>
+#include <CryptoNoteCore/DBMigration.h>
 #include "CryptoNoteCore/TransactionExtra.h"
 
 namespace CryptoNote {
@@ -197,7 +199,7 @@ bool requestRawBlock(IDataBase& database, uint32_t blockIndex, RawBlock& block)
     return false;
   }
 
-  block = result.getRawBlocks().at(blockIndex);
+  block = std::move(result.extractRawBlocks().at(blockIndex));
   return true;
 }
 
@@ -415,7 +417,13 @@ private:
   uint32_t schemeVersion;
 };
 
-const uint32_t CURRENT_DB_SCHEME_VERSION = 2;
+const uint32_t CURRENT_DB_SCHEME_VERSION = 4;
+
+// Keys and values written by the KV binary serializer, migrated in place
+const uint32_t KV_BINARY_DB_SCHEME_VERSION = 2;
+
+// Hash lists prefixed with their size, migrated in place
+const uint32_t SIZE_PREFIXED_HASHES_DB_SCHEME_VERSION = 3;
 
 }
 
@@ -425,8 +433,10 @@ struct DatabaseBlockchainCache::ExtendedPushedBlockInfo {
 };
 
 
-DatabaseBlockchainCache::DatabaseBlockchainCache(const Currency& curr, IDataBase& dataBase, IBlockchainCacheFactory& blockchainCacheFactory, Logging::ILogger& _logger)
-    : currency(curr), database(dataBase), blockchainCacheFactory(blockchainCacheFactory), logger(_logger, "DatabaseBlockchainCache") {
+DatabaseBlockchainCache::DatabaseBlockchainCache(const Currency& curr, IDataBase& dataBase, IBlockchainCacheFactory& blockchainCacheFactory, Logging::ILogger& _logger,
+                                                 bool rawBlocksInMainChainStorage)
+    : currency(curr), database(dataBase), blockchainCacheFactory(blockchainCacheFactory), rawBlocksInMainChainStorage(rawBlocksInMainChainStorage),
+      logger(_logger, "DatabaseBlockchainCache") {
   DatabaseVersionReadBatch readBatch;
   auto ec = database.read(readBatch);
   if (ec) {
@@ -446,6 +456,17 @@ DatabaseBlockchainCache::DatabaseBlockchainCache(const Currency& curr, IDataBase
     logger(Logging::DEBUGGING) << "Current db scheme version: " << *version;
   }
 
+  if (!rawBlocksInMainChainStorage) {
+    // Only this cache writes the raw blocks from now on, blocks.bin would fall
+    // behind them unless exportDatabaseMainChainStorage() brought it up to date
+    auto countBatch = BlockchainReadBatch().requestRawBlocksCount();
+    auto countResult = readDatabase(countBatch);
+    if (countResult.getRawBlocksCount().second) {
+      logger(Logging::ERROR) << "The DB keeps the raw blocks instead of blocks.bin, restart with --db-store-blocks";
+      throw std::runtime_error("The raw blocks in the DB were not exported to blocks.bin");
+    }
+  }
+
   if (getTopBlockIndex() == 0) {
     logger(Logging::DEBUGGING) << "top block index is nill, add genesis block";
     addGenesisBlock(CachedBlock (currency.genesisBlock()));
@@ -464,6 +485,28 @@ bool DatabaseBlockchainCache::checkDBSchemeVersion(IDataBase& database, Logging:
   auto version = readBatch.getDbSchemeVersion();
   if (!version) {
     //DB scheme version not found. Looks like it was just created.
+    return true;
+  } else if (*version == KV_BINARY_DB_SCHEME_VERSION) {
+    logger(Logging::INFO) << "Migrating DB from scheme version " << *version << " to " << CURRENT_DB_SCHEME_VERSION << ", this may take a while...";
+    DB::migrateFromKVBinaryScheme(database, _logger);
+
+    DatabaseVersionWriteBatch writeBatch(CURRENT_DB_SCHEME_VERSION);
+    auto writeError = database.writeSync(writeBatch);
+    if (writeError) {
+      throw std::system_error(writeError);
+    }
+
+    return true;
+  } else if (*version == SIZE_PREFIXED_HASHES_DB_SCHEME_VERSION) {
+    logger(Logging::INFO) << "Migrating DB from scheme version " << *version << " to " << CURRENT_DB_SCHEME_VERSION;
+    DB::migrateSizePrefixedHashes(database, _logger);
+
+    DatabaseVersionWriteBatch writeBatch(CURRENT_DB_SCHEME_VERSION);
+    auto writeError = database.writeSync(writeBatch);
+    if (writeError) {
+      throw std::system_error(writeError);
+    }
+
     return true;
   } else if (*version < CURRENT_DB_SCHEME_VERSION) {
     logger(Logging::WARNING) << "DB scheme version is less than expected. Expected version " << CURRENT_DB_SCHEME_VERSION << ". Actual version " << *version << ". DB will be destroyed and recreated from blocks.bin file.";
@@ -537,7 +580,11 @@ std::unique_ptr<IBlockchainCache> DatabaseBlockchainCache::split(uint32_t splitB
     auto& validatorState = std::get<2>(*it);
     uint64_t timestamp = std::get<3>(*it);
 
-    writeBatch.removeCachedBlock(blockHash, blockIndex).removeRawBlock(blockIndex);
+    writeBatch.removeCachedBlock(blockHash, blockIndex);
+    if (!rawBlocksInMainChainStorage) {
+      writeBatch.removeRawBlock(blockIndex);
+    }
+
     requestDeleteSpentOutputs(writeBatch,
                               blockIndex,
                               validatorState);
@@ -566,8 +613,9 @@ std::unique_ptr<IBlockchainCache> DatabaseBlockchainCache::split(uint32_t splitB
   deleteClosestTimestampBlockIndex(writeBatch, splitBlockIndex);
 
   logger(Logging::DEBUGGING) << "Performing delete operations";
-  // all data and indexes are now copied, no errors detected, can now erase data from database
-  auto err = database.write(writeBatch);
+  // all data and indexes are now copied, no errors detected, can now erase data from database.
+  // A reorg also commits whatever blocks are pending.
+  auto err = database.writeSync(writeBatch);
   if (err) {
     logger(Logging::ERROR) << "split write failed, " << err.message();
     throw std::runtime_error(err.message());
@@ -843,31 +891,18 @@ void DatabaseBlockchainCache::insertPaymentId(BlockchainWriteBatch& batch, const
     count = readResult.getTransactionCountByPaymentIds().at(paymentId);
   }
 
-  count += 1;
-
   batch.insertPaymentId(transactionHash, paymentId, count);
 }
 
 void DatabaseBlockchainCache::insertBlockTimestamp(BlockchainWriteBatch& batch, uint64_t timestamp, const Crypto::Hash& blockHash) {
-  BlockchainReadBatch readBatch;
-  readBatch.requestBlockHashesByTimestamp(timestamp);
-
-  std::vector<Crypto::Hash> blockHashes;
-  auto readResult = readDatabase(readBatch);
-
-  if (readResult.getBlockHashesByTimestamp().count(timestamp) != 0) {
-    blockHashes = readResult.getBlockHashesByTimestamp().at(timestamp);
-  }
-
-  blockHashes.emplace_back(blockHash);
-
-  batch.insertTimestamp(timestamp, blockHashes);
+  batch.insertTimestampBlockHash(timestamp, blockHash);
 }
 
 void DatabaseBlockchainCache::pushBlock(const CachedBlock& cachedBlock,
                                         const std::vector<CachedTransaction>& cachedTransactions,
                                         const TransactionValidatorState& validatorState, size_t blockSize,
                                         uint64_t generatedCoins, uint64_t blockDifficulty, RawBlock&& rawBlock) {
+  TRACE_SPAN("DatabaseBlockchainCache::pushBlock");
   BlockchainWriteBatch batch;
   logger(Logging::DEBUGGING) << "push block with hash " << cachedBlock.getBlockHash() << ", and "
                              << cachedTransactions.size() + 1 << " transactions"; //+1 for base transaction
@@ -896,7 +931,9 @@ void DatabaseBlockchainCache::pushBlock(const CachedBlock& cachedBlock,
   txHashes.insert(txHashes.begin(), cachedBaseTransaction.getTransactionHash());
 
   batch.insertCachedBlock(blockInfo, getTopBlockIndex() + 1, txHashes);
-  batch.insertRawBlock(getTopBlockIndex() + 1, std::move(rawBlock));
+  if (!rawBlocksInMainChainStorage) {
+    batch.insertRawBlock(getTopBlockIndex() + 1, std::move(rawBlock));
+  }
 
   auto transactionIndex = 0;
   pushTransaction(cachedBaseTransaction, getTopBlockIndex() + 1, transactionIndex++, batch);
@@ -905,15 +942,8 @@ void DatabaseBlockchainCache::pushBlock(const CachedBlock& cachedBlock,
     pushTransaction(transaction, getTopBlockIndex() + 1, transactionIndex++, batch);
   }
 
-  auto closestBlockIndexDb = requestClosestBlockIndexByTimestamp(roundToMidnight(cachedBlock.getBlock().timestamp), database);
-  if (!closestBlockIndexDb.second) {
-    logger(Logging::ERROR) << "push block " << cachedBlock.getBlockHash() << " request closest block index by timestamp failed";
-    throw std::runtime_error("Couldn't get closest to timestamp block index");
-  }
-
-  if (!closestBlockIndexDb.first) {
-    batch.insertClosestTimestampBlockIndex(roundToMidnight(cachedBlock.getBlock().timestamp), getTopBlockIndex() + 1);
-  }
+  // only the first block of the day is kept
+  batch.insertClosestTimestampBlockIndex(roundToMidnight(cachedBlock.getBlock().timestamp), getTopBlockIndex() + 1);
 
   insertBlockTimestamp(batch, cachedBlock.getBlock().timestamp, cachedBlock.getBlockHash());
 
@@ -1466,11 +1496,11 @@ void DatabaseBlockchainCache::getRawTransactions(const std::vector<Crypto::Hash>
 RawBlock DatabaseBlockchainCache::getBlockByIndex(uint32_t index) const {
   auto batch = BlockchainReadBatch().requestRawBlock(index);
   auto res = readDatabase(batch);
-  return std::move(res.getRawBlocks().at(index));
+  return std::move(res.extractRawBlocks().at(index));
 }
 
 BinaryArray DatabaseBlockchainCache::getRawTransaction(uint32_t blockIndex, uint32_t transactionIndex) const {
-  return getBlockByIndex(blockIndex).transactions.at(transactionIndex);
+  return std::move(getBlockByIndex(blockIndex).transactions.at(transactionIndex));
 }
 
 std::vector<Crypto::Hash> DatabaseBlockchainCache::getTransactionHashes() const {
@@ -1626,7 +1656,7 @@ DatabaseBlockchainCache::ExtendedPushedBlockInfo DatabaseBlockchainCache::getExt
 
   ExtendedPushedBlockInfo extendedInfo;
 
-  extendedInfo.pushedBlockInfo.rawBlock = dbResult.getRawBlocks().at(blockIndex);
+  extendedInfo.pushedBlockInfo.rawBlock = std::move(dbResult.extractRawBlocks().at(blockIndex));
   extendedInfo.pushedBlockInfo.blockSize = blockInfo.blockSize;
   extendedInfo.pushedBlockInfo.blockDifficulty = blockInfo.cumulativeDifficulty - previousBlockInfo.cumulativeDifficulty;
   extendedInfo.pushedBlockInfo.generatedCoins = blockInfo.alreadyGeneratedCoins - previousBlockInfo.alreadyGeneratedCoins;
@@ -1689,7 +1719,10 @@ void DatabaseBlockchainCache::addGenesisBlock(CachedBlock&& genesisBlock) {
   pushTransaction(cachedBaseTransaction, 0, 0, batch);
 
   batch.insertCachedBlock(blockInfo, 0, {cachedBaseTransaction.getTransactionHash()});
-  batch.insertRawBlock(0, {toBinaryArray(genesisBlock.getBlock()), {}});
+  if (!rawBlocksInMainChainStorage) {
+    batch.insertRawBlock(0, {toBinaryArray(genesisBlock.getBlock()), {}});
+  }
+
   batch.insertClosestTimestampBlockIndex(roundToMidnight(genesisBlock.getBlock().timestamp), 0);
 
   auto res = database.write(batch);
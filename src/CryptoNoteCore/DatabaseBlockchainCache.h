@@ -44,9 +44,13 @@ public:
   /*
    * Constructs new DatabaseBlockchainCache object. Currnetly, only factories that produce 
    * BlockchainCache objects as children are supported.
+   *
+   * With rawBlocksInMainChainStorage the raw blocks under BLOCK_INDEX_TO_RAW_BLOCK_PREFIX belong to
+   * DatabaseMainChainStorage, which writes them before they are pushed here, so the cache only reads them.
    */
   DatabaseBlockchainCache(const Currency& currency, IDataBase& dataBase,
-                          IBlockchainCacheFactory& blockchainCacheFactory, Logging::ILogger& logger);
+                          IBlockchainCacheFactory& blockchainCacheFactory, Logging::ILogger& logger,
+                          bool rawBlocksInMainChainStorage = false);
 
   static bool checkDBSchemeVersion(IDataBase& dataBase, Logging::ILogger& logger);
 
@@ -161,6 +165,7 @@ private:
   const Currency& currency;
   IDataBase& database;
   IBlockchainCacheFactory& blockchainCacheFactory;
+  const bool rawBlocksInMainChainStorage;
   mutable boost::optional<uint32_t> topBlockIndex;
   mutable boost::optional<Crypto::Hash> topBlockHash;
   mutable boost::optional<uint64_t> transactionsCount;
@@ -26,7 +26,8 @@ class IDataBase;
 
 class DatabaseBlockchainCacheFactory: public IBlockchainCacheFactory {
 public:
-  explicit DatabaseBlockchainCacheFactory(IDataBase& database, Logging::ILogger& logger);
+  // rawBlocksInMainChainStorage: the main chain storage keeps the raw blocks in the same database, see DatabaseMainChainStorage.h
+  DatabaseBlockchainCacheFactory(IDataBase& database, Logging::ILogger& logger, bool rawBlocksInMainChainStorage = false);
   virtual ~DatabaseBlockchainCacheFactory();
 
   virtual std::unique_ptr<IBlockchainCache> createRootBlockchainCache(const Currency& currency) override;
@@ -35,6 +36,7 @@ public:
 private:
   IDataBase& database;
   Logging::ILogger& logger;
+  bool rawBlocksInMainChainStorage;
 };
 
 } //namespace CryptoNote
@@ -0,0 +1,236 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "DatabaseMainChainStorage.h"
+
+#include <algorithm>
+#include <cassert>
+#include <system_error>
+
+#include <boost/filesystem.hpp>
+
+#include "BlockchainReadBatch.h"
+#include "BlockchainWriteBatch.h"
+#include "CryptoNoteTools.h"
+#include "MainChainStorage.h"
+#include "Common/Trace.h"
+
+using namespace Logging;
+
+namespace CryptoNote {
+
+namespace {
+
+const uint32_t IMPORT_BATCH_BLOCKS = 1000;
+
+}
+
+DatabaseMainChainStorage::DatabaseMainChainStorage(IDataBase& database, Logging::ILogger& logger) :
+  database(database), logger(logger, "DatabaseMainChainStorage"), blockCount(0), initialized(false) {
+  auto batch = BlockchainReadBatch().requestRawBlocksCount();
+  auto ec = database.read(batch);
+  if (ec) {
+    throw std::system_error(ec);
+  }
+
+  auto result = batch.extractResult();
+  if (result.getRawBlocksCount().second) {
+    blockCount = result.getRawBlocksCount().first;
+    initialized = true;
+  }
+}
+
+DatabaseMainChainStorage::~DatabaseMainChainStorage() {
+}
+
+void DatabaseMainChainStorage::pushBlock(const RawBlock& rawBlock) {
+  TRACE_SPAN("DatabaseMainChainStorage::pushBlock");
+  BlockchainWriteBatch batch;
+  batch.insertRawBlock(blockCount, rawBlock).insertRawBlocksCount(blockCount + 1);
+  write(batch);
+
+  ++blockCount;
+  initialized = true;
+}
+
+void DatabaseMainChainStorage::popBlock() {
+  assert(blockCount > 0);
+
+  BlockchainWriteBatch batch;
+  batch.removeRawBlock(blockCount - 1).insertRawBlocksCount(blockCount - 1);
+  write(batch);
+
+  --blockCount;
+}
+
+RawBlock DatabaseMainChainStorage::getBlockByIndex(uint32_t index) const {
+  if (index >= blockCount) {
+    throw std::out_of_range("Block index " + std::to_string(index) + " is out of range. Blocks count: " + std::to_string(blockCount));
+  }
+
+  auto batch = BlockchainReadBatch().requestRawBlock(index);
+  auto ec = database.read(batch);
+  if (ec) {
+    throw std::system_error(ec);
+  }
+
+  auto rawBlocks = batch.extractResult().extractRawBlocks();
+  auto it = rawBlocks.find(index);
+  if (it == rawBlocks.end()) {
+    logger(ERROR) << "Raw block " << index << " is missing from the DB, blocks count: " << blockCount;
+    throw std::runtime_error("Raw block " + std::to_string(index) + " is missing from the DB");
+  }
+
+  return std::move(it->second);
+}
+
+uint32_t DatabaseMainChainStorage::getBlockCount() const {
+  return blockCount;
+}
+
+void DatabaseMainChainStorage::clear() {
+  BlockchainWriteBatch batch;
+  for (uint32_t index = 0; index < blockCount; ++index) {
+    batch.removeRawBlock(index);
+    if ((index + 1) % IMPORT_BATCH_BLOCKS == 0) {
+      write(batch);
+      batch = BlockchainWriteBatch();
+    }
+  }
+
+  batch.insertRawBlocksCount(0);
+  write(batch);
+
+  blockCount = 0;
+  initialized = true;
+}
+
+bool DatabaseMainChainStorage::isInitialized() const {
+  return initialized;
+}
+
+void DatabaseMainChainStorage::importBlocks(const std::string& blocksFilename, const std::string& indexesFilename) {
+  // Whatever the root cache wrote, it wrote up to its top block
+  auto lastBlockBatch = BlockchainReadBatch().requestLastBlockIndex();
+  auto ec = database.read(lastBlockBatch);
+  if (ec) {
+    throw std::system_error(ec);
+  }
+
+  auto lastBlockResult = lastBlockBatch.extractResult();
+  uint32_t dbBlockCount = lastBlockResult.getLastBlockIndex().second ? lastBlockResult.getLastBlockIndex().first + 1 : 0;
+  blockCount = dbBlockCount;
+
+  BlockchainWriteBatch batch;
+  if (boost::filesystem::exists(blocksFilename) && boost::filesystem::exists(indexesFilename)) {
+    MainChainStorage swappedStorage(blocksFilename, indexesFilename);
+    uint32_t swappedBlockCount = swappedStorage.getBlockCount();
+
+    // The blocks the root cache indexes are kept as they are, Core::load
+    // settles any divergence. The swapped storage only adds blocks on top of
+    // them, if it continues the same chain.
+    if (dbBlockCount < swappedBlockCount && dbBlockCount > 0 &&
+        getBlockByIndex(dbBlockCount - 1).block != swappedStorage.getBlockByIndex(dbBlockCount - 1).block) {
+      logger(INFO) << blocksFilename << " does not continue the chain in the DB, importing no blocks from it";
+      swappedBlockCount = dbBlockCount;
+    }
+
+    if (dbBlockCount < swappedBlockCount) {
+      logger(INFO) << "Importing blocks " << dbBlockCount << " to " << swappedBlockCount - 1 << " from " << blocksFilename << " into the DB";
+    }
+
+    for (uint32_t index = dbBlockCount; index < swappedBlockCount; ++index) {
+      batch.insertRawBlock(index, swappedStorage.getBlockByIndex(index));
+      ++blockCount;
+
+      if (blockCount % IMPORT_BATCH_BLOCKS == 0) {
+        write(batch);
+        batch = BlockchainWriteBatch();
+        logger(INFO) << "Imported block " << blockCount - 1 << " / " << swappedBlockCount - 1;
+      }
+    }
+
+    logger(INFO) << blocksFilename << " and " << indexesFilename << " are no longer written to and can be removed";
+  }
+
+  batch.insertRawBlocksCount(blockCount);
+  write(batch);
+
+  initialized = true;
+}
+
+void DatabaseMainChainStorage::exportBlocks(const std::string& blocksFilename, const std::string& indexesFilename) {
+  assert(initialized);
+
+  {
+    MainChainStorage swappedStorage(blocksFilename, indexesFilename);
+    uint32_t commonCount = std::min(blockCount, swappedStorage.getBlockCount());
+    while (commonCount > 0 && getBlockByIndex(commonCount - 1).block != swappedStorage.getBlockByIndex(commonCount - 1).block) {
+      --commonCount;
+    }
+
+    if (commonCount < blockCount) {
+      logger(INFO) << "Exporting blocks " << commonCount << " to " << blockCount - 1 << " from the DB into " << blocksFilename;
+    }
+
+    while (swappedStorage.getBlockCount() > commonCount) {
+      swappedStorage.popBlock();
+    }
+
+    for (uint32_t index = commonCount; index < blockCount; ++index) {
+      swappedStorage.pushBlock(getBlockByIndex(index));
+      if ((index + 1) % IMPORT_BATCH_BLOCKS == 0) {
+        logger(INFO) << "Exported block " << index << " / " << blockCount - 1;
+      }
+    }
+  }
+
+  // the files are flushed and closed by now
+  BlockchainWriteBatch batch;
+  batch.removeRawBlocksCount();
+  auto ec = database.writeSync(batch);
+  if (ec) {
+    logger(ERROR) << "Failed to remove the raw blocks count from the DB: " << ec.message();
+    throw std::system_error(ec);
+  }
+
+  blockCount = 0;
+  initialized = false;
+}
+
+void DatabaseMainChainStorage::write(BlockchainWriteBatch& batch) {
+  auto ec = database.write(batch);
+  if (ec) {
+    logger(ERROR) << "Failed to write raw blocks to the DB: " << ec.message();
+    throw std::system_error(ec);
+  }
+}
+
+std::unique_ptr<IMainChainStorage> createDatabaseMainChainStorage(IDataBase& database, const std::string& dataDir, const Currency& currency, Logging::ILogger& logger) {
+  std::unique_ptr<DatabaseMainChainStorage> storage(new DatabaseMainChainStorage(database, logger));
+  if (!storage->isInitialized()) {
+    boost::filesystem::path blocksFilename = boost::filesystem::path(dataDir) / currency.blocksFileName();
+    boost::filesystem::path indexesFilename = boost::filesystem::path(dataDir) / currency.blockIndexesFileName();
+    storage->importBlocks(blocksFilename.string(), indexesFilename.string());
+  }
+
+  if (storage->getBlockCount() == 0) {
+    RawBlock genesis;
+    genesis.block = toBinaryArray(currency.genesisBlock());
+    storage->pushBlock(genesis);
+  }
+
+  return storage;
+}
+
+void exportDatabaseMainChainStorage(IDataBase& database, const std::string& dataDir, const Currency& currency, Logging::ILogger& logger) {
+  DatabaseMainChainStorage storage(database, logger);
+  if (storage.isInitialized()) {
+    boost::filesystem::path blocksFilename = boost::filesystem::path(dataDir) / currency.blocksFileName();
+    boost::filesystem::path indexesFilename = boost::filesystem::path(dataDir) / currency.blockIndexesFileName();
+    storage.exportBlocks(blocksFilename.string(), indexesFilename.string());
+  }
+}
+
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include "IMainChainStorage.h"
+#include "IDataBase.h"
+#include "Currency.h"
+
+#include <Logging/LoggerRef.h>
+
+namespace CryptoNote {
+
+class BlockchainWriteBatch;
+
+/* Main chain storage that keeps the raw blocks in the database, under the
+   keys the root DatabaseBlockchainCache reads them from, so that a block
+   body is stored once instead of in blocks.bin and again in the DB. The
+   cache has to be created with rawBlocksInMainChainStorage, which leaves
+   these keys to us. Writes go through the same database as the cache's,
+   group commit included, so the storage is never behind the root segment
+   after a crash. */
+class DatabaseMainChainStorage: public IMainChainStorage {
+public:
+  DatabaseMainChainStorage(IDataBase& database, Logging::ILogger& logger);
+  virtual ~DatabaseMainChainStorage();
+
+  virtual void pushBlock(const RawBlock& rawBlock) override;
+  virtual void popBlock() override;
+
+  virtual RawBlock getBlockByIndex(uint32_t index) const override;
+  virtual uint32_t getBlockCount() const override;
+
+  virtual void clear() override;
+
+  // false until the DB has the raw blocks count written by this class
+  bool isInitialized() const;
+
+  /* Takes over the raw blocks the DB has from a root cache that wrote them
+     itself, then appends the blocks of the swapped storage files past them
+     if the files continue the chain of the DB. The count is written last,
+     so an interrupted import starts over next time. */
+  void importBlocks(const std::string& blocksFilename, const std::string& indexesFilename);
+
+  /* The other way round, for a daemon that no longer keeps the raw blocks
+     in the DB: brings the swapped storage files up to the blocks of the DB,
+     which went on without them, then drops the count. The raw blocks stay
+     for the root cache. An interrupted export starts over next time. */
+  void exportBlocks(const std::string& blocksFilename, const std::string& indexesFilename);
+
+private:
+  void write(BlockchainWriteBatch& batch);
+
+  IDataBase& database;
+  Logging::LoggerRef logger;
+  uint32_t blockCount;
+  bool initialized;
+};
+
+std::unique_ptr<IMainChainStorage> createDatabaseMainChainStorage(IDataBase& database, const std::string& dataDir, const Currency& currency, Logging::ILogger& logger);
+
+// Exports the blocks of a DatabaseMainChainStorage left in database, if any, to the swapped storage files of dataDir
+void exportDatabaseMainChainStorage(IDataBase& database, const std::string& dataDir, const Currency& currency, Logging::ILogger& logger);
+
+}
@@ -0,0 +1,303 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "DatabaseSnapshot.h"
+
+#include <algorithm>
+#include <system_error>
+
+#include <boost/filesystem.hpp>
+
+#include "BlockchainReadBatch.h"
+#include "CachedBlock.h"
+#include "CryptoNoteTools.h"
+#include "DatabaseBlockchainCacheFactory.h"
+#include "DatabaseMainChainStorage.h"
+#include "MainChainStorage.h"
+
+#include <Logging/LoggerRef.h>
+
+using namespace Logging;
+
+namespace CryptoNote {
+namespace DB {
+
+namespace {
+
+const uint32_t SNAPSHOT_BATCH_BLOCKS = 1000;
+const uint32_t VERIFY_LOG_INTERVAL = 100000;
+
+BlockchainReadResult readDataBase(IDataBase& database, BlockchainReadBatch& batch) {
+  auto ec = database.read(batch);
+  if (ec) {
+    throw std::system_error(ec);
+  }
+
+  return batch.extractResult();
+}
+
+uint32_t readTopBlockIndex(IDataBase& database) {
+  auto batch = BlockchainReadBatch().requestLastBlockIndex();
+  auto result = readDataBase(database, batch);
+  if (!result.getLastBlockIndex().second) {
+    throw std::runtime_error("The DB has no blocks");
+  }
+
+  return result.getLastBlockIndex().first;
+}
+
+void checkTopBlock(IDataBase& database, uint32_t topIndex, const Checkpoints& checkpoints, Crypto::Hash& topHash) {
+  auto batch = BlockchainReadBatch().requestCachedBlock(topIndex);
+  auto result = readDataBase(database, batch);
+  if (result.getCachedBlocks().count(topIndex) == 0) {
+    throw std::runtime_error("Block " + std::to_string(topIndex) + " is missing from the DB");
+  }
+
+  topHash = result.getCachedBlocks().at(topIndex).blockHash;
+
+  bool isCheckpoint;
+  if (!checkpoints.checkBlock(topIndex, topHash, isCheckpoint) || !isCheckpoint) {
+    throw std::runtime_error("Top block " + std::to_string(topIndex) + " is not one of the checkpoints");
+  }
+}
+
+void verifyBlock(uint32_t index, const RawBlock& rawBlock, const CachedBlockInfo& blockInfo, const Checkpoints& checkpoints, Crypto::Hash& expectedHash) {
+  BlockTemplate block;
+  if (!fromBinaryArray(block, rawBlock.block)) {
+    throw std::runtime_error("Block " + std::to_string(index) + " can't be parsed");
+  }
+
+  CachedBlock cachedBlock(block);
+  const Crypto::Hash& hash = cachedBlock.getBlockHash();
+  if (hash != expectedHash || hash != blockInfo.blockHash || !checkpoints.checkBlock(index, hash)) {
+    throw std::runtime_error("Block " + std::to_string(index) + " is not on the chain of the checkpoint");
+  }
+
+  if (block.transactionHashes.size() != rawBlock.transactions.size()) {
+    throw std::runtime_error("Block " + std::to_string(index) + " does not have the transactions it names");
+  }
+
+  for (size_t i = 0; i < rawBlock.transactions.size(); ++i) {
+    if (getBinaryArrayHash(rawBlock.transactions[i]) != block.transactionHashes[i]) {
+      throw std::runtime_error("Block " + std::to_string(index) + " does not have the transactions it names");
+    }
+  }
+
+  expectedHash = block.previousBlockHash;
+}
+
+uint32_t verifySnapshot(IDataBase& database, const Currency& currency, const Checkpoints& checkpoints, Logging::ILogger& _logger) {
+  LoggerRef logger(_logger, "DatabaseSnapshot");
+
+  uint32_t topIndex = readTopBlockIndex(database);
+  DatabaseMainChainStorage storage(database, _logger);
+  if (storage.isInitialized() && storage.getBlockCount() != topIndex + 1) {
+    throw std::runtime_error("The main chain storage has " + std::to_string(storage.getBlockCount()) + " blocks, the DB " + std::to_string(topIndex + 1));
+  }
+
+  Crypto::Hash genesisHash = CachedBlock(currency.genesisBlock()).getBlockHash();
+  Crypto::Hash expectedHash;
+  checkTopBlock(database, topIndex, checkpoints, expectedHash);
+  logger(INFO) << "Snapshot top block " << topIndex << " is a checkpoint, verifying the blocks down from it...";
+
+  // Only the headers and raw blocks are checked, the rest of the DB is
+  // taken on trust from whoever made the snapshot
+  uint32_t end = topIndex + 1;
+  while (end > 0) {
+    uint32_t first = end > SNAPSHOT_BATCH_BLOCKS ? end - SNAPSHOT_BATCH_BLOCKS : 0;
+
+    BlockchainReadBatch batch;
+    for (uint32_t index = first; index < end; ++index) {
+      batch.requestRawBlock(index).requestCachedBlock(index);
+    }
+
+    auto result = readDataBase(database, batch);
+    const auto& blockInfos = result.getCachedBlocks();
+    auto rawBlocks = result.extractRawBlocks();
+    for (uint32_t index = end; index-- > first;) {
+      if (rawBlocks.count(index) == 0 || blockInfos.count(index) == 0) {
+        throw std::runtime_error("Block " + std::to_string(index) + " is missing from the DB");
+      }
+
+      verifyBlock(index, rawBlocks.at(index), blockInfos.at(index), checkpoints, expectedHash);
+      if (index == 0 && blockInfos.at(index).blockHash != genesisHash) {
+        throw std::runtime_error("The snapshot is of another currency's chain");
+      }
+
+      if (index % VERIFY_LOG_INTERVAL == 0) {
+        logger(INFO) << "Verified blocks " << index << " to " << topIndex;
+      }
+    }
+
+    end = first;
+  }
+
+  return topIndex;
+}
+
+void writeSwappedStorage(IDataBase& database, uint32_t blockCount, const std::string& blocksFilename, const std::string& indexesFilename) {
+  MainChainStorage storage(blocksFilename, indexesFilename);
+  for (uint32_t first = 0; first < blockCount; first += SNAPSHOT_BATCH_BLOCKS) {
+    uint32_t end = std::min(first + SNAPSHOT_BATCH_BLOCKS, blockCount);
+
+    BlockchainReadBatch batch;
+    for (uint32_t index = first; index < end; ++index) {
+      batch.requestRawBlock(index);
+    }
+
+    auto rawBlocks = readDataBase(database, batch).extractRawBlocks();
+    for (uint32_t index = first; index < end; ++index) {
+      if (rawBlocks.count(index) == 0) {
+        throw std::runtime_error("Block " + std::to_string(index) + " is missing from the DB");
+      }
+
+      storage.pushBlock(rawBlocks.at(index));
+    }
+  }
+}
+
+// Table files are never changed once written, so the node's DB and the
+// snapshot can share them
+void copyDataBase(const boost::filesystem::path& source, const boost::filesystem::path& target) {
+  boost::filesystem::create_directories(target);
+  for (boost::filesystem::directory_iterator it(source), end; it != end; ++it) {
+    if (!boost::filesystem::is_regular_file(it->status())) {
+      continue;
+    }
+
+    boost::filesystem::path targetFile = target / it->path().filename();
+    if (it->path().extension() == ".sst") {
+      boost::system::error_code ec;
+      boost::filesystem::create_hard_link(it->path(), targetFile, ec);
+      if (!ec) {
+        continue;
+      }
+    }
+
+    boost::filesystem::copy_file(it->path(), targetFile);
+  }
+}
+
+}
+
+uint32_t exportSnapshot(RocksDBWrapper& database, const std::string& directory, const Currency& currency,
+                        const Checkpoints& checkpoints, Logging::ILogger& _logger) {
+  LoggerRef logger(_logger, "DatabaseSnapshot");
+
+  if (boost::filesystem::exists(directory) && !boost::filesystem::is_empty(directory)) {
+    throw std::runtime_error(directory + " is not empty");
+  }
+
+  boost::filesystem::create_directories(directory);
+
+  DataBaseConfig snapshotConfig = database.getConfig();
+  snapshotConfig.setDataDir(directory);
+  auto ec = database.createCheckpoint(snapshotConfig);
+  if (ec) {
+    boost::filesystem::remove_all(directory);
+    throw std::system_error(ec);
+  }
+
+  RocksDBWrapper snapshot(_logger);
+  uint32_t checkpointIndex;
+  try {
+    snapshot.init(snapshotConfig);
+
+    uint32_t topIndex = readTopBlockIndex(snapshot);
+    std::vector<uint32_t> heights = checkpoints.getCheckpointHeights();
+    auto it = std::upper_bound(heights.begin(), heights.end(), topIndex);
+    if (it == heights.begin()) {
+      throw std::runtime_error("The DB has not reached a checkpoint yet");
+    }
+
+    checkpointIndex = *std::prev(it);
+
+    DatabaseMainChainStorage storage(snapshot, _logger);
+    if (topIndex > checkpointIndex) {
+      logger(INFO) << "Cutting the snapshot from block " << topIndex << " back to checkpoint " << checkpointIndex;
+
+      DatabaseBlockchainCacheFactory factory(snapshot, _logger, storage.isInitialized());
+      std::unique_ptr<IBlockchainCache> root = factory.createRootBlockchainCache(currency);
+      std::unique_ptr<IBlockchainCache> upperSegment = root->split(checkpointIndex + 1);
+      root->deleteChild(upperSegment.get());
+    }
+
+    // The storage may be ahead of the root segment, with blocks that were
+    // still in memory on the node
+    if (storage.isInitialized()) {
+      while (storage.getBlockCount() > checkpointIndex + 1) {
+        storage.popBlock();
+      }
+    }
+
+    Crypto::Hash topHash;
+    checkTopBlock(snapshot, checkpointIndex, checkpoints, topHash);
+    snapshot.shutdown();
+  } catch (std::exception&) {
+    try {
+      snapshot.shutdown();
+    } catch (std::exception&) {
+    }
+
+    boost::filesystem::remove_all(directory);
+    throw;
+  }
+
+  logger(INFO) << "Snapshot of blocks 0 to " << checkpointIndex << " written to " << directory;
+  return checkpointIndex;
+}
+
+void importSnapshot(const std::string& directory, const DataBaseConfig& config, const Currency& currency,
+                    const Checkpoints& checkpoints, Logging::ILogger& _logger) {
+  LoggerRef logger(_logger, "DatabaseSnapshot");
+
+  DataBaseConfig snapshotConfig = config;
+  snapshotConfig.setDataDir(directory);
+  boost::filesystem::path source = RocksDBWrapper::getDataDir(snapshotConfig);
+  boost::filesystem::path target = RocksDBWrapper::getDataDir(config);
+  boost::filesystem::path blocksFilename = boost::filesystem::path(config.getDataDir()) / currency.blocksFileName();
+  boost::filesystem::path indexesFilename = boost::filesystem::path(config.getDataDir()) / currency.blockIndexesFileName();
+
+  if (!boost::filesystem::is_directory(source)) {
+    throw std::runtime_error("There is no snapshot DB in " + source.string());
+  }
+
+  if (boost::filesystem::exists(target) || boost::filesystem::exists(blocksFilename) || boost::filesystem::exists(indexesFilename)) {
+    throw std::runtime_error("The data directory already has a blockchain, remove " + target.string() + " and " +
+                             blocksFilename.string() + " to import a snapshot");
+  }
+
+  logger(INFO) << "Importing snapshot " << source.string() << " into " << target.string();
+  copyDataBase(source, target);
+
+  RocksDBWrapper database(_logger);
+  bool initialized = false;
+  try {
+    database.init(config);
+    initialized = true;
+
+    uint32_t topIndex = verifySnapshot(database, currency, checkpoints, _logger);
+    if (!config.getStoreBlocks()) {
+      logger(INFO) << "Writing " << blocksFilename.string();
+      writeSwappedStorage(database, topIndex + 1, blocksFilename.string(), indexesFilename.string());
+    }
+
+    initialized = false;
+    database.shutdown();
+    logger(INFO) << "Snapshot of blocks 0 to " << topIndex << " imported";
+  } catch (std::exception& e) {
+    logger(ERROR) << "Snapshot import failed: " << e.what();
+    if (initialized) {
+      database.shutdown();
+    }
+
+    boost::filesystem::remove_all(target);
+    boost::filesystem::remove(blocksFilename);
+    boost::filesystem::remove(indexesFilename);
+    throw;
+  }
+}
+
+}
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <string>
+
+#include "Checkpoints.h"
+#include "Currency.h"
+#include "DataBaseConfig.h"
+#include "RocksDBWrapper.h"
+
+#include <Logging/ILogger.h>
+
+namespace CryptoNote {
+namespace DB {
+
+/* Writes a snapshot of the node to directory, which must not exist or be
+   empty: a RocksDB checkpoint of database, cut back to the highest of
+   checkpoints it has reached. The DB has all the raw blocks whichever main
+   chain storage the node uses, so blocks.bin is not part of it. Returns
+   the index of the snapshot's top block. */
+uint32_t exportSnapshot(RocksDBWrapper& database, const std::string& directory, const Currency& currency,
+                        const Checkpoints& checkpoints, Logging::ILogger& logger);
+
+/* Copies a snapshot written by exportSnapshot() into the data directory of
+   config, which must not have a DB or blocks.bin yet, before the DB is
+   opened. The snapshot's top block has to be one of checkpoints, and from
+   there down to the genesis block every raw block has to hash to the hash
+   the DB has for it, link to its parent and have the transactions it
+   names. Unless config keeps the raw blocks in the DB, blocks.bin is then
+   written from them. A snapshot that fails any of this is removed again
+   and throws. */
+void importSnapshot(const std::string& directory, const DataBaseConfig& config, const Currency& currency,
+                    const Checkpoints& checkpoints, Logging::ILogger& logger);
+
+}
+}
@@ -37,6 +37,9 @@ public:
 
   virtual uint64_t getTransactionReceiveTime(const Crypto::Hash& hash) const = 0;
   virtual std::vector<Crypto::Hash> getTransactionHashesByPaymentId(const Crypto::Hash& paymentId) const = 0;
+  // Pool transactions spending any of the key images in state
+  virtual std::vector<Crypto::Hash> getConflictingTransactionHashes(const TransactionValidatorState& state) const = 0;
+  virtual std::vector<Crypto::Hash> getTransactionHashesLargerThan(size_t size) const = 0;
 };
 
 }
@@ -20,6 +20,7 @@
 #include <boost/filesystem.hpp>
 
 #include "CryptoNoteTools.h"
+#include "Common/Trace.h"
 
 namespace CryptoNote {
 
@@ -36,6 +37,7 @@ MainChainStorage::~MainChainStorage() {
 }
 
 void MainChainStorage::pushBlock(const RawBlock& rawBlock) {
+  TRACE_SPAN("MainChainStorage::pushBlock");
   storage.push_back(rawBlock);
 }
 
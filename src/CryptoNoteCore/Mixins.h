@@ -6,6 +6,7 @@
 #pragma once
 
 #include "CachedTransaction.h"
+#include "Common/Trace.h"
 #include "TransactionApi.h"
 #include "Wallet/WalletErrors.h"
 #include <config/CryptoNoteConfig.h>
@@ -77,8 +78,10 @@ namespace CryptoNote
 
       /* This method is commonly used by the node to determine if the transactions in the vector have
          the correct mixin (anonymity) as defined by the current rules */
-      static std::tuple<bool, std::string> validate(std::vector<CachedTransaction> transactions, uint32_t height)
+      static std::tuple<bool, std::string> validate(const std::vector<CachedTransaction>& transactions, uint32_t height)
       {
+        TRACE_SPAN("Mixins::validate");
+
         uint64_t minMixin;
         uint64_t maxMixin;
 
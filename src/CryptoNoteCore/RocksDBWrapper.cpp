@@ -17,12 +17,20 @@
 
 #include "RocksDBWrapper.h"
 
+#include <algorithm>
+
 #include "rocksdb/cache.h"
+#include "rocksdb/convenience.h"
+#include "rocksdb/filter_policy.h"
+#include "rocksdb/merge_operator.h"
+#include "rocksdb/slice_transform.h"
 #include "rocksdb/table.h"
 #include "rocksdb/db.h"
-#include "rocksdb/utilities/backupable_db.h"
+#include "rocksdb/utilities/checkpoint.h"
 
+#include "Common/Trace.h"
 #include "DataBaseErrors.h"
+#include "DBUtils.h"
 
 using namespace CryptoNote;
 using namespace Logging;
@@ -30,9 +38,186 @@ using namespace Logging;
 namespace {
   const std::string DB_NAME = "DB";
   const std::string TESTNET_DB_NAME = "testnet_DB";
+
+  const int BLOOM_FILTER_BITS_PER_KEY = 10;
+  // the data type byte and the amount, see DB::appendKey()
+  const size_t AMOUNT_PREFIX_LENGTH = 1 + sizeof(uint64_t);
+  const size_t COLD_BLOCK_SIZE = 64 * 1024;
+  const size_t MOVE_BATCH_SIZE = 10000;
+
+  enum class Tuning {
+    GENERAL,
+    // block indexed, appended in order and nearly always found
+    SEQUENTIAL,
+    // keyed by hash or key image, and most lookups are for keys that aren't there
+    LOOKUP,
+    // keyed by amount first, looked up many at a time for the same amount
+    AMOUNT,
+    // written once, read rarely and in bulk
+    COLD
+  };
+
+  struct ColumnFamily {
+    std::string name;
+    std::vector<std::string> prefixes;
+    Tuning tuning;
+  };
+
+  // Every key goes to the family of its first byte, the DB::*_PREFIX it was
+  // written with. Anything else, like the scheme version, stays in default.
+  const std::vector<ColumnFamily>& getColumnFamilies() {
+    static const std::vector<ColumnFamily> columnFamilies = {
+      { rocksdb::kDefaultColumnFamilyName, {}, Tuning::GENERAL },
+      { "blocks", { DB::BLOCK_INDEX_TO_KEY_IMAGE_PREFIX, DB::BLOCK_INDEX_TO_TX_HASHES_PREFIX, DB::BLOCK_INDEX_TO_TRANSACTION_INFO_PREFIX,
+          DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX, DB::BLOCK_INDEX_TO_BLOCK_HASH_PREFIX }, Tuning::SEQUENTIAL },
+      { "raw_blocks", { DB::BLOCK_INDEX_TO_RAW_BLOCK_PREFIX }, Tuning::COLD },
+      { "block_hashes", { DB::BLOCK_HASH_TO_BLOCK_INDEX_PREFIX }, Tuning::LOOKUP },
+      { "key_images", { DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX }, Tuning::LOOKUP },
+      { "transactions", { DB::TRANSACTION_HASH_TO_TRANSACTION_INFO_PREFIX }, Tuning::LOOKUP },
+      { "payment_ids", { DB::PAYMENT_ID_TO_TX_HASH_PREFIX }, Tuning::LOOKUP },
+      { "outputs", { DB::KEY_OUTPUT_AMOUNT_PREFIX, DB::KEY_OUTPUT_AMOUNTS_COUNT_PREFIX, DB::KEY_OUTPUT_KEY_PREFIX }, Tuning::AMOUNT },
+      { "timestamps", { DB::CLOSEST_TIMESTAMP_BLOCK_INDEX_PREFIX, DB::TIMESTAMP_TO_BLOCKHASHES_PREFIX }, Tuning::GENERAL }
+    };
+
+    return columnFamilies;
+  }
+
+  const ColumnFamily* findColumnFamily(const std::string& name) {
+    for (const ColumnFamily& columnFamily : getColumnFamilies()) {
+      if (columnFamily.name == name) {
+        return &columnFamily;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Applies the operands of DB::applyMergeOperand(), which RocksDB has no
+  // partial merge for, so it keeps them as they are until a full merge
+  class DataBaseMergeOperator : public rocksdb::MergeOperator {
+  public:
+    virtual bool FullMergeV2(const MergeOperationInput& input, MergeOperationOutput* output) const override {
+      bool exists = input.existing_value != nullptr;
+      if (exists) {
+        output->new_value.assign(input.existing_value->data(), input.existing_value->size());
+      }
+
+      for (const rocksdb::Slice& operand : input.operand_list) {
+        if (!DB::applyMergeOperand(output->new_value, exists, operand.data(), operand.size())) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    virtual const char* Name() const override {
+      return "CryptoNoteMergeOperator";
+    }
+  };
+
+  const std::shared_ptr<rocksdb::MergeOperator>& getMergeOperator() {
+    static const std::shared_ptr<rocksdb::MergeOperator> mergeOperator = std::make_shared<DataBaseMergeOperator>();
+    return mergeOperator;
+  }
+
+  std::string getTuningName(Tuning tuning) {
+    switch (tuning) {
+      case Tuning::SEQUENTIAL: return "bloom filter for hits";
+      case Tuning::LOOKUP: return "bloom filter";
+      case Tuning::AMOUNT: return "amount prefix bloom filter";
+      case Tuning::COLD: return "compressed";
+      default: return "general";
+    }
+  }
+
+  CryptoNote::DataBaseLatencyStatistics getLatencyStatistics(rocksdb::Statistics& statistics, rocksdb::Histograms histogram) {
+    rocksdb::HistogramData data;
+    statistics.histogramData(histogram, &data);
+    return CryptoNote::DataBaseLatencyStatistics{data.count, data.sum, data.median, data.percentile99};
+  }
+
+  // The first of the given compressions this RocksDB build supports
+  rocksdb::CompressionType pickCompression(std::initializer_list<rocksdb::CompressionType> preferred) {
+    std::vector<rocksdb::CompressionType> supported = rocksdb::GetSupportedCompressions();
+    for (rocksdb::CompressionType compression : preferred) {
+      if (std::find(supported.begin(), supported.end(), compression) != supported.end()) {
+        return compression;
+      }
+    }
+
+    return rocksdb::kNoCompression;
+  }
+
+  rocksdb::ColumnFamilyOptions getColumnFamilyOptions(const DataBaseConfig& config, const std::shared_ptr<rocksdb::Cache>& blockCache, Tuning tuning) {
+    rocksdb::ColumnFamilyOptions fOptions;
+    fOptions.write_buffer_size = static_cast<size_t>(config.getWriteBufferSize());
+    // merge two memtables when flushing to L0
+    fOptions.min_write_buffer_number_to_merge = 2;
+    // this means we'll use 50% extra memory in the worst case, but will reduce
+    // write stalls.
+    fOptions.max_write_buffer_number = 6;
+    // start flushing L0->L1 as soon as possible. each file on level0 is
+    // (memtable_memory_budget / 2). This will flush level 0 when it's bigger than
+    // memtable_memory_budget.
+    fOptions.level0_file_num_compaction_trigger = 20;
+
+    fOptions.level0_slowdown_writes_trigger = 30;
+    fOptions.level0_stop_writes_trigger = 40;
+
+    // doesn't really matter much, but we don't want to create too many files
+    fOptions.target_file_size_base = config.getWriteBufferSize() / 10;
+    // make Level1 size equal to Level0 size, so that L0->L1 compactions are fast
+    fOptions.max_bytes_for_level_base = config.getWriteBufferSize();
+    fOptions.num_levels = 10;
+    fOptions.target_file_size_multiplier = 2;
+    // level style compaction
+    fOptions.compaction_style = rocksdb::kCompactionStyleLevel;
+    fOptions.merge_operator = getMergeOperator();
+
+    fOptions.compression_per_level.resize(fOptions.num_levels);
+    for (int i = 0; i < fOptions.num_levels; ++i) {
+      fOptions.compression_per_level[i] = rocksdb::kNoCompression;
+    }
+
+    rocksdb::BlockBasedTableOptions tableOptions;
+    tableOptions.block_cache = blockCache;
+
+    switch (tuning) {
+      case Tuning::SEQUENTIAL:
+        // lookups that hit skip the upper levels on their filters, and the
+        // last level, where they end up, keeps no filter of its own
+        tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(BLOOM_FILTER_BITS_PER_KEY, false));
+        fOptions.optimize_filters_for_hits = true;
+        break;
+      case Tuning::LOOKUP:
+        // checkIfSpent and friends mostly miss, and a miss without a filter
+        // reads a block on every level
+        tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(BLOOM_FILTER_BITS_PER_KEY, false));
+        break;
+      case Tuning::AMOUNT:
+        fOptions.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(AMOUNT_PREFIX_LENGTH));
+        fOptions.memtable_prefix_bloom_size_ratio = 0.05;
+        tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(BLOOM_FILTER_BITS_PER_KEY, false));
+        break;
+      case Tuning::COLD:
+        // raw blocks are most of the DB by size and compress well
+        fOptions.compression_per_level.clear();
+        fOptions.compression = pickCompression({ rocksdb::kLZ4Compression, rocksdb::kSnappyCompression });
+        fOptions.bottommost_compression = pickCompression({ rocksdb::kZSTD, rocksdb::kLZ4Compression, rocksdb::kSnappyCompression });
+        tableOptions.block_size = COLD_BLOCK_SIZE;
+        break;
+      default:
+        break;
+    }
+
+    fOptions.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
+    return fOptions;
+  }
 }
 
-RocksDBWrapper::RocksDBWrapper(Logging::ILogger& logger) : logger(logger, "RocksDBWrapper"), state(NOT_INITIALIZED){
+RocksDBWrapper::RocksDBWrapper(Logging::ILogger& logger) : logger(logger, "RocksDBWrapper"), state(NOT_INITIALIZED),
+  groupCommit(false), commitWrites(0), commitSize(0), pendingWrites(0) {
 
 }
 
@@ -50,15 +235,21 @@ void RocksDBWrapper::init(const DataBaseConfig& config) {
   logger(INFO) << "Opening DB in " << dataDir;
 
   rocksdb::DB* dbPtr;
+  std::vector<rocksdb::ColumnFamilyHandle*> handles;
 
   rocksdb::Options dbOptions = getDBOptions(config);
-  rocksdb::Status status = rocksdb::DB::Open(dbOptions, dataDir, &dbPtr);
+  statistics = rocksdb::CreateDBStatistics();
+  dbOptions.statistics = statistics;
+  dbOptions.create_missing_column_families = true;
+
+  std::vector<rocksdb::ColumnFamilyDescriptor> descriptors = getColumnFamilyDescriptors(config, dataDir);
+  rocksdb::Status status = rocksdb::DB::Open(dbOptions, dataDir, descriptors, &handles, &dbPtr);
   if (status.ok()) {
     logger(INFO) << "DB opened in " << dataDir;
   } else if (!status.ok() && status.IsInvalidArgument()) {
     logger(INFO) << "DB not found in " << dataDir << ". Creating new DB...";
     dbOptions.create_if_missing = true;
-    rocksdb::Status status = rocksdb::DB::Open(dbOptions, dataDir, &dbPtr);
+    rocksdb::Status status = rocksdb::DB::Open(dbOptions, dataDir, descriptors, &handles, &dbPtr);
     if (!status.ok()) {
       logger(ERROR) << "DB Error. DB can't be created in " << dataDir << ". Error: " << status.ToString();
       throw std::system_error(make_error_code(CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR));
@@ -72,7 +263,26 @@ void RocksDBWrapper::init(const DataBaseConfig& config) {
   }
 
   db.reset(dbPtr);
+  columnFamilies = handles;
+
+  columnFamilyByPrefix.fill(columnFamilies[0]);
+  for (rocksdb::ColumnFamilyHandle* handle : columnFamilies) {
+    const ColumnFamily* columnFamily = findColumnFamily(handle->GetName());
+    if (columnFamily == nullptr) {
+      continue;
+    }
+
+    for (const std::string& prefix : columnFamily->prefixes) {
+      columnFamilyByPrefix[static_cast<uint8_t>(prefix[0])] = handle;
+    }
+  }
+
+  this->config = config;
+  commitWrites = std::max<uint32_t>(config.getSyncCommitBlocks(), 1);
+  commitSize = config.getSyncCommitSize();
   state.store(INITIALIZED);
+
+  moveToColumnFamilies();
 }
 
 void RocksDBWrapper::shutdown() {
@@ -81,8 +291,23 @@ void RocksDBWrapper::shutdown() {
   }
 
   logger(INFO) << "Closing DB.";
-  db->Flush(rocksdb::FlushOptions());
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    commitPending(false);
+    groupCommit = false;
+  }
+
+  for (rocksdb::ColumnFamilyHandle* handle : columnFamilies) {
+    db->Flush(rocksdb::FlushOptions(), handle);
+  }
+
   db->SyncWAL();
+
+  for (rocksdb::ColumnFamilyHandle* handle : columnFamilies) {
+    db->DestroyColumnFamilyHandle(handle);
+  }
+
+  columnFamilies.clear();
   db.reset();
   state.store(NOT_INITIALIZED);
 }
@@ -124,18 +349,37 @@ std::error_code RocksDBWrapper::writeSync(IWriteBatch& batch) {
 }
 
 std::error_code RocksDBWrapper::write(IWriteBatch& batch, bool sync) {
+  TRACE_SPAN("RocksDBWrapper::write");
+  std::vector<std::pair<std::string, std::string>> rawData(batch.extractRawDataToInsert());
+  std::vector<std::pair<std::string, std::string>> rawMerges(batch.extractRawDataToMerge());
+  std::vector<std::string> rawKeys(batch.extractRawKeysToRemove());
+
+  std::unique_lock<std::mutex> lock(pendingMutex);
+  if (groupCommit || pendingWrites != 0) {
+    addPending(rawData, rawMerges, rawKeys);
+    if (sync || !groupCommit || pendingWrites >= commitWrites || pendingBatch.GetDataSize() >= commitSize) {
+      return commitPending(sync);
+    }
+
+    return std::error_code();
+  }
+
+  lock.unlock();
+
   rocksdb::WriteOptions writeOptions;
   writeOptions.sync = sync;
 
   rocksdb::WriteBatch rocksdbBatch;
-  std::vector<std::pair<std::string, std::string>> rawData(batch.extractRawDataToInsert());
   for (const std::pair<std::string, std::string>& kvPair : rawData) {
-    rocksdbBatch.Put(rocksdb::Slice(kvPair.first), rocksdb::Slice(kvPair.second));
+    rocksdbBatch.Put(getColumnFamily(kvPair.first), rocksdb::Slice(kvPair.first), rocksdb::Slice(kvPair.second));
+  }
+
+  for (const std::pair<std::string, std::string>& kvPair : rawMerges) {
+    rocksdbBatch.Merge(getColumnFamily(kvPair.first), rocksdb::Slice(kvPair.first), rocksdb::Slice(kvPair.second));
   }
 
-  std::vector<std::string> rawKeys(batch.extractRawKeysToRemove());
   for (const std::string& key : rawKeys) {
-    rocksdbBatch.Delete(rocksdb::Slice(key));
+    rocksdbBatch.Delete(getColumnFamily(key), rocksdb::Slice(key));
   }
 
   rocksdb::Status status = db->Write(writeOptions, &rocksdbBatch);
@@ -153,21 +397,89 @@ std::error_code RocksDBWrapper::read(IReadBatch& batch) {
     throw std::runtime_error("Not initialized.");
   }
 
+  std::vector<std::string> rawKeys(batch.getRawKeys());
+  std::vector<std::string> values;
+  std::vector<bool> resultStates;
+
+  std::unique_lock<std::mutex> lock(pendingMutex);
+  if (pendingValues.empty()) {
+    lock.unlock();
+    std::error_code error = readStored(rawKeys, values, resultStates);
+    if (error) {
+      return error;
+    }
+
+    batch.submitRawResult(values, resultStates);
+    return std::error_code();
+  }
+
+  // The lock stays held until the operands are applied, so that a commit
+  // can't put them in the stored values in between
+  values.resize(rawKeys.size());
+  resultStates.assign(rawKeys.size(), false);
+  std::vector<const PendingValue*> pending(rawKeys.size(), nullptr);
+  std::vector<std::string> storedKeys;
+  std::vector<size_t> storedIndexes;
+  for (size_t i = 0; i < rawKeys.size(); ++i) {
+    auto it = pendingValues.find(rawKeys[i]);
+    if (it != pendingValues.end()) {
+      pending[i] = &it->second;
+      if (it->second.replacesStored) {
+        values[i] = it->second.value;
+        resultStates[i] = it->second.exists;
+        continue;
+      }
+    }
+
+    storedKeys.push_back(rawKeys[i]);
+    storedIndexes.push_back(i);
+  }
+
+  std::vector<std::string> storedValues;
+  std::vector<bool> storedStates;
+  std::error_code error = readStored(storedKeys, storedValues, storedStates);
+  if (error) {
+    return error;
+  }
+
+  for (size_t j = 0; j < storedIndexes.size(); ++j) {
+    size_t i = storedIndexes[j];
+    bool exists = storedStates[j];
+    values[i] = std::move(storedValues[j]);
+    if (pending[i] != nullptr) {
+      for (const std::string& operand : pending[i]->operands) {
+        if (!DB::applyMergeOperand(values[i], exists, operand.data(), operand.size())) {
+          logger(ERROR) << "Unknown DB merge operand";
+          return make_error_code(CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR);
+        }
+      }
+    }
+
+    resultStates[i] = exists;
+  }
+
+  lock.unlock();
+
+  batch.submitRawResult(values, resultStates);
+  return std::error_code();
+}
+
+std::error_code RocksDBWrapper::readStored(const std::vector<std::string>& rawKeys, std::vector<std::string>& values, std::vector<bool>& resultStates) {
   rocksdb::ReadOptions readOptions;
 
-  std::vector<std::string> rawKeys(batch.getRawKeys());
   std::vector<rocksdb::Slice> keySlices;
+  std::vector<rocksdb::ColumnFamilyHandle*> keyColumnFamilies;
   keySlices.reserve(rawKeys.size());
+  keyColumnFamilies.reserve(rawKeys.size());
   for (const std::string& key : rawKeys) {
     keySlices.emplace_back(rocksdb::Slice(key));
+    keyColumnFamilies.push_back(getColumnFamily(key));
   }
 
-  std::vector<std::string> values;
   values.reserve(rawKeys.size());
-  std::vector<rocksdb::Status> statuses = db->MultiGet(readOptions, keySlices, &values);
+  std::vector<rocksdb::Status> statuses = db->MultiGet(readOptions, keyColumnFamilies, keySlices, &values);
 
-  std::error_code error;
-  std::vector<bool> resultStates;
+  resultStates.reserve(statuses.size());
   for (const rocksdb::Status& status : statuses) {
     if (!status.ok() && !status.IsNotFound()) {
       return make_error_code(CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR);
@@ -175,51 +487,239 @@ std::error_code RocksDBWrapper::read(IReadBatch& batch) {
     resultStates.push_back(status.ok());
   }
 
-  batch.submitRawResult(values, resultStates);
   return std::error_code();
 }
 
+void RocksDBWrapper::addPending(const std::vector<std::pair<std::string, std::string>>& rawData, const std::vector<std::pair<std::string, std::string>>& rawMerges,
+                                const std::vector<std::string>& rawKeys) {
+  for (const std::pair<std::string, std::string>& kvPair : rawData) {
+    pendingBatch.Put(getColumnFamily(kvPair.first), rocksdb::Slice(kvPair.first), rocksdb::Slice(kvPair.second));
+    PendingValue& pending = pendingValues[kvPair.first];
+    pending.replacesStored = true;
+    pending.exists = true;
+    pending.value = kvPair.second;
+    pending.operands.clear();
+  }
+
+  for (const std::pair<std::string, std::string>& kvPair : rawMerges) {
+    pendingBatch.Merge(getColumnFamily(kvPair.first), rocksdb::Slice(kvPair.first), rocksdb::Slice(kvPair.second));
+    auto it = pendingValues.find(kvPair.first);
+    if (it == pendingValues.end()) {
+      it = pendingValues.emplace(kvPair.first, PendingValue{ false, false, std::string(), {} }).first;
+    }
+
+    if (it->second.replacesStored) {
+      DB::applyMergeOperand(it->second.value, it->second.exists, kvPair.second.data(), kvPair.second.size());
+    } else {
+      it->second.operands.push_back(kvPair.second);
+    }
+  }
+
+  for (const std::string& key : rawKeys) {
+    pendingBatch.Delete(getColumnFamily(key), rocksdb::Slice(key));
+    PendingValue& pending = pendingValues[key];
+    pending.replacesStored = true;
+    pending.exists = false;
+    pending.value.clear();
+    pending.operands.clear();
+  }
+
+  ++pendingWrites;
+}
+
+// Called with pendingMutex held. What fails to commit stays pending, the
+// writes before it were reported done already.
+std::error_code RocksDBWrapper::commitPending(bool sync) {
+  if (pendingWrites == 0) {
+    return std::error_code();
+  }
+
+  TRACE_SPAN("RocksDBWrapper::commitPending");
+
+  rocksdb::WriteOptions writeOptions;
+  writeOptions.sync = sync;
+
+  rocksdb::Status status = db->Write(writeOptions, &pendingBatch);
+  if (!status.ok()) {
+    logger(ERROR) << "Can't write to DB. " << status.ToString();
+    return make_error_code(CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR);
+  }
+
+  logger(DEBUGGING) << "Committed " << pendingWrites << " DB writes, " << pendingBatch.GetDataSize() << " bytes";
+  pendingBatch.Clear();
+  pendingValues.clear();
+  pendingWrites = 0;
+  return std::error_code();
+}
+
+void RocksDBWrapper::setGroupCommit(bool enabled) {
+  if (state.load() != INITIALIZED) {
+    throw std::system_error(make_error_code(CryptoNote::error::DataBaseErrorCodes::NOT_INITIALIZED));
+  }
+
+  std::lock_guard<std::mutex> lock(pendingMutex);
+  if (groupCommit == enabled) {
+    return;
+  }
+
+  groupCommit = enabled;
+  if (enabled) {
+    logger(INFO) << "DB group commit on, every " << commitWrites << " writes or " << commitSize / (1024 * 1024) << " MB";
+  } else {
+    logger(INFO) << "DB group commit off";
+    std::error_code error = commitPending(false);
+    if (error) {
+      throw std::system_error(error);
+    }
+  }
+}
+
+std::error_code RocksDBWrapper::createCheckpoint(const DataBaseConfig& checkpointConfig) {
+  if (state.load() != INITIALIZED) {
+    throw std::system_error(make_error_code(CryptoNote::error::DataBaseErrorCodes::NOT_INITIALIZED));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    std::error_code error = commitPending(false);
+    if (error) {
+      return error;
+    }
+  }
+
+  std::string checkpointDir = getDataDir(checkpointConfig);
+  logger(INFO) << "Creating DB checkpoint in " << checkpointDir;
+
+  rocksdb::Checkpoint* checkpointPtr;
+  rocksdb::Status status = rocksdb::Checkpoint::Create(db.get(), &checkpointPtr);
+  if (status.ok()) {
+    std::unique_ptr<rocksdb::Checkpoint> checkpoint(checkpointPtr);
+    status = checkpoint->CreateCheckpoint(checkpointDir);
+  }
+
+  if (!status.ok()) {
+    logger(ERROR) << "DB Error. Checkpoint can't be created in " << checkpointDir << ". Error: " << status.ToString();
+    return make_error_code(status.IsIOError() ? CryptoNote::error::DataBaseErrorCodes::IO_ERROR : CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR);
+  }
+
+  return std::error_code();
+}
+
+const DataBaseConfig& RocksDBWrapper::getConfig() const {
+  return config;
+}
+
+std::error_code RocksDBWrapper::iterate(const std::string& prefix, const std::function<bool(const std::string& key, const std::string& value)>& visitor) {
+  if (state.load() != INITIALIZED) {
+    throw std::runtime_error("Not initialized.");
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    std::error_code error = commitPending(false);
+    if (error) {
+      return error;
+    }
+  }
+
+  rocksdb::ReadOptions readOptions;
+  // scans touch everything once, keep them from evicting what the node reads
+  readOptions.fill_cache = false;
+  // the prefix may be shorter than the family's prefix extractor
+  readOptions.total_order_seek = true;
+
+  std::unique_ptr<rocksdb::Iterator> iterator(db->NewIterator(readOptions, getColumnFamily(prefix)));
+  for (iterator->Seek(prefix); iterator->Valid() && iterator->key().starts_with(prefix); iterator->Next()) {
+    if (!visitor(iterator->key().ToString(), iterator->value().ToString())) {
+      break;
+    }
+  }
+
+  if (!iterator->status().ok()) {
+    logger(ERROR) << "Can't iterate over DB. " << iterator->status().ToString();
+    return make_error_code(CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR);
+  }
+
+  return std::error_code();
+}
+
+DataBaseStatistics RocksDBWrapper::getStatistics() {
+  if (state.load() != INITIALIZED) {
+    throw std::runtime_error("Not initialized.");
+  }
+
+  DataBaseStatistics result;
+  for (rocksdb::ColumnFamilyHandle* handle : columnFamilies) {
+    DataBaseColumnFamilyStatistics columnFamily;
+    columnFamily.name = handle->GetName();
+    const ColumnFamily* description = findColumnFamily(columnFamily.name);
+    columnFamily.tuning = description != nullptr ? getTuningName(description->tuning) : "unknown";
+
+    columnFamily.estimatedKeys = 0;
+    columnFamily.sstFilesSize = 0;
+    columnFamily.memTablesSize = 0;
+    columnFamily.tableReadersMemory = 0;
+    columnFamily.pendingCompactionBytes = 0;
+    db->GetIntProperty(handle, rocksdb::DB::Properties::kEstimateNumKeys, &columnFamily.estimatedKeys);
+    db->GetIntProperty(handle, rocksdb::DB::Properties::kTotalSstFilesSize, &columnFamily.sstFilesSize);
+    db->GetIntProperty(handle, rocksdb::DB::Properties::kCurSizeAllMemTables, &columnFamily.memTablesSize);
+    db->GetIntProperty(handle, rocksdb::DB::Properties::kEstimateTableReadersMem, &columnFamily.tableReadersMemory);
+    db->GetIntProperty(handle, rocksdb::DB::Properties::kEstimatePendingCompactionBytes, &columnFamily.pendingCompactionBytes);
+    result.columnFamilies.push_back(columnFamily);
+  }
+
+  result.blockCacheUsage = blockCache->GetUsage();
+  result.blockCacheCapacity = blockCache->GetCapacity();
+  result.blockCacheHits = statistics->getTickerCount(rocksdb::BLOCK_CACHE_HIT);
+  result.blockCacheMisses = statistics->getTickerCount(rocksdb::BLOCK_CACHE_MISS);
+  result.bloomFilterUseful = statistics->getTickerCount(rocksdb::BLOOM_FILTER_USEFUL);
+  result.bloomFilterPrefixChecked = statistics->getTickerCount(rocksdb::BLOOM_FILTER_PREFIX_CHECKED);
+  result.bloomFilterPrefixUseful = statistics->getTickerCount(rocksdb::BLOOM_FILTER_PREFIX_USEFUL);
+  result.reads = getLatencyStatistics(*statistics, rocksdb::DB_MULTIGET);
+  result.writes = getLatencyStatistics(*statistics, rocksdb::DB_WRITE);
+
+  std::lock_guard<std::mutex> lock(pendingMutex);
+  result.pendingWrites = pendingWrites;
+  result.pendingBytes = pendingWrites != 0 ? pendingBatch.GetDataSize() : 0;
+  return result;
+}
+
 rocksdb::Options RocksDBWrapper::getDBOptions(const DataBaseConfig& config) {
   rocksdb::DBOptions dbOptions;
   dbOptions.IncreaseParallelism(config.getBackgroundThreadsCount());
   dbOptions.info_log_level = rocksdb::InfoLogLevel::WARN_LEVEL;
   dbOptions.max_open_files = config.getMaxOpenFiles();
+  // every column family has memtables of its own, this keeps them together
+  // to what the single family used to flush at
+  dbOptions.db_write_buffer_size = static_cast<size_t>(config.getWriteBufferSize() * 2);
 
-  rocksdb::ColumnFamilyOptions fOptions;
-  fOptions.write_buffer_size = static_cast<size_t>(config.getWriteBufferSize());
-  // merge two memtables when flushing to L0
-  fOptions.min_write_buffer_number_to_merge = 2;
-  // this means we'll use 50% extra memory in the worst case, but will reduce
-  // write stalls.
-  fOptions.max_write_buffer_number = 6;
-  // start flushing L0->L1 as soon as possible. each file on level0 is
-  // (memtable_memory_budget / 2). This will flush level 0 when it's bigger than
-  // memtable_memory_budget.
-  fOptions.level0_file_num_compaction_trigger = 20;
+  blockCache = rocksdb::NewLRUCache(config.getReadCacheSize());
 
-  fOptions.level0_slowdown_writes_trigger = 30;
-  fOptions.level0_stop_writes_trigger = 40;
+  return rocksdb::Options(dbOptions, getColumnFamilyOptions(config, blockCache, Tuning::GENERAL));
+}
 
-  // doesn't really matter much, but we don't want to create too many files
-  fOptions.target_file_size_base = config.getWriteBufferSize() / 10;
-  // make Level1 size equal to Level0 size, so that L0->L1 compactions are fast
-  fOptions.max_bytes_for_level_base = config.getWriteBufferSize();
-  fOptions.num_levels = 10;
-  fOptions.target_file_size_multiplier = 2;
-  // level style compaction
-  fOptions.compaction_style = rocksdb::kCompactionStyleLevel;
+std::vector<rocksdb::ColumnFamilyDescriptor> RocksDBWrapper::getColumnFamilyDescriptors(const DataBaseConfig& config, const std::string& dataDir) {
+  std::vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+  for (const ColumnFamily& columnFamily : getColumnFamilies()) {
+    descriptors.emplace_back(columnFamily.name, getColumnFamilyOptions(config, blockCache, columnFamily.tuning));
+  }
 
-  fOptions.compression_per_level.resize(fOptions.num_levels);
-  for (int i = 0; i < fOptions.num_levels; ++i) {
-    fOptions.compression_per_level[i] = rocksdb::kNoCompression;
+  // Every family in the DB has to be opened, including any we don't know
+  std::vector<std::string> existingNames;
+  rocksdb::DB::ListColumnFamilies(rocksdb::DBOptions(), dataDir, &existingNames);
+  for (const std::string& name : existingNames) {
+    if (findColumnFamily(name) == nullptr) {
+      logger(WARNING) << "Unknown DB column family " << name;
+      descriptors.emplace_back(name, getColumnFamilyOptions(config, blockCache, Tuning::GENERAL));
+    }
   }
 
-  rocksdb::BlockBasedTableOptions tableOptions;
-  tableOptions.block_cache = rocksdb::NewLRUCache(config.getReadCacheSize());
-  std::shared_ptr<rocksdb::TableFactory> tfp(NewBlockBasedTableFactory(tableOptions));
-  fOptions.table_factory = tfp;
+  const rocksdb::CompressionType cold = getColumnFamilyOptions(config, blockCache, Tuning::COLD).bottommost_compression;
+  if (cold == rocksdb::kNoCompression) {
+    logger(INFO) << "This RocksDB build has no LZ4, ZSTD or Snappy support, raw blocks are stored uncompressed";
+  }
 
-  return rocksdb::Options(dbOptions, fOptions);
+  return descriptors;
 }
 
 std::string RocksDBWrapper::getDataDir(const DataBaseConfig& config) {
@@ -229,3 +729,60 @@ std::string RocksDBWrapper::getDataDir(const DataBaseConfig& config) {
     return config.getDataDir() + '/' + DB_NAME;
   }
 }
+
+rocksdb::ColumnFamilyHandle* RocksDBWrapper::getColumnFamily(const std::string& key) const {
+  return key.empty() ? columnFamilies[0] : columnFamilyByPrefix[static_cast<uint8_t>(key[0])];
+}
+
+/* DBs written before there were column families have everything in default.
+   Entries move over in batches, each put and deleted in one write, so an
+   interrupted move carries on at the next start. */
+void RocksDBWrapper::moveToColumnFamilies() {
+  rocksdb::ColumnFamilyHandle* defaultColumnFamily = columnFamilies[0];
+  rocksdb::ReadOptions readOptions;
+  readOptions.fill_cache = false;
+
+  size_t moved = 0;
+  for (size_t prefix = 0; prefix < columnFamilyByPrefix.size(); ++prefix) {
+    if (columnFamilyByPrefix[prefix] == defaultColumnFamily) {
+      continue;
+    }
+
+    const std::string prefixKey(1, static_cast<char>(prefix));
+    rocksdb::WriteBatch batch;
+    std::unique_ptr<rocksdb::Iterator> iterator(db->NewIterator(readOptions, defaultColumnFamily));
+    for (iterator->Seek(prefixKey); iterator->Valid() && iterator->key().starts_with(prefixKey); iterator->Next()) {
+      if (moved == 0) {
+        logger(INFO) << "Moving DB entries into column families, this may take a while...";
+      }
+
+      batch.Put(columnFamilyByPrefix[prefix], iterator->key(), iterator->value());
+      batch.Delete(defaultColumnFamily, iterator->key());
+      if (++moved % MOVE_BATCH_SIZE == 0) {
+        rocksdb::Status status = db->Write(rocksdb::WriteOptions(), &batch);
+        if (!status.ok()) {
+          logger(ERROR) << "Can't write to DB. " << status.ToString();
+          throw std::system_error(make_error_code(CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR));
+        }
+
+        batch.Clear();
+        logger(INFO) << "Moved " << moved << " DB entries";
+      }
+    }
+
+    rocksdb::Status status = iterator->status();
+    if (status.ok()) {
+      status = db->Write(rocksdb::WriteOptions(), &batch);
+    }
+
+    if (!status.ok()) {
+      logger(ERROR) << "Can't move DB entries. " << status.ToString();
+      throw std::system_error(make_error_code(CryptoNote::error::DataBaseErrorCodes::INTERNAL_ERROR));
+    }
+  }
+
+  if (moved != 0) {
+    logger(INFO) << "Moved " << moved << " DB entries into column families, compacting...";
+    db->CompactRange(rocksdb::CompactRangeOptions(), defaultColumnFamily, nullptr, nullptr);
+  }
+}
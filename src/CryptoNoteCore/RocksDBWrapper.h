@@ -17,11 +17,18 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "rocksdb/cache.h"
 #include "rocksdb/db.h"
+#include "rocksdb/statistics.h"
+#include "rocksdb/write_batch.h"
 
 #include "IDataBase.h"
 #include "DataBaseConfig.h"
@@ -30,6 +37,42 @@
 
 namespace CryptoNote {
 
+struct DataBaseColumnFamilyStatistics {
+  std::string name;
+  std::string tuning;
+  uint64_t estimatedKeys;
+  uint64_t sstFilesSize;
+  uint64_t memTablesSize;
+  //index and filter blocks held by open table readers
+  uint64_t tableReadersMemory;
+  uint64_t pendingCompactionBytes;
+};
+
+struct DataBaseLatencyStatistics {
+  uint64_t count;
+  uint64_t sumMicroseconds;
+  double medianMicroseconds;
+  double percentile99Microseconds;
+};
+
+struct DataBaseStatistics {
+  std::vector<DataBaseColumnFamilyStatistics> columnFamilies;
+  uint64_t blockCacheUsage;
+  uint64_t blockCacheCapacity;
+  uint64_t blockCacheHits;
+  uint64_t blockCacheMisses;
+  //point lookups a whole key filter answered without reading a data block
+  uint64_t bloomFilterUseful;
+  uint64_t bloomFilterPrefixChecked;
+  uint64_t bloomFilterPrefixUseful;
+  //writes held back by group commit
+  uint64_t pendingWrites;
+  uint64_t pendingBytes;
+  //every read batch is one MultiGet, every commit one Write
+  DataBaseLatencyStatistics reads;
+  DataBaseLatencyStatistics writes;
+};
+
 class RocksDBWrapper : public IDataBase {
 public:
   RocksDBWrapper(Logging::ILogger& logger);
@@ -48,12 +91,47 @@ public:
   std::error_code write(IWriteBatch& batch) override;
   std::error_code writeSync(IWriteBatch& batch) override;
   std::error_code read(IReadBatch& batch) override;
+  std::error_code iterate(const std::string& prefix, const std::function<bool(const std::string& key, const std::string& value)>& visitor) override;
+
+  /* While group commit is on, as it is for the initial sync, writes are
+     gathered into one RocksDB write batch, committed once it holds
+     DataBaseConfig::getSyncCommitBlocks() writes or getSyncCommitSize()
+     bytes. Reads see the pending writes. writeSync(), iterate(), shutdown()
+     and turning group commit off commit them first. A crash loses the
+     pending writes, never a part of one. */
+  void setGroupCommit(bool enabled);
+
+  DataBaseStatistics getStatistics();
+
+  /* Writes a consistent copy of the DB, pending writes included, to where
+     a DB opened with checkpointConfig lives. Table files are hard linked
+     when they are on the same file system, so this takes seconds. */
+  std::error_code createCheckpoint(const DataBaseConfig& checkpointConfig);
+
+  const DataBaseConfig& getConfig() const;
+  static std::string getDataDir(const DataBaseConfig& config);
 
 private:
+  //what the pending writes did to a key
+  struct PendingValue {
+    //false when only merge operands were written, to go on top of the stored value
+    bool replacesStored;
+    bool exists;
+    std::string value;
+    std::vector<std::string> operands;
+  };
+
   std::error_code write(IWriteBatch& batch, bool sync);
+  std::error_code readStored(const std::vector<std::string>& rawKeys, std::vector<std::string>& values, std::vector<bool>& resultStates);
+  void addPending(const std::vector<std::pair<std::string, std::string>>& rawData, const std::vector<std::pair<std::string, std::string>>& rawMerges,
+                  const std::vector<std::string>& rawKeys);
+  std::error_code commitPending(bool sync);
 
   rocksdb::Options getDBOptions(const DataBaseConfig& config);
-  std::string getDataDir(const DataBaseConfig& config);
+  std::vector<rocksdb::ColumnFamilyDescriptor> getColumnFamilyDescriptors(const DataBaseConfig& config, const std::string& dataDir);
+
+  rocksdb::ColumnFamilyHandle* getColumnFamily(const std::string& key) const;
+  void moveToColumnFamilies();
 
   enum State {
     NOT_INITIALIZED,
@@ -61,7 +139,21 @@ private:
   };
 
   Logging::LoggerRef logger;
+  DataBaseConfig config;
   std::unique_ptr<rocksdb::DB> db;
+  std::vector<rocksdb::ColumnFamilyHandle*> columnFamilies;
+  //column family of each key prefix, indexed by the prefix byte
+  std::array<rocksdb::ColumnFamilyHandle*, 256> columnFamilyByPrefix;
+  std::shared_ptr<rocksdb::Cache> blockCache;
+  std::shared_ptr<rocksdb::Statistics> statistics;
   std::atomic<State> state;
+
+  std::mutex pendingMutex;
+  bool groupCommit;
+  uint32_t commitWrites;
+  uint64_t commitSize;
+  rocksdb::WriteBatch pendingBatch;
+  uint32_t pendingWrites;
+  std::unordered_map<std::string, PendingValue> pendingValues;
 };
 }
@@ -0,0 +1,61 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "SignatureCache.h"
+
+#include <algorithm>
+
+#include <CryptoNote.h>
+
+namespace CryptoNote {
+
+SignatureCache::SignatureCache(size_t maxSize) : m_generationSize(std::max<size_t>(maxSize / 2, 1)) {
+}
+
+Crypto::Hash SignatureCache::getKey(const Crypto::Hash& transactionHash, const std::vector<std::vector<Crypto::PublicKey>>& rings, bool checkKeyImage) {
+  size_t keyCount = 0;
+  for (const auto& ring : rings) {
+    keyCount += ring.size();
+  }
+
+  BinaryArray data;
+  data.reserve(sizeof(Crypto::Hash) + keyCount * sizeof(Crypto::PublicKey) + 1);
+  data.insert(data.end(), transactionHash.data, transactionHash.data + sizeof(transactionHash.data));
+
+  for (const auto& ring : rings) {
+    for (const auto& key : ring) {
+      data.insert(data.end(), key.data, key.data + sizeof(key.data));
+    }
+  }
+
+  data.push_back(checkKeyImage ? 1 : 0);
+
+  Crypto::Hash key;
+  Crypto::cn_fast_hash(data.data(), data.size(), key);
+  return key;
+}
+
+bool SignatureCache::contains(const Crypto::Hash& key) {
+  if (m_current.count(key) != 0) {
+    return true;
+  }
+
+  if (m_previous.erase(key) != 0) {
+    insert(key);
+    return true;
+  }
+
+  return false;
+}
+
+void SignatureCache::insert(const Crypto::Hash& key) {
+  if (m_current.size() >= m_generationSize) {
+    m_previous = std::move(m_current);
+    m_current.clear();
+  }
+
+  m_current.insert(key);
+}
+
+}
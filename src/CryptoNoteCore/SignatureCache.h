@@ -0,0 +1,37 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <unordered_set>
+#include <vector>
+
+#include <crypto/crypto.h>
+
+namespace CryptoNote {
+
+/* Remembers transactions whose ring signatures verified, so a transaction
+   checked on its way into the pool isn't checked again when it arrives in a
+   block or the pool is revalidated. Entries are keyed by the transaction
+   hash together with the keys its rings resolved to, since the same global
+   indexes can point at other outputs after a chain switch.
+
+   The cache keeps two generations; when the current one fills up the older
+   one is dropped, so memory stays bounded and recently used entries stay. */
+class SignatureCache {
+public:
+  explicit SignatureCache(size_t maxSize);
+
+  static Crypto::Hash getKey(const Crypto::Hash& transactionHash, const std::vector<std::vector<Crypto::PublicKey>>& rings, bool checkKeyImage);
+
+  bool contains(const Crypto::Hash& key);
+  void insert(const Crypto::Hash& key);
+
+private:
+  size_t m_generationSize;
+  std::unordered_set<Crypto::Hash> m_current;
+  std::unordered_set<Crypto::Hash> m_previous;
+};
+
+}
@@ -17,6 +17,9 @@
 
 #include "TransactionPool.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "Common/int-util.h"
 #include "CryptoNoteBasicImpl.h"
 #include "CryptoNoteCore/TransactionExtra.h"
@@ -49,6 +52,10 @@ const Crypto::Hash& TransactionPool::PendingTransactionInfo::getTransactionHash(
   return cachedTransaction.getTransactionHash();
 }
 
+size_t TransactionPool::PendingTransactionInfo::getTransactionSize() const {
+  return cachedTransaction.getTransactionBinaryArray().size();
+}
+
 size_t TransactionPool::PaymentIdHasher::operator() (const boost::optional<Crypto::Hash>& paymentId) const {
   if (!paymentId) {
     return std::numeric_limits<size_t>::max();
@@ -61,6 +68,7 @@ TransactionPool::TransactionPool(Logging::ILogger& logger) :
   transactionHashIndex(transactions.get<TransactionHashTag>()),
   transactionCostIndex(transactions.get<TransactionCostTag>()),
   paymentIdIndex(transactions.get<PaymentIdTag>()),
+  transactionSizeIndex(transactions.get<TransactionSizeTag>()),
   logger(logger, "TransactionPool") {
 }
 
@@ -83,6 +91,9 @@ bool TransactionPool::pushTransaction(CachedTransaction&& transaction, Transacti
   }
 
   mergeStates(poolState, transactionState);
+  for (const auto& keyImage : transactionState.spentKeyImages) {
+    keyImageIndex.emplace(keyImage, pendingTx.getTransactionHash());
+  }
 
   logger(Logging::DEBUGGING) << "pushed transaction " << pendingTx.getTransactionHash() << " to pool";
   return transactionHashIndex.emplace(std::move(pendingTx)).second;
@@ -103,6 +114,12 @@ bool TransactionPool::removeTransaction(const Crypto::Hash& hash) {
   }
 
   excludeFromState(poolState, it->cachedTransaction);
+  for (const auto& input : it->cachedTransaction.getTransaction().inputs) {
+    if (input.type() == typeid(KeyInput)) {
+      keyImageIndex.erase(boost::get<KeyInput>(input).keyImage);
+    }
+  }
+
   transactionHashIndex.erase(it);
 
   logger(Logging::DEBUGGING) << "transaction " << hash << " removed from pool";
@@ -161,4 +178,31 @@ std::vector<Crypto::Hash> TransactionPool::getTransactionHashesByPaymentId(const
   return transactionHashes;
 }
 
+std::vector<Crypto::Hash> TransactionPool::getConflictingTransactionHashes(const TransactionValidatorState& state) const {
+  std::vector<Crypto::Hash> transactionHashes;
+  for (const auto& keyImage : state.spentKeyImages) {
+    auto it = keyImageIndex.find(keyImage);
+    if (it != keyImageIndex.end()) {
+      transactionHashes.push_back(it->second);
+    }
+  }
+
+  // a transaction spending several of the key images is listed once
+  std::sort(transactionHashes.begin(), transactionHashes.end(), [] (const Crypto::Hash& lhs, const Crypto::Hash& rhs) {
+    return std::memcmp(lhs.data, rhs.data, sizeof(lhs.data)) < 0;
+  });
+  transactionHashes.erase(std::unique(transactionHashes.begin(), transactionHashes.end()), transactionHashes.end());
+
+  return transactionHashes;
+}
+
+std::vector<Crypto::Hash> TransactionPool::getTransactionHashesLargerThan(size_t size) const {
+  std::vector<Crypto::Hash> transactionHashes;
+  for (auto it = transactionSizeIndex.upper_bound(size); it != transactionSizeIndex.end(); ++it) {
+    transactionHashes.push_back(it->getTransactionHash());
+  }
+
+  return transactionHashes;
+}
+
 }
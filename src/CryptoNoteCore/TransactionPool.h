@@ -51,6 +51,8 @@ public:
 
   virtual uint64_t getTransactionReceiveTime(const Crypto::Hash& hash) const override;
   virtual std::vector<Crypto::Hash> getTransactionHashesByPaymentId(const Crypto::Hash& paymentId) const override;
+  virtual std::vector<Crypto::Hash> getConflictingTransactionHashes(const TransactionValidatorState& state) const override;
+  virtual std::vector<Crypto::Hash> getTransactionHashesLargerThan(size_t size) const override;
 private:
   TransactionValidatorState poolState;
 
@@ -60,6 +62,7 @@ private:
     boost::optional<Crypto::Hash> paymentId;
 
     const Crypto::Hash& getTransactionHash() const;
+    size_t getTransactionSize() const;
   };
 
   struct TransactionPriorityComparator {
@@ -70,6 +73,7 @@ private:
   struct TransactionHashTag {};
   struct TransactionCostTag {};
   struct PaymentIdTag {};
+  struct TransactionSizeTag {};
 
   typedef boost::multi_index::ordered_non_unique<
     boost::multi_index::tag<TransactionCostTag>,
@@ -96,12 +100,22 @@ private:
     PaymentIdHasher
   > PaymentIdIndex;
 
+  typedef boost::multi_index::ordered_non_unique<
+    boost::multi_index::tag<TransactionSizeTag>,
+    boost::multi_index::const_mem_fun<
+      PendingTransactionInfo,
+      size_t,
+      &PendingTransactionInfo::getTransactionSize
+    >
+  > TransactionSizeIndex;
+
   typedef boost::multi_index_container<
     PendingTransactionInfo,
     boost::multi_index::indexed_by<
       TransactionHashIndex,
       TransactionCostIndex,
-      PaymentIdIndex
+      PaymentIdIndex,
+      TransactionSizeIndex
     >
   > TransactionsContainer;
 
@@ -109,6 +123,10 @@ private:
   TransactionsContainer::index<TransactionHashTag>::type& transactionHashIndex;
   TransactionsContainer::index<TransactionCostTag>::type& transactionCostIndex;
   TransactionsContainer::index<PaymentIdTag>::type& paymentIdIndex;
+  TransactionsContainer::index<TransactionSizeTag>::type& transactionSizeIndex;
+
+  // A transaction has several key images, so this can't be a container index
+  std::unordered_map<Crypto::KeyImage, Crypto::Hash> keyImageIndex;
   
   Logging::LoggerRef logger;
 };
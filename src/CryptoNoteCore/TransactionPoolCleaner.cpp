@@ -71,6 +71,14 @@ std::vector<Crypto::Hash> TransactionPoolCleanWrapper::getTransactionHashesByPay
   return transactionPool->getTransactionHashesByPaymentId(paymentId);
 }
 
+std::vector<Crypto::Hash> TransactionPoolCleanWrapper::getConflictingTransactionHashes(const TransactionValidatorState& state) const {
+  return transactionPool->getConflictingTransactionHashes(state);
+}
+
+std::vector<Crypto::Hash> TransactionPoolCleanWrapper::getTransactionHashesLargerThan(size_t size) const {
+  return transactionPool->getTransactionHashesLargerThan(size);
+}
+
 std::vector<Crypto::Hash> TransactionPoolCleanWrapper::clean(const uint32_t height) {
   try {
     uint64_t currentTime = timeProvider->now();
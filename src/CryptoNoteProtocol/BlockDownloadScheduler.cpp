@@ -0,0 +1,393 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "BlockDownloadScheduler.h"
+
+#include <algorithm>
+
+#include <config/CryptoNoteConfig.h>
+
+namespace CryptoNote {
+
+namespace {
+
+/* Chunk sizes aim for a response every few seconds per peer */
+const double TARGET_CHUNK_SECONDS = 3;
+
+const std::chrono::seconds MIN_CHUNK_TIMEOUT(20);
+const std::chrono::seconds CHAIN_REQUEST_TIMEOUT(60);
+
+/* A chunk is taken back once it takes this many times longer than the
+   peer's measured rate predicts */
+const double CHUNK_TIMEOUT_FACTOR = 4;
+
+}
+
+BlockDownloadScheduler::BlockDownloadScheduler() :
+  m_firstIndex(0),
+  m_nextUnassigned(0),
+  m_queueHeight(0) {
+}
+
+size_t BlockDownloadScheduler::addHashes(const net_connection_id& peer, uint32_t peerHeight, uint32_t startIndex, const std::vector<Crypto::Hash>& hashes) {
+  PeerState& state = getPeer(peer);
+  state.chainStart = startIndex;
+  state.chain = hashes;
+
+  if (m_hashes.empty()) {
+    m_queueHeight = 0;
+  }
+
+  size_t added = 0;
+  bool followed = true;
+
+  for (size_t i = 0; i < hashes.size(); ++i) {
+    uint32_t index = startIndex + static_cast<uint32_t>(i);
+
+    if (m_hashes.empty()) {
+      m_firstIndex = index;
+      m_nextUnassigned = index;
+    }
+
+    if (index < m_firstIndex) {
+      continue;
+    }
+
+    if (index < endIndex()) {
+      if (m_hashes[index - m_firstIndex] == hashes[i]) {
+        continue;
+      }
+
+      // the entry is from another branch than the one being downloaded, the taller one wins
+      if (peerHeight <= m_queueHeight) {
+        followed = false;
+        break;
+      }
+
+      truncate(index);
+    }
+
+    if (index != endIndex()) {
+      followed = false;
+      break;
+    }
+
+    m_hashes.push_back(hashes[i]);
+    ++added;
+  }
+
+  if (followed) {
+    m_queueHeight = std::max(m_queueHeight, peerHeight);
+  }
+
+  return added;
+}
+
+bool BlockDownloadScheduler::assign(const net_connection_id& peer, uint32_t peerHeight, Clock::time_point now, std::vector<Crypto::Hash>& hashes) {
+  PeerState& state = getPeer(peer);
+  if (state.hasChunk || state.chainRequested || state.awaitingLateResponse) {
+    return false;
+  }
+
+  // ids of another branch would make the peer fail the request
+  uint32_t first = std::max(state.chainStart, m_firstIndex);
+  uint32_t last = std::min(matchEnd(state), peerHeight);
+  if (first >= last) {
+    return false;
+  }
+
+  uint32_t start;
+  uint32_t available;
+  auto returned = std::find_if(m_returned.begin(), m_returned.end(), [first, last] (const std::pair<const uint32_t, uint32_t>& range) {
+    return range.first < last && range.first + range.second > first;
+  });
+
+  // ranges a peer gave up on come first, the window can't move past them
+  if (returned != m_returned.end()) {
+    start = std::max(returned->first, first);
+    available = std::min(returned->first + returned->second, last) - start;
+  } else {
+    uint32_t windowEnd = std::min(last, m_firstIndex + static_cast<uint32_t>(BLOCKS_SYNCHRONIZING_WINDOW_COUNT));
+    if (m_nextUnassigned < first || m_nextUnassigned >= windowEnd) {
+      return false;
+    }
+
+    start = m_nextUnassigned;
+    available = windowEnd - start;
+  }
+
+  uint32_t count = std::min(available, static_cast<uint32_t>(state.batchSize));
+
+  if (returned != m_returned.end()) {
+    uint32_t rangeStart = returned->first;
+    uint32_t rangeEnd = returned->first + returned->second;
+
+    m_returned.erase(returned);
+    if (rangeStart < start) {
+      m_returned.emplace(rangeStart, start - rangeStart);
+    }
+
+    if (start + count < rangeEnd) {
+      m_returned.emplace(start + count, rangeEnd - start - count);
+    }
+  } else {
+    m_nextUnassigned += count;
+  }
+
+  auto firstHash = m_hashes.begin() + (start - m_firstIndex);
+  hashes.assign(firstHash, firstHash + count);
+
+  state.hasChunk = true;
+  state.chunkStart = start;
+  state.chunkSize = count;
+  state.requestTime = now;
+  state.deadline = now + chunkTimeout(state);
+
+  return true;
+}
+
+bool BlockDownloadScheduler::deliver(const net_connection_id& peer, Clock::time_point now, DownloadedBlocks&& blocks) {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    return false;
+  }
+
+  PeerState& state = it->second;
+  if (!state.hasChunk) {
+    state.awaitingLateResponse = false;
+    return false;
+  }
+
+  double seconds = std::max(std::chrono::duration<double>(now - state.requestTime).count(), 0.001);
+  double rate = state.chunkSize / seconds;
+  state.blocksPerSecond = state.blocksPerSecond == 0 ? rate : 0.7 * state.blocksPerSecond + 0.3 * rate;
+
+  size_t batchSize = static_cast<size_t>(state.blocksPerSecond * TARGET_CHUNK_SECONDS);
+  state.batchSize = std::max(BLOCKS_SYNCHRONIZING_MIN_COUNT, std::min(batchSize, BLOCKS_SYNCHRONIZING_MAX_COUNT));
+  state.hasChunk = false;
+
+  blocks.peer = peer;
+  m_ready.emplace(state.chunkStart, ReadyChunk{state.chunkSize, std::move(blocks)});
+
+  return true;
+}
+
+bool BlockDownloadScheduler::popReady(DownloadedBlocks& blocks) {
+  auto it = m_ready.begin();
+  if (it == m_ready.end() || it->first != m_firstIndex) {
+    return false;
+  }
+
+  uint32_t size = it->second.size;
+  blocks = std::move(it->second.blocks);
+  m_ready.erase(it);
+
+  m_hashes.erase(m_hashes.begin(), m_hashes.begin() + size);
+  m_firstIndex += size;
+
+  return true;
+}
+
+void BlockDownloadScheduler::chainRequested(const net_connection_id& peer, Clock::time_point now) {
+  PeerState& state = getPeer(peer);
+  state.chainRequested = true;
+  state.deadline = now + CHAIN_REQUEST_TIMEOUT;
+}
+
+void BlockDownloadScheduler::chainReceived(const net_connection_id& peer) {
+  auto it = m_peers.find(peer);
+  if (it != m_peers.end()) {
+    it->second.chainRequested = false;
+  }
+}
+
+bool BlockDownloadScheduler::isChainRequestPending() const {
+  return std::any_of(m_peers.begin(), m_peers.end(), [] (const std::pair<const net_connection_id, PeerState>& peer) {
+    return peer.second.chainRequested;
+  });
+}
+
+std::vector<net_connection_id> BlockDownloadScheduler::expireStalled(Clock::time_point now) {
+  std::vector<net_connection_id> stalled;
+
+  for (auto& peer : m_peers) {
+    PeerState& state = peer.second;
+    if (now <= state.deadline) {
+      continue;
+    }
+
+    if (state.hasChunk) {
+      m_returned.emplace(state.chunkStart, state.chunkSize);
+      state.hasChunk = false;
+      state.awaitingLateResponse = true;
+      state.blocksPerSecond /= 2;
+      state.batchSize = std::max(BLOCKS_SYNCHRONIZING_MIN_COUNT, state.batchSize / 2);
+      state.deadline = now + chunkTimeout(state);
+    } else if (state.awaitingLateResponse || state.chainRequested) {
+      state.chainRequested = false;
+      stalled.push_back(peer.first);
+    }
+  }
+
+  return stalled;
+}
+
+void BlockDownloadScheduler::removePeer(const net_connection_id& peer) {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    return;
+  }
+
+  if (it->second.hasChunk) {
+    m_returned.emplace(it->second.chunkStart, it->second.chunkSize);
+  }
+
+  m_peers.erase(it);
+}
+
+void BlockDownloadScheduler::reset() {
+  m_hashes.clear();
+  m_returned.clear();
+  m_ready.clear();
+  m_firstIndex = 0;
+  m_nextUnassigned = 0;
+  m_queueHeight = 0;
+
+  for (auto& peer : m_peers) {
+    if (peer.second.hasChunk) {
+      peer.second.hasChunk = false;
+      peer.second.awaitingLateResponse = true;
+    }
+  }
+}
+
+bool BlockDownloadScheduler::needsChain(const net_connection_id& peer, uint32_t peerHeight) const {
+  if (m_hashes.empty()) {
+    return true;
+  }
+
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end() || it->second.chain.empty()) {
+    return true;
+  }
+
+  const PeerState& state = it->second;
+  uint32_t chainEnd = state.chainStart + static_cast<uint32_t>(state.chain.size());
+  uint32_t first = std::max(state.chainStart, m_firstIndex);
+  uint32_t last = matchEnd(state);
+
+  // a peer on a branch that lost to the queued one waits for the queue to drain
+  if (last < std::min(chainEnd, endIndex()) || chainEnd >= peerHeight) {
+    return false;
+  }
+
+  if (std::max(m_nextUnassigned, first) < last) {
+    return false;
+  }
+
+  return std::none_of(m_returned.begin(), m_returned.end(), [first, last] (const std::pair<const uint32_t, uint32_t>& range) {
+    return range.first < last && range.first + range.second > first;
+  });
+}
+
+bool BlockDownloadScheduler::isBusy(const net_connection_id& peer) const {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    return false;
+  }
+
+  return it->second.hasChunk || it->second.chainRequested || it->second.awaitingLateResponse;
+}
+
+bool BlockDownloadScheduler::empty() const {
+  return m_hashes.empty();
+}
+
+size_t BlockDownloadScheduler::queuedCount() const {
+  return m_hashes.size();
+}
+
+size_t BlockDownloadScheduler::readyCount() const {
+  return m_ready.size();
+}
+
+BlockDownloadScheduler::PeerState& BlockDownloadScheduler::getPeer(const net_connection_id& peer) {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    PeerState state;
+    state.batchSize = BLOCKS_SYNCHRONIZING_DEFAULT_COUNT;
+    it = m_peers.emplace(peer, state).first;
+  }
+
+  return it->second;
+}
+
+BlockDownloadScheduler::Clock::duration BlockDownloadScheduler::chunkTimeout(const PeerState& state) const {
+  Clock::duration timeout = MIN_CHUNK_TIMEOUT;
+
+  if (state.blocksPerSecond > 0) {
+    std::chrono::duration<double> expected(CHUNK_TIMEOUT_FACTOR * state.chunkSize / state.blocksPerSecond);
+    timeout = std::max(timeout, std::chrono::duration_cast<Clock::duration>(expected));
+  }
+
+  return timeout;
+}
+
+uint32_t BlockDownloadScheduler::endIndex() const {
+  return m_firstIndex + static_cast<uint32_t>(m_hashes.size());
+}
+
+uint32_t BlockDownloadScheduler::matchEnd(const PeerState& state) const {
+  uint32_t index = std::max(state.chainStart, m_firstIndex);
+  uint32_t end = std::min(state.chainStart + static_cast<uint32_t>(state.chain.size()), endIndex());
+
+  while (index < end && m_hashes[index - m_firstIndex] == state.chain[index - state.chainStart]) {
+    ++index;
+  }
+
+  return index;
+}
+
+/* Drops the queued ids from index on, along with everything downloaded or
+   in flight for them, so another branch can be queued from there */
+void BlockDownloadScheduler::truncate(uint32_t index) {
+  m_hashes.erase(m_hashes.begin() + (index - m_firstIndex), m_hashes.end());
+  m_nextUnassigned = std::min(m_nextUnassigned, index);
+
+  for (auto it = m_returned.begin(); it != m_returned.end();) {
+    if (it->first >= index) {
+      it = m_returned.erase(it);
+    } else {
+      it->second = std::min(it->second, index - it->first);
+      ++it;
+    }
+  }
+
+  for (auto it = m_ready.begin(); it != m_ready.end();) {
+    if (it->first + it->second.size <= index) {
+      ++it;
+      continue;
+    }
+
+    if (it->first < index) {
+      m_returned.emplace(it->first, index - it->first);
+    }
+
+    it = m_ready.erase(it);
+  }
+
+  for (auto& peer : m_peers) {
+    PeerState& state = peer.second;
+    if (state.hasChunk && state.chunkStart + state.chunkSize > index) {
+      if (state.chunkStart < index) {
+        m_returned.emplace(state.chunkStart, index - state.chunkStart);
+      }
+
+      state.hasChunk = false;
+      state.awaitingLateResponse = true;
+    }
+  }
+}
+
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include "CryptoNote.h"
+#include "CryptoNoteCore/CachedBlock.h"
+#include "P2p/P2pProtocolTypes.h"
+
+namespace CryptoNote {
+
+/* Splits the blocks still needed during synchronization into chunks, hands
+   them to every synchronizing peer in parallel and hands the downloaded
+   blocks back in chain order. It does no networking itself, the protocol
+   handler asks it what to request from whom and reports what came back. */
+class BlockDownloadScheduler {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct DownloadedBlocks {
+    net_connection_id peer;
+    std::vector<RawBlock> rawBlocks;
+    std::vector<BlockTemplate> blockTemplates;
+    // Refer into blockTemplates, which keeps its buffer when the struct is moved
+    std::vector<CachedBlock> cachedBlocks;
+  };
+
+  BlockDownloadScheduler();
+
+  /* Records the chain entry peer advertised, starting at block index
+     startIndex, and appends its ids to the queue. Ids that are already
+     queued are skipped; the rest must continue the queued chain. Where the
+     entry forks off the queued chain, the queue follows it from there if
+     peerHeight is above the height of the queued branch, otherwise the rest
+     of the entry is dropped. Returns the number of ids queued. */
+  size_t addHashes(const net_connection_id& peer, uint32_t peerHeight, uint32_t startIndex, const std::vector<Crypto::Hash>& hashes);
+
+  /* Picks the next chunk for peer, sized by its measured throughput and
+     limited to queued ids that match the chain entry of the peer, to blocks
+     below peerHeight and to the reorder window */
+  bool assign(const net_connection_id& peer, uint32_t peerHeight, Clock::time_point now, std::vector<Crypto::Hash>& hashes);
+
+  /* Stores the blocks of the chunk assigned to peer. Returns false if the
+     peer has no live chunk, e.g. it was reassigned after a stall. */
+  bool deliver(const net_connection_id& peer, Clock::time_point now, DownloadedBlocks&& blocks);
+
+  /* Moves out the next chunk in chain order, if it has arrived */
+  bool popReady(DownloadedBlocks& blocks);
+
+  void chainRequested(const net_connection_id& peer, Clock::time_point now);
+  void chainReceived(const net_connection_id& peer);
+  bool isChainRequestPending() const;
+
+  /* Takes chunks back from peers that exceeded their deadline and returns
+     the peers that still haven't answered a second deadline later */
+  std::vector<net_connection_id> expireStalled(Clock::time_point now);
+
+  void removePeer(const net_connection_id& peer);
+
+  /* Forgets every queued id and downloaded chunk, used when a block fails
+     to add and everything after it is suspect */
+  void reset();
+
+  /* Whether a new chain entry should be requested from peer: nothing is
+     queued, or its entry agrees with the queue, every queued id of it is
+     assigned and the peer has blocks past it */
+  bool needsChain(const net_connection_id& peer, uint32_t peerHeight) const;
+
+  bool isBusy(const net_connection_id& peer) const;
+  bool empty() const;
+  size_t queuedCount() const;
+  size_t readyCount() const;
+
+private:
+  struct PeerState {
+    bool hasChunk = false;
+    bool chainRequested = false;
+    // A chunk was taken back but the peer may still answer for it
+    bool awaitingLateResponse = false;
+    uint32_t chunkStart = 0;
+    uint32_t chunkSize = 0;
+    Clock::time_point requestTime;
+    Clock::time_point deadline;
+    size_t batchSize;
+    double blocksPerSecond = 0;
+    // The last chain entry the peer advertised, ids of blocks chainStart, chainStart + 1, ...
+    uint32_t chainStart = 0;
+    std::vector<Crypto::Hash> chain;
+  };
+
+  struct ReadyChunk {
+    uint32_t size;
+    DownloadedBlocks blocks;
+  };
+
+  PeerState& getPeer(const net_connection_id& peer);
+  Clock::duration chunkTimeout(const PeerState& state) const;
+  uint32_t endIndex() const;
+  uint32_t matchEnd(const PeerState& state) const;
+  void truncate(uint32_t index);
+
+  std::unordered_map<net_connection_id, PeerState, boost::hash<net_connection_id>> m_peers;
+
+  // Ids of blocks m_firstIndex, m_firstIndex + 1, ... that are not added yet
+  std::deque<Crypto::Hash> m_hashes;
+  uint32_t m_firstIndex;
+  uint32_t m_nextUnassigned;
+  // The highest height advertised by a peer whose entry the queue follows
+  uint32_t m_queueHeight;
+
+  // Ranges taken back from stalled or disconnected peers, start -> size
+  std::map<uint32_t, uint32_t> m_returned;
+  std::map<uint32_t, ReadyChunk> m_ready;
+};
+
+}
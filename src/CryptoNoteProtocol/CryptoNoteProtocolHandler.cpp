@@ -17,6 +17,7 @@
 #include "P2p/LevinProtocol.h"
 
 #include <Common/FormatTools.h>
+#include <Common/Trace.h>
 
 #include <config/Ascii.h>
 #include <config/CryptoNoteConfig.h>
@@ -50,12 +51,12 @@ std::vector<RawBlockLegacy> convertRawBlocksToRawBlocksLegacy(const std::vector<
   return legacy;
 }
 
-std::vector<RawBlock> convertRawBlocksLegacyToRawBlocks(const std::vector<RawBlockLegacy>& legacy) {
+std::vector<RawBlock> convertRawBlocksLegacyToRawBlocks(std::vector<RawBlockLegacy>&& legacy) {
   std::vector<RawBlock> rawBlocks;
   rawBlocks.reserve(legacy.size());
 
-  for (const auto& legacyBlock: legacy) {
-    rawBlocks.emplace_back(RawBlock{legacyBlock.block, legacyBlock.transactions});
+  for (auto& legacyBlock: legacy) {
+    rawBlocks.emplace_back(RawBlock{std::move(legacyBlock.block), std::move(legacyBlock.transactions)});
   }
 
   return rawBlocks;
@@ -63,29 +64,29 @@ std::vector<RawBlock> convertRawBlocksLegacyToRawBlocks(const std::vector<RawBlo
 
 }
 
-// unpack to strings to maintain protocol compatibility with older versions
-static inline void serialize(RawBlockLegacy& rawBlock, ISerializer& serializer) {
-  std::string block;
-  std::vector<std::string> transactions;
-  if (serializer.type() == ISerializer::INPUT) {
-    serializer(block, "block");
-    serializer(transactions, "txs");
-    rawBlock.block.reserve(block.size());
-    rawBlock.transactions.reserve(transactions.size());
-    std::copy(block.begin(), block.end(), std::back_inserter(rawBlock.block));
-    std::transform(transactions.begin(), transactions.end(), std::back_inserter(rawBlock.transactions), [] (const std::string& s) {
-      return BinaryArray(s.begin(), s.end());
-    });
-  } else {
-    block.reserve(rawBlock.block.size());
-    transactions.reserve(rawBlock.transactions.size());
-    std::copy(rawBlock.block.begin(), rawBlock.block.end(), std::back_inserter(block));
-    std::transform(rawBlock.transactions.begin(), rawBlock.transactions.end(), std::back_inserter(transactions), [] (BinaryArray& s) {
-      return std::string(s.begin(), s.end());
-    });
-    serializer(block, "block");
-    serializer(transactions, "txs");
+// sent as strings to maintain protocol compatibility with older versions
+static bool serializeBlobs(std::vector<BinaryArray>& blobs, Common::StringView name, ISerializer& serializer) {
+  size_t size = blobs.size();
+  if (!serializer.beginArray(size, name)) {
+    if (serializer.type() == ISerializer::INPUT) {
+      blobs.clear();
+    }
+
+    return false;
+  }
+
+  blobs.resize(size);
+  for (auto& blob : blobs) {
+    serializer.bytes(blob, "");
   }
+
+  serializer.endArray();
+  return true;
+}
+
+static inline void serialize(RawBlockLegacy& rawBlock, ISerializer& serializer) {
+  serializer.bytes(rawBlock.block, "block");
+  serializeBlobs(rawBlock.transactions, "txs", serializer);
 }
 
 static inline void serialize(NOTIFY_NEW_BLOCK_request& request, ISerializer& s) {
@@ -94,22 +95,8 @@ static inline void serialize(NOTIFY_NEW_BLOCK_request& request, ISerializer& s)
   s(request.hop, "hop");
 }
 
-// unpack to strings to maintain protocol compatibility with older versions
 static inline void serialize(NOTIFY_NEW_TRANSACTIONS_request& request, ISerializer& s) {
-  std::vector<std::string> transactions;
-  if (s.type() == ISerializer::INPUT) {
-    s(transactions, "txs");
-    request.txs.reserve(transactions.size());
-    std::transform(transactions.begin(), transactions.end(), std::back_inserter(request.txs), [] (const std::string& s) {
-      return BinaryArray(s.begin(), s.end());
-    });
-  }else {
-    transactions.reserve(request.txs.size());
-    std::transform(request.txs.begin(), request.txs.end(), std::back_inserter(transactions), [] (const BinaryArray& s) {
-      return std::string(s.begin(), s.end());
-    });
-    s(transactions, "txs");
-  }
+  serializeBlobs(request.txs, "txs", s);
 }
 
 static inline void serialize(NOTIFY_RESPONSE_GET_OBJECTS_request& request, ISerializer& s) {
@@ -129,6 +116,7 @@ CryptoNoteProtocolHandler::CryptoNoteProtocolHandler(const Currency& currency, S
   m_observedHeight(0),
   m_blockchainHeight(0),
   m_peersCount(0),
+  m_processingDownloads(false),
   logger(log, "protocol") {
 
   if (!m_p2p) {
@@ -140,6 +128,14 @@ size_t CryptoNoteProtocolHandler::getPeerCount() const {
   return m_peersCount;
 }
 
+size_t CryptoNoteProtocolHandler::getQueuedBlockCount() const {
+  return m_downloader.queuedCount();
+}
+
+size_t CryptoNoteProtocolHandler::getReadyBlockCount() const {
+  return m_downloader.readyCount();
+}
+
 void CryptoNoteProtocolHandler::set_p2p_endpoint(IP2pEndpoint* p2p) {
   if (p2p)
     m_p2p = p2p;
@@ -151,6 +147,8 @@ void CryptoNoteProtocolHandler::onConnectionOpened(CryptoNoteConnectionContext&
 }
 
 void CryptoNoteProtocolHandler::onConnectionClosed(CryptoNoteConnectionContext& context) {
+  m_downloader.removePeer(context.m_connection_id);
+
   bool updated = false;
   {
     std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -180,13 +178,8 @@ bool CryptoNoteProtocolHandler::start_sync(CryptoNoteConnectionContext& context)
   logger(Logging::TRACE) << context << "Starting synchronization";
 
   if (context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
-    assert(context.m_needed_objects.empty());
     assert(context.m_requested_objects.empty());
-
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
   }
 
   return true;
@@ -303,7 +296,7 @@ bool CryptoNoteProtocolHandler::get_payload_sync_data(CORE_SYNC_DATA& hshd) {
 }
 
 template <typename Command, typename Handler>
-int notifyAdaptor(const BinaryArray& reqBuf, CryptoNoteConnectionContext& ctx, Handler handler) {
+int notifyAdaptor(Common::ArrayView<uint8_t> reqBuf, CryptoNoteConnectionContext& ctx, Handler handler) {
 
   typedef typename Command::request Request;
   int command = Command::ID;
@@ -319,7 +312,7 @@ int notifyAdaptor(const BinaryArray& reqBuf, CryptoNoteConnectionContext& ctx, H
 // Changed std::bind -> lambda, for better debugging, remove it ASAP
 #define HANDLE_NOTIFY(CMD, Handler) case CMD::ID: { ret = notifyAdaptor<CMD>(in, ctx, [this](int a1, CMD::request& a2, CryptoNoteConnectionContext& a3) { return Handler(a1, a2, a3); }); break; }
 
-int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, const BinaryArray& in, BinaryArray& out, CryptoNoteConnectionContext& ctx, bool& handled) {
+int CryptoNoteProtocolHandler::handleCommand(bool is_notify, int command, Common::ArrayView<uint8_t> in, BinaryArray& out, CryptoNoteConnectionContext& ctx, bool& handled) {
   int ret = 0;
   handled = true;
 
@@ -369,10 +362,7 @@ int CryptoNoteProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_B
     }
   } else if (result == error::AddBlockErrorCondition::BLOCK_REJECTED) {
     context.m_state = CryptoNoteConnectionContext::state_synchronizing;
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
   } else {
     logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection: " << result.message();
     context.m_state = CryptoNoteConnectionContext::state_shutdown;
@@ -439,12 +429,15 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
 
   updateObservedHeight(arg.current_blockchain_height, context);
   context.m_remote_blockchain_height = arg.current_blockchain_height;
-  std::vector<BlockTemplate> blockTemplates;
-  std::vector<CachedBlock> cachedBlocks;
-  blockTemplates.resize(arg.blocks.size());
-  cachedBlocks.reserve(arg.blocks.size());
 
-  std::vector<RawBlock> rawBlocks = convertRawBlocksLegacyToRawBlocks(arg.blocks);
+  BlockDownloadScheduler::DownloadedBlocks downloaded;
+  downloaded.rawBlocks = convertRawBlocksLegacyToRawBlocks(std::move(arg.blocks));
+  downloaded.blockTemplates.resize(downloaded.rawBlocks.size());
+  downloaded.cachedBlocks.reserve(downloaded.rawBlocks.size());
+
+  const auto& rawBlocks = downloaded.rawBlocks;
+  auto& blockTemplates = downloaded.blockTemplates;
+  auto& cachedBlocks = downloaded.cachedBlocks;
 
   for (size_t index = 0; index < rawBlocks.size(); ++index) {
     if (!fromBinaryArray(blockTemplates[index], rawBlocks[index].block)) {
@@ -455,15 +448,6 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
     }
 
     cachedBlocks.emplace_back(blockTemplates[index]);
-    if (index == 1) {
-      if (m_core.hasBlock(cachedBlocks.back().getBlockHash())) { //TODO
-        context.m_state = CryptoNoteConnectionContext::state_idle;
-        context.m_needed_objects.clear();
-        context.m_requested_objects.clear();
-        logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
-        return 1;
-      }
-    }
 
     auto req_it = context.m_requested_objects.find(cachedBlocks.back().getBlockHash());
     if (req_it == context.m_requested_objects.end()) {
@@ -494,51 +478,84 @@ int CryptoNoteProtocolHandler::handle_response_get_objects(int command, NOTIFY_R
     return 1;
   }
 
-  {
-    int result = processObjects(context, std::move(rawBlocks), cachedBlocks);
-    if (result != 0) {
-      return result;
-    }
+  const size_t blockCount = downloaded.rawBlocks.size();
+  if (!m_downloader.deliver(context.m_connection_id, BlockDownloadScheduler::Clock::now(), std::move(downloaded))) {
+    logger(Logging::TRACE) << context << "response came after its blocks were requested elsewhere, ignoring " << blockCount << " blocks";
   }
 
-  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new index = " << m_core.getTopBlockIndex();
-  if (!m_stop && context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
-    request_missing_objects(context, true);
+  if (!processDownloadedBlocks(context)) {
+    return 1;
   }
 
+  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new index = " << m_core.getTopBlockIndex();
+  dispatchDownloads();
+
   return 1;
 }
 
-int CryptoNoteProtocolHandler::processObjects(CryptoNoteConnectionContext& context, std::vector<RawBlock>&& rawBlocks, const std::vector<CachedBlock>& cachedBlocks) {
+bool CryptoNoteProtocolHandler::processDownloadedBlocks(CryptoNoteConnectionContext& context) {
+  // processObjects yields between blocks, responses arriving meanwhile only queue their blocks
+  if (m_processingDownloads) {
+    return true;
+  }
+
+  m_processingDownloads = true;
+  BOOST_SCOPE_EXIT_ALL(this) {
+    m_processingDownloads = false;
+  };
+
+  BlockDownloadScheduler::DownloadedBlocks blocks;
+  while (!m_stop && m_downloader.popReady(blocks)) {
+    auto result = processObjects(std::move(blocks.rawBlocks), blocks.cachedBlocks);
+    if (!result) {
+      continue;
+    }
+
+    // everything queued after the failed block builds on it
+    m_downloader.reset();
+
+    if (blocks.peer == context.m_connection_id) {
+      if (result == error::AddBlockErrorCondition::BLOCK_REJECTED) {
+        logger(Logging::INFO) << context << "Block received at sync phase was marked as orphaned, dropping connection: " << result.message();
+      } else {
+        logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection: " << result.message();
+      }
+
+      context.m_state = CryptoNoteConnectionContext::state_shutdown;
+      return false;
+    }
+
+    logger(Logging::DEBUGGING) << "Block from connection " << blocks.peer << " failed to add, dropping it: " << result.message();
+    m_p2p->drop_connection(blocks.peer);
+    break;
+  }
+
+  return true;
+}
+
+std::error_code CryptoNoteProtocolHandler::processObjects(std::vector<RawBlock>&& rawBlocks, const std::vector<CachedBlock>& cachedBlocks) {
   assert(rawBlocks.size() == cachedBlocks.size());
   for (size_t index = 0; index < rawBlocks.size(); ++index) {
     if (m_stop) {
       break;
     }
 
-    auto addResult = m_core.addBlock(cachedBlocks[index], std::move(rawBlocks[index]));
-    if (addResult == error::AddBlockErrorCondition::BLOCK_VALIDATION_FAILED ||
-        addResult == error::AddBlockErrorCondition::TRANSACTION_VALIDATION_FAILED ||
-        addResult == error::AddBlockErrorCondition::DESERIALIZATION_FAILED) {
-      logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection: " << addResult.message();
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
-    } else if (addResult == error::AddBlockErrorCondition::BLOCK_REJECTED) {
-      logger(Logging::INFO) << context << "Block received at sync phase was marked as orphaned, dropping connection: " << addResult.message();
-      context.m_state = CryptoNoteConnectionContext::state_shutdown;
-      return 1;
-    } else if (addResult == error::AddBlockErrorCode::ALREADY_EXISTS) {
-      logger(Logging::DEBUGGING) << context << "Block already exists, switching to idle state: " << addResult.message();
-      context.m_state = CryptoNoteConnectionContext::state_idle;
-      context.m_needed_objects.clear();
-      context.m_requested_objects.clear();
-      return 1;
+    {
+      // a span per block, the time other contexts run in the yield is theirs
+      TRACE_SPAN("CryptoNoteProtocolHandler::processObjects");
+      auto addResult = m_core.addBlock(cachedBlocks[index], std::move(rawBlocks[index]));
+      if (addResult == error::AddBlockErrorCondition::BLOCK_VALIDATION_FAILED ||
+          addResult == error::AddBlockErrorCondition::TRANSACTION_VALIDATION_FAILED ||
+          addResult == error::AddBlockErrorCondition::DESERIALIZATION_FAILED ||
+          addResult == error::AddBlockErrorCondition::BLOCK_REJECTED) {
+        return addResult;
+      }
     }
 
     m_dispatcher.yield();
   }
 
-  return 0;
+  return std::error_code();
 }
 
 int CryptoNoteProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, CryptoNoteConnectionContext& context) {
@@ -564,43 +581,23 @@ int CryptoNoteProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_
   return 1;
 }
 
-bool CryptoNoteProtocolHandler::request_missing_objects(CryptoNoteConnectionContext& context, bool check_having_blocks) {
-  if (context.m_needed_objects.size()) {
-    //we know objects that we need, request this objects
-    NOTIFY_REQUEST_GET_OBJECTS::request req;
-    size_t count = 0;
-    auto it = context.m_needed_objects.begin();
+bool CryptoNoteProtocolHandler::request_missing_objects(CryptoNoteConnectionContext& context) {
+  if (m_downloader.isBusy(context.m_connection_id)) {
+    return true;
+  }
 
-    while (it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) {
-      if (!(check_having_blocks && m_core.hasBlock(*it))) {
-        req.blocks.push_back(*it);
-        ++count;
-        context.m_requested_objects.insert(*it);
-      }
-      it = context.m_needed_objects.erase(it);
-    }
+  NOTIFY_REQUEST_GET_OBJECTS::request req;
+  if (m_downloader.assign(context.m_connection_id, context.m_remote_blockchain_height, BlockDownloadScheduler::Clock::now(), req.blocks)) {
+    context.m_requested_objects.insert(req.blocks.begin(), req.blocks.end());
     logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size();
     post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
-  } else if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
-
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
-  } else {
-    if (!(context.m_last_response_height ==
-      context.m_remote_blockchain_height - 1 &&
-      !context.m_needed_objects.size() &&
-      !context.m_requested_objects.size())) {
-      logger(Logging::ERROR, Logging::BRIGHT_RED)
-        << "request_missing_blocks final condition failed!"
-        << "\r\nm_last_response_height=" << context.m_last_response_height
-        << "\r\nm_remote_blockchain_height=" << context.m_remote_blockchain_height
-        << "\r\nm_needed_objects.size()=" << context.m_needed_objects.size()
-        << "\r\nm_requested_objects.size()=" << context.m_requested_objects.size()
-        << "\r\non connection [" << context << "]";
-      return false;
+  } else if (get_current_blockchain_height() < context.m_remote_blockchain_height) {
+    // the peer has more, but the ids it advertised are in flight, waiting for the reorder window or on another branch
+    if (m_downloader.needsChain(context.m_connection_id, context.m_remote_blockchain_height) && !m_downloader.isChainRequestPending()) {
+      requestChain(context);
     }
+  } else {
+    assert(context.m_requested_objects.empty());
 
     requestMissingPoolTransactions(context);
 
@@ -611,6 +608,35 @@ bool CryptoNoteProtocolHandler::request_missing_objects(CryptoNoteConnectionCont
   return true;
 }
 
+void CryptoNoteProtocolHandler::requestChain(CryptoNoteConnectionContext& context) {
+  NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+  r.block_ids = m_core.buildSparseChain();
+  logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
+  m_downloader.chainRequested(context.m_connection_id, BlockDownloadScheduler::Clock::now());
+  post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+}
+
+void CryptoNoteProtocolHandler::dispatchDownloads() {
+  if (m_stop) {
+    return;
+  }
+
+  m_p2p->for_each_connection([this](CryptoNoteConnectionContext& context, PeerIdType peerId) {
+    if (context.m_state == CryptoNoteConnectionContext::state_synchronizing) {
+      request_missing_objects(context);
+    }
+  });
+}
+
+void CryptoNoteProtocolHandler::on_idle() {
+  for (const auto& peer : m_downloader.expireStalled(BlockDownloadScheduler::Clock::now())) {
+    logger(Logging::DEBUGGING) << "Connection " << peer << " stopped answering synchronization requests, dropping it";
+    m_p2p->drop_connection(peer);
+  }
+
+  dispatchDownloads();
+}
+
 bool CryptoNoteProtocolHandler::on_connection_synchronized() {
   bool val_expected = false;
   if (m_synchronized.compare_exchange_strong(val_expected, true)) {
@@ -649,6 +675,8 @@ int CryptoNoteProtocolHandler::handle_response_chain_entry(int command, NOTIFY_R
     return 1;
   }
 
+  m_downloader.chainReceived(context.m_connection_id);
+
   context.m_remote_blockchain_height = arg.total_height;
   context.m_last_response_height = arg.start_height + static_cast<uint32_t>(arg.m_block_ids.size()) - 1;
 
@@ -661,19 +689,16 @@ int CryptoNoteProtocolHandler::handle_response_chain_entry(int command, NOTIFY_R
     context.m_state = CryptoNoteConnectionContext::state_shutdown;
   }
 
-  bool allBlocksKnown = true;
-  for (auto& bl_id : arg.m_block_ids) {
-    if (allBlocksKnown) {
-      if (!m_core.hasBlock(bl_id)) {
-        context.m_needed_objects.push_back(bl_id);
-        allBlocksKnown = false;
-      }
-    } else {
-      context.m_needed_objects.push_back(bl_id);
-    }
+  size_t firstUnknown = 0;
+  while (firstUnknown < arg.m_block_ids.size() && m_core.hasBlock(arg.m_block_ids[firstUnknown])) {
+    ++firstUnknown;
   }
 
-  request_missing_objects(context, false);
+  std::vector<Crypto::Hash> neededBlocks(arg.m_block_ids.begin() + firstUnknown, arg.m_block_ids.end());
+  size_t queued = m_downloader.addHashes(context.m_connection_id, context.m_remote_blockchain_height, arg.start_height + static_cast<uint32_t>(firstUnknown), neededBlocks);
+  logger(Logging::TRACE) << context << "queued " << queued << " new block ids, " << m_downloader.queuedCount() << " waiting to be added";
+
+  dispatchDownloads();
   return 1;
 }
 
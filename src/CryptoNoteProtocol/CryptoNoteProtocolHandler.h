@@ -19,10 +19,12 @@
 
 #include <atomic>
 
+#include <Common/ArrayView.h>
 #include <Common/ObserverManager.h>
 
 #include "CryptoNoteCore/ICore.h"
 
+#include "CryptoNoteProtocol/BlockDownloadScheduler.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolDefinitions.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandlerCommon.h"
 #include "CryptoNoteProtocol/ICryptoNoteProtocolObserver.h"
@@ -64,11 +66,16 @@ namespace CryptoNote
     CoreStatistics getStatistics();
     bool get_payload_sync_data(CORE_SYNC_DATA& hshd);
     bool process_payload_sync_data(const CORE_SYNC_DATA& hshd, CryptoNoteConnectionContext& context, bool is_inital);
-    int handleCommand(bool is_notify, int command, const BinaryArray& in_buff, BinaryArray& buff_out, CryptoNoteConnectionContext& context, bool& handled);
+    int handleCommand(bool is_notify, int command, Common::ArrayView<uint8_t> in_buff, BinaryArray& buff_out, CryptoNoteConnectionContext& context, bool& handled);
     virtual size_t getPeerCount() const override;
     virtual uint32_t getObservedHeight() const override;
     virtual uint32_t getBlockchainHeight() const override;
+    // Block ids waiting to be downloaded and downloaded blocks waiting to be added
+    size_t getQueuedBlockCount() const;
+    size_t getReadyBlockCount() const;
     void requestMissingPoolTransactions(const CryptoNoteConnectionContext& context);
+    // Called by the p2p layer about once a second
+    void on_idle();
 
   private:
     //----------------- commands handlers ----------------------------------------------
@@ -86,11 +93,14 @@ namespace CryptoNote
 
     //----------------------------------------------------------------------------------
     uint32_t get_current_blockchain_height();
-    bool request_missing_objects(CryptoNoteConnectionContext& context, bool check_having_blocks);
+    bool request_missing_objects(CryptoNoteConnectionContext& context);
+    void requestChain(CryptoNoteConnectionContext& context);
+    void dispatchDownloads();
+    bool processDownloadedBlocks(CryptoNoteConnectionContext& context);
     bool on_connection_synchronized();
     void updateObservedHeight(uint32_t peerHeight, const CryptoNoteConnectionContext& context);
     void recalculateMaxObservedHeight(const CryptoNoteConnectionContext& context);
-    int processObjects(CryptoNoteConnectionContext& context, std::vector<RawBlock>&& rawBlocks, const std::vector<CachedBlock>& cachedBlocks);
+    std::error_code processObjects(std::vector<RawBlock>&& rawBlocks, const std::vector<CachedBlock>& cachedBlocks);
     Logging::LoggerRef logger;
 
   private:
@@ -111,6 +121,9 @@ namespace CryptoNote
     uint32_t m_blockchainHeight;
 
     std::atomic<size_t> m_peersCount;
+
+    BlockDownloadScheduler m_downloader;
+    bool m_processingDownloads;
     Tools::ObserverManager<ICryptoNoteProtocolObserver> m_observerManager;
   };
 }
@@ -4,18 +4,234 @@
 
 #include <iostream>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 #include "CryptoNote.h"
 #include "CryptoTypes.h"
 #include "Common/StringTools.h"
 #include "crypto/crypto.h"
 
+namespace Crypto {
+  extern "C" {
+#include "crypto/crypto-ops.h"
+  }
+}
+
 #define PERFORMANCE_ITERATIONS  1000
+#define CRYPTO_OPS_KAT_ROUNDS   64
+#define CRYPTO_OPS_ITERATIONS   1000
+#define RING_SIZE               16
+
+/* Digest of every deterministic crypto_ops output produced by runCryptoOpsKat,
+   generated with the ref10 backend. All backends must reproduce it. */
+const std::string CRYPTO_OPS_KAT_DIGEST = "c06695561bc71c692b470f225adf5888672d3a6ae3d8c2d42cfb05f02adff816";
 
 using namespace Crypto;
 using namespace CryptoNote;
 
+namespace {
+
+const char* backendName(int backend)
+{
+  return backend == CRYPTO_OPS_BACKEND_FE51 ? "fe51" : "ref10";
+}
+
+std::vector<int> availableBackends()
+{
+  std::vector<int> backends;
+  const int previous = crypto_ops_get_backend();
+
+  for (int backend : {CRYPTO_OPS_BACKEND_REF10, CRYPTO_OPS_BACKEND_FE51})
+  {
+    if (crypto_ops_set_backend(backend) == 0)
+    {
+      backends.push_back(backend);
+    }
+  }
+
+  crypto_ops_set_backend(previous);
+  return backends;
+}
+
+template<typename T>
+void absorb(Hash& digest, const T& value)
+{
+  uint8_t buffer[sizeof(Hash) + sizeof(T)];
+  memcpy(buffer, &digest, sizeof(Hash));
+  memcpy(buffer + sizeof(Hash), &value, sizeof(T));
+  cn_fast_hash(buffer, sizeof(buffer), digest);
+}
+
+/* Runs every crypto_ops entry point on a deterministic key schedule and
+   folds the results into one digest. The randomised operations (signatures,
+   fresh keys) are checked for round trips instead, since their output cannot
+   be pinned. */
+bool runCryptoOpsKat(Hash& digest)
+{
+  bool success = true;
+  Hash seed = cn_fast_hash("TurtleCoin crypto_ops known answer tests", 40);
+  const uint8_t suffix[] = {0x74, 0x75, 0x72, 0x74, 0x6c, 0x65};
+
+  digest = Hash();
+
+  for (int i = 0; i < CRYPTO_OPS_KAT_ROUNDS; i++)
+  {
+    PublicKey viewPub, spendPub, txPub, derivedPub, derivedPubSuffix, underived, underivedSuffix, underivedScalarBase, recomputed, ecPoint;
+    SecretKey viewSec, spendSec, txSec, mSec, derivedSec, derivedSecSuffix;
+    KeyDerivation senderDerivation, receiverDerivation;
+    KeyImage image;
+    EllipticCurveScalar hashedDerivation;
+
+    seed = cn_fast_hash(&seed, sizeof(seed));
+    SecretKey seedKey = reinterpret_cast<const SecretKey&>(seed);
+
+    generate_deterministic_keys(viewPub, viewSec, seedKey);
+    seed = cn_fast_hash(&seed, sizeof(seed));
+    seedKey = reinterpret_cast<const SecretKey&>(seed);
+    generate_m_keys(spendPub, spendSec, seedKey, true);
+    seed = cn_fast_hash(&seed, sizeof(seed));
+    seedKey = reinterpret_cast<const SecretKey&>(seed);
+    generate_deterministic_keys(txPub, txSec, seedKey);
+    generate_m_keys(recomputed, mSec, txSec, true);
+
+    success &= check_key(viewPub) && check_key(spendPub) && check_key(txPub);
+    success &= secret_key_to_public_key(spendSec, recomputed) && recomputed == spendPub;
+    success &= generate_key_derivation(viewPub, txSec, senderDerivation);
+    success &= generate_key_derivation(txPub, viewSec, receiverDerivation);
+    success &= memcmp(&senderDerivation, &receiverDerivation, sizeof(KeyDerivation)) == 0;
+
+    success &= derive_public_key(senderDerivation, i, spendPub, derivedPub);
+    success &= derive_public_key(senderDerivation, i, spendPub, suffix, sizeof(suffix), derivedPubSuffix);
+    derive_secret_key(receiverDerivation, i, spendSec, derivedSec);
+    derive_secret_key(receiverDerivation, i, spendSec, suffix, sizeof(suffix), derivedSecSuffix);
+    success &= secret_key_to_public_key(derivedSec, recomputed) && recomputed == derivedPub;
+    success &= secret_key_to_public_key(derivedSecSuffix, recomputed) && recomputed == derivedPubSuffix;
+
+    success &= underive_public_key(receiverDerivation, i, derivedPub, underived) && underived == spendPub;
+    success &= underive_public_key(receiverDerivation, i, derivedPubSuffix, suffix, sizeof(suffix), underivedSuffix) && underivedSuffix == spendPub;
+    success &= underive_public_key_and_get_scalar(receiverDerivation, i, derivedPub, underivedScalarBase, hashedDerivation) && underivedScalarBase == spendPub;
+
+    generate_key_image(derivedPub, derivedSec, image);
+    hash_data_to_ec(reinterpret_cast<const uint8_t*>(&derivedPub), sizeof(derivedPub), ecPoint);
+    const KeyImage scaled = scalarmultKey(reinterpret_cast<const KeyImage&>(ecPoint), reinterpret_cast<const KeyImage&>(derivedSec));
+    success &= scaled == image;
+
+    /* An invalid point must be rejected the same way by every backend */
+    PublicKey garbage = reinterpret_cast<const PublicKey&>(seed);
+    const bool garbageValid = check_key(garbage);
+
+    absorb(digest, viewPub);
+    absorb(digest, spendPub);
+    absorb(digest, txPub);
+    absorb(digest, mSec);
+    absorb(digest, senderDerivation);
+    absorb(digest, derivedPub);
+    absorb(digest, derivedPubSuffix);
+    absorb(digest, derivedSec);
+    absorb(digest, derivedSecSuffix);
+    absorb(digest, hashedDerivation);
+    absorb(digest, image);
+    absorb(digest, ecPoint);
+    absorb(digest, garbageValid);
+
+    Signature signature;
+    generate_signature(seed, derivedPub, derivedSec, signature);
+    success &= check_signature(seed, derivedPub, signature);
+    success &= !check_signature(seed, spendPub, signature);
+
+    if (i % 16 == 0)
+    {
+      std::vector<PublicKey> ring(i / 16 + 1);
+      std::vector<const PublicKey*> ringPointers;
+      std::vector<Signature> signatures(ring.size());
+      const size_t realIndex = i % ring.size();
+      SecretKey unused;
+
+      for (size_t j = 0; j < ring.size(); j++)
+      {
+        generate_keys(ring[j], unused);
+        ringPointers.push_back(&ring[j]);
+      }
+      ring[realIndex] = derivedPub;
+
+      generate_ring_signature(seed, image, ringPointers, derivedSec, realIndex, signatures.data());
+      success &= check_ring_signature(seed, image, ringPointers, signatures.data(), true);
+      signatures[0].data[0] ^= 1;
+      success &= !check_ring_signature(seed, image, ringPointers, signatures.data(), true);
+    }
+  }
+
+  return success;
+}
+
+template<typename F>
+double microsecondsPerOp(size_t iterations, F operation)
+{
+  auto startTimer = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < iterations; i++)
+  {
+    operation(i);
+  }
+  auto elapsedTime = std::chrono::high_resolution_clock::now() - startTimer;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsedTime).count() / 1000.0 / iterations;
+}
+
+void benchmarkCryptoOps()
+{
+  std::vector<PublicKey> ring(RING_SIZE);
+  std::vector<SecretKey> secrets(RING_SIZE);
+  std::vector<const PublicKey*> ringPointers;
+  std::vector<Signature> signatures(RING_SIZE);
+  KeyDerivation derivation;
+  KeyImage image;
+  Hash prefixHash = cn_fast_hash("prefix", 6);
+
+  for (size_t i = 0; i < RING_SIZE; i++)
+  {
+    generate_keys(ring[i], secrets[i]);
+    ringPointers.push_back(&ring[i]);
+  }
+
+  generate_key_image(ring[0], secrets[0], image);
+  generate_ring_signature(prefixHash, image, ringPointers, secrets[0], 0, signatures.data());
+  generate_key_derivation(ring[1], secrets[0], derivation);
+
+  for (int backend : availableBackends())
+  {
+    crypto_ops_set_backend(backend);
+
+    PublicKey derived;
+    KeyImage tmpImage;
+
+    std::cout << backendName(backend) << " generate_key_derivation: "
+      << microsecondsPerOp(CRYPTO_OPS_ITERATIONS, [&](size_t i) { generate_key_derivation(ring[i % RING_SIZE], secrets[0], derivation); })
+      << " us/op\n";
+
+    std::cout << backendName(backend) << " derive_public_key: "
+      << microsecondsPerOp(CRYPTO_OPS_ITERATIONS, [&](size_t i) { derive_public_key(derivation, i, ring[0], derived); })
+      << " us/op\n";
+
+    std::cout << backendName(backend) << " underive_public_key: "
+      << microsecondsPerOp(CRYPTO_OPS_ITERATIONS, [&](size_t i) { underive_public_key(derivation, i, ring[0], derived); })
+      << " us/op\n";
+
+    std::cout << backendName(backend) << " generate_key_image: "
+      << microsecondsPerOp(CRYPTO_OPS_ITERATIONS, [&](size_t i) { generate_key_image(ring[0], secrets[0], tmpImage); })
+      << " us/op\n";
+
+    std::cout << backendName(backend) << " check_ring_signature (" << RING_SIZE << " keys): "
+      << microsecondsPerOp(CRYPTO_OPS_ITERATIONS / RING_SIZE, [&](size_t i) { check_ring_signature(prefixHash, image, ringPointers, signatures.data(), true); })
+      << " us/op\n";
+  }
+}
+
+} // namespace
+
 int main(int argc, char** argv) {
+  int result = 0;
+
   try {
     if (argc != 2)
     {
@@ -54,6 +270,26 @@ int main(int argc, char** argv) {
       std::cout << "cn_lite_slow_hash_v2: " << Common::toHex(&hash, sizeof(Hash)) << "\n";
     }
 
+    std::cout << "\nCrypto ops known answer tests (default backend: " << backendName(crypto_ops_get_backend()) << ")\n\n";
+
+    const int defaultBackend = crypto_ops_get_backend();
+    for (int backend : availableBackends())
+    {
+      Hash digest;
+      crypto_ops_set_backend(backend);
+      const bool roundTrips = runCryptoOpsKat(digest);
+      const bool digestMatches = Common::podToHex(digest) == CRYPTO_OPS_KAT_DIGEST;
+
+      std::cout << backendName(backend) << ": " << Common::podToHex(digest)
+        << (roundTrips && digestMatches ? " OK" : " FAILED") << "\n";
+
+      if (!roundTrips || !digestMatches)
+      {
+        result = 1;
+      }
+    }
+    crypto_ops_set_backend(defaultBackend);
+
     std::cout <<  "\nPerformance Tests: Please wait, this may take a while depending on your system...\n\n";
 
     auto startTimer = std::chrono::high_resolution_clock::now();
@@ -62,7 +298,7 @@ int main(int argc, char** argv) {
       cn_slow_hash_v0(rawData.data(), rawData.size(), hash);
     }
     auto elapsedTime = std::chrono::high_resolution_clock::now() - startTimer;
-    std::cout << "cn_slow_hash_v0: " << (PERFORMANCE_ITERATIONS / std::chrono::duration_cast<std::chrono::seconds>(elapsedTime).count()) << " H/s\n";
+    std::cout << "cn_slow_hash_v0: " << (PERFORMANCE_ITERATIONS / std::chrono::duration<double>(elapsedTime).count()) << " H/s\n";
 
     startTimer = std::chrono::high_resolution_clock::now();
     for (auto i = 0; i < PERFORMANCE_ITERATIONS; i++)
@@ -70,12 +306,16 @@ int main(int argc, char** argv) {
       cn_lite_slow_hash_v0(rawData.data(), rawData.size(), hash);
     }
     elapsedTime = std::chrono::high_resolution_clock::now() - startTimer;
-    std::cout << "cn_lite_slow_hash_v0: " << (PERFORMANCE_ITERATIONS / std::chrono::duration_cast<std::chrono::seconds>(elapsedTime).count()) << " H/s\n";
+    std::cout << "cn_lite_slow_hash_v0: " << (PERFORMANCE_ITERATIONS / std::chrono::duration<double>(elapsedTime).count()) << " H/s\n";
+
+    std::cout << "\n";
+    benchmarkCryptoOps();
+    crypto_ops_set_backend(defaultBackend);
   }
   catch (std::exception& e)
   {
     std::cout << "Something went terribly wrong...\n" << e.what() << "\n\n";
   }
 
-  return 0;
-}
\ No newline at end of file
+  return result;
+}
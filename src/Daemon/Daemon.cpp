@@ -23,6 +23,8 @@
 #include "CryptoNoteCore/Currency.h"
 #include "CryptoNoteCore/DatabaseBlockchainCache.h"
 #include "CryptoNoteCore/DatabaseBlockchainCacheFactory.h"
+#include "CryptoNoteCore/DatabaseMainChainStorage.h"
+#include "CryptoNoteCore/DatabaseSnapshot.h"
 #include "CryptoNoteCore/MainChainStorage.h"
 #include "CryptoNoteCore/RocksDBWrapper.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandler.h"
@@ -68,6 +70,24 @@ namespace
   const command_line::arg_descriptor<std::string> arg_load_checkpoints   = {"load-checkpoints", "<default|filename> Use builtin default checkpoints or checkpoint csv file for faster initial blockchain sync", "default"};
   const command_line::arg_descriptor<std::string> arg_set_fee_address = { "fee-address", "Sets fee address for light wallets that use the daemon.", "" };
   const command_line::arg_descriptor<int> arg_set_fee_amount = { "fee-amount", "Sets the fee amount for the light wallets that use the daemon.", 0 };
+  const command_line::arg_descriptor<uint32_t> arg_rpc_threads = { "rpc-threads", "Number of threads reading and writing RPC connections, 0 keeps them on the main thread", 0 };
+  const command_line::arg_descriptor<uint32_t> arg_rpc_max_body_size = { "rpc-max-body-size", "Largest RPC request body accepted, in bytes", 16 * 1024 * 1024 };
+  const command_line::arg_descriptor<std::string> arg_import_snapshot = { "import-snapshot", "Import the DB snapshot export_snapshot wrote to a directory, into a data directory without a blockchain yet, before starting", "" };
+
+  // Blocks come one at a time once the chain has caught up, so the DB stops
+  // gathering them into group commits
+  class DataBaseSyncObserver : public CryptoNote::ICryptoNoteProtocolObserver {
+  public:
+    DataBaseSyncObserver(CryptoNote::RocksDBWrapper& database) : database(database) {
+    }
+
+    virtual void blockchainSynchronized(uint32_t topHeight) override {
+      database.setGroupCommit(false);
+    }
+
+  private:
+    CryptoNote::RocksDBWrapper& database;
+  };
 }
 
 bool command_line_preprocessor(const boost::program_options::variables_map& vm, LoggerRef& logger);
@@ -160,6 +180,7 @@ int main(int argc, char* argv[])
     // tools::get_default_data_dir() can't be called during static initialization
     command_line::add_arg(desc_cmd_sett, command_line::arg_data_dir, Tools::getDefaultDataDirectory());
     command_line::add_arg(desc_cmd_only, arg_config_file);
+    command_line::add_arg(desc_cmd_only, arg_import_snapshot);
 
     command_line::add_arg(desc_cmd_sett, arg_log_file);
     command_line::add_arg(desc_cmd_sett, arg_log_level);
@@ -172,6 +193,8 @@ int main(int argc, char* argv[])
     command_line::add_arg(desc_cmd_sett, arg_load_checkpoints);
     command_line::add_arg(desc_cmd_sett, arg_set_fee_address);
     command_line::add_arg(desc_cmd_sett, arg_set_fee_amount);
+    command_line::add_arg(desc_cmd_sett, arg_rpc_threads);
+    command_line::add_arg(desc_cmd_sett, arg_rpc_max_body_size);
     
     RpcServerConfig::initOptions(desc_cmd_sett);
     NetNodeConfig::initOptions(desc_cmd_sett);
@@ -298,6 +321,10 @@ int main(int argc, char* argv[])
       }
     }
 
+    if (!command_line::get_arg(vm, arg_import_snapshot).empty()) {
+      DB::importSnapshot(command_line::get_arg(vm, arg_import_snapshot), dbConfig, currency, checkpoints, logManager);
+    }
+
     RocksDBWrapper database(logManager);
     database.init(dbConfig);
     Tools::ScopeExit dbShutdownOnExit([&database] () { database.shutdown(); });
@@ -313,6 +340,17 @@ int main(int argc, char* argv[])
       dbShutdownOnExit.resume();
     }
 
+    database.setGroupCommit(true);
+
+    std::unique_ptr<IMainChainStorage> mainChainStorage;
+    if (dbConfig.getStoreBlocks()) {
+      mainChainStorage = createDatabaseMainChainStorage(database, data_dir_path.string(), currency, logManager);
+    } else {
+      // Raw blocks an earlier run kept in the DB only go back to blocks.bin first
+      exportDatabaseMainChainStorage(database, data_dir_path.string(), currency, logManager);
+      mainChainStorage = createSwappedMainChainStorage(data_dir_path.string(), currency);
+    }
+
     System::Dispatcher dispatcher;
     logger(INFO) << "Initializing core...";
     CryptoNote::Core ccore(
@@ -320,19 +358,34 @@ int main(int argc, char* argv[])
       logManager,
       std::move(checkpoints),
       dispatcher,
-      std::unique_ptr<IBlockchainCacheFactory>(new DatabaseBlockchainCacheFactory(database, logger.getLogger())),
-      createSwappedMainChainStorage(data_dir_path.string(), currency));
+      std::unique_ptr<IBlockchainCacheFactory>(new DatabaseBlockchainCacheFactory(database, logger.getLogger(), dbConfig.getStoreBlocks())),
+      std::move(mainChainStorage));
 
     ccore.load();
     logger(INFO) << "Core initialized OK";
 
+    DataBaseSyncObserver dbSyncObserver(database);
     CryptoNote::CryptoNoteProtocolHandler cprotocol(currency, dispatcher, ccore, nullptr, logManager);
+    cprotocol.addObserver(&dbSyncObserver);
     CryptoNote::NodeServer p2psrv(dispatcher, cprotocol, logManager);
+
+    std::unique_ptr<System::DispatcherPool> rpcPool;
+    uint32_t rpcThreads = command_line::get_arg(vm, arg_rpc_threads);
+    if (rpcThreads != 0) {
+      rpcPool.reset(new System::DispatcherPool(dispatcher, rpcThreads));
+    }
+
     CryptoNote::RpcServer rpcServer(dispatcher, logManager, ccore, p2psrv, cprotocol);
+    if (rpcPool) {
+      rpcServer.setDispatcherPool(*rpcPool);
+    }
+
+    rpcServer.setDatabase(&database);
+    rpcServer.setMaxRequestBodySize(command_line::get_arg(vm, arg_rpc_max_body_size));
 
     cprotocol.set_p2p_endpoint(&p2psrv);
     //DaemonCommandsHandler dch(ccore, p2psrv, logManager);
-    DaemonCommandsHandler dch(ccore, p2psrv, logManager, &rpcServer);
+    DaemonCommandsHandler dch(ccore, p2psrv, logManager, &rpcServer, &database);
     logger(INFO) << "Initializing p2p server...";
     if (!p2psrv.init(netNodeConfig)) {
       logger(ERROR, BRIGHT_RED) << "Failed to initialize p2p server.";
@@ -5,9 +5,14 @@
 
 #include "DaemonCommandsHandler.h"
 
+#include <algorithm>
 #include <ctime>
+#include <fstream>
+#include <iomanip>
 #include "P2p/NetNode.h"
 #include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/DatabaseSnapshot.h"
+#include "CryptoNoteCore/RocksDBWrapper.h"
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandler.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "Serialization/SerializationTools.h"
@@ -17,6 +22,7 @@
 #include "CryptoNoteCore/Currency.h"
 #include <boost/format.hpp>
 #include "Common/FormatTools.h"
+#include "Common/Trace.h"
 
 namespace {
 template <typename T>
@@ -45,8 +51,8 @@ std::string printTransactionFullInfo(const CryptoNote::CachedTransaction& transa
 
 }
 
-DaemonCommandsHandler::DaemonCommandsHandler(CryptoNote::Core& core, CryptoNote::NodeServer& srv, Logging::LoggerManager& log, CryptoNote::RpcServer* prpc_server) :
-  m_core(core), m_srv(srv), logger(log, "daemon"), m_logManager(log), m_prpc_server(prpc_server) {
+DaemonCommandsHandler::DaemonCommandsHandler(CryptoNote::Core& core, CryptoNote::NodeServer& srv, Logging::LoggerManager& log, CryptoNote::RpcServer* prpc_server, CryptoNote::RocksDBWrapper* database) :
+  m_core(core), m_srv(srv), logger(log, "daemon"), m_logManager(log), m_prpc_server(prpc_server), m_database(database) {
   m_consoleHandler.setHandler("exit", boost::bind(&DaemonCommandsHandler::exit, this, _1), "Shutdown the daemon");
   m_consoleHandler.setHandler("help", boost::bind(&DaemonCommandsHandler::help, this, _1), "Show this help");
   m_consoleHandler.setHandler("print_pl", boost::bind(&DaemonCommandsHandler::print_pl, this, _1), "Print peer list");
@@ -60,6 +66,14 @@ DaemonCommandsHandler::DaemonCommandsHandler(CryptoNote::Core& core, CryptoNote:
   m_consoleHandler.setHandler("print_pool_sh", boost::bind(&DaemonCommandsHandler::print_pool_sh, this, _1), "Print transaction pool (short format)");
   m_consoleHandler.setHandler("set_log", boost::bind(&DaemonCommandsHandler::set_log, this, _1), "set_log <level> - Change current log level, <level> is a number 0-4");
   m_consoleHandler.setHandler("status", boost::bind(&DaemonCommandsHandler::status, this, _1), "Show daemon status");
+  if (m_database != nullptr) {
+    m_consoleHandler.setHandler("print_db_stats", boost::bind(&DaemonCommandsHandler::print_db_stats, this, _1), "Print per column family DB statistics");
+    m_consoleHandler.setHandler("export_snapshot", boost::bind(&DaemonCommandsHandler::export_snapshot, this, _1), "Write a DB snapshot cut back to the last checkpoint, export_snapshot <directory>");
+  }
+#ifdef ENABLE_TRACING
+  m_consoleHandler.setHandler("print_trace", boost::bind(&DaemonCommandsHandler::print_trace, this, _1), "Print the average time of each traced block processing stage over its recent spans");
+  m_consoleHandler.setHandler("dump_trace", boost::bind(&DaemonCommandsHandler::dump_trace, this, _1), "Write the recent traced spans as a Chrome trace, dump_trace <file>");
+#endif
 }
 
 //--------------------------------------------------------------------------------
@@ -328,3 +342,99 @@ bool DaemonCommandsHandler::status(const std::vector<std::string>& args)
   
   return true;
 }
+//--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::print_db_stats(const std::vector<std::string>& args)
+{
+  const CryptoNote::DataBaseStatistics stats = m_database->getStatistics();
+  const uint64_t megabyte = 1024 * 1024;
+
+  std::cout << std::left << std::setw(14) << "family" << std::setw(28) << "tuning" << std::right
+    << std::setw(14) << "keys" << std::setw(12) << "sst MB" << std::setw(12) << "memtable MB"
+    << std::setw(12) << "filters MB" << std::setw(14) << "compaction MB" << std::endl;
+
+  for (const auto& family : stats.columnFamilies) {
+    std::cout << std::left << std::setw(14) << family.name << std::setw(28) << family.tuning << std::right
+      << std::setw(14) << family.estimatedKeys
+      << std::setw(12) << family.sstFilesSize / megabyte
+      << std::setw(12) << family.memTablesSize / megabyte
+      << std::setw(12) << family.tableReadersMemory / megabyte
+      << std::setw(14) << family.pendingCompactionBytes / megabyte << std::endl;
+  }
+
+  const uint64_t cacheLookups = stats.blockCacheHits + stats.blockCacheMisses;
+  std::cout << std::endl << "block cache: " << stats.blockCacheUsage / megabyte << " of " << stats.blockCacheCapacity / megabyte << " MB used, "
+    << stats.blockCacheHits << " hits, " << stats.blockCacheMisses << " misses";
+  if (cacheLookups != 0) {
+    std::cout << " (" << std::fixed << std::setprecision(1) << 100.0 * stats.blockCacheHits / cacheLookups << "% hit rate)";
+  }
+
+  std::cout << std::endl << "bloom filters: " << stats.bloomFilterUseful << " lookups skipped by key, "
+    << stats.bloomFilterPrefixUseful << " of " << stats.bloomFilterPrefixChecked << " skipped by prefix" << std::endl;
+  std::cout << "pending writes: " << stats.pendingWrites << ", " << stats.pendingBytes / megabyte << " MB" << std::endl;
+  std::cout << "reads: " << stats.reads.count << ", median " << stats.reads.medianMicroseconds << " us, 99% "
+    << stats.reads.percentile99Microseconds << " us" << std::endl;
+  std::cout << "writes: " << stats.writes.count << ", median " << stats.writes.medianMicroseconds << " us, 99% "
+    << stats.writes.percentile99Microseconds << " us" << std::endl;
+
+  return true;
+}
+//--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::export_snapshot(const std::vector<std::string>& args)
+{
+  if (args.size() != 1) {
+    std::cout << "use: export_snapshot <directory>" << std::endl;
+    return true;
+  }
+
+  try {
+    uint32_t topIndex = CryptoNote::DB::exportSnapshot(*m_database, args[0], m_core.getCurrency(), m_core.getCheckpoints(), m_logManager);
+    std::cout << "Snapshot of blocks 0 to " << topIndex << " written to " << args[0] << std::endl;
+  } catch (std::exception& e) {
+    std::cout << "Snapshot export failed: " << e.what() << std::endl;
+  }
+
+  return true;
+}
+//--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::print_trace(const std::vector<std::string>& args)
+{
+  std::vector<Common::Trace::StageStatistics> stages = Common::Trace::getStageStatistics();
+  if (stages.empty()) {
+    std::cout << "No spans recorded yet" << std::endl;
+    return true;
+  }
+
+  std::sort(stages.begin(), stages.end(), [](const Common::Trace::StageStatistics& a, const Common::Trace::StageStatistics& b) {
+    return a.totalMicroseconds > b.totalMicroseconds;
+  });
+
+  std::cout << std::left << std::setw(46) << "stage" << std::right << std::setw(10) << "spans"
+    << std::setw(14) << "average us" << std::setw(14) << "max us" << std::setw(14) << "total ms" << std::endl;
+
+  for (const auto& stage : stages) {
+    std::cout << std::left << std::setw(46) << stage.name << std::right << std::setw(10) << stage.count
+      << std::fixed << std::setprecision(1) << std::setw(14) << stage.averageMicroseconds
+      << std::setw(14) << stage.maxMicroseconds << std::setw(14) << stage.totalMicroseconds / 1000 << std::endl;
+  }
+
+  return true;
+}
+//--------------------------------------------------------------------------------
+bool DaemonCommandsHandler::dump_trace(const std::vector<std::string>& args)
+{
+  if (args.size() != 1) {
+    std::cout << "use: dump_trace <file>" << std::endl;
+    return true;
+  }
+
+  std::ofstream file(args[0]);
+  Common::Trace::writeChromeTrace(file);
+  file.close();
+  if (!file) {
+    std::cout << "Failed to write " << args[0] << std::endl;
+    return true;
+  }
+
+  std::cout << "Trace written to " << args[0] << ", open it in chrome://tracing" << std::endl;
+  return true;
+}
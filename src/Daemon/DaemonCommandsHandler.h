@@ -15,13 +15,14 @@
 
 namespace CryptoNote {
 class Core;
+class RocksDBWrapper;
 class NodeServer;
 }
 
 class DaemonCommandsHandler
 {
 public:
-  DaemonCommandsHandler(CryptoNote::Core& core, CryptoNote::NodeServer& srv, Logging::LoggerManager& log, CryptoNote::RpcServer* prpc_server);
+  DaemonCommandsHandler(CryptoNote::Core& core, CryptoNote::NodeServer& srv, Logging::LoggerManager& log, CryptoNote::RpcServer* prpc_server, CryptoNote::RocksDBWrapper* database = nullptr);
 
   bool start_handling() {
     m_consoleHandler.start();
@@ -40,6 +41,7 @@ private:
   Logging::LoggerRef logger;
   Logging::LoggerManager& m_logManager;
   CryptoNote::RpcServer* m_prpc_server;
+  CryptoNote::RocksDBWrapper* m_database;
 
   std::string get_commands_str();
   bool print_block_by_height(uint32_t height);
@@ -62,4 +64,8 @@ private:
   bool start_mining(const std::vector<std::string>& args);
   bool stop_mining(const std::vector<std::string>& args);
   bool status(const std::vector<std::string>& args);
+  bool print_db_stats(const std::vector<std::string>& args);
+  bool export_snapshot(const std::vector<std::string>& args);
+  bool print_trace(const std::vector<std::string>& args);
+  bool dump_trace(const std::vector<std::string>& args);
 };
@@ -0,0 +1,590 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/JsonValue.h"
+#include "Common/StdInputStream.h"
+#include "Common/StdOutputStream.h"
+#include "CryptoNoteCore/BlockchainReadBatch.h"
+#include "CryptoNoteCore/BlockchainWriteBatch.h"
+#include "CryptoNoteCore/DataBaseConfig.h"
+#include "CryptoNoteCore/DBUtils.h"
+#include "CryptoNoteCore/RocksDBWrapper.h"
+#include "Logging/ConsoleLogger.h"
+#include "Serialization/KVBinaryInputStreamSerializer.h"
+#include "Serialization/KVBinaryOutputStreamSerializer.h"
+
+using namespace CryptoNote;
+using Common::JsonValue;
+
+namespace {
+
+/* Timing samples are taken over a group of calls, so that very cheap
+   operations are not dominated by the clock itself */
+const uint64_t TARGET_SAMPLE_NANOSECONDS = 20000;
+
+/* Shape of the synthetic blocks, roughly a busy mainnet block */
+const uint32_t TRANSACTIONS_PER_BLOCK = 8;
+const uint32_t INPUTS_PER_TRANSACTION = 2;
+const uint32_t OUTPUTS_PER_TRANSACTION = 4;
+const uint32_t AMOUNT_COUNT = 16;
+const size_t RAW_TRANSACTION_SIZE = 600;
+
+/* What a getblockheaderbyheight range or a random outputs request reads */
+const uint32_t HEADERS_PER_READ = 100;
+const uint32_t OUTPUTS_PER_READ = 16;
+
+struct Options {
+  bool json = false;
+  bool groupCommit = false;
+  double seconds = 1.0;
+  uint32_t blocks = 20000;
+  std::string dataDir;
+  std::string filter;
+};
+
+struct Benchmark {
+  std::string name;
+  // called with an increasing counter, so operations can cycle through inputs
+  std::function<void(size_t)> operation;
+};
+
+struct Result {
+  std::string name;
+  uint64_t operations;
+  double mean;
+  double min;
+  double p50;
+  double p90;
+  double p99;
+  double max;
+};
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+double percentile(const std::vector<double>& sorted, double fraction)
+{
+  const size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+/* Calls per sample, doubling until one sample takes TARGET_SAMPLE_NANOSECONDS */
+size_t calibrate(const Benchmark& benchmark, size_t& counter)
+{
+  size_t calls = 1;
+
+  while (true)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; i++)
+    {
+      benchmark.operation(counter++);
+    }
+
+    if (nanosecondsSince(start) >= TARGET_SAMPLE_NANOSECONDS || calls >= (1 << 20))
+    {
+      return calls;
+    }
+
+    calls *= 2;
+  }
+}
+
+Result run(const Benchmark& benchmark, const Options& options)
+{
+  Result result;
+  result.name = benchmark.name;
+
+  /* The counter carries on from the calibration, so the write benchmarks
+     never write a block index twice */
+  size_t counter = 0;
+  const size_t callsPerSample = calibrate(benchmark, counter);
+  const uint64_t budget = static_cast<uint64_t>(options.seconds * 1e9);
+  std::vector<double> samples;
+  const size_t firstCounter = counter;
+
+  auto start = std::chrono::steady_clock::now();
+  while (nanosecondsSince(start) < budget || samples.size() < 5)
+  {
+    auto sampleStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < callsPerSample; i++)
+    {
+      benchmark.operation(counter++);
+    }
+    samples.push_back(static_cast<double>(nanosecondsSince(sampleStart)) / callsPerSample);
+  }
+
+  result.operations = counter - firstCounter;
+
+  double total = 0;
+  for (double sample : samples)
+  {
+    total += sample;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  result.mean = total / samples.size();
+  result.min = samples.front();
+  result.p50 = percentile(samples, 0.50);
+  result.p90 = percentile(samples, 0.90);
+  result.p99 = percentile(samples, 0.99);
+  result.max = samples.back();
+
+  return result;
+}
+
+/* The KV binary encoding of scheme 2, which DBUtils.h used before, for
+   comparing against */
+template <class Value>
+std::string legacySerialize(const Value& value, const std::string& name)
+{
+  KVBinaryOutputStreamSerializer serializer;
+  std::stringstream ss;
+  Common::StdOutputStream stream(ss);
+
+  serializer(const_cast<Value&>(value), name);
+  serializer.dump(stream);
+
+  return ss.str();
+}
+
+template <class Value>
+void legacyDeserialize(const std::string& serialized, Value& value, const std::string& name)
+{
+  std::stringstream ss(serialized);
+  Common::StdInputStream stream(ss);
+  KVBinaryInputStreamSerializer serializer(stream);
+  serializer(value, name);
+}
+
+template <class Key>
+std::string legacySerializeKey(const std::string& prefix, const Key& key)
+{
+  return legacySerialize(std::make_pair(prefix, key), prefix);
+}
+
+/* Distinct, well spread bytes for hashes and keys; the real hash would cost
+   more than the DB work being measured */
+template <class T>
+T makeHash(uint64_t seed, uint64_t salt)
+{
+  T result;
+  static_assert(sizeof(result) % sizeof(uint64_t) == 0, "Unexpected hash size");
+  uint64_t state = seed * 0x9E3779B97F4A7C15ull + salt;
+  uint8_t* bytes = reinterpret_cast<uint8_t*>(&result);
+  for (size_t i = 0; i < sizeof(result); i += sizeof(uint64_t))
+  {
+    // splitmix64
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    std::memcpy(bytes + i, &z, sizeof(z));
+  }
+  return result;
+}
+
+uint64_t amountOf(uint32_t index)
+{
+  return 10 * (index % AMOUNT_COUNT + 1);
+}
+
+/* The writes DatabaseBlockchainCache::pushBlock makes for a block, with the
+   global output indexes of every amount growing by the same count each block */
+BlockchainWriteBatch makeBlockBatch(uint32_t blockIndex)
+{
+  BlockchainWriteBatch batch;
+
+  CachedBlockInfo blockInfo;
+  blockInfo.blockHash = makeHash<Crypto::Hash>(blockIndex, 0);
+  blockInfo.timestamp = 1500000000 + blockIndex * 30;
+  blockInfo.cumulativeDifficulty = blockIndex * 100000ull;
+  blockInfo.alreadyGeneratedCoins = blockIndex * 29000000ull;
+  blockInfo.alreadyGeneratedTransactions = blockIndex * TRANSACTIONS_PER_BLOCK;
+  blockInfo.blockSize = TRANSACTIONS_PER_BLOCK * RAW_TRANSACTION_SIZE;
+
+  std::unordered_set<Crypto::KeyImage> spentKeyImages;
+  std::vector<Crypto::Hash> transactionHashes;
+  std::map<uint64_t, std::vector<PackedOutIndex>> outputsByAmount;
+  RawBlock rawBlock;
+  rawBlock.block.assign(200, static_cast<char>(blockIndex));
+
+  for (uint16_t t = 0; t < TRANSACTIONS_PER_BLOCK; t++)
+  {
+    ExtendedTransactionInfo transaction;
+    transaction.blockIndex = blockIndex;
+    transaction.transactionIndex = t;
+    transaction.transactionHash = makeHash<Crypto::Hash>(blockIndex, t + 1);
+    transaction.unlockTime = 0;
+
+    for (uint32_t i = 0; i < INPUTS_PER_TRANSACTION; i++)
+    {
+      spentKeyImages.insert(makeHash<Crypto::KeyImage>(blockIndex, 1000 + t * INPUTS_PER_TRANSACTION + i));
+    }
+
+    for (uint16_t o = 0; o < OUTPUTS_PER_TRANSACTION; o++)
+    {
+      const uint32_t outputNumber = t * OUTPUTS_PER_TRANSACTION + o;
+      const uint64_t amount = amountOf(outputNumber);
+
+      KeyOutput output;
+      output.key = makeHash<Crypto::PublicKey>(blockIndex, 2000 + outputNumber);
+      transaction.outputs.push_back(output);
+
+      PackedOutIndex index;
+      index.blockIndex = blockIndex;
+      index.transactionIndex = t;
+      index.outputIndex = o;
+      auto& outputs = outputsByAmount[amount];
+      outputs.push_back(index);
+
+      const uint32_t perBlock = TRANSACTIONS_PER_BLOCK * OUTPUTS_PER_TRANSACTION / AMOUNT_COUNT;
+      const uint32_t globalIndex = blockIndex * perBlock + static_cast<uint32_t>(outputs.size()) - 1;
+      transaction.globalIndexes.push_back(globalIndex);
+      transaction.amountToKeyIndexes[amount].push_back(globalIndex);
+    }
+
+    batch.insertCachedTransaction(transaction, blockInfo.alreadyGeneratedTransactions + t + 1);
+    transactionHashes.push_back(transaction.transactionHash);
+    rawBlock.transactions.emplace_back(RAW_TRANSACTION_SIZE, static_cast<char>(t));
+  }
+
+  batch.insertSpentKeyImages(blockIndex, spentKeyImages);
+  batch.insertCachedBlock(blockInfo, blockIndex, transactionHashes);
+  batch.insertRawBlock(blockIndex, rawBlock);
+
+  for (const auto& amount : outputsByAmount)
+  {
+    const uint32_t total = (blockIndex + 1) * static_cast<uint32_t>(amount.second.size());
+    batch.insertKeyOutputGlobalIndexes(amount.first, amount.second, total);
+  }
+
+  batch.insertClosestTimestampBlockIndex(blockInfo.timestamp - blockInfo.timestamp % 86400, blockIndex);
+  batch.insertTimestampBlockHash(blockInfo.timestamp, blockInfo.blockHash);
+
+  return batch;
+}
+
+void check(std::error_code error)
+{
+  if (error)
+  {
+    throw std::runtime_error("DB error: " + error.message());
+  }
+}
+
+std::vector<Benchmark> makeCodecBenchmarks()
+{
+  std::vector<Benchmark> benchmarks;
+
+  auto keyImages = std::make_shared<std::vector<Crypto::KeyImage>>();
+  for (uint32_t i = 0; i < 256; i++)
+  {
+    keyImages->push_back(makeHash<Crypto::KeyImage>(i, 0));
+  }
+
+  auto blockInfo = std::make_shared<CachedBlockInfo>();
+  blockInfo->blockHash = makeHash<Crypto::Hash>(1, 0);
+  blockInfo->timestamp = 1500000000;
+  blockInfo->cumulativeDifficulty = 123456789012ull;
+  blockInfo->alreadyGeneratedCoins = 987654321098ull;
+  blockInfo->alreadyGeneratedTransactions = 1234567;
+  blockInfo->blockSize = 4800;
+
+  PackedOutIndex outIndex;
+  outIndex.blockIndex = 500000;
+  outIndex.transactionIndex = 3;
+  outIndex.outputIndex = 1;
+
+  benchmarks.push_back({"key_image_key_legacy", [keyImages](size_t i) {
+    legacySerializeKey(DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, (*keyImages)[i % keyImages->size()]);
+  }});
+
+  benchmarks.push_back({"key_image_key", [keyImages](size_t i) {
+    DB::serializeKey(DB::KEY_IMAGE_TO_BLOCK_INDEX_PREFIX, (*keyImages)[i % keyImages->size()]);
+  }});
+
+  benchmarks.push_back({"global_index_key_legacy", [](size_t i) {
+    legacySerializeKey(DB::KEY_OUTPUT_AMOUNT_PREFIX, std::make_pair(amountOf(i), static_cast<uint32_t>(i)));
+  }});
+
+  benchmarks.push_back({"global_index_key", [](size_t i) {
+    DB::serializeKey(DB::KEY_OUTPUT_AMOUNT_PREFIX, std::make_pair(amountOf(i), static_cast<uint32_t>(i)));
+  }});
+
+  auto legacyBlockInfo = std::make_shared<std::string>(legacySerialize(*blockInfo, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX));
+  auto flatBlockInfo = std::make_shared<std::string>(DB::serialize(*blockInfo, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX));
+
+  benchmarks.push_back({"cached_block_info_write_legacy", [blockInfo](size_t) {
+    legacySerialize(*blockInfo, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX);
+  }});
+
+  benchmarks.push_back({"cached_block_info_write", [blockInfo](size_t) {
+    DB::serialize(*blockInfo, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX);
+  }});
+
+  benchmarks.push_back({"cached_block_info_read_legacy", [legacyBlockInfo](size_t) {
+    CachedBlockInfo value;
+    legacyDeserialize(*legacyBlockInfo, value, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX);
+  }});
+
+  benchmarks.push_back({"cached_block_info_read", [flatBlockInfo](size_t) {
+    CachedBlockInfo value;
+    DB::deserialize(*flatBlockInfo, value, DB::BLOCK_INDEX_TO_BLOCK_INFO_PREFIX);
+  }});
+
+  auto legacyOutIndex = std::make_shared<std::string>(legacySerialize(outIndex, DB::KEY_OUTPUT_AMOUNT_PREFIX));
+  auto flatOutIndex = std::make_shared<std::string>(DB::serialize(outIndex, DB::KEY_OUTPUT_AMOUNT_PREFIX));
+
+  benchmarks.push_back({"packed_out_index_read_legacy", [legacyOutIndex](size_t) {
+    PackedOutIndex value;
+    legacyDeserialize(*legacyOutIndex, value, DB::KEY_OUTPUT_AMOUNT_PREFIX);
+  }});
+
+  benchmarks.push_back({"packed_out_index_read", [flatOutIndex](size_t) {
+    PackedOutIndex value;
+    DB::deserialize(*flatOutIndex, value, DB::KEY_OUTPUT_AMOUNT_PREFIX);
+  }});
+
+  /* Everything a synced block costs before it reaches RocksDB */
+  benchmarks.push_back({"sync_block_encode", [](size_t i) {
+    BlockchainWriteBatch batch = makeBlockBatch(static_cast<uint32_t>(i));
+    batch.extractRawDataToInsert();
+  }});
+
+  return benchmarks;
+}
+
+std::vector<Benchmark> makeDatabaseBenchmarks(RocksDBWrapper& database, const Options& options)
+{
+  std::vector<Benchmark> benchmarks;
+  RocksDBWrapper* db = &database;
+  const uint32_t blocks = options.blocks;
+
+  /* New blocks go on top of the ones the read benchmarks use */
+  benchmarks.push_back({"sync_block_write", [db, blocks](size_t i) {
+    BlockchainWriteBatch batch = makeBlockBatch(blocks + static_cast<uint32_t>(i));
+    check(db->write(batch));
+  }});
+
+  benchmarks.push_back({"rpc_block_headers_" + std::to_string(HEADERS_PER_READ), [db, blocks](size_t i) {
+    const uint32_t first = static_cast<uint32_t>(i * HEADERS_PER_READ % (blocks - HEADERS_PER_READ));
+    BlockchainReadBatch batch;
+    for (uint32_t index = first; index < first + HEADERS_PER_READ; index++)
+    {
+      batch.requestCachedBlock(index);
+    }
+    check(db->read(batch));
+  }});
+
+  benchmarks.push_back({"rpc_block_index_by_hash", [db, blocks](size_t i) {
+    BlockchainReadBatch batch;
+    batch.requestBlockIndexByBlockHash(makeHash<Crypto::Hash>(i * 7919 % blocks, 0));
+    check(db->read(batch));
+  }});
+
+  benchmarks.push_back({"rpc_random_outs_" + std::to_string(OUTPUTS_PER_READ), [db, blocks](size_t i) {
+    BlockchainReadBatch batch;
+    for (uint32_t o = 0; o < OUTPUTS_PER_READ; o++)
+    {
+      const uint32_t perBlock = TRANSACTIONS_PER_BLOCK * OUTPUTS_PER_TRANSACTION / AMOUNT_COUNT;
+      batch.requestKeyOutputGlobalIndexForAmount(amountOf(o), static_cast<uint32_t>((i * 104729 + o * 7919) % (blocks * perBlock)));
+    }
+    check(db->read(batch));
+  }});
+
+  benchmarks.push_back({"rpc_spent_key_images_" + std::to_string(OUTPUTS_PER_READ), [db, blocks](size_t i) {
+    BlockchainReadBatch batch;
+    for (uint32_t k = 0; k < OUTPUTS_PER_READ; k++)
+    {
+      batch.requestBlockIndexBySpentKeyImage(makeHash<Crypto::KeyImage>((i * 7919 + k) % blocks, 1000 + k % (TRANSACTIONS_PER_BLOCK * INPUTS_PER_TRANSACTION)));
+    }
+    check(db->read(batch));
+  }});
+
+  benchmarks.push_back({"rpc_transaction", [db, blocks](size_t i) {
+    BlockchainReadBatch batch;
+    batch.requestCachedTransaction(makeHash<Crypto::Hash>(i * 7919 % blocks, i % TRANSACTIONS_PER_BLOCK + 1));
+    check(db->read(batch));
+  }});
+
+  return benchmarks;
+}
+
+void printText(const Result& result)
+{
+  std::cout << std::left << std::setw(32) << result.name << std::right << std::fixed << std::setprecision(0)
+    << " mean " << std::setw(10) << result.mean
+    << " p50 " << std::setw(10) << result.p50
+    << " p90 " << std::setw(10) << result.p90
+    << " p99 " << std::setw(10) << result.p99
+    << " ns/op" << std::endl;
+}
+
+JsonValue toJson(const Result& result)
+{
+  JsonValue value(JsonValue::OBJECT);
+  value.insert("name", result.name);
+  value.insert("operations", static_cast<JsonValue::Integer>(result.operations));
+  value.insert("mean_ns", result.mean);
+  value.insert("min_ns", result.min);
+  value.insert("p50_ns", result.p50);
+  value.insert("p90_ns", result.p90);
+  value.insert("p99_ns", result.p99);
+  value.insert("max_ns", result.max);
+  return value;
+}
+
+void printUsage()
+{
+  std::cout << "Usage: dbbench [options]\n\n"
+    << "  --json              Print the results as JSON\n"
+    << "  --group-commit      Write blocks the way the daemon does while syncing, many to a RocksDB write\n"
+    << "  --seconds <s>       Time spent on each measurement (default: 1)\n"
+    << "  --blocks <n>        Synthetic blocks written before the read benchmarks (default: 20000)\n"
+    << "  --data-dir <path>   Where the scratch DB goes, it is deleted afterwards (default: a temporary directory)\n"
+    << "  --filter <text>     Only run benchmarks whose name contains text\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+
+  try
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--json")
+      {
+        options.json = true;
+      }
+      else if (arg == "--group-commit")
+      {
+        options.groupCommit = true;
+      }
+      else if (arg == "--seconds" && hasValue)
+      {
+        options.seconds = std::stod(argv[++i]);
+      }
+      else if (arg == "--blocks" && hasValue)
+      {
+        options.blocks = std::max<uint32_t>(HEADERS_PER_READ + 1, std::stoul(argv[++i]));
+      }
+      else if (arg == "--data-dir" && hasValue)
+      {
+        options.dataDir = argv[++i];
+      }
+      else if (arg == "--filter" && hasValue)
+      {
+        options.filter = argv[++i];
+      }
+      else
+      {
+        printUsage();
+        return arg == "--help" ? 0 : 1;
+      }
+    }
+
+    const bool temporaryDataDir = options.dataDir.empty();
+    if (temporaryDataDir)
+    {
+      options.dataDir = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("dbbench-%%%%%%%%")).string();
+    }
+
+    boost::filesystem::create_directories(options.dataDir);
+
+    Logging::ConsoleLogger logger(Logging::ERROR);
+    DataBaseConfig config;
+    config.setDataDir(options.dataDir);
+
+    RocksDBWrapper database(logger);
+    database.init(config);
+    database.setGroupCommit(options.groupCommit);
+
+    if (!options.json)
+    {
+      std::cout << "Writing " << options.blocks << " synthetic blocks to " << options.dataDir << "\n\n";
+    }
+
+    for (uint32_t blockIndex = 0; blockIndex < options.blocks; blockIndex++)
+    {
+      BlockchainWriteBatch batch = makeBlockBatch(blockIndex);
+      check(database.write(batch));
+    }
+
+    std::vector<Benchmark> benchmarks = makeCodecBenchmarks();
+    for (auto& benchmark : makeDatabaseBenchmarks(database, options))
+    {
+      benchmarks.push_back(std::move(benchmark));
+    }
+
+    JsonValue results(JsonValue::ARRAY);
+
+    for (const auto& benchmark : benchmarks)
+    {
+      if (benchmark.name.find(options.filter) == std::string::npos)
+      {
+        continue;
+      }
+
+      const Result result = run(benchmark, options);
+
+      if (options.json)
+      {
+        results.pushBack(toJson(result));
+      }
+      else
+      {
+        printText(result);
+      }
+    }
+
+    database.shutdown();
+    database.destroy(config);
+
+    if (temporaryDataDir)
+    {
+      boost::filesystem::remove_all(options.dataDir);
+    }
+
+    if (options.json)
+    {
+      JsonValue report(JsonValue::OBJECT);
+      report.insert("blocks", static_cast<JsonValue::Integer>(options.blocks));
+      report.insert("benchmarks", std::move(results));
+      std::cout << report << std::endl;
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::cout << "Something went terribly wrong...\n" << e.what() << "\n\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -18,25 +18,76 @@
 #include "HttpParser.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <system_error>
 
 #include "HttpParserErrorCodes.h"
 
 namespace {
 
-void throwIfNotGood(std::istream& stream) {
-  if (!stream.good()) {
-    if (stream.eof()) {
-      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::END_OF_STREAM));
-    } else {
-      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::STREAM_NOT_GOOD));
+// whole request and status lines and headers, a peer can't grow the buffer without end before sending a body
+const size_t MAX_HEAD_SIZE = 64 * 1024;
+const size_t MIN_RECEIVE_SIZE = 4096;
+// most the buffer grows by for a body, so it only gets as large as what has arrived
+const size_t MAX_RECEIVE_SIZE = 1024 * 1024;
+// a buffer grown by a large message is dropped once it is empty
+const size_t MAX_IDLE_BUFFER_SIZE = 64 * 1024;
+
+const char CRLF[] = "\r\n";
+const char HEAD_END[] = "\r\n\r\n";
+
+void throwError(CryptoNote::error::HttpParserErrorCodes code) {
+  throw std::system_error(make_error_code(code));
+}
+
+bool equalsIgnoreCase(Common::StringView left, Common::StringView right) {
+  if (left.getSize() != right.getSize()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < left.getSize(); ++i) {
+    if (::tolower(static_cast<unsigned char>(left[i])) != ::tolower(static_cast<unsigned char>(right[i]))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+size_t parseContentLength(Common::StringView value) {
+  if (value.isEmpty()) {
+    throwError(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+  }
+
+  size_t length = 0;
+  for (size_t i = 0; i < value.getSize(); ++i) {
+    char c = value[i];
+    if (c < '0' || c > '9' || length > (std::numeric_limits<size_t>::max() - 9) / 10) {
+      throwError(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL);
     }
+
+    length = length * 10 + (c - '0');
   }
+
+  return length;
+}
+
+std::string toLower(Common::StringView value) {
+  std::string result(value.getData(), value.getSize());
+  std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+  return result;
 }
 
 }
 
 namespace CryptoNote {
 
+HttpParser::HttpParser(size_t maxBodySize) : maxBodySize(maxBodySize), messageBegin(0), received(0), scanned(0), headSize(0), bodySize(0),
+  method{0, 0}, url{0, 0}, status{0, 0}, persistent(true) {
+}
+
 HttpResponse::HTTP_STATUS HttpParser::parseResponseStatusFromString(const std::string& status) {
   if (status == "200 OK" || status == "200 Ok") return CryptoNote::HttpResponse::STATUS_200;
   else if (status == "404 Not Found") return CryptoNote::HttpResponse::STATUS_404;
@@ -47,178 +98,229 @@ HttpResponse::HTTP_STATUS HttpParser::parseResponseStatusFromString(const std::s
   return CryptoNote::HttpResponse::STATUS_200; //unaccessible
 }
 
+char* HttpParser::prepareReceive(size_t& size) {
+  size_t rest = 0;
+  if (headSize != 0) {
+    rest = headSize + bodySize - (received - messageBegin);
+  }
 
-void HttpParser::receiveRequest(std::istream& stream, HttpRequest& request) {
-  readWord(stream, request.method);
-  readWord(stream, request.url);
+  size_t wanted = std::max(std::min(rest, MAX_RECEIVE_SIZE), MIN_RECEIVE_SIZE);
+  if (buffer.size() - received < wanted) {
+    // move the message being received to the front
+    if (messageBegin != 0) {
+      std::memmove(buffer.data(), buffer.data() + messageBegin, received - messageBegin);
+      received -= messageBegin;
+      messageBegin = 0;
+    }
 
-  std::string httpVersion;
-  readWord(stream, httpVersion);
+    if (buffer.size() - received < wanted) {
+      buffer.resize(received + wanted);
+    }
+  }
 
-  readHeaders(stream, request.headers);
+  size = buffer.size() - received;
+  return buffer.data() + received;
+}
 
-  std::string body;
-  size_t bodyLen = getBodyLen(request.headers);
-  if (bodyLen) {
-    readBody(stream, request.body, bodyLen);
-  }
+void HttpParser::receive(size_t size) {
+  received += size;
 }
 
+bool HttpParser::hasBufferedData() const {
+  return received != messageBegin;
+}
 
-void HttpParser::receiveResponse(std::istream& stream, HttpResponse& response) {
-  std::string httpVersion;
-  readWord(stream, httpVersion);
-  
-  std::string status;
-  char c;
-  
-  stream.get(c);
-  while (stream.good() && c != '\r') { //Till the end
-    status += c;
-    stream.get(c);
-  }
+bool HttpParser::parseRequest() {
+  return parse(true);
+}
+
+bool HttpParser::parseResponse() {
+  return parse(false);
+}
 
-  throwIfNotGood(stream);
+Common::StringView HttpParser::getMethod() const {
+  return view(method);
+}
 
-  if (c == '\r') {
-    stream.get(c);
-    if (c != '\n') {
-      throw std::runtime_error("Parser error: '\\n' symbol is expected");
-    }
-  }
+Common::StringView HttpParser::getUrl() const {
+  return view(url);
+}
 
-  response.setStatus(parseResponseStatusFromString(status));
-  
-  std::string name;
-  std::string value;
+Common::StringView HttpParser::getStatus() const {
+  return view(status);
+}
 
-  while (readHeader(stream, name, value)) {
-    response.addHeader(name, value);
-    name.clear();
-    value.clear();
-  }
+Common::StringView HttpParser::getBody() const {
+  return view(Range{headSize, bodySize});
+}
 
-  response.addHeader(name, value);
-  auto headers = response.getHeaders();
-  size_t length = 0;
-  auto it = headers.find("content-length");
-  if (it != headers.end()) {
-    length = std::stoul(it->second);
-  }
-  
-  std::string body;
-  if (length) {
-    readBody(stream, body, length);
+bool HttpParser::findHeader(Common::StringView name, Common::StringView& value) const {
+  for (const Header& header : headers) {
+    if (equalsIgnoreCase(view(header.name), name)) {
+      value = view(header.value);
+      return true;
+    }
   }
 
-  response.setBody(body);
+  return false;
 }
 
+bool HttpParser::keepAlive() const {
+  return persistent;
+}
 
-void HttpParser::readWord(std::istream& stream, std::string& word) {
-  char c;
+void HttpParser::getRequest(HttpRequest& request) const {
+  Common::StringView value = getMethod();
+  request.method.assign(value.getData(), value.getSize());
+  value = getUrl();
+  request.url.assign(value.getData(), value.getSize());
 
-  stream.get(c);
-  while (stream.good() && c != ' ' && c != '\r') {
-    word += c;
-    stream.get(c);
+  for (const Header& header : headers) {
+    value = view(header.value);
+    request.headers[toLower(view(header.name))].assign(value.getData(), value.getSize());
   }
 
-  throwIfNotGood(stream);
-
-  if (c == '\r') {
-    stream.get(c);
-    if (c != '\n') {
-      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
-    }
-  }
+  value = getBody();
+  request.body.assign(value.getData(), value.getSize());
 }
 
-void HttpParser::readHeaders(std::istream& stream, HttpRequest::Headers& headers) {
-  std::string name;
-  std::string value;
+void HttpParser::getResponse(HttpResponse& response) const {
+  Common::StringView value = getStatus();
+  response.setStatus(parseResponseStatusFromString(std::string(value.getData(), value.getSize())));
 
-  while (readHeader(stream, name, value)) {
-    headers[name] = value; //use insert
-    name.clear();
-    value.clear();
+  for (const Header& header : headers) {
+    value = view(header.value);
+    response.addHeader(toLower(view(header.name)), std::string(value.getData(), value.getSize()));
   }
 
-  headers[name] = value; //use insert
+  value = getBody();
+  response.setBody(std::string(value.getData(), value.getSize()));
 }
 
-bool HttpParser::readHeader(std::istream& stream, std::string& name, std::string& value) {
-  char c;
-  bool isName = true;
+void HttpParser::next() {
+  messageBegin += headSize + bodySize;
+  scanned = 0;
+  headSize = 0;
+  bodySize = 0;
+  headers.clear();
+
+  if (messageBegin == received) {
+    messageBegin = 0;
+    received = 0;
+    if (buffer.size() > MAX_IDLE_BUFFER_SIZE) {
+      std::vector<char>().swap(buffer);
+    }
+  }
+}
 
-  stream.get(c);
-  while (stream.good() && c != '\r') {
-    if (c == ':') {
-      if (stream.peek() == ' ') {
-        stream.get(c);
-      }
+bool HttpParser::parse(bool isRequest) {
+  if (headSize == 0) {
+    // empty lines ahead of a request are allowed
+    while (received - messageBegin >= 2 && std::memcmp(buffer.data() + messageBegin, CRLF, 2) == 0) {
+      messageBegin += 2;
+      scanned = 0;
+    }
 
-      if (name.empty()) {
-        throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::EMPTY_HEADER));
+    const char* begin = buffer.data() + messageBegin;
+    const size_t available = received - messageBegin;
+    const size_t from = scanned < 3 ? 0 : scanned - 3;
+    const char* end = std::search(begin + from, begin + available, HEAD_END, HEAD_END + 4);
+    if (end == begin + available) {
+      scanned = available;
+      if (available > MAX_HEAD_SIZE) {
+        throwError(error::HttpParserErrorCodes::HEAD_TOO_LARGE);
       }
 
-      if (isName) {
-        isName = false;
-        stream.get(c);
-        continue;
-      }
+      return false;
     }
 
-    if (isName) {
-      name += c;
-      stream.get(c);
-    } else {
-      value += c;
-      stream.get(c);
-    }
+    parseHead(end - begin + 4, isRequest);
   }
 
-  throwIfNotGood(stream);
+  return received - messageBegin >= headSize + bodySize;
+}
 
-  stream.get(c);
-  if (c != '\n') {
-    throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
+void HttpParser::parseHead(size_t size, bool isRequest) {
+  const char* head = buffer.data() + messageBegin;
+  const size_t lineEnd = findLineEnd(0, size);
+  const char* lineSpace = std::find(head, head + lineEnd, ' ');
+  const size_t firstSpace = lineSpace - head;
+  if (firstSpace == 0 || firstSpace == lineEnd) {
+    throwError(error::HttpParserErrorCodes::UNEXPECTED_SYMBOL);
   }
 
-  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-
-  c = stream.peek();
-  if (c == '\r') {
-    stream.get(c).get(c);
-    if (c != '\n') {
-      throw std::system_error(make_error_code(CryptoNote::error::HttpParserErrorCodes::UNEXPECTED_SYMBOL));
+  Range version;
+  if (isRequest) {
+    const size_t secondSpace = std::find(lineSpace + 1, head + lineEnd, ' ') - head;
+    if (secondSpace == firstSpace + 1 || secondSpace + 1 >= lineEnd) {
+      throwError(error::HttpParserErrorCodes::UNEXPECTED_SYMBOL);
     }
 
-    return false; //no more headers
+    method = Range{0, firstSpace};
+    url = Range{firstSpace + 1, secondSpace - firstSpace - 1};
+    version = Range{secondSpace + 1, lineEnd - secondSpace - 1};
+    status = Range{0, 0};
+  } else {
+    version = Range{0, firstSpace};
+    status = Range{firstSpace + 1, lineEnd - firstSpace - 1};
+    method = Range{0, 0};
+    url = Range{0, 0};
   }
 
-  return true;
-}
+  parseHeaders(lineEnd + 2, size);
 
-size_t HttpParser::getBodyLen(const HttpRequest::Headers& headers) {
-  auto it = headers.find("content-length");
-  if (it != headers.end()) {
-    size_t bytes = std::stoul(it->second);
-    return bytes;
+  Common::StringView value;
+  bodySize = findHeader("Content-Length", value) ? parseContentLength(value) : 0;
+  if (bodySize > maxBodySize) {
+    throwError(error::HttpParserErrorCodes::BODY_TOO_LARGE);
   }
 
-  return 0;
+  if (view(version) == "HTTP/1.0") {
+    persistent = findHeader("Connection", value) && equalsIgnoreCase(value, "keep-alive");
+  } else {
+    persistent = !(findHeader("Connection", value) && equalsIgnoreCase(value, "close"));
+  }
+
+  headSize = size;
 }
 
-void HttpParser::readBody(std::istream& stream, std::string& body, const size_t bodyLen) {
-  size_t read = 0;
+void HttpParser::parseHeaders(size_t offset, size_t size) {
+  const char* head = buffer.data() + messageBegin;
+
+  // the head ends with an empty line
+  while (offset + 2 < size) {
+    const size_t lineEnd = findLineEnd(offset, size);
+    const size_t colon = std::find(head + offset, head + lineEnd, ':') - head;
+    if (colon == offset) {
+      throwError(error::HttpParserErrorCodes::EMPTY_HEADER);
+    }
 
-  while (stream.good() && read < bodyLen) {
-    body += stream.get();
-    ++read;
+    if (colon == lineEnd) {
+      throwError(error::HttpParserErrorCodes::UNEXPECTED_SYMBOL);
+    }
+
+    size_t valueBegin = colon + 1;
+    size_t valueEnd = lineEnd;
+    while (valueBegin < valueEnd && (head[valueBegin] == ' ' || head[valueBegin] == '\t')) {
+      ++valueBegin;
+    }
+
+    while (valueEnd > valueBegin && (head[valueEnd - 1] == ' ' || head[valueEnd - 1] == '\t')) {
+      --valueEnd;
+    }
+
+    headers.push_back(Header{Range{offset, colon - offset}, Range{valueBegin, valueEnd - valueBegin}});
+    offset = lineEnd + 2;
   }
+}
+
+size_t HttpParser::findLineEnd(size_t offset, size_t size) const {
+  const char* head = buffer.data() + messageBegin;
+  return std::search(head + offset, head + size, CRLF, CRLF + 2) - head;
+}
 
-  throwIfNotGood(stream);
+Common::StringView HttpParser::view(const Range& range) const {
+  return Common::StringView(buffer.data() + messageBegin + range.offset, range.size);
 }
 
 }
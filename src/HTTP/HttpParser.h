@@ -18,28 +18,92 @@
 #ifndef HTTPPARSER_H_
 #define HTTPPARSER_H_
 
-#include <iostream>
-#include <map>
+#include <cstddef>
 #include <string>
+#include <vector>
+
+#include <Common/StringView.h>
+
 #include "HttpRequest.h"
 #include "HttpResponse.h"
 
 namespace CryptoNote {
 
-//Blocking HttpParser
+/* Incremental HTTP/1.1 parser over its own receive buffer. Bytes are
+   received straight into the buffer, parseRequest() or parseResponse()
+   then tell whether the message at its front is complete, leaving any bytes
+   of pipelined messages behind it for the next call. The method, url, body
+   and headers of a parsed message are views into the buffer, valid until
+   next() or the next receive. */
 class HttpParser {
 public:
-  HttpParser() {};
+  static const size_t DEFAULT_MAX_BODY_SIZE = 16 * 1024 * 1024;
+
+  // Messages with a longer Content-Length are rejected before their body is received
+  explicit HttpParser(size_t maxBodySize = DEFAULT_MAX_BODY_SIZE);
+
+  /* Space to receive into. The buffer grows as the body of a message
+     arrives, a bounded step at a time, not by its Content-Length at once */
+  char* prepareReceive(size_t& size);
+  void receive(size_t size);
+
+  // Received bytes not taken by a parsed message
+  bool hasBufferedData() const;
+
+  // Throw std::system_error when the message is malformed
+  bool parseRequest();
+  bool parseResponse();
+
+  Common::StringView getMethod() const;
+  Common::StringView getUrl() const;
+  Common::StringView getStatus() const;
+  Common::StringView getBody() const;
+  // name is matched case insensitively
+  bool findHeader(Common::StringView name, Common::StringView& value) const;
+  bool keepAlive() const;
+
+  void getRequest(HttpRequest& request) const;
+  void getResponse(HttpResponse& response) const;
+
+  // Drops the parsed message
+  void next();
 
-  void receiveRequest(std::istream& stream, HttpRequest& request);
-  void receiveResponse(std::istream& stream, HttpResponse& response);
   static HttpResponse::HTTP_STATUS parseResponseStatusFromString(const std::string& status);
+
 private:
-  void readWord(std::istream& stream, std::string& word);
-  void readHeaders(std::istream& stream, HttpRequest::Headers &headers);
-  bool readHeader(std::istream& stream, std::string& name, std::string& value);
-  size_t getBodyLen(const HttpRequest::Headers& headers);
-  void readBody(std::istream& stream, std::string& body, const size_t bodyLen);
+  struct Range {
+    size_t offset;
+    size_t size;
+  };
+
+  struct Header {
+    Range name;
+    Range value;
+  };
+
+  bool parse(bool isRequest);
+  void parseHead(size_t size, bool isRequest);
+  void parseHeaders(size_t offset, size_t size);
+  size_t findLineEnd(size_t offset, size_t size) const;
+  Common::StringView view(const Range& range) const;
+
+  size_t maxBodySize;
+  std::vector<char> buffer;
+  // start of the message being parsed and end of the received bytes
+  size_t messageBegin;
+  size_t received;
+  // bytes of the message already searched for the end of its head
+  size_t scanned;
+  // 0 until the head is parsed
+  size_t headSize;
+  size_t bodySize;
+
+  // relative to messageBegin
+  Range method;
+  Range url;
+  Range status;
+  std::vector<Header> headers;
+  bool persistent;
 };
 
 } //namespace CryptoNote
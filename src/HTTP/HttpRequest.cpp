@@ -52,22 +52,29 @@ namespace CryptoNote {
     url = u;
   }
 
-  std::ostream& HttpRequest::printHttpRequest(std::ostream& os) const {
-    os << "POST " << url << " HTTP/1.1\r\n";
+  void HttpRequest::appendTo(std::string& buffer) const {
+    buffer += "POST ";
+    buffer += url;
+    buffer += " HTTP/1.1\r\n";
     auto host = headers.find("Host");
     if (host == headers.end()) {
-      os << "Host: " << "127.0.0.1" << "\r\n";
+      buffer += "Host: 127.0.0.1\r\n";
     }
 
-    for (auto pair : headers) {
-      os << pair.first << ": " << pair.second << "\r\n";
-    }
-    
-    os << "\r\n";
-    if (!body.empty()) {
-      os << body;
+    for (const auto& pair : headers) {
+      buffer += pair.first;
+      buffer += ": ";
+      buffer += pair.second;
+      buffer += "\r\n";
     }
 
-    return os;
+    buffer += "\r\n";
+    buffer += body;
+  }
+
+  std::ostream& HttpRequest::printHttpRequest(std::ostream& os) const {
+    std::string buffer;
+    appendTo(buffer);
+    return os << buffer;
   }
 }
@@ -35,6 +35,9 @@ namespace CryptoNote {
     void setBody(const std::string& b);
     void setUrl(const std::string& uri);
 
+    // Appends the request as sent, to go out in one write
+    void appendTo(std::string& buffer) const;
+
   private:
     friend class HttpParser;
 
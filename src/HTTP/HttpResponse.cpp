@@ -79,19 +79,26 @@ void HttpResponse::setBody(const std::string& b) {
   }
 }
 
-std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
-  os << "HTTP/1.1 " << getStatusString(status) << "\r\n";
-
-  for (auto pair: headers) {
-    os << pair.first << ": " << pair.second << "\r\n";
+void HttpResponse::appendTo(std::string& buffer) const {
+  buffer += "HTTP/1.1 ";
+  buffer += getStatusString(status);
+  buffer += "\r\n";
+
+  for (const auto& pair: headers) {
+    buffer += pair.first;
+    buffer += ": ";
+    buffer += pair.second;
+    buffer += "\r\n";
   }
-  os << "\r\n";
 
-  if (!body.empty()) {
-    os << body;
-  }
+  buffer += "\r\n";
+  buffer += body;
+}
 
-  return os;
+std::ostream& HttpResponse::printHttpResponse(std::ostream& os) const {
+  std::string buffer;
+  appendTo(buffer);
+  return os << buffer;
 }
 
 } //namespace CryptoNote
@@ -41,6 +41,9 @@ namespace CryptoNote {
     HTTP_STATUS getStatus() const { return status; }
     const std::string& getBody() const { return body; }
 
+    // Appends the response as sent, to go out in one write
+    void appendTo(std::string& buffer) const;
+
   private:
     friend std::ostream& operator<<(std::ostream& os, const HttpResponse& resp);
     std::ostream& printHttpResponse(std::ostream& os) const;
@@ -19,6 +19,13 @@
 
 namespace CryptoNote {
 
+namespace {
+
+/* Nonces hashed per slow hash call in each worker */
+const size_t MINER_HASH_WAYS = 2;
+
+}
+
 Miner::Miner(System::Dispatcher& dispatcher, Logging::ILogger& logger) :
   m_dispatcher(dispatcher),
   m_miningStopped(dispatcher),
@@ -92,25 +99,44 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
 
 void Miner::workerFunc(const BlockTemplate& blockTemplate, uint64_t difficulty, uint32_t nonceStep) {
   try {
-    BlockTemplate block = blockTemplate;
+    /* The scratchpads live for the whole run and each call hashes MINER_HASH_WAYS
+       nonces side by side, so the memory latency of one hash hides behind the others */
+    Crypto::SlowHashContext context(MINER_HASH_WAYS);
+    const size_t ways = context.ways();
+
+    std::vector<BlockTemplate> blocks(ways, blockTemplate);
+    uint32_t nonce = blockTemplate.nonce;
 
     while (m_state == MiningState::MINING_IN_PROGRESS) {
-      CachedBlock cachedBlock(block);
-      Crypto::Hash hash = cachedBlock.getBlockLongHash();
-      if (check_hash(hash, difficulty)) {
-        m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+      std::vector<CachedBlock> cachedBlocks;
+      std::vector<const CachedBlock*> cachedBlockPointers;
+      cachedBlocks.reserve(ways);
+
+      for (size_t i = 0; i < ways; ++i) {
+        blocks[i].nonce = nonce + static_cast<uint32_t>(i) * nonceStep;
+        cachedBlocks.emplace_back(blocks[i]);
+        cachedBlockPointers.push_back(&cachedBlocks.back());
+      }
+
+      CachedBlock::getBlockLongHashes(cachedBlockPointers.data(), ways, context);
+
+      for (size_t i = 0; i < ways; ++i) {
+        if (check_hash(cachedBlocks[i].getBlockLongHash(), difficulty)) {
+          m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+
+          if (!setStateBlockFound()) {
+            m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+            return;
+          }
 
-        if (!setStateBlockFound()) {
-          m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+          m_block = blocks[i];
           return;
         }
 
-        m_block = block;
-        return;
+        incrementHashCount();
       }
 
-      incrementHashCount();
-      block.nonce += nonceStep;
+      nonce += static_cast<uint32_t>(ways) * nonceStep;
     }
   } catch (std::exception& e) {
     m_logger(Logging::ERROR) << "Miner got error: " << e.what();
@@ -0,0 +1,118 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "LevinBuffer.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+using namespace CryptoNote;
+
+namespace {
+
+const size_t MIN_BLOCK_SIZE = 4 * 1024;
+// 4 KiB up to 16 MiB, bigger bodies are rare enough to be allocated as they come
+const unsigned BLOCK_CLASSES = 13;
+// free blocks kept of a class, at most this many bytes of them
+const size_t MAX_FREE_BLOCKS = 64;
+const size_t MAX_FREE_BYTES = 16 * 1024 * 1024;
+
+struct Pool {
+  std::mutex mutex;
+  std::vector<uint8_t*> freeBlocks[BLOCK_CLASSES];
+};
+
+// never destroyed, buffers may still be released by other static objects on exit
+Pool& pool() {
+  static Pool* instance = new Pool;
+  return *instance;
+}
+
+unsigned blockClass(size_t capacity) {
+  unsigned index = 0;
+  while (MIN_BLOCK_SIZE << index < capacity) {
+    ++index;
+  }
+
+  return index;
+}
+
+size_t maxFreeBlocks(unsigned index) {
+  return std::min(MAX_FREE_BLOCKS, MAX_FREE_BYTES / (MIN_BLOCK_SIZE << index));
+}
+
+}
+
+LevinBuffer::LevinBuffer() : m_data(nullptr), m_size(0), m_capacity(0) {
+}
+
+LevinBuffer::LevinBuffer(size_t size) : m_data(nullptr), m_size(size), m_capacity(0) {
+  if (size == 0) {
+    return;
+  }
+
+  unsigned index = blockClass(size);
+  if (index >= BLOCK_CLASSES) {
+    m_data = new uint8_t[size];
+    m_capacity = size;
+    return;
+  }
+
+  m_capacity = MIN_BLOCK_SIZE << index;
+
+  {
+    Pool& blocks = pool();
+    std::lock_guard<std::mutex> lock(blocks.mutex);
+    if (!blocks.freeBlocks[index].empty()) {
+      m_data = blocks.freeBlocks[index].back();
+      blocks.freeBlocks[index].pop_back();
+      return;
+    }
+  }
+
+  m_data = new uint8_t[m_capacity];
+}
+
+LevinBuffer::LevinBuffer(LevinBuffer&& other) : m_data(other.m_data), m_size(other.m_size), m_capacity(other.m_capacity) {
+  other.m_data = nullptr;
+  other.m_size = 0;
+  other.m_capacity = 0;
+}
+
+LevinBuffer& LevinBuffer::operator=(LevinBuffer&& other) {
+  if (this != &other) {
+    release();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_capacity, other.m_capacity);
+  }
+
+  return *this;
+}
+
+LevinBuffer::~LevinBuffer() {
+  release();
+}
+
+void LevinBuffer::release() {
+  if (m_data == nullptr) {
+    return;
+  }
+
+  unsigned index = blockClass(m_capacity);
+  if (index < BLOCK_CLASSES && m_capacity == MIN_BLOCK_SIZE << index) {
+    Pool& blocks = pool();
+    std::lock_guard<std::mutex> lock(blocks.mutex);
+    if (blocks.freeBlocks[index].size() < maxFreeBlocks(index)) {
+      blocks.freeBlocks[index].push_back(m_data);
+      m_data = nullptr;
+    }
+  }
+
+  delete[] m_data;
+  m_data = nullptr;
+  m_size = 0;
+  m_capacity = 0;
+}
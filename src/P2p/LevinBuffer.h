@@ -0,0 +1,65 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <Common/ArrayView.h>
+
+namespace CryptoNote {
+
+/* Body of a Levin message. The storage is left uninitialized, as it is read
+   into straight away, and comes from a process wide pool of power of two
+   sized blocks, so a connection receiving a stream of similar messages
+   doesn't go to the allocator for every one of them. */
+class LevinBuffer {
+public:
+  LevinBuffer();
+  explicit LevinBuffer(size_t size);
+  LevinBuffer(LevinBuffer&& other);
+  LevinBuffer& operator=(LevinBuffer&& other);
+  ~LevinBuffer();
+
+  LevinBuffer(const LevinBuffer&) = delete;
+  LevinBuffer& operator=(const LevinBuffer&) = delete;
+
+  uint8_t* data() {
+    return m_data;
+  }
+
+  const uint8_t* data() const {
+    return m_data;
+  }
+
+  size_t size() const {
+    return m_size;
+  }
+
+  bool empty() const {
+    return m_size == 0;
+  }
+
+  const uint8_t* begin() const {
+    return m_data;
+  }
+
+  const uint8_t* end() const {
+    return m_data + m_size;
+  }
+
+  operator Common::ArrayView<uint8_t>() const {
+    return Common::ArrayView<uint8_t>(m_data, m_size);
+  }
+
+private:
+  void release();
+
+  uint8_t* m_data;
+  size_t m_size;
+  size_t m_capacity;
+};
+
+}
@@ -27,6 +27,8 @@ const uint32_t LEVIN_PACKET_REQUEST = 0x00000001;
 const uint32_t LEVIN_PACKET_RESPONSE = 0x00000002;
 const uint32_t LEVIN_DEFAULT_MAX_PACKET_SIZE = 100000000;      //100MB by default
 const uint32_t LEVIN_PROTOCOL_VER_1 = 1;
+// bodies up to this size are copied behind the header to go out in one write
+const size_t LEVIN_COALESCE_SIZE = 16 * 1024;
 
 #pragma pack(push)
 #pragma pack(1)
@@ -60,15 +62,7 @@ void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool n
   head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
   head.m_flags = LEVIN_PACKET_REQUEST;
 
-  // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeBucket(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out);
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -86,11 +80,10 @@ bool LevinProtocol::readCommand(Command& cmd) {
     throw std::runtime_error("Levin packet size is too big");
   }
 
-  BinaryArray buf;
+  LevinBuffer buf(head.m_cb);
 
   if (head.m_cb != 0) {
-    buf.resize(head.m_cb);
-    if (!readStrict(&buf[0], head.m_cb)) {
+    if (!readStrict(buf.data(), head.m_cb)) {
       return false;
     }
   }
@@ -113,11 +106,23 @@ void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t
   head.m_flags = LEVIN_PACKET_RESPONSE;
   head.m_return_code = returnCode;
 
+  writeBucket(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out);
+}
+
+// There is no gather write on TcpConnection, so a large body goes out on its
+// own instead of being copied behind the header
+void LevinProtocol::writeBucket(const uint8_t* head, size_t headSize, const BinaryArray& out) {
+  if (out.size() > LEVIN_COALESCE_SIZE) {
+    writeStrict(head, headSize);
+    writeStrict(out.data(), out.size());
+    return;
+  }
+
   BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
+  writeBuffer.reserve(headSize + out.size());
 
   Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
+  stream.writeSome(head, headSize);
   stream.writeSome(out.data(), out.size());
 
   writeStrict(writeBuffer.data(), writeBuffer.size());
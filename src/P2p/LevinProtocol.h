@@ -18,9 +18,10 @@
 #pragma once
 
 #include "CryptoNote.h"
-#include <Common/MemoryInputStream.h>
+#include <Common/ArrayView.h>
 #include <Common/VectorOutputStream.h>
-#include "Serialization/KVBinaryInputStreamSerializer.h"
+#include "P2p/LevinBuffer.h"
+#include "Serialization/KVBinaryInputMemorySerializer.h"
 #include "Serialization/KVBinaryOutputStreamSerializer.h"
 
 namespace System {
@@ -70,7 +71,7 @@ public:
     uint32_t command;
     bool isNotify;
     bool isResponse;
-    BinaryArray buf;
+    LevinBuffer buf;
 
     bool needReply() const;
   };
@@ -81,10 +82,9 @@ public:
   void sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode);
 
   template <typename T>
-  static bool decode(const BinaryArray& buf, T& value) {
+  static bool decode(Common::ArrayView<uint8_t> buf, T& value) {
     try {
-      Common::MemoryInputStream stream(buf.data(), buf.size());
-      KVBinaryInputStreamSerializer serializer(stream);
+      KVBinaryInputMemorySerializer serializer(buf.getData(), buf.getSize());
       serialize(value, serializer);
     } catch (std::exception&) {
       return false;
@@ -93,6 +93,11 @@ public:
     return true;
   }
 
+  template <typename T>
+  static bool decode(const BinaryArray& buf, T& value) {
+    return decode(Common::ArrayView<uint8_t>(buf.data(), buf.size()), value);
+  }
+
   template <typename T>
   static BinaryArray encode(const T& value) {
     BinaryArray result;
@@ -107,6 +112,7 @@ private:
 
   bool readStrict(uint8_t* ptr, size_t size);
   void writeStrict(const uint8_t* ptr, size_t size);
+  void writeBucket(const uint8_t* head, size_t headSize, const BinaryArray& out);
   System::TcpConnection& m_conn;
 };
 
@@ -161,6 +161,10 @@ std::string print_peerlist_to_string(const std::list<PeerlistEntry>& pl) {
     return writeOperationStartTime == TimePoint() ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>(now - writeOperationStartTime).count();
   }
 
+  size_t P2pConnectionContext::getWriteQueueSize() const {
+    return writeQueueSize;
+  }
+
   void P2pConnectionContext::interrupt() {
     logger(DEBUGGING) << *this << "Interrupt connection";
     assert(context != nullptr);
@@ -171,7 +175,7 @@ std::string print_peerlist_to_string(const std::list<PeerlistEntry>& pl) {
 
 
   template <typename Command, typename Handler>
-  int invokeAdaptor(const BinaryArray& reqBuf, BinaryArray& resBuf, P2pConnectionContext& ctx, Handler handler) {
+  int invokeAdaptor(Common::ArrayView<uint8_t> reqBuf, BinaryArray& resBuf, P2pConnectionContext& ctx, Handler handler) {
     typedef typename Command::request Request;
     typedef typename Command::response Response;
     int command = Command::ID;
@@ -317,6 +321,17 @@ std::string print_peerlist_to_string(const std::list<PeerlistEntry>& pl) {
     }
   }
 
+  //-----------------------------------------------------------------------------------
+  void NodeServer::drop_connection(const net_connection_id& connectionId) {
+    auto it = m_connections.find(connectionId);
+    if (it == m_connections.end()) {
+      return;
+    }
+
+    it->second.m_state = CryptoNoteConnectionContext::state_shutdown;
+    safeInterrupt(it->second);
+  }
+
   //-----------------------------------------------------------------------------------
   void NodeServer::externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
     m_dispatcher.remoteSpawn([this, command, data_buff, excludeConnection] {
@@ -512,6 +527,15 @@ std::string print_peerlist_to_string(const std::list<PeerlistEntry>& pl) {
   uint64_t NodeServer::get_connections_count() {
     return m_connections.size();
   }
+
+  size_t NodeServer::getWriteQueueSize() const {
+    size_t size = 0;
+    for (const auto& connection : m_connections) {
+      size += connection.second.getWriteQueueSize();
+    }
+
+    return size;
+  }
   //-----------------------------------------------------------------------------------
 
   bool NodeServer::deinit()  {
@@ -630,7 +654,7 @@ std::string print_peerlist_to_string(const std::list<PeerlistEntry>& pl) {
     return true;
   }
 
-  bool NodeServer::handleTimedSyncResponse(const BinaryArray& in, P2pConnectionContext& context) {
+  bool NodeServer::handleTimedSyncResponse(Common::ArrayView<uint8_t> in, P2pConnectionContext& context) {
     COMMAND_TIMED_SYNC::response rsp;
     if (!LevinProtocol::decode<COMMAND_TIMED_SYNC::response>(in, rsp)) {
       return false;
@@ -914,6 +938,7 @@ std::string print_peerlist_to_string(const std::list<PeerlistEntry>& pl) {
     try {
       m_connections_maker_interval.call(std::bind(&NodeServer::connections_maker, this));
       m_peerlist_store_interval.call(std::bind(&NodeServer::store_config, this));
+      m_payload_handler.on_idle();
     } catch (std::exception& e) {
       logger(DEBUGGING) << "exception in idle_worker: " << e.what();
     }
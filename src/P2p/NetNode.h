@@ -97,6 +97,7 @@ namespace CryptoNote
     void interrupt();
 
     uint64_t writeDuration(TimePoint now) const;
+    size_t getWriteQueueSize() const;
 
   private:
     Logging::LoggerRef logger;
@@ -129,6 +130,8 @@ namespace CryptoNote
     bool log_connections();
     virtual uint64_t get_connections_count() override;
     size_t get_outgoing_connections_count();
+    // bytes queued on every connection and not written yet
+    size_t getWriteQueueSize() const;
 
     CryptoNote::PeerlistManager& getPeerlistManager() { return m_peerlist; }
 
@@ -154,7 +157,7 @@ namespace CryptoNote
 
     bool handshake(CryptoNote::LevinProtocol& proto, P2pConnectionContext& context, bool just_take_peerlist = false);
     bool timedSync();
-    bool handleTimedSyncResponse(const BinaryArray& in, P2pConnectionContext& context);
+    bool handleTimedSyncResponse(Common::ArrayView<uint8_t> in, P2pConnectionContext& context);
     void forEachConnection(std::function<void(P2pConnectionContext&)> action);
 
     void on_connection_new(P2pConnectionContext& context);
@@ -164,6 +167,7 @@ namespace CryptoNote
     virtual void relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override;
     virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const CryptoNoteConnectionContext& context) override;
     virtual void for_each_connection(std::function<void(CryptoNote::CryptoNoteConnectionContext&, PeerIdType)> f) override;
+    virtual void drop_connection(const net_connection_id& connectionId) override;
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override;
 
     //-----------------------------------------------------------------------------------------------
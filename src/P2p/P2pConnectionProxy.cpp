@@ -75,7 +75,7 @@ void P2pConnectionProxy::read(P2pMessage& message) {
     } else if (cmd.command == COMMAND_TIMED_SYNC::ID) {
       handleTimedSync(cmd);
     } else {
-      message.data = std::move(cmd.buf);
+      message.data.assign(cmd.buf.begin(), cmd.buf.end());
       break;
     }
   }
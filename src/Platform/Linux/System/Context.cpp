@@ -0,0 +1,233 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "Context.h"
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ErrorMessage.h"
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+extern "C" void dispatcherSwitchContext(void** from, void* to);
+extern "C" void dispatcherContextEntry();
+
+#if defined(__x86_64__)
+
+// Saved state, from the stack pointer up: mxcsr and x87 control word, r15,
+// r14, r13, r12, rbx, rbp, return address
+__asm__(
+  ".text\n"
+  ".globl dispatcherSwitchContext\n"
+  ".hidden dispatcherSwitchContext\n"
+  ".type dispatcherSwitchContext, @function\n"
+  ".align 16\n"
+  "dispatcherSwitchContext:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  subq $8, %rsp\n"
+  "  stmxcsr (%rsp)\n"
+  "  fnstcw 4(%rsp)\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  ldmxcsr (%rsp)\n"
+  "  fldcw 4(%rsp)\n"
+  "  addq $8, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size dispatcherSwitchContext, .-dispatcherSwitchContext\n"
+
+  // The first switch to a new context returns here, with the argument in r12
+  // and the procedure in r13
+  ".globl dispatcherContextEntry\n"
+  ".hidden dispatcherContextEntry\n"
+  ".type dispatcherContextEntry, @function\n"
+  ".align 16\n"
+  "dispatcherContextEntry:\n"
+  "  movq %r12, %rdi\n"
+  "  callq *%r13\n"
+  "  ud2\n"
+  ".size dispatcherContextEntry, .-dispatcherContextEntry\n"
+);
+
+#else
+
+// Saved state, from the stack pointer up: x19 - x28, x29, x30, d8 - d15
+__asm__(
+  ".text\n"
+  ".globl dispatcherSwitchContext\n"
+  ".hidden dispatcherSwitchContext\n"
+  ".type dispatcherSwitchContext, %function\n"
+  ".align 4\n"
+  "dispatcherSwitchContext:\n"
+  "  sub sp, sp, #160\n"
+  "  stp x19, x20, [sp, #0]\n"
+  "  stp x21, x22, [sp, #16]\n"
+  "  stp x23, x24, [sp, #32]\n"
+  "  stp x25, x26, [sp, #48]\n"
+  "  stp x27, x28, [sp, #64]\n"
+  "  stp x29, x30, [sp, #80]\n"
+  "  stp d8, d9, [sp, #96]\n"
+  "  stp d10, d11, [sp, #112]\n"
+  "  stp d12, d13, [sp, #128]\n"
+  "  stp d14, d15, [sp, #144]\n"
+  "  mov x9, sp\n"
+  "  str x9, [x0]\n"
+  "  mov sp, x1\n"
+  "  ldp x19, x20, [sp, #0]\n"
+  "  ldp x21, x22, [sp, #16]\n"
+  "  ldp x23, x24, [sp, #32]\n"
+  "  ldp x25, x26, [sp, #48]\n"
+  "  ldp x27, x28, [sp, #64]\n"
+  "  ldp x29, x30, [sp, #80]\n"
+  "  ldp d8, d9, [sp, #96]\n"
+  "  ldp d10, d11, [sp, #112]\n"
+  "  ldp d12, d13, [sp, #128]\n"
+  "  ldp d14, d15, [sp, #144]\n"
+  "  add sp, sp, #160\n"
+  "  ret\n"
+  ".size dispatcherSwitchContext, .-dispatcherSwitchContext\n"
+
+  // The first switch to a new context returns here, with the argument in x19
+  // and the procedure in x20
+  ".globl dispatcherContextEntry\n"
+  ".hidden dispatcherContextEntry\n"
+  ".type dispatcherContextEntry, %function\n"
+  ".align 4\n"
+  "dispatcherContextEntry:\n"
+  "  mov x0, x19\n"
+  "  blr x20\n"
+  "  brk #0\n"
+  ".size dispatcherContextEntry, .-dispatcherContextEntry\n"
+);
+
+#endif
+
+#else
+
+#include <ucontext.h>
+
+#endif
+
+namespace System {
+
+namespace {
+
+#if !defined(__x86_64__) && !defined(__aarch64__)
+
+struct ContextStart {
+  ucontext_t context;
+  void (*procedure)(void*);
+  void* argument;
+};
+
+void contextStart(void* start) {
+  ContextStart* contextStart = static_cast<ContextStart*>(start);
+  contextStart->procedure(contextStart->argument);
+}
+
+#endif
+
+}
+
+size_t getPageSize() {
+  static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return pageSize;
+}
+
+void* allocateContextStack(size_t size) {
+  assert(size % getPageSize() == 0);
+
+  void* mapping = mmap(nullptr, size + getPageSize(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("allocateContextStack, mmap failed, " + lastErrorMessage());
+  }
+
+  // stacks grow down, the guard goes below the lowest usable address
+  if (mprotect(mapping, getPageSize(), PROT_NONE) == -1) {
+    std::string message = "allocateContextStack, mprotect failed, " + lastErrorMessage();
+    munmap(mapping, size + getPageSize());
+    throw std::runtime_error(message);
+  }
+
+  return static_cast<uint8_t*>(mapping) + getPageSize();
+}
+
+void freeContextStack(void* stack, size_t size) {
+  auto result = munmap(static_cast<uint8_t*>(stack) - getPageSize(), size + getPageSize());
+  if (result) {}
+  assert(result == 0);
+}
+
+void* makeContext(void* stack, size_t size, void (*procedure)(void*), void* argument) {
+  uintptr_t top = (reinterpret_cast<uintptr_t>(stack) + size) & ~static_cast<uintptr_t>(15);
+
+#if defined(__x86_64__)
+  // The return address sits 8 bytes below a 16 byte boundary, so the entry
+  // calls the procedure with the stack aligned as the ABI expects
+  uint64_t* state = reinterpret_cast<uint64_t*>(top) - 1;
+  *state = reinterpret_cast<uint64_t>(&dispatcherContextEntry);
+  *--state = 0; // rbp
+  *--state = 0; // rbx
+  *--state = reinterpret_cast<uint64_t>(argument); // r12
+  *--state = reinterpret_cast<uint64_t>(procedure); // r13
+  *--state = 0; // r14
+  *--state = 0; // r15
+  *--state = 0x1f80 | (static_cast<uint64_t>(0x037f) << 32); // default mxcsr and x87 control word
+  return state;
+#elif defined(__aarch64__)
+  uint64_t* state = reinterpret_cast<uint64_t*>(top) - 20;
+  for (size_t i = 0; i < 20; ++i) {
+    state[i] = 0;
+  }
+
+  state[0] = reinterpret_cast<uint64_t>(argument); // x19
+  state[1] = reinterpret_cast<uint64_t>(procedure); // x20
+  state[11] = reinterpret_cast<uint64_t>(&dispatcherContextEntry); // x30
+  return state;
+#else
+  ContextStart* start = reinterpret_cast<ContextStart*>((top - sizeof(ContextStart)) & ~static_cast<uintptr_t>(15));
+  if (getcontext(&start->context) == -1) { //makecontext precondition
+    throw std::runtime_error("makeContext, getcontext failed, " + lastErrorMessage());
+  }
+
+  start->procedure = procedure;
+  start->argument = argument;
+  start->context.uc_stack.ss_sp = stack;
+  start->context.uc_stack.ss_size = reinterpret_cast<uintptr_t>(start) - reinterpret_cast<uintptr_t>(stack);
+  start->context.uc_link = nullptr;
+  makecontext(&start->context, (void(*)())contextStart, 1, reinterpret_cast<int*>(start));
+  return &start->context;
+#endif
+}
+
+void switchContext(void** from, void* to) {
+#if defined(__x86_64__) || defined(__aarch64__)
+  dispatcherSwitchContext(from, to);
+#else
+  // the suspended context keeps its state in this frame until it is resumed
+  ucontext_t context;
+  *from = &context;
+  if (swapcontext(&context, static_cast<ucontext_t*>(to)) == -1) {
+    throw std::runtime_error("switchContext, swapcontext failed, " + lastErrorMessage());
+  }
+#endif
+}
+
+}
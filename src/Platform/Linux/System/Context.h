@@ -0,0 +1,29 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <cstddef>
+
+namespace System {
+
+/* Maps size bytes of stack plus a guard page below them, so an overflow
+   faults instead of running into whatever was allocated next. size must be
+   a multiple of the page size. Returns the lowest usable address. */
+void* allocateContextStack(size_t size);
+void freeContextStack(void* stack, size_t size);
+
+size_t getPageSize();
+
+/* Prepares the stack [stack, stack + size) so that the first switchContext()
+   to the returned state calls procedure(argument). procedure must not return. */
+void* makeContext(void* stack, size_t size, void (*procedure)(void*), void* argument);
+
+/* Suspends the running context, storing its state in *from, and resumes the
+   context whose state is to. Only the registers the calling convention asks
+   a callee to preserve are saved, on the suspended stack itself; unlike
+   swapcontext() the signal mask is left alone, so no system call is made. */
+void switchContext(void** from, void* to);
+
+}
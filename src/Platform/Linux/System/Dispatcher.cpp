@@ -16,15 +16,16 @@
 // along with Bytecoin.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Dispatcher.h"
+#include <algorithm>
 #include <cassert>
+#include <limits>
 
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
-#include <sys/timerfd.h>
 #include <fcntl.h>
 #include <string.h>
-#include <ucontext.h>
 #include <unistd.h>
+#include "Context.h"
 #include "ErrorMessage.h"
 
 namespace System {
@@ -33,7 +34,7 @@ namespace {
 
 struct ContextMakingData {
   Dispatcher* dispatcher;
-  void* ucontext;
+  void* stack;
 };
 
 class MutextGuard {
@@ -55,56 +56,63 @@ private:
 
 static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "invalid pthread mutex size");
 
-const size_t STACK_SIZE = 64 * 1024;
+/* Timers are kept to the millisecond, the resolution of the epoll_wait
+   timeout that waits for them */
+typedef std::chrono::milliseconds TimerTick;
+
+uint64_t currentTimerTick() {
+  return std::chrono::duration_cast<TimerTick>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
 };
 
-Dispatcher::Dispatcher() {
+Dispatcher::Dispatcher(size_t stackSize) {
   std::string message;
   epoll = ::epoll_create1(0);
   if (epoll == -1) {
     message = "epoll_create1 failed, " + lastErrorMessage();
   } else {
-    mainContext.ucontext = new ucontext_t;
-    if (getcontext(reinterpret_cast<ucontext_t*>(mainContext.ucontext)) == -1) {
-      message = "getcontext failed, " + lastErrorMessage();
-    } else {
-      remoteSpawnEvent = eventfd(0, O_NONBLOCK);
-      if(remoteSpawnEvent == -1) {
-        message = "eventfd failed, " + lastErrorMessage();
-      } else {
-        remoteSpawnEventContext.writeContext = nullptr;
-        remoteSpawnEventContext.readContext = nullptr;
+    mainContext.savedState = nullptr;
+    mainContext.stack = nullptr;
 
-        epoll_event remoteSpawnEventEpollEvent;
-        remoteSpawnEventEpollEvent.events = EPOLLIN;
-        remoteSpawnEventEpollEvent.data.ptr = &remoteSpawnEventContext;
+    remoteSpawnEvent = eventfd(0, O_NONBLOCK);
+    if(remoteSpawnEvent == -1) {
+      message = "eventfd failed, " + lastErrorMessage();
+    } else {
+      remoteSpawnEventContext.writeContext = nullptr;
+      remoteSpawnEventContext.readContext = nullptr;
 
-        if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
-          message = "epoll_ctl failed, " + lastErrorMessage();
-        } else {
-          *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
-
-          mainContext.interrupted = false;
-          mainContext.group = &contextGroup;
-          mainContext.groupPrev = nullptr;
-          mainContext.groupNext = nullptr;
-          mainContext.inExecutionQueue = false;
-          contextGroup.firstContext = nullptr;
-          contextGroup.lastContext = nullptr;
-          contextGroup.firstWaiter = nullptr;
-          contextGroup.lastWaiter = nullptr;
-          currentContext = &mainContext;
-          firstResumingContext = nullptr;
-          firstReusableContext = nullptr;
-          runningContextCount = 0;
-          return;
-        }
+      epoll_event remoteSpawnEventEpollEvent;
+      remoteSpawnEventEpollEvent.events = EPOLLIN;
+      remoteSpawnEventEpollEvent.data.ptr = &remoteSpawnEventContext;
 
-        auto result = close(remoteSpawnEvent);
-        if (result) {}
-        assert(result == 0);
+      if (epoll_ctl(epoll, EPOLL_CTL_ADD, remoteSpawnEvent, &remoteSpawnEventEpollEvent) == -1) {
+        message = "epoll_ctl failed, " + lastErrorMessage();
+      } else {
+        *reinterpret_cast<pthread_mutex_t*>(this->mutex) = pthread_mutex_t(PTHREAD_MUTEX_INITIALIZER);
+
+        mainContext.interrupted = false;
+        mainContext.group = &contextGroup;
+        mainContext.groupPrev = nullptr;
+        mainContext.groupNext = nullptr;
+        mainContext.inExecutionQueue = false;
+        contextGroup.firstContext = nullptr;
+        contextGroup.lastContext = nullptr;
+        contextGroup.firstWaiter = nullptr;
+        contextGroup.lastWaiter = nullptr;
+        currentContext = &mainContext;
+        firstResumingContext = nullptr;
+        firstReusableContext = nullptr;
+        runningContextCount = 0;
+        contextCount = 0;
+        contextSwitchCount = 0;
+        this->stackSize = (std::max(stackSize, getPageSize()) + getPageSize() - 1) / getPageSize() * getPageSize();
+        return;
       }
+
+      auto result = close(remoteSpawnEvent);
+      if (result) {}
+      assert(result == 0);
     }
 
     auto result = close(epoll);
@@ -125,20 +133,8 @@ Dispatcher::~Dispatcher() {
   assert(contextGroup.firstWaiter == nullptr);
   assert(firstResumingContext == nullptr);
   assert(runningContextCount == 0);
-  while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
-    firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
-
-  while (!timers.empty()) {
-    int result = ::close(timers.top());
-    if (result) {}
-    assert(result == 0);
-    timers.pop();
-  }
+  freeReusableContexts();
+  assert(timerWheel.empty());
 
   auto result = close(epoll);
   if (result) {}
@@ -150,22 +146,7 @@ Dispatcher::~Dispatcher() {
 }
 
 void Dispatcher::clear() {
-  while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
-    firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
-
-  while (!timers.empty()) {
-    int result = ::close(timers.top());
-    if (result == -1) {
-      throw std::runtime_error("Dispatcher::clear, close failed, "  + lastErrorMessage());
-    }
-
-    timers.pop();
-  }
+  freeReusableContexts();
 }
 
 void Dispatcher::dispatch() {
@@ -181,8 +162,25 @@ void Dispatcher::dispatch() {
       break;
     }
 
+    int timeout = -1;
+    if (!timerWheel.empty()) {
+      uint64_t now = currentTimerTick();
+      expireTimers(now);
+      if (firstResumingContext != nullptr) {
+        continue;
+      }
+
+      if (!timerWheel.empty()) {
+        timeout = static_cast<int>(std::min<uint64_t>(timerWheel.nextTick() - now, std::numeric_limits<int>::max()));
+      }
+    }
+
     epoll_event event;
-    int count = epoll_wait(epoll, &event, 1, -1);
+    int count = epoll_wait(epoll, &event, 1, timeout);
+    if (count == 0) {
+      continue;
+    }
+
     if (count == 1) {
       ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
       if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
@@ -221,14 +219,25 @@ void Dispatcher::dispatch() {
   }
 
   if (context != currentContext) {
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
+    NativeContext* oldContext = currentContext;
     currentContext = context;
-    if (swapcontext(oldContext, static_cast<ucontext_t *>(context->ucontext)) == -1) {
-      throw std::runtime_error("Dispatcher::dispatch, swapcontext failed, " + lastErrorMessage());
-    }
+    ++contextSwitchCount;
+    switchContext(&oldContext->savedState, context->savedState);
   }
 }
 
+uint64_t Dispatcher::getContextSwitchCount() const {
+  return contextSwitchCount;
+}
+
+size_t Dispatcher::getContextCount() const {
+  return contextCount;
+}
+
+size_t Dispatcher::getRunningContextCount() const {
+  return runningContextCount;
+}
+
 NativeContext* Dispatcher::getCurrentContext() const {
   return currentContext;
 }
@@ -363,6 +372,10 @@ void Dispatcher::yield() {
     }
   }
 
+  if (!timerWheel.empty()) {
+    expireTimers(currentTimerTick());
+  }
+
   if (firstResumingContext != nullptr) {
     pushContext(currentContext);
     dispatch();
@@ -375,26 +388,22 @@ int Dispatcher::getEpoll() const {
 
 NativeContext& Dispatcher::getReusableContext() {
   if(firstReusableContext == nullptr) {
-    ucontext_t* newlyCreatedContext = new ucontext_t;
-    if (getcontext(newlyCreatedContext) == -1) { //makecontext precondition
-      throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
-    }
-
-    auto stackPointer = new uint8_t[STACK_SIZE];
-    newlyCreatedContext->uc_stack.ss_sp = stackPointer;
-    newlyCreatedContext->uc_stack.ss_size = STACK_SIZE;
-
-    ContextMakingData makingContextData {this, newlyCreatedContext};
-    makecontext(newlyCreatedContext, (void(*)())contextProcedureStatic, 1, reinterpret_cast<int*>(&makingContextData));
+    void* stack = allocateContextStack(stackSize);
 
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
-    if (swapcontext(oldContext, newlyCreatedContext) == -1) {
-      throw std::runtime_error("Dispatcher::getReusableContext, swapcontext failed, " + lastErrorMessage());
+    ContextMakingData makingContextData {this, stack};
+    void* newlyCreatedContext;
+    try {
+      newlyCreatedContext = makeContext(stack, stackSize, contextProcedureStatic, &makingContextData);
+    } catch (...) {
+      freeContextStack(stack, stackSize);
+      throw;
     }
 
+    switchContext(&currentContext->savedState, newlyCreatedContext);
+
     assert(firstReusableContext != nullptr);
-    assert(firstReusableContext->ucontext == newlyCreatedContext);
-    firstReusableContext->stackPtr = stackPointer;
+    assert(firstReusableContext->stack == stack);
+    ++contextCount;
   };
 
   NativeContext* context = firstReusableContext;
@@ -408,41 +417,50 @@ void Dispatcher::pushReusableContext(NativeContext& context) {
   --runningContextCount;
 }
 
-int Dispatcher::getTimer() {
-  int timer;
-  if (timers.empty()) {
-    timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-    epoll_event timerEvent;
-    timerEvent.events = EPOLLONESHOT;
-    timerEvent.data.ptr = nullptr;
-
-    if (epoll_ctl(getEpoll(), EPOLL_CTL_ADD, timer, &timerEvent) == -1) {
-      throw std::runtime_error("Dispatcher::getTimer, epoll_ctl failed, "  + lastErrorMessage());
-    }
-  } else {
-    timer = timers.top();
-    timers.pop();
+void Dispatcher::addTimer(NativeTimer& timer, std::chrono::nanoseconds duration) {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  // rounded up, a timer never expires early
+  auto expires = std::chrono::duration_cast<TimerTick>(now + duration);
+  if (expires < now + duration) {
+    ++expires;
   }
 
-  return timer;
+  timer.expires = expires.count();
+  timerWheel.add(timer, std::chrono::duration_cast<TimerTick>(now).count());
+}
+
+void Dispatcher::removeTimer(NativeTimer& timer) {
+  timerWheel.remove(timer);
 }
 
-void Dispatcher::pushTimer(int timer) {
-  timers.push(timer);
+void Dispatcher::expireTimers(uint64_t now) {
+  NativeTimer* timer = timerWheel.advance(now);
+  while (timer != nullptr) {
+    NativeTimer* next = timer->next;
+    pushContext(timer->context);
+    timer = next;
+  }
 }
 
-void Dispatcher::contextProcedure(void* ucontext) {
+void Dispatcher::freeReusableContexts() {
+  while (firstReusableContext != nullptr) {
+    void* stack = firstReusableContext->stack;
+    firstReusableContext = firstReusableContext->next;
+    // the context lives on its own stack
+    freeContextStack(stack, stackSize);
+    --contextCount;
+  }
+}
+
+void Dispatcher::contextProcedure(void* stack) {
   assert(firstReusableContext == nullptr);
   NativeContext context;
-  context.ucontext = ucontext;
+  context.stack = stack;
   context.interrupted = false;
   context.next = nullptr;
   context.inExecutionQueue = false;
   firstReusableContext = &context;
-  ucontext_t* oldContext = static_cast<ucontext_t*>(context.ucontext);
-  if (swapcontext(oldContext, static_cast<ucontext_t*>(currentContext->ucontext)) == -1) {
-    throw std::runtime_error("Dispatcher::contextProcedure, swapcontext failed, " + lastErrorMessage());
-  }
+  switchContext(&context.savedState, currentContext->savedState);
 
   for (;;) {
     ++runningContextCount;
@@ -493,7 +511,7 @@ void Dispatcher::contextProcedure(void* ucontext) {
 
 void Dispatcher::contextProcedureStatic(void *context) {
   ContextMakingData* makingContextData = reinterpret_cast<ContextMakingData*>(context);
-  makingContextData->dispatcher->contextProcedure(makingContextData->ucontext);
+  makingContextData->dispatcher->contextProcedure(makingContextData->stack);
 }
 
 }
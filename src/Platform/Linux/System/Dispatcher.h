@@ -17,21 +17,23 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <queue>
-#include <stack>
 #ifndef __GLIBC__
 #include <bits/reg.h>
 #endif
+#include "TimerWheel.h"
 
 namespace System {
 
 struct NativeContextGroup;
 
 struct NativeContext {
-  void* ucontext;
-  void* stackPtr;
+  void* savedState;
+  void* stack;
   bool interrupted;
   bool inExecutionQueue;
   NativeContext* next;
@@ -62,7 +64,10 @@ struct ContextPair {
 
 class Dispatcher {
 public:
-  Dispatcher();
+  static const size_t DEFAULT_STACK_SIZE = 64 * 1024;
+
+  /* stackSize is rounded up to whole pages */
+  explicit Dispatcher(size_t stackSize = DEFAULT_STACK_SIZE);
   Dispatcher(const Dispatcher&) = delete;
   ~Dispatcher();
   Dispatcher& operator=(const Dispatcher&) = delete;
@@ -76,12 +81,16 @@ public:
   void remoteSpawn(std::function<void()>&& procedure);
   void yield();
 
+  uint64_t getContextSwitchCount() const;
+  size_t getContextCount() const;
+  size_t getRunningContextCount() const;
+
   // system-dependent
   int getEpoll() const;
   NativeContext& getReusableContext();
   void pushReusableContext(NativeContext&);
-  int getTimer();
-  void pushTimer(int timer);
+  void addTimer(NativeTimer& timer, std::chrono::nanoseconds duration);
+  void removeTimer(NativeTimer& timer);
 
 #ifdef __x86_64__
     # if __WORDSIZE == 64
@@ -102,7 +111,7 @@ private:
   int remoteSpawnEvent;
   ContextPair remoteSpawnEventContext;
   std::queue<std::function<void()>> remoteSpawningProcedures;
-  std::stack<int> timers;
+  TimerWheel timerWheel;
 
   NativeContext mainContext;
   NativeContextGroup contextGroup;
@@ -111,8 +120,13 @@ private:
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
   size_t runningContextCount;
+  size_t contextCount;
+  uint64_t contextSwitchCount;
+  size_t stackSize;
 
-  void contextProcedure(void* ucontext);
+  void expireTimers(uint64_t now);
+  void freeReusableContexts();
+  void contextProcedure(void* stack);
   static void contextProcedureStatic(void* context);
 };
 
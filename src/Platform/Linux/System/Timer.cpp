@@ -19,12 +19,7 @@
 #include <cassert>
 #include <stdexcept>
 
-#include <sys/timerfd.h>
-#include <sys/epoll.h>
-#include <unistd.h>
-
 #include "Dispatcher.h"
-#include <System/ErrorMessage.h>
 #include <System/InterruptedException.h>
 
 namespace System {
@@ -32,13 +27,12 @@ namespace System {
 Timer::Timer() : dispatcher(nullptr) {
 }
 
-Timer::Timer(Dispatcher& dispatcher) : dispatcher(&dispatcher), context(nullptr), timer(-1) {
+Timer::Timer(Dispatcher& dispatcher) : dispatcher(&dispatcher), context(nullptr) {
 }
 
 Timer::Timer(Timer&& other) : dispatcher(other.dispatcher) {
   if (other.dispatcher != nullptr) {
     assert(other.context == nullptr);
-    timer = other.timer;
     context = nullptr;
     other.dispatcher = nullptr;
   }
@@ -53,10 +47,8 @@ Timer& Timer::operator=(Timer&& other) {
   dispatcher = other.dispatcher;
   if (other.dispatcher != nullptr) {
     assert(other.context == nullptr);
-    timer = other.timer;
     context = nullptr;
     other.dispatcher = nullptr;
-    other.timer = -1;
   }
 
   return *this;
@@ -72,71 +64,33 @@ void Timer::sleep(std::chrono::nanoseconds duration) {
   if(duration.count() == 0 ) {
     dispatcher->yield();
   } else {
-    timer = dispatcher->getTimer();
-
-    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
-    itimerspec expires;
-    expires.it_interval.tv_nsec = expires.it_interval.tv_sec = 0;
-    expires.it_value.tv_sec = seconds.count();
-    expires.it_value.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(duration - seconds).count();
-    timerfd_settime(timer, 0, &expires, NULL);
-
-    ContextPair contextPair;
-    OperationContext timerContext;
-    timerContext.interrupted = false;
-    timerContext.context = dispatcher->getCurrentContext();
-    contextPair.writeContext = nullptr;
-    contextPair.readContext = &timerContext;
-
-    epoll_event timerEvent;
-    timerEvent.events = EPOLLIN | EPOLLONESHOT;
-    timerEvent.data.ptr = &contextPair;
+    NativeTimer timer;
+    timer.context = dispatcher->getCurrentContext();
+    timer.pending = false;
+    timer.interrupted = false;
+    dispatcher->addTimer(timer, duration);
 
-    if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, timer, &timerEvent) == -1) {
-      throw std::runtime_error("Timer::sleep, epoll_ctl failed, " + lastErrorMessage());
-    }
     dispatcher->getCurrentContext()->interruptProcedure = [&]() {
         assert(dispatcher != nullptr);
         assert(context != nullptr);
-        OperationContext* timerContext = static_cast<OperationContext*>(context);
-        if (!timerContext->interrupted) {
-          uint64_t value = 0;
-          if(::read(timer, &value, sizeof value) == -1 ){
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wlogical-op"
-            if(errno == EAGAIN || errno == EWOULDBLOCK) {
-#pragma GCC diagnostic pop
-              timerContext->interrupted = true;
-              dispatcher->pushContext(timerContext->context);
-            } else {
-              throw std::runtime_error("Timer::sleep, interrupt procedure, read failed, "  + lastErrorMessage());
-            }
-          } else {
-            assert(value>0);
-            dispatcher->pushContext(timerContext->context);
-          }
-
-          epoll_event timerEvent;
-          timerEvent.events = EPOLLONESHOT;
-          timerEvent.data.ptr = nullptr;
-
-          if (epoll_ctl(dispatcher->getEpoll(), EPOLL_CTL_MOD, timer, &timerEvent) == -1) {
-            throw std::runtime_error("Timer::sleep, interrupt procedure, epoll_ctl failed, " + lastErrorMessage());
-          }
+        NativeTimer* timer = static_cast<NativeTimer*>(context);
+        // an expired timer has already resumed the context
+        if (timer->pending) {
+          dispatcher->removeTimer(*timer);
+          timer->interrupted = true;
+          dispatcher->pushContext(timer->context);
         }
     };
 
-    context = &timerContext;
+    context = &timer;
     dispatcher->dispatch();
     dispatcher->getCurrentContext()->interruptProcedure = nullptr;
     assert(dispatcher != nullptr);
-    assert(timerContext.context == dispatcher->getCurrentContext());
-    assert(contextPair.writeContext == nullptr);
-    assert(context == &timerContext);
+    assert(timer.context == dispatcher->getCurrentContext());
+    assert(!timer.pending);
+    assert(context == &timer);
     context = nullptr;
-    timerContext.context = nullptr;
-    dispatcher->pushTimer(timer);
-    if (timerContext.interrupted) {
+    if (timer.interrupted) {
       throw InterruptedException();
     }
   }
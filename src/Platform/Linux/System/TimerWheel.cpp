@@ -0,0 +1,180 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "TimerWheel.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace System {
+
+namespace {
+
+const uint64_t SLOT_MASK = TimerWheel::SLOTS - 1;
+
+// the furthest a timer is placed from the current tick, later ones are placed again when they get there
+const uint64_t MAX_DELTA = (uint64_t(1) << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS)) - 1;
+
+}
+
+TimerWheel::TimerWheel() : currentTick(0), count(0) {
+  std::fill(occupied, occupied + LEVELS, 0);
+  for (unsigned level = 0; level < LEVELS; ++level) {
+    std::fill(slots[level], slots[level] + SLOTS, nullptr);
+  }
+}
+
+bool TimerWheel::empty() const {
+  return count == 0;
+}
+
+size_t TimerWheel::size() const {
+  return count;
+}
+
+void TimerWheel::add(NativeTimer& timer, uint64_t now) {
+  assert(!timer.pending);
+  // nothing is on the wheel to expire on the way, so it can jump ahead
+  if (count == 0 && now > currentTick) {
+    currentTick = now;
+  }
+
+  timer.expires = std::max(timer.expires, currentTick);
+  timer.pending = true;
+  place(timer);
+  ++count;
+}
+
+void TimerWheel::remove(NativeTimer& timer) {
+  assert(timer.pending);
+  *timer.previousNext = timer.next;
+  if (timer.next != nullptr) {
+    timer.next->previousNext = timer.previousNext;
+  }
+
+  const unsigned level = timer.slot / SLOTS;
+  const unsigned index = timer.slot % SLOTS;
+  if (slots[level][index] == nullptr) {
+    occupied[level] &= ~(uint64_t(1) << index);
+  }
+
+  timer.pending = false;
+  --count;
+}
+
+NativeTimer* TimerWheel::advance(uint64_t now) {
+  NativeTimer* expired = nullptr;
+  if (count != 0) {
+    // timers added when they were already due
+    expire(currentTick & SLOT_MASK, expired);
+  }
+
+  while (currentTick < now && count != 0) {
+    // skip to the next timers of level 0 or to the end of its turn, whichever is first
+    const unsigned index = currentTick & SLOT_MASK;
+    const uint64_t later = index + 1 < SLOTS ? occupied[0] >> (index + 1) : 0;
+    const uint64_t next = later != 0 ? currentTick + 1 + __builtin_ctzll(later) : currentTick - index + SLOTS;
+    currentTick = std::min(next, now);
+
+    if ((currentTick & SLOT_MASK) == 0) {
+      cascade(1);
+    }
+
+    expire(currentTick & SLOT_MASK, expired);
+  }
+
+  currentTick = std::max(currentTick, now);
+  return expired;
+}
+
+uint64_t TimerWheel::nextTick() const {
+  uint64_t tick = std::numeric_limits<uint64_t>::max();
+  for (unsigned level = 0; level < LEVELS; ++level) {
+    if (occupied[level] == 0) {
+      continue;
+    }
+
+    const unsigned shift = SLOT_BITS * level;
+    const unsigned index = (currentTick >> shift) & SLOT_MASK;
+    if (level == 0 && (occupied[0] >> index & 1) != 0) {
+      return currentTick;
+    }
+
+    // bit n of rotated is the slot n + 1 turns of the level ahead
+    const unsigned rotation = (index + 1) & SLOT_MASK;
+    const uint64_t rotated = rotation == 0 ? occupied[level] : occupied[level] >> rotation | occupied[level] << (SLOTS - rotation);
+    const uint64_t turns = __builtin_ctzll(rotated) + 1;
+    tick = std::min(tick, ((currentTick >> shift) + turns) << shift);
+  }
+
+  return tick;
+}
+
+void TimerWheel::place(NativeTimer& timer) {
+  assert(timer.expires >= currentTick);
+  const uint64_t expires = std::min(timer.expires, currentTick + MAX_DELTA);
+  const uint64_t delta = expires - currentTick;
+
+  unsigned level = 0;
+  while (level + 1 < LEVELS && delta >> (SLOT_BITS * (level + 1)) != 0) {
+    ++level;
+  }
+
+  const unsigned index = (expires >> (SLOT_BITS * level)) & SLOT_MASK;
+  NativeTimer*& head = slots[level][index];
+  timer.next = head;
+  timer.previousNext = &head;
+  if (head != nullptr) {
+    head->previousNext = &timer.next;
+  }
+
+  head = &timer;
+  timer.slot = level * SLOTS + index;
+  occupied[level] |= uint64_t(1) << index;
+}
+
+// Moves the timers of the slot the current tick has just entered a level down
+void TimerWheel::cascade(unsigned level) {
+  const unsigned index = (currentTick >> (SLOT_BITS * level)) & SLOT_MASK;
+  if (index == 0 && level + 1 < LEVELS) {
+    cascade(level + 1);
+  }
+
+  NativeTimer* timer = slots[level][index];
+  slots[level][index] = nullptr;
+  occupied[level] &= ~(uint64_t(1) << index);
+
+  while (timer != nullptr) {
+    NativeTimer* next = timer->next;
+    place(*timer);
+    timer = next;
+  }
+}
+
+void TimerWheel::expire(unsigned index, NativeTimer*& expired) {
+  NativeTimer* timer = slots[0][index];
+  if (timer == nullptr) {
+    return;
+  }
+
+  slots[0][index] = nullptr;
+  occupied[0] &= ~(uint64_t(1) << index);
+
+  while (timer != nullptr) {
+    NativeTimer* next = timer->next;
+    if (timer->expires > currentTick) {
+      // beyond MAX_DELTA when it was placed
+      place(*timer);
+    } else {
+      timer->pending = false;
+      timer->next = expired;
+      expired = timer;
+      --count;
+    }
+
+    timer = next;
+  }
+}
+
+}
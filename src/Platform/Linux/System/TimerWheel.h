@@ -0,0 +1,69 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace System {
+
+struct NativeContext;
+
+struct NativeTimer {
+  // tick the timer is due at
+  uint64_t expires;
+  NativeContext* context;
+  // on the wheel, cleared when the timer expires or is removed
+  bool pending;
+  bool interrupted;
+
+  // owned by the wheel
+  NativeTimer* next;
+  NativeTimer** previousNext;
+  uint32_t slot;
+};
+
+/* Hierarchical timing wheel: LEVELS wheels of SLOTS slots each, level n
+   holding the timers due within SLOTS^(n+1) ticks, so adding and removing a
+   timer is a list insertion or removal and only the timers that get close
+   to expiring are ever moved, a level down at a time. The wheel has no
+   clock of its own, it is told the current tick by add() and advance(). */
+class TimerWheel {
+public:
+  static const unsigned SLOT_BITS = 6;
+  static const unsigned SLOTS = 1 << SLOT_BITS;
+  static const unsigned LEVELS = 6;
+
+  TimerWheel();
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  bool empty() const;
+  size_t size() const;
+
+  /* now must not be before the tick of the last add() or advance(). A timer
+     due at or before now expires on the next advance() */
+  void add(NativeTimer& timer, uint64_t now);
+  void remove(NativeTimer& timer);
+
+  /* Returns the timers due by now, linked through next, and no longer
+     pending */
+  NativeTimer* advance(uint64_t now);
+
+  // first tick advance() has anything to do at, only meaningful when not empty
+  uint64_t nextTick() const;
+
+private:
+  void place(NativeTimer& timer);
+  void cascade(unsigned level);
+  void expire(unsigned index, NativeTimer*& expired);
+
+  uint64_t currentTick;
+  size_t count;
+  uint64_t occupied[LEVELS];
+  NativeTimer* slots[LEVELS][SLOTS];
+};
+
+}
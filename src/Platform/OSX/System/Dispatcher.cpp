@@ -94,6 +94,8 @@ Dispatcher::Dispatcher() : lastCreatedTimer(0) {
           firstResumingContext = nullptr;
           firstReusableContext = nullptr;
           runningContextCount = 0;
+          contextCount = 0;
+          contextSwitchCount = 0;
           return;
         }
       }
@@ -123,6 +125,7 @@ Dispatcher::~Dispatcher() {
     firstReusableContext = firstReusableContext->next;
     delete[] stackPtr;
     delete ucontext;
+    --contextCount;
   }
   
   auto result = close(kqueue);
@@ -139,6 +142,7 @@ void Dispatcher::clear() {
     firstReusableContext = firstReusableContext->next;
     delete[] stackPtr;
     delete ucontext;
+    --contextCount;
   }
 }
 
@@ -207,12 +211,25 @@ void Dispatcher::dispatch() {
   if (context != currentContext) {
     uctx* oldContext = static_cast<uctx*>(currentContext->uctx);
     currentContext = context;
+    ++contextSwitchCount;
     if (swapcontext(oldContext,static_cast<uctx*>(currentContext->uctx)) == -1) {
       throw std::runtime_error("Dispatcher::dispatch, swapcontext failed, " + lastErrorMessage());
     }
   }
 }
 
+uint64_t Dispatcher::getContextSwitchCount() const {
+  return contextSwitchCount;
+}
+
+size_t Dispatcher::getContextCount() const {
+  return contextCount;
+}
+
+size_t Dispatcher::getRunningContextCount() const {
+  return runningContextCount;
+}
+
 NativeContext* Dispatcher::getCurrentContext() const {
   return currentContext;
 }
@@ -365,6 +382,7 @@ NativeContext& Dispatcher::getReusableContext() {
    assert(firstReusableContext != nullptr);
    assert(firstReusableContext->uctx == newlyCreatedContext);
    firstReusableContext->stackPtr = stackPointer;
+   ++contextCount;
   }
   
   NativeContext* context = firstReusableContext;
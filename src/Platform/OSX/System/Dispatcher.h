@@ -19,6 +19,7 @@
 
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <queue>
 #include <stack>
@@ -68,6 +69,10 @@ public:
   void remoteSpawn(std::function<void()>&& procedure);
   void yield();
 
+  uint64_t getContextSwitchCount() const;
+  size_t getContextCount() const;
+  size_t getRunningContextCount() const;
+
   int getKqueue() const;
   NativeContext& getReusableContext();
   void pushReusableContext(NativeContext&);
@@ -97,6 +102,8 @@ private:
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
   size_t runningContextCount;
+  size_t contextCount;
+  uint64_t contextSwitchCount;
 
   void contextProcedure(void* uctx);
   static void contextProcedureStatic(intptr_t context);
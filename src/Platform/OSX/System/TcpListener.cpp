@@ -120,6 +120,11 @@ TcpListener& TcpListener::operator=(TcpListener&& other) {
 }
 
 TcpConnection TcpListener::accept() {
+  assert(dispatcher != nullptr);
+  return accept(*dispatcher);
+}
+
+TcpConnection TcpListener::accept(Dispatcher& connectionDispatcher) {
   assert(dispatcher != nullptr);
   assert(context == nullptr);
   if (dispatcher->interrupted()) {
@@ -175,7 +180,7 @@ TcpConnection TcpListener::accept() {
       if (flags == -1 || fcntl(connection, F_SETFL, flags | O_NONBLOCK) == -1) {
         message = "fcntl failed, " + lastErrorMessage();
       } else {
-        return TcpConnection(*dispatcher, connection);
+        return TcpConnection(connectionDispatcher, connection);
       }
     }
   }
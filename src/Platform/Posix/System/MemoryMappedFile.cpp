@@ -181,6 +181,37 @@ void MemoryMappedFile::rename(const std::string& newPath) {
   }
 }
 
+void MemoryMappedFile::resize(uint64_t size, std::error_code& ec) {
+  assert(isOpened());
+
+  int result = ::ftruncate(m_file, static_cast<off_t>(size));
+  if (result == -1) {
+    ec = std::error_code(errno, std::system_category());
+    return;
+  }
+
+  // map the new size before dropping the old view, so a failure leaves the file usable
+  void* data = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+  if (data == MAP_FAILED) {
+    ec = std::error_code(errno, std::system_category());
+    return;
+  }
+
+  ::munmap(m_data, static_cast<size_t>(m_size));
+
+  m_data = reinterpret_cast<uint8_t*>(data);
+  m_size = size;
+  ec = std::error_code();
+}
+
+void MemoryMappedFile::resize(uint64_t size) {
+  std::error_code ec;
+  resize(size, ec);
+  if (ec) {
+    throw std::system_error(ec, "MemoryMappedFile::resize");
+  }
+}
+
 void MemoryMappedFile::close(std::error_code& ec) {
   int result;
   if (m_data != nullptr) {
@@ -74,6 +74,8 @@ Dispatcher::Dispatcher() {
         firstResumingContext = nullptr;
         firstReusableContext = nullptr;
         runningContextCount = 0;
+        contextCount = 0;
+        contextSwitchCount = 0;
         return;
       }
 
@@ -105,6 +107,7 @@ Dispatcher::~Dispatcher() {
     void* fiber = firstReusableContext->fiber;
     firstReusableContext = firstReusableContext->next;
     DeleteFiber(fiber);
+    --contextCount;
   }
 
   int wsaResult = WSACleanup();
@@ -122,6 +125,7 @@ void Dispatcher::clear() {
     void* fiber = firstReusableContext->fiber;
     firstReusableContext = firstReusableContext->next;
     DeleteFiber(fiber);
+    --contextCount;
   }
 }
 
@@ -195,10 +199,23 @@ void Dispatcher::dispatch() {
 
   if (context != currentContext) {
     currentContext = context;
+    ++contextSwitchCount;
     SwitchToFiber(context->fiber);
   }
 }
 
+uint64_t Dispatcher::getContextSwitchCount() const {
+  return contextSwitchCount;
+}
+
+size_t Dispatcher::getContextCount() const {
+  return contextCount;
+}
+
+size_t Dispatcher::getRunningContextCount() const {
+  return runningContextCount;
+}
+
 NativeContext* Dispatcher::getCurrentContext() const {
   assert(GetCurrentThreadId() == threadId);
   return currentContext;
@@ -359,6 +376,7 @@ NativeContext& Dispatcher::getReusableContext() {
     SwitchToFiber(fiber);
     assert(firstReusableContext != nullptr);
     firstReusableContext->fiber = fiber;
+    ++contextCount;
   }
 
   NativeContext* context = firstReusableContext;
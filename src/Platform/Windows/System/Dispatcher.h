@@ -61,6 +61,10 @@ public:
   void remoteSpawn(std::function<void()>&& procedure);
   void yield();
 
+  uint64_t getContextSwitchCount() const;
+  size_t getContextCount() const;
+  size_t getRunningContextCount() const;
+
   // Platform-specific
   void addTimer(uint64_t time, NativeContext* context);
   void* getCompletionPort() const;
@@ -85,6 +89,8 @@ private:
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
   size_t runningContextCount;
+  size_t contextCount;
+  uint64_t contextSwitchCount;
 
   void contextProcedure();
   static void __stdcall contextProcedureStatic(void* context);
@@ -44,6 +44,10 @@ public:
   void rename(const std::string& newPath, std::error_code& ec);
   void rename(const std::string& newPath);
 
+  // Changes the file size in place, data() may move
+  void resize(uint64_t size, std::error_code& ec);
+  void resize(uint64_t size);
+
   void flush(uint8_t* data, uint64_t size, std::error_code& ec);
   void flush(uint8_t* data, uint64_t size);
 
@@ -37,6 +37,11 @@ public:
   TcpListener& operator=(TcpListener&& other);
   TcpConnection accept();
 
+  /* Waits for a connection on this listener's dispatcher but hands it to
+     connectionDispatcher, which may run on another thread. The connection
+     must only be used from connectionDispatcher's thread afterwards. */
+  TcpConnection accept(Dispatcher& connectionDispatcher);
+
 private:
   Dispatcher* dispatcher;
   size_t listener;
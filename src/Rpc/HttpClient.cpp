@@ -17,15 +17,22 @@
 
 #include "HttpClient.h"
 
-#include <HTTP/HttpParser.h>
+#include <HTTP/HttpParserErrorCodes.h>
 #include <System/Ipv4Resolver.h>
 #include <System/Ipv4Address.h>
 #include <System/TcpConnector.h>
 
 namespace CryptoNote {
 
+namespace {
+
+// block query responses run to tens of megabytes
+const size_t MAX_RESPONSE_BODY_SIZE = 256 * 1024 * 1024;
+
+}
+
 HttpClient::HttpClient(System::Dispatcher& dispatcher, const std::string& address, uint16_t port) :
-  m_dispatcher(dispatcher), m_address(address), m_port(port) {
+  m_dispatcher(dispatcher), m_address(address), m_port(port), m_parser(MAX_RESPONSE_BODY_SIZE) {
 }
 
 HttpClient::~HttpClient() {
@@ -40,11 +47,27 @@ void HttpClient::request(const HttpRequest &req, HttpResponse &res) {
   }
 
   try {
-    std::iostream stream(m_streamBuf.get());
-    HttpParser parser;
-    stream << req;
-    stream.flush();
-    parser.receiveResponse(stream, res);
+    std::string buffer;
+    req.appendTo(buffer);
+
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+      offset += m_connection.write(reinterpret_cast<const uint8_t*>(buffer.data()) + offset, buffer.size() - offset);
+    }
+
+    while (!m_parser.parseResponse()) {
+      size_t size;
+      char* data = m_parser.prepareReceive(size);
+      size_t read = m_connection.read(reinterpret_cast<uint8_t*>(data), size);
+      if (read == 0) {
+        throw std::system_error(make_error_code(error::HttpParserErrorCodes::END_OF_STREAM));
+      }
+
+      m_parser.receive(read);
+    }
+
+    m_parser.getResponse(res);
+    m_parser.next();
   } catch (const std::exception &) {
     disconnect();
     throw;
@@ -55,7 +78,6 @@ void HttpClient::connect() {
   try {
     auto ipAddr = System::Ipv4Resolver(m_dispatcher).resolve(m_address);
     m_connection = System::TcpConnector(m_dispatcher).connect(ipAddr, m_port);
-    m_streamBuf.reset(new System::TcpStreambuf(m_connection));
     m_connected = true;
   } catch (const std::exception& e) {
     throw ConnectException(e.what());
@@ -67,7 +89,7 @@ bool HttpClient::isConnected() const {
 }
 
 void HttpClient::disconnect() {
-  m_streamBuf.reset();
+  m_parser = HttpParser(MAX_RESPONSE_BODY_SIZE);
   try {
     m_connection.write(nullptr, 0); //Socket shutdown.
   } catch (std::exception&) {
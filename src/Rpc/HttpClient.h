@@ -19,10 +19,10 @@
 
 #include <memory>
 
+#include <HTTP/HttpParser.h>
 #include <HTTP/HttpRequest.h>
 #include <HTTP/HttpResponse.h>
 #include <System/TcpConnection.h>
-#include <System/TcpStream.h>
 
 #include "Serialization/SerializationTools.h"
 
@@ -52,7 +52,7 @@ private:
   bool m_connected = false;
   System::Dispatcher& m_dispatcher;
   System::TcpConnection m_connection;
-  std::unique_ptr<System::TcpStreambuf> m_streamBuf;
+  HttpParser m_parser;
 };
 
 template <typename Request, typename Response>
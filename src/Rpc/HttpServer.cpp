@@ -19,8 +19,8 @@
 #include <boost/scope_exit.hpp>
 
 #include <HTTP/HttpParser.h>
+#include <HTTP/HttpParserErrorCodes.h>
 #include <System/InterruptedException.h>
-#include <System/TcpStream.h>
 #include <System/Ipv4Address.h>
 
 using namespace Logging;
@@ -28,28 +28,64 @@ using namespace Logging;
 namespace CryptoNote {
 
 HttpServer::HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log)
-  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer") {
+  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer"), m_connectionCount(0), m_pool(nullptr),
+    m_maxRequestBodySize(HttpParser::DEFAULT_MAX_BODY_SIZE) {
 
 }
 
+void HttpServer::setDispatcherPool(System::DispatcherPool& pool) {
+  m_pool = &pool;
+}
+
+void HttpServer::setMaxRequestBodySize(size_t size) {
+  m_maxRequestBodySize = size;
+}
+
 void HttpServer::start(const std::string& address, uint16_t port) {
   m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
+
+  if (m_pool != nullptr) {
+    m_workerGroups.resize(m_pool->size());
+    for (size_t i = 0; i < m_pool->size(); ++i) {
+      m_pool->call(i, [this, i] { m_workerGroups[i].reset(new System::ContextGroup(m_pool->getDispatcher(i))); });
+    }
+  }
+
   workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
 }
 
 void HttpServer::stop() {
   workingContextGroup.interrupt();
   workingContextGroup.wait();
+
+  // Destroying a group interrupts its connections and waits for them
+  for (size_t i = 0; i < m_workerGroups.size(); ++i) {
+    m_pool->call(i, [this, i] { m_workerGroups[i].reset(); });
+  }
+
+  m_workerGroups.clear();
 }
 
 void HttpServer::acceptLoop() {
   try {
     System::TcpConnection connection;
     bool accepted = false;
+    size_t worker = 0;
 
     while (!accepted) {
       try {
-        connection = m_listener.accept();
+        if (m_pool != nullptr) {
+          worker = m_pool->assign();
+          try {
+            connection = m_listener.accept(m_pool->getDispatcher(worker));
+          } catch (...) {
+            m_pool->release(worker);
+            throw;
+          }
+        } else {
+          connection = m_listener.accept();
+        }
+
         accepted = true;
       } catch (System::InterruptedException&) {
         throw;
@@ -58,36 +94,98 @@ void HttpServer::acceptLoop() {
       }
     }
 
-    m_connections.insert(&connection);
-    BOOST_SCOPE_EXIT_ALL(this, &connection) { 
-      m_connections.erase(&connection); };
-
     workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
 
+    if (m_pool == nullptr) {
+      connectionHandler(connection, 0);
+      return;
+    }
+
+    // The connection belongs to the worker's dispatcher now and must be
+    // destroyed there too, so no reference to it is kept on this side
+    std::shared_ptr<System::TcpConnection> pooledConnection = std::make_shared<System::TcpConnection>(std::move(connection));
+    std::function<void()> procedure = [this, worker, pooledConnection] {
+      if (m_workerGroups[worker] == nullptr) {
+        // stopped before the connection got here
+        m_pool->release(worker);
+        return;
+      }
+
+      m_workerGroups[worker]->spawn([this, worker, pooledConnection] {
+        BOOST_SCOPE_EXIT_ALL(this, worker) {
+          m_pool->release(worker); };
+
+        connectionHandler(*pooledConnection, worker);
+      });
+    };
+
+    pooledConnection.reset();
+    m_pool->spawn(worker, std::move(procedure));
+  } catch (System::InterruptedException&) {
+  } catch (std::exception& e) {
+    logger(WARNING) << "Connection error: " << e.what();
+  }
+}
+
+void HttpServer::connectionHandler(System::TcpConnection& connection, size_t worker) {
+  try {
+    ++m_connectionCount;
+    BOOST_SCOPE_EXIT_ALL(this) {
+      --m_connectionCount; };
+
     auto addr = connection.getPeerAddressAndPort();
 
     logger(DEBUGGING) << "Incoming connection from " << addr.first.toDottedDecimal() << ":" << addr.second;
 
-    System::TcpStreambuf streambuf(connection);
-    std::iostream stream(&streambuf);
-    HttpParser parser;
+    HttpParser parser(m_maxRequestBodySize);
+    std::string responses;
+    bool keepAlive = true;
 
-    for (;;) {
-      HttpRequest req;
-      HttpResponse resp;
+    while (keepAlive) {
+      // Every request already received is answered before the responses go out together
+      while (keepAlive && parser.parseRequest()) {
+        HttpRequest req;
+        HttpResponse resp;
 
-      parser.receiveRequest(stream, req);
-      processRequest(req, resp);
+        parser.getRequest(req);
+        keepAlive = parser.keepAlive();
+        parser.next();
 
-      stream << resp;
-      stream.flush();
+        if (m_pool != nullptr) {
+          // Handlers share state with the rest of the daemon, they only run on its dispatcher
+          m_pool->callOwner(worker, [this, &req, &resp] { processRequest(req, resp); });
+        } else {
+          processRequest(req, resp);
+        }
 
-      if (stream.peek() == std::iostream::traits_type::eof()) {
+        resp.appendTo(responses);
+      }
+
+      size_t offset = 0;
+      while (offset < responses.size()) {
+        offset += connection.write(reinterpret_cast<const uint8_t*>(responses.data()) + offset, responses.size() - offset);
+      }
+
+      responses.clear();
+      if (!keepAlive) {
         break;
       }
+
+      size_t size;
+      char* data = parser.prepareReceive(size);
+      size_t read = connection.read(reinterpret_cast<uint8_t*>(data), size);
+      if (read == 0) {
+        if (parser.hasBufferedData()) {
+          throw std::system_error(make_error_code(error::HttpParserErrorCodes::END_OF_STREAM));
+        }
+
+        break;
+      }
+
+      parser.receive(read);
     }
 
-    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << m_connections.size();
+    logger(DEBUGGING) << "Closing connection from " << addr.first.toDottedDecimal() << ":" << addr.second << " total=" << m_connectionCount.load();
 
   } catch (System::InterruptedException&) {
   } catch (std::exception& e) {
@@ -17,13 +17,16 @@
 
 #pragma once 
 
-#include <unordered_set>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include <HTTP/HttpRequest.h>
 #include <HTTP/HttpResponse.h>
 
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
+#include <System/DispatcherPool.h>
 #include <System/TcpListener.h>
 #include <System/TcpConnection.h>
 #include <System/Event.h>
@@ -38,6 +41,14 @@ public:
 
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
 
+  /* Reads and writes connections on pool's threads instead of this
+     dispatcher; processRequest() still runs here. Call before start(), the
+     pool must outlive stop(). */
+  void setDispatcherPool(System::DispatcherPool& pool);
+
+  // Requests with a larger body are refused and their connection closed
+  void setMaxRequestBodySize(size_t size);
+
   void start(const std::string& address, uint16_t port);
   void stop();
 
@@ -50,12 +61,17 @@ protected:
 private:
 
   void acceptLoop();
-  void connectionHandler(System::TcpConnection&& conn);
+  void connectionHandler(System::TcpConnection& connection, size_t worker);
 
   System::ContextGroup workingContextGroup;
   Logging::LoggerRef logger;
   System::TcpListener m_listener;
-  std::unordered_set<System::TcpConnection*> m_connections;
+  std::atomic<size_t> m_connectionCount;
+
+  System::DispatcherPool* m_pool;
+  size_t m_maxRequestBodySize;
+  // One per pool thread, each created, used and destroyed on its own thread
+  std::vector<std::unique_ptr<System::ContextGroup>> m_workerGroups;
 };
 
 }
@@ -5,7 +5,9 @@
 // Please see the included LICENSE file for more information.
 
 #include "RpcServer.h"
+#include <chrono>
 #include <future>
+#include <sstream>
 #include <unordered_map>
 #include "math.h"
 
@@ -13,6 +15,7 @@
 #include "Common/StringTools.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "CryptoNoteCore/Core.h"
+#include "CryptoNoteCore/RocksDBWrapper.h"
 #include "CryptoNoteCore/TransactionExtra.h"
 #include <config/CryptoNoteConfig.h>
 #include "CryptoNoteProtocol/CryptoNoteProtocolHandlerCommon.h"
@@ -76,6 +79,42 @@ RpcServer::HandlerFunction jsonMethod(bool (RpcServer::*handler)(typename Comman
   };
 }
 
+// where requests to urls without a handler are counted
+const char UNKNOWN_ENDPOINT[] = "unknown";
+
+const std::vector<double> METRICS_QUANTILES = { 0.5, 0.9, 0.99, 0.999 };
+
+// Prometheus label values are quoted, with backslashes, quotes and line breaks escaped
+std::string escapeLabel(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+
+  return escaped;
+}
+
+void writeMetric(std::ostream& out, const std::string& name, const std::string& labels, uint64_t value) {
+  out << name;
+  if (!labels.empty()) {
+    out << '{' << labels << '}';
+  }
+
+  out << ' ' << value << '\n';
+}
+
+void writeMetricHeader(std::ostream& out, const std::string& name, const char* type, const char* help) {
+  out << "# HELP " << name << ' ' << help << '\n';
+  out << "# TYPE " << name << ' ' << type << '\n';
+}
+
 
 }
 
@@ -110,14 +149,44 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/get_transaction_hashes_by_payment_id", { jsonMethod<COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID>(&RpcServer::onGetTransactionHashesByPaymentId), false } },
 
   // json rpc
-  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true } }
+  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true } },
+
+  { "/metrics", { std::bind(&RpcServer::onMetrics, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true } }
 };
 
+std::unordered_map<std::string, RpcServer::RpcHandler<JsonRpc::JsonMemberMethod>> RpcServer::s_jsonRpcHandlers = {
+  { "f_blocks_list_json", { JsonRpc::makeMemberMethod(&RpcServer::f_on_blocks_list_json), false } },
+  { "f_block_json", { JsonRpc::makeMemberMethod(&RpcServer::f_on_block_json), false } },
+  { "f_transaction_json", { JsonRpc::makeMemberMethod(&RpcServer::f_on_transaction_json), false } },
+  { "f_on_transactions_pool_json", { JsonRpc::makeMemberMethod(&RpcServer::f_on_transactions_pool_json), false } },
+  { "getblockcount", { JsonRpc::makeMemberMethod(&RpcServer::on_getblockcount), true } },
+  { "on_getblockhash", { JsonRpc::makeMemberMethod(&RpcServer::on_getblockhash), false } },
+  { "getblocktemplate", { JsonRpc::makeMemberMethod(&RpcServer::on_getblocktemplate), false } },
+  { "getcurrencyid", { JsonRpc::makeMemberMethod(&RpcServer::on_get_currency_id), true } },
+  { "submitblock", { JsonRpc::makeMemberMethod(&RpcServer::on_submitblock), false } },
+  { "getlastblockheader", { JsonRpc::makeMemberMethod(&RpcServer::on_get_last_block_header), false } },
+  { "getblockheaderbyhash", { JsonRpc::makeMemberMethod(&RpcServer::on_get_block_header_by_hash), false } },
+  { "getblockheaderbyheight", { JsonRpc::makeMemberMethod(&RpcServer::on_get_block_header_by_height), false } }
+};
+
+RpcServer::EndpointMetrics::EndpointMetrics() : requests(0), failures(0), requestBytes(0), responseBytes(0) {
+}
+
 RpcServer::RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, Core& c, NodeServer& p2p, ICryptoNoteProtocolHandler& protocol) :
-  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocol(protocol) {
+  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocol(protocol), m_database(nullptr) {
+  for (const auto& handler : s_handlers) {
+    m_endpointMetrics.emplace(std::piecewise_construct, std::forward_as_tuple(handler.first), std::forward_as_tuple());
+  }
+
+  m_endpointMetrics.emplace(std::piecewise_construct, std::forward_as_tuple(UNKNOWN_ENDPOINT), std::forward_as_tuple());
+
+  for (const auto& handler : s_jsonRpcHandlers) {
+    m_jsonRpcMetrics.emplace(std::piecewise_construct, std::forward_as_tuple(handler.first), std::forward_as_tuple());
+  }
 }
 
 void RpcServer::processRequest(const HttpRequest& request, HttpResponse& response) {
+  auto start = std::chrono::steady_clock::now();
   auto url = request.getUrl();
   if (url.find(".bin") == std::string::npos) {
       logger(TRACE) << "RPC request came: \n" << request << std::endl;
@@ -126,24 +195,47 @@ void RpcServer::processRequest(const HttpRequest& request, HttpResponse& respons
   }
 
   auto it = s_handlers.find(url);
-  if (it == s_handlers.end()) {
-    response.setStatus(HttpResponse::STATUS_404);
-    return;
+  EndpointMetrics& metrics = m_endpointMetrics.at(it == s_handlers.end() ? UNKNOWN_ENDPOINT : url);
+  bool succeeded = false;
+  try {
+    if (it == s_handlers.end()) {
+      response.setStatus(HttpResponse::STATUS_404);
+    } else if (!it->second.allowBusyCore && !isCoreReady()) {
+      response.setStatus(HttpResponse::STATUS_500);
+      response.setBody("Core is busy");
+    } else {
+      succeeded = it->second.handler(this, request, response);
+    }
+  } catch (std::exception&) {
+    recordRequest(metrics, start, request.getBody().size(), 0, false);
+    throw;
   }
 
-  if (!it->second.allowBusyCore && !isCoreReady()) {
-    response.setStatus(HttpResponse::STATUS_500);
-    response.setBody("Core is busy");
-    return;
-  }
+  recordRequest(metrics, start, request.getBody().size(), response.getBody().size(),
+                succeeded && response.getStatus() == HttpResponse::STATUS_200);
+}
 
-  it->second.handler(this, request, response);
+void RpcServer::recordRequest(EndpointMetrics& metrics, std::chrono::steady_clock::time_point start,
+                              size_t requestBytes, size_t responseBytes, bool succeeded) {
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  metrics.latency.record(duration.count());
+  metrics.requests.fetch_add(1, std::memory_order_relaxed);
+  metrics.requestBytes.fetch_add(requestBytes, std::memory_order_relaxed);
+  metrics.responseBytes.fetch_add(responseBytes, std::memory_order_relaxed);
+  if (!succeeded) {
+    metrics.failures.fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
 bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse& response) {
 
   using namespace JsonRpc;
 
+  auto start = std::chrono::steady_clock::now();
+  // unknown methods are only counted as requests to /json_rpc
+  EndpointMetrics* metrics = nullptr;
+  bool succeeded = false;
+
   for (const auto& cors_domain: m_cors_domains) {
     response.addHeader("Access-Control-Allow-Origin", cors_domain);
   }
@@ -157,31 +249,17 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
     jsonRequest.parseRequest(request.getBody());
     jsonResponse.setId(jsonRequest.getId()); // copy id
 
-    static std::unordered_map<std::string, RpcServer::RpcHandler<JsonMemberMethod>> jsonRpcHandlers = {
-      { "f_blocks_list_json", { makeMemberMethod(&RpcServer::f_on_blocks_list_json), false } },
-      { "f_block_json", { makeMemberMethod(&RpcServer::f_on_block_json), false } },
-      { "f_transaction_json", { makeMemberMethod(&RpcServer::f_on_transaction_json), false } },
-      { "f_on_transactions_pool_json", { makeMemberMethod(&RpcServer::f_on_transactions_pool_json), false } },
-      { "getblockcount", { makeMemberMethod(&RpcServer::on_getblockcount), true } },
-      { "on_getblockhash", { makeMemberMethod(&RpcServer::on_getblockhash), false } },
-      { "getblocktemplate", { makeMemberMethod(&RpcServer::on_getblocktemplate), false } },
-      { "getcurrencyid", { makeMemberMethod(&RpcServer::on_get_currency_id), true } },
-      { "submitblock", { makeMemberMethod(&RpcServer::on_submitblock), false } },
-      { "getlastblockheader", { makeMemberMethod(&RpcServer::on_get_last_block_header), false } },
-      { "getblockheaderbyhash", { makeMemberMethod(&RpcServer::on_get_block_header_by_hash), false } },
-      { "getblockheaderbyheight", { makeMemberMethod(&RpcServer::on_get_block_header_by_height), false } }
-    };
-
-    auto it = jsonRpcHandlers.find(jsonRequest.getMethod());
-    if (it == jsonRpcHandlers.end()) {
+    auto it = s_jsonRpcHandlers.find(jsonRequest.getMethod());
+    if (it == s_jsonRpcHandlers.end()) {
       throw JsonRpcError(JsonRpc::errMethodNotFound);
     }
 
+    metrics = &m_jsonRpcMetrics.at(it->first);
     if (!it->second.allowBusyCore && !isCoreReady()) {
       throw JsonRpcError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Core is busy");
     }
 
-    it->second.handler(this, jsonRequest, jsonResponse);
+    succeeded = it->second.handler(this, jsonRequest, jsonResponse);
 
   } catch (const JsonRpcError& err) {
     jsonResponse.setError(err);
@@ -191,6 +269,103 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
 
   response.setBody(jsonResponse.getBody());
   logger(TRACE) << "JSON-RPC response: " << jsonResponse.getBody();
+  if (metrics != nullptr) {
+    recordRequest(*metrics, start, request.getBody().size(), response.getBody().size(), succeeded);
+  }
+
+  return true;
+}
+
+bool RpcServer::onMetrics(const HttpRequest& request, HttpResponse& response) {
+  std::ostringstream out;
+
+  const struct {
+    const char* label;
+    const std::map<std::string, EndpointMetrics>& metrics;
+    const char* prefix;
+    const char* description;
+  } groups[] = {
+    { "endpoint", m_endpointMetrics, "turtlecoind_rpc_", "RPC requests" },
+    { "method", m_jsonRpcMetrics, "turtlecoind_jsonrpc_", "JSON-RPC calls" }
+  };
+
+  for (const auto& group : groups) {
+    const std::string prefix = group.prefix;
+    const std::string description = group.description;
+
+    writeMetricHeader(out, prefix + "latency_microseconds", "summary", (description + " latency").c_str());
+    for (const auto& metrics : group.metrics) {
+      const std::string labels = std::string(group.label) + "=\"" + escapeLabel(metrics.first) + "\"";
+      const LatencyHistogram& latency = metrics.second.latency;
+      std::vector<uint64_t> quantiles = latency.getQuantiles(METRICS_QUANTILES);
+      for (size_t i = 0; i < METRICS_QUANTILES.size(); ++i) {
+        std::ostringstream quantile;
+        quantile << METRICS_QUANTILES[i];
+        writeMetric(out, prefix + "latency_microseconds", labels + ",quantile=\"" + quantile.str() + "\"", quantiles[i]);
+      }
+
+      writeMetric(out, prefix + "latency_microseconds_sum", labels, latency.getSum());
+      writeMetric(out, prefix + "latency_microseconds_count", labels, latency.getCount());
+    }
+
+    const struct {
+      const char* name;
+      const char* help;
+      const std::atomic<uint64_t> EndpointMetrics::*counter;
+    } counters[] = {
+      { "requests_total", "", &EndpointMetrics::requests },
+      { "failures_total", " that failed", &EndpointMetrics::failures },
+      { "request_bytes_total", ", bytes of the request bodies", &EndpointMetrics::requestBytes },
+      { "response_bytes_total", ", bytes of the response bodies", &EndpointMetrics::responseBytes }
+    };
+
+    for (const auto& counter : counters) {
+      writeMetricHeader(out, prefix + counter.name, "counter", (description + counter.help).c_str());
+      for (const auto& metrics : group.metrics) {
+        const std::string labels = std::string(group.label) + "=\"" + escapeLabel(metrics.first) + "\"";
+        writeMetric(out, prefix + counter.name, labels, (metrics.second.*counter.counter).load(std::memory_order_relaxed));
+      }
+    }
+  }
+
+  writeMetricHeader(out, "turtlecoind_height", "gauge", "Blocks in the main chain");
+  writeMetric(out, "turtlecoind_height", "", m_core.getTopBlockIndex() + 1);
+  writeMetricHeader(out, "turtlecoind_pool_transactions", "gauge", "Transactions in the pool");
+  writeMetric(out, "turtlecoind_pool_transactions", "", m_core.getPoolTransactionCount());
+
+  writeMetricHeader(out, "turtlecoind_p2p_connections", "gauge", "Open P2P connections");
+  writeMetric(out, "turtlecoind_p2p_connections", "", m_p2p.get_connections_count());
+  writeMetricHeader(out, "turtlecoind_p2p_write_queue_bytes", "gauge", "Bytes queued to be sent to peers");
+  writeMetric(out, "turtlecoind_p2p_write_queue_bytes", "", m_p2p.getWriteQueueSize());
+  writeMetricHeader(out, "turtlecoind_p2p_queued_blocks", "gauge", "Blocks requested or waiting to be requested from peers");
+  writeMetric(out, "turtlecoind_p2p_queued_blocks", "", m_p2p.get_payload_object().getQueuedBlockCount());
+  writeMetricHeader(out, "turtlecoind_p2p_ready_blocks", "gauge", "Downloaded blocks waiting to be added to the chain");
+  writeMetric(out, "turtlecoind_p2p_ready_blocks", "", m_p2p.get_payload_object().getReadyBlockCount());
+
+  if (m_database != nullptr) {
+    DataBaseStatistics stats = m_database->getStatistics();
+    const struct {
+      const char* name;
+      const char* help;
+      const DataBaseLatencyStatistics& latency;
+    } operations[] = {
+      { "turtlecoind_db_read_latency_microseconds", "DB read batch latency", stats.reads },
+      { "turtlecoind_db_write_latency_microseconds", "DB write batch latency", stats.writes }
+    };
+
+    // RocksDB keeps its own histograms and only reports these two quantiles
+    for (const auto& operation : operations) {
+      const std::string name = operation.name;
+      writeMetricHeader(out, name, "summary", operation.help);
+      writeMetric(out, name, "quantile=\"0.5\"", static_cast<uint64_t>(operation.latency.medianMicroseconds));
+      writeMetric(out, name, "quantile=\"0.99\"", static_cast<uint64_t>(operation.latency.percentile99Microseconds));
+      writeMetric(out, name + "_sum", "", operation.latency.sumMicroseconds);
+      writeMetric(out, name + "_count", "", operation.latency.count);
+    }
+  }
+
+  response.addHeader("Content-Type", "text/plain; version=0.0.4");
+  response.setBody(out.str());
   return true;
 }
 
@@ -213,6 +388,10 @@ std::vector<std::string> RpcServer::getCorsDomains() {
   return m_cors_domains;
 }
 
+void RpcServer::setDatabase(RocksDBWrapper* database) {
+  m_database = database;
+}
+
 bool RpcServer::isCoreReady() {
   return m_core.getCurrency().isTestnet() || m_p2p.get_payload_object().isSynchronized();
 }
@@ -8,10 +8,14 @@
 
 #include "HttpServer.h"
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <map>
 #include <unordered_map>
 
 #include <Logging/LoggerRef.h>
+#include "Common/LatencyHistogram.h"
 #include "Common/Math.h"
 #include "CoreRpcServerCommandsDefinitions.h"
 #include "JsonRpc.h"
@@ -20,6 +24,7 @@ namespace CryptoNote {
 
 class Core;
 class NodeServer;
+class RocksDBWrapper;
 struct ICryptoNoteProtocolHandler;
 
 class RpcServer : public HttpServer {
@@ -31,6 +36,8 @@ public:
   bool setFeeAddress(const std::string fee_address);
   bool setFeeAmount(const uint32_t fee_amount);
   std::vector<std::string> getCorsDomains();
+  // DB whose read and write latencies /metrics reports, none by default
+  void setDatabase(RocksDBWrapper* database);
 
   bool on_get_block_headers_range(const COMMAND_RPC_GET_BLOCK_HEADERS_RANGE::request& req, COMMAND_RPC_GET_BLOCK_HEADERS_RANGE::response& res, JsonRpc::JsonRpcError& error_resp);
   bool on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RPC_GET_INFO::response& res);
@@ -45,10 +52,26 @@ private:
 
   typedef void (RpcServer::*HandlerPtr)(const HttpRequest& request, HttpResponse& response);
   static std::unordered_map<std::string, RpcHandler<HandlerFunction>> s_handlers;
+  static std::unordered_map<std::string, RpcHandler<JsonRpc::JsonMemberMethod>> s_jsonRpcHandlers;
+
+  // Updated lock free, so /metrics can be read while requests are served
+  struct EndpointMetrics {
+    EndpointMetrics();
+
+    std::atomic<uint64_t> requests;
+    // requests answered with an error status or a handler returning false
+    std::atomic<uint64_t> failures;
+    std::atomic<uint64_t> requestBytes;
+    std::atomic<uint64_t> responseBytes;
+    Common::LatencyHistogram latency;
+  };
 
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) override;
   bool processJsonRpcRequest(const HttpRequest& request, HttpResponse& response);
   bool isCoreReady();
+  bool onMetrics(const HttpRequest& request, HttpResponse& response);
+  void recordRequest(EndpointMetrics& metrics, std::chrono::steady_clock::time_point start,
+                     size_t requestBytes, size_t responseBytes, bool succeeded);
 
   // json handlers
   bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
@@ -96,6 +119,12 @@ private:
   std::vector<std::string> m_cors_domains;
   std::string m_fee_address;
   uint32_t m_fee_amount;
+  RocksDBWrapper* m_database;
+
+  // Both filled in the constructor and never changed after, only the
+  // metrics themselves are; urls without a handler share one entry
+  std::map<std::string, EndpointMetrics> m_endpointMetrics;
+  std::map<std::string, EndpointMetrics> m_jsonRpcMetrics;
 };
 
 }
@@ -19,6 +19,7 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
 
 #include <Common/StringView.h>
 
@@ -56,6 +57,24 @@ public:
   virtual bool binary(void* value, size_t size, Common::StringView name) = 0;
   virtual bool binary(std::string& value, Common::StringView name) = 0;
 
+  // bytes sent as a string, serializers able to read them without a string in between override this
+  virtual bool bytes(std::vector<uint8_t>& value, Common::StringView name) {
+    std::string blob;
+    if (type() == OUTPUT) {
+      blob.assign(value.begin(), value.end());
+    }
+
+    if (!(*this)(blob, name)) {
+      return false;
+    }
+
+    if (type() == INPUT) {
+      value.assign(blob.begin(), blob.end());
+    }
+
+    return true;
+  }
+
   template<typename T>
   bool operator()(T& value, Common::StringView name);
 };
@@ -0,0 +1,382 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "KVBinaryInputMemorySerializer.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include "KVBinaryCommon.h"
+
+using namespace CryptoNote;
+
+namespace {
+
+// Well beyond any message of the protocol, a peer can't run the parser off its stack
+const unsigned MAX_DEPTH = 64;
+
+}
+
+struct KVBinaryInputMemorySerializer::Reader {
+  const uint8_t* position;
+  const uint8_t* end;
+
+  size_t left() const {
+    return end - position;
+  }
+
+  const uint8_t* take(size_t size) {
+    if (size > left()) {
+      throw std::runtime_error("KV binary storage is truncated");
+    }
+
+    const uint8_t* data = position;
+    position += size;
+    return data;
+  }
+
+  template <typename T>
+  T readPod() {
+    T value;
+    memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  size_t readVarint() {
+    uint8_t b = readPod<uint8_t>();
+    size_t bytesLeft = 0;
+
+    switch (b & PORTABLE_RAW_SIZE_MARK_MASK) {
+    case PORTABLE_RAW_SIZE_MARK_BYTE:
+      bytesLeft = 0;
+      break;
+    case PORTABLE_RAW_SIZE_MARK_WORD:
+      bytesLeft = 1;
+      break;
+    case PORTABLE_RAW_SIZE_MARK_DWORD:
+      bytesLeft = 3;
+      break;
+    case PORTABLE_RAW_SIZE_MARK_INT64:
+      bytesLeft = 7;
+      break;
+    }
+
+    size_t value = b;
+    for (size_t i = 1; i <= bytesLeft; ++i) {
+      size_t n = readPod<uint8_t>();
+      value |= n << (i * 8);
+    }
+
+    return value >> 2;
+  }
+
+  // every element takes at least a byte, a count beyond that is garbage
+  size_t readCount() {
+    size_t count = readVarint();
+    if (count > left()) {
+      throw std::runtime_error("KV binary storage is truncated");
+    }
+
+    return count;
+  }
+};
+
+KVBinaryInputMemorySerializer::KVBinaryInputMemorySerializer(const uint8_t* data, size_t size) {
+  Reader reader{data, data + size};
+  auto hdr = reader.readPod<KVBinaryStorageBlockHeader>();
+
+  if (hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA || hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
+    throw std::runtime_error("Invalid binary storage signature");
+  }
+
+  if (hdr.m_ver != PORTABLE_STORAGE_FORMAT_VER) {
+    throw std::runtime_error("Unknown binary storage format version");
+  }
+
+  size_t root = loadSection(reader, 0);
+  assert(root == 0);
+  chain.push_back(Level{root, 0});
+}
+
+KVBinaryInputMemorySerializer::~KVBinaryInputMemorySerializer() {
+}
+
+ISerializer::SerializerType KVBinaryInputMemorySerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool KVBinaryInputMemorySerializer::beginObject(Common::StringView name) {
+  const Node* node = getValue(name);
+  if (node == nullptr) {
+    return false;
+  }
+
+  if (node->type != BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    throw std::runtime_error("KV binary value is not an object");
+  }
+
+  chain.push_back(Level{static_cast<size_t>(node - nodes.data()), 0});
+  return true;
+}
+
+void KVBinaryInputMemorySerializer::endObject() {
+  assert(!chain.empty());
+  chain.pop_back();
+}
+
+bool KVBinaryInputMemorySerializer::beginArray(size_t& size, Common::StringView name) {
+  const Node* node = getValue(name);
+  if (node == nullptr) {
+    size = 0;
+    return false;
+  }
+
+  if (node->type != BIN_KV_SERIALIZE_TYPE_ARRAY) {
+    throw std::runtime_error("KV binary value is not an array");
+  }
+
+  size = node->size;
+  chain.push_back(Level{static_cast<size_t>(node - nodes.data()), node->firstChild});
+  return true;
+}
+
+void KVBinaryInputMemorySerializer::endArray() {
+  assert(!chain.empty());
+  chain.pop_back();
+}
+
+bool KVBinaryInputMemorySerializer::operator()(uint8_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputMemorySerializer::operator()(int16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputMemorySerializer::operator()(uint16_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputMemorySerializer::operator()(int32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputMemorySerializer::operator()(uint32_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputMemorySerializer::operator()(int64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputMemorySerializer::operator()(uint64_t& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputMemorySerializer::operator()(double& value, Common::StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputMemorySerializer::operator()(bool& value, Common::StringView name) {
+  const Node* node = getValue(name);
+  if (node == nullptr) {
+    return false;
+  }
+
+  if (node->type != BIN_KV_SERIALIZE_TYPE_BOOL) {
+    throw std::runtime_error("KV binary value is not a bool");
+  }
+
+  value = node->integer != 0;
+  return true;
+}
+
+bool KVBinaryInputMemorySerializer::operator()(std::string& value, Common::StringView name) {
+  const Node* node = getString(name);
+  if (node == nullptr) {
+    return false;
+  }
+
+  value.assign(reinterpret_cast<const char*>(node->data), node->size);
+  return true;
+}
+
+bool KVBinaryInputMemorySerializer::binary(void* value, size_t size, Common::StringView name) {
+  const Node* node = getString(name);
+  if (node == nullptr) {
+    return false;
+  }
+
+  if (node->size != size) {
+    throw std::runtime_error("Binary block size mismatch");
+  }
+
+  memcpy(value, node->data, size);
+  return true;
+}
+
+bool KVBinaryInputMemorySerializer::binary(std::string& value, Common::StringView name) {
+  return (*this)(value, name); // load as string
+}
+
+bool KVBinaryInputMemorySerializer::bytes(std::vector<uint8_t>& value, Common::StringView name) {
+  const Node* node = getString(name);
+  if (node == nullptr) {
+    return false;
+  }
+
+  value.assign(node->data, node->data + node->size);
+  return true;
+}
+
+const KVBinaryInputMemorySerializer::Node* KVBinaryInputMemorySerializer::getValue(Common::StringView name) {
+  Level& level = chain.back();
+  const Node& parent = nodes[level.node];
+
+  if (parent.type == BIN_KV_SERIALIZE_TYPE_ARRAY) {
+    if (level.item == 0) {
+      return nullptr;
+    }
+
+    const Node* item = &nodes[level.item];
+    level.item = item->next;
+    return item;
+  }
+
+  for (size_t child = parent.firstChild; child != 0; child = nodes[child].next) {
+    if (Common::StringView(nodes[child].name, nodes[child].nameSize) == name) {
+      return &nodes[child];
+    }
+  }
+
+  return nullptr;
+}
+
+const KVBinaryInputMemorySerializer::Node* KVBinaryInputMemorySerializer::getString(Common::StringView name) {
+  const Node* node = getValue(name);
+  if (node != nullptr && node->type != BIN_KV_SERIALIZE_TYPE_STRING) {
+    throw std::runtime_error("KV binary value is not a string");
+  }
+
+  return node;
+}
+
+template <typename T>
+bool KVBinaryInputMemorySerializer::getNumber(Common::StringView name, T& v) {
+  const Node* node = getValue(name);
+  if (node == nullptr) {
+    return false;
+  }
+
+  switch (node->type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:
+  case BIN_KV_SERIALIZE_TYPE_INT32:
+  case BIN_KV_SERIALIZE_TYPE_INT16:
+  case BIN_KV_SERIALIZE_TYPE_INT8:
+  case BIN_KV_SERIALIZE_TYPE_UINT64:
+  case BIN_KV_SERIALIZE_TYPE_UINT32:
+  case BIN_KV_SERIALIZE_TYPE_UINT16:
+  case BIN_KV_SERIALIZE_TYPE_UINT8:
+    v = static_cast<T>(node->integer);
+    return true;
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE:
+    v = static_cast<T>(node->real);
+    return true;
+  default:
+    throw std::runtime_error("KV binary value is not a number");
+  }
+}
+
+size_t KVBinaryInputMemorySerializer::loadSection(Reader& reader, unsigned depth) {
+  if (depth > MAX_DEPTH) {
+    throw std::runtime_error("KV binary storage is nested too deep");
+  }
+
+  size_t section = nodes.size();
+  nodes.push_back(Node{BIN_KV_SERIALIZE_TYPE_OBJECT, nullptr, 0, 0, 0, 0, nullptr, 0, 0});
+
+  size_t count = reader.readCount();
+  size_t last = 0;
+  while (count--) {
+    uint8_t nameSize = reader.readPod<uint8_t>();
+    const char* name = reinterpret_cast<const char*>(reader.take(nameSize));
+    size_t child = loadEntry(reader, depth + 1);
+    nodes[child].name = name;
+    nodes[child].nameSize = nameSize;
+    addChild(section, last, child);
+  }
+
+  return section;
+}
+
+size_t KVBinaryInputMemorySerializer::loadEntry(Reader& reader, unsigned depth) {
+  uint8_t type = reader.readPod<uint8_t>();
+
+  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
+    type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+    return loadArray(reader, type, depth);
+  }
+
+  return loadValue(reader, type, depth);
+}
+
+size_t KVBinaryInputMemorySerializer::loadValue(Reader& reader, uint8_t type, unsigned depth) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_OBJECT: return loadSection(reader, depth);
+  case BIN_KV_SERIALIZE_TYPE_ARRAY:  return loadArray(reader, type, depth);
+  default:
+    break;
+  }
+
+  Node node{type, nullptr, 0, 0, 0, 0, nullptr, 0, 0};
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  node.integer = reader.readPod<int64_t>(); break;
+  case BIN_KV_SERIALIZE_TYPE_INT32:  node.integer = reader.readPod<int32_t>(); break;
+  case BIN_KV_SERIALIZE_TYPE_INT16:  node.integer = reader.readPod<int16_t>(); break;
+  case BIN_KV_SERIALIZE_TYPE_INT8:   node.integer = reader.readPod<int8_t>(); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT64: node.integer = static_cast<int64_t>(reader.readPod<uint64_t>()); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT32: node.integer = reader.readPod<uint32_t>(); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT16: node.integer = reader.readPod<uint16_t>(); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  node.integer = reader.readPod<uint8_t>(); break;
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE: node.real = reader.readPod<double>(); break;
+  case BIN_KV_SERIALIZE_TYPE_BOOL:   node.integer = reader.readPod<uint8_t>() != 0; break;
+  case BIN_KV_SERIALIZE_TYPE_STRING:
+    node.size = reader.readVarint();
+    node.data = reader.take(node.size);
+    break;
+  default:
+    throw std::runtime_error("Unknown data type");
+  }
+
+  nodes.push_back(node);
+  return nodes.size() - 1;
+}
+
+size_t KVBinaryInputMemorySerializer::loadArray(Reader& reader, uint8_t itemType, unsigned depth) {
+  if (depth > MAX_DEPTH) {
+    throw std::runtime_error("KV binary storage is nested too deep");
+  }
+
+  size_t array = nodes.size();
+  nodes.push_back(Node{BIN_KV_SERIALIZE_TYPE_ARRAY, nullptr, 0, 0, 0, 0, nullptr, 0, 0});
+
+  size_t count = reader.readCount();
+  size_t last = 0;
+  while (count--) {
+    addChild(array, last, loadValue(reader, itemType, depth + 1));
+  }
+
+  return array;
+}
+
+void KVBinaryInputMemorySerializer::addChild(size_t parent, size_t& last, size_t child) {
+  if (last == 0) {
+    nodes[parent].firstChild = child;
+  } else {
+    nodes[last].next = child;
+  }
+
+  last = child;
+  ++nodes[parent].size;
+}
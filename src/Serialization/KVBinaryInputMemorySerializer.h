@@ -0,0 +1,89 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <vector>
+
+#include "ISerializer.h"
+
+namespace CryptoNote {
+
+/* Reads KV binary storage in place. Instead of loading the message into a
+   JsonValue like KVBinaryInputStreamSerializer, it only indexes it, every
+   string is copied once, straight from the message into the value it is
+   read into. The message has to outlive the serializer. */
+class KVBinaryInputMemorySerializer : public ISerializer {
+public:
+  KVBinaryInputMemorySerializer(const uint8_t* data, size_t size);
+  virtual ~KVBinaryInputMemorySerializer();
+
+  SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
+  virtual bool binary(void* value, size_t size, Common::StringView name) override;
+  virtual bool binary(std::string& value, Common::StringView name) override;
+  virtual bool bytes(std::vector<uint8_t>& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  struct Node {
+    uint8_t type;
+    const char* name;
+    uint8_t nameSize;
+    // index of the next node in the same object or array, 0 after the last
+    size_t next;
+    // first child of an object or array, 0 when it has none
+    size_t firstChild;
+    // children of an object or array, bytes of a string
+    size_t size;
+    const uint8_t* data;
+    int64_t integer;
+    double real;
+  };
+
+  struct Level {
+    size_t node;
+    // next item handed out of an array
+    size_t item;
+  };
+
+  struct Reader;
+
+  std::vector<Node> nodes;
+  std::vector<Level> chain;
+
+  size_t loadSection(Reader& reader, unsigned depth);
+  size_t loadEntry(Reader& reader, unsigned depth);
+  size_t loadValue(Reader& reader, uint8_t type, unsigned depth);
+  size_t loadArray(Reader& reader, uint8_t itemType, unsigned depth);
+  void addChild(size_t parent, size_t& last, size_t child);
+
+  const Node* getValue(Common::StringView name);
+  const Node* getString(Common::StringView name);
+
+  template <typename T>
+  bool getNumber(Common::StringView name, T& v);
+};
+
+}
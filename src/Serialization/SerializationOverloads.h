@@ -40,8 +40,8 @@ serializeAsBinary(std::vector<T>& value, Common::StringView name, CryptoNote::IS
   if (serializer.type() == ISerializer::INPUT) {
     serializer.binary(blob, name);
     value.resize(blob.size() / sizeof(T));
-    if (blob.size()) {
-      memcpy(&value[0], blob.data(), blob.size());
+    if (!value.empty()) {
+      memcpy(&value[0], blob.data(), value.size() * sizeof(T));
     }
   } else {
     if (!value.empty()) {
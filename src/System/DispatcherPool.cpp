@@ -0,0 +1,209 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "DispatcherPool.h"
+
+#include <cassert>
+
+#include <System/Dispatcher.h>
+#include <System/InterruptedException.h>
+
+namespace System {
+
+namespace {
+
+// Waits like RemoteContext does: the event is set by another dispatcher and
+// nothing else, so an interruption is remembered and passed on afterwards
+void waitUninterrupted(Dispatcher& dispatcher, Event& event) {
+  bool interrupted = false;
+  while (!event.get()) {
+    try {
+      event.wait();
+    } catch (InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    dispatcher.interrupt();
+  }
+}
+
+}
+
+DispatcherPool::DispatcherPool(Dispatcher& dispatcher, size_t threadCount) :
+  dispatcher(dispatcher), mailbox(dispatcher), group(dispatcher), runningWorkers(0), workersStopped(dispatcher) {
+  assert(threadCount > 0);
+
+  try {
+    for (size_t i = 0; i < threadCount; ++i) {
+      workers.emplace_back(new Worker);
+      Worker& worker = *workers.back();
+      worker.dispatcher = nullptr;
+      worker.mailbox = nullptr;
+      worker.group = nullptr;
+      worker.stopped = nullptr;
+      worker.connections = 0;
+
+      std::promise<void> ready;
+      std::future<void> started = ready.get_future();
+      worker.thread = std::thread(&DispatcherPool::workerProcedure, this, std::ref(worker), std::ref(ready));
+      started.get();
+      ++runningWorkers;
+    }
+  } catch (...) {
+    stop();
+    throw;
+  }
+}
+
+DispatcherPool::~DispatcherPool() {
+  stop();
+}
+
+size_t DispatcherPool::size() const {
+  return workers.size();
+}
+
+Dispatcher& DispatcherPool::getDispatcher(size_t index) {
+  assert(index < workers.size());
+  return *workers[index]->dispatcher;
+}
+
+size_t DispatcherPool::assign() {
+  size_t best = 0;
+  size_t bestConnections = workers[0]->connections.load(std::memory_order_relaxed);
+  for (size_t i = 1; i < workers.size(); ++i) {
+    size_t connections = workers[i]->connections.load(std::memory_order_relaxed);
+    if (connections < bestConnections) {
+      best = i;
+      bestConnections = connections;
+    }
+  }
+
+  workers[best]->connections.fetch_add(1, std::memory_order_relaxed);
+  return best;
+}
+
+void DispatcherPool::release(size_t index) {
+  assert(index < workers.size());
+  workers[index]->connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void DispatcherPool::spawn(size_t index, std::function<void()>&& procedure) {
+  assert(index < workers.size());
+  ContextGroup* workerGroup = workers[index]->group;
+  // procedure is moved along rather than copied, so what it holds is only
+  // ever released on the worker
+  workers[index]->mailbox->post(std::bind([workerGroup] (std::function<void()>& task) {
+    workerGroup->spawn(std::move(task));
+  }, std::move(procedure)));
+}
+
+void DispatcherPool::call(size_t index, std::function<void()>&& procedure) {
+  assert(index < workers.size());
+  call(mailbox, *workers[index]->mailbox, *workers[index]->group, std::move(procedure));
+}
+
+void DispatcherPool::callOwner(size_t index, std::function<void()>&& procedure) {
+  assert(index < workers.size());
+  call(*workers[index]->mailbox, mailbox, group, std::move(procedure));
+}
+
+void DispatcherPool::call(Mailbox& caller, Mailbox& target, ContextGroup& targetGroup, std::function<void()>&& procedure) {
+  Event done(caller.getDispatcher());
+  std::exception_ptr error;
+
+  Mailbox* replyMailbox = &caller;
+  Event* replyEvent = &done;
+  std::exception_ptr* replyError = &error;
+  ContextGroup* targetContextGroup = &targetGroup;
+  std::function<void()> task = std::move(procedure);
+  target.post([=] {
+    // procedure may wait, so it gets a context of its own
+    targetContextGroup->spawn([=] {
+      std::exception_ptr result;
+      try {
+        task();
+      } catch (...) {
+        result = std::current_exception();
+      }
+
+      replyMailbox->post([=] {
+        *replyError = result;
+        replyEvent->set();
+      });
+    });
+  });
+
+  waitUninterrupted(caller.getDispatcher(), done);
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+void DispatcherPool::workerProcedure(Worker& worker, std::promise<void>& ready) {
+  std::unique_ptr<Dispatcher> workerDispatcher;
+  std::unique_ptr<Mailbox> workerMailbox;
+  std::unique_ptr<ContextGroup> workerGroup;
+  std::unique_ptr<Event> stopped;
+  try {
+    workerDispatcher.reset(new Dispatcher);
+    workerMailbox.reset(new Mailbox(*workerDispatcher));
+    workerGroup.reset(new ContextGroup(*workerDispatcher));
+    stopped.reset(new Event(*workerDispatcher));
+  } catch (...) {
+    ready.set_exception(std::current_exception());
+    return;
+  }
+
+  worker.dispatcher = workerDispatcher.get();
+  worker.mailbox = workerMailbox.get();
+  worker.group = workerGroup.get();
+  worker.stopped = stopped.get();
+  ready.set_value();
+
+  waitUninterrupted(*workerDispatcher, *stopped);
+
+  // Contexts waiting on the owning dispatcher still get their replies, it
+  // keeps dispatching while it waits for us
+  workerGroup->interrupt();
+  workerGroup->wait();
+  mailbox.post([this] {
+    assert(runningWorkers > 0);
+    if (--runningWorkers == 0) {
+      workersStopped.set();
+    }
+  });
+}
+
+void DispatcherPool::stop() {
+  for (auto& worker : workers) {
+    if (worker->stopped != nullptr) {
+      Event* stopped = worker->stopped;
+      worker->mailbox->post([stopped] { stopped->set(); });
+    }
+  }
+
+  bool interrupted = false;
+  while (runningWorkers != 0) {
+    try {
+      workersStopped.wait();
+    } catch (InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  for (auto& worker : workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+
+  if (interrupted) {
+    dispatcher.interrupt();
+  }
+}
+
+}
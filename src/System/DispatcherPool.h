@@ -0,0 +1,79 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <System/ContextGroup.h>
+#include <System/Event.h>
+#include <System/Mailbox.h>
+
+namespace System {
+
+class Dispatcher;
+
+/* Worker threads, each running its own dispatcher, and so its own epoll,
+   kqueue or completion port, for spreading connections over several cores.
+
+   The pool is created, used and destroyed in contexts of the owning
+   dispatcher it is given; the workers talk back to it through mailboxes.
+   Code that is not thread safe stays on the owning dispatcher and is reached
+   from the workers with callOwner(). */
+class DispatcherPool {
+public:
+  DispatcherPool(Dispatcher& dispatcher, size_t threadCount);
+  DispatcherPool(const DispatcherPool&) = delete;
+  ~DispatcherPool();
+  DispatcherPool& operator=(const DispatcherPool&) = delete;
+
+  size_t size() const;
+  Dispatcher& getDispatcher(size_t index);
+
+  /* Picks the worker with the fewest connections and counts one more on it,
+     release() takes it off again. Both are safe from any thread. */
+  size_t assign();
+  void release(size_t index);
+
+  /* Runs procedure in a new context on worker index. Safe from any thread,
+     the context is interrupted when the pool is destroyed. */
+  void spawn(size_t index, std::function<void()>&& procedure);
+
+  /* From a context of the owning dispatcher: runs procedure on worker index
+     and waits for it, rethrowing what it threw. */
+  void call(size_t index, std::function<void()>&& procedure);
+
+  /* From a context of worker index: runs procedure on the owning dispatcher
+     and waits for it, rethrowing what it threw. */
+  void callOwner(size_t index, std::function<void()>&& procedure);
+
+private:
+  struct Worker {
+    std::thread thread;
+    Dispatcher* dispatcher;
+    Mailbox* mailbox;
+    ContextGroup* group;
+    Event* stopped;
+    std::atomic<size_t> connections;
+  };
+
+  void workerProcedure(Worker& worker, std::promise<void>& ready);
+  void stop();
+
+  static void call(Mailbox& caller, Mailbox& target, ContextGroup& targetGroup, std::function<void()>&& procedure);
+
+  Dispatcher& dispatcher;
+  Mailbox mailbox;
+  ContextGroup group;
+  std::vector<std::unique_ptr<Worker>> workers;
+  size_t runningWorkers;
+  Event workersStopped;
+};
+
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "Mailbox.h"
+
+#include <System/Dispatcher.h>
+
+namespace System {
+
+Mailbox::Queue::Queue() : head(&stub), tail(&stub), drainScheduled(false), dispatcher(nullptr) {
+  stub.next.store(nullptr, std::memory_order_relaxed);
+}
+
+Mailbox::Queue::~Queue() {
+  while (Message* message = pop()) {
+    delete message;
+  }
+}
+
+void Mailbox::Queue::push(Message* message) {
+  message->next.store(nullptr, std::memory_order_relaxed);
+  Message* previous = head.exchange(message, std::memory_order_acq_rel);
+  // Until this store the message is queued but not reachable from tail,
+  // pop() sees an empty queue and the producer's own wake up covers it
+  previous->next.store(message, std::memory_order_release);
+}
+
+Mailbox::Message* Mailbox::Queue::pop() {
+  Message* first = tail;
+  Message* next = first->next.load(std::memory_order_acquire);
+  if (first == &stub) {
+    if (next == nullptr) {
+      return nullptr;
+    }
+
+    tail = next;
+    first = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+
+  if (next != nullptr) {
+    tail = next;
+    return first;
+  }
+
+  if (first != head.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  // first is the last message; put the stub behind it so it can be taken
+  push(&stub);
+  next = first->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    tail = next;
+    return first;
+  }
+
+  return nullptr;
+}
+
+Mailbox::Mailbox(Dispatcher& dispatcher) : dispatcher(dispatcher), queue(std::make_shared<Queue>()) {
+  queue->dispatcher = &dispatcher;
+}
+
+Mailbox::~Mailbox() {
+  queue->dispatcher = nullptr;
+}
+
+Dispatcher& Mailbox::getDispatcher() {
+  return dispatcher;
+}
+
+void Mailbox::post(std::function<void()>&& procedure) {
+  Message* message = new Message;
+  message->procedure = std::move(procedure);
+  queue->push(message);
+
+  if (!queue->drainScheduled.exchange(true)) {
+    std::shared_ptr<Queue> drainQueue = queue;
+    dispatcher.remoteSpawn([drainQueue] { drain(drainQueue); });
+  }
+}
+
+void Mailbox::drain(const std::shared_ptr<Queue>& queue) {
+  size_t count = 0;
+  while (queue->dispatcher != nullptr) {
+    bool handedOver = false;
+    std::unique_ptr<Message> message(queue->pop());
+    if (!message) {
+      // The flag stays set until the queue is empty, so this is the only
+      // drain context. Look again after clearing it: a post that still saw
+      // it set pushed its message before that, and the exchange reads the
+      // post's exchange, so the message is visible now.
+      queue->drainScheduled.exchange(false);
+      message.reset(queue->pop());
+      if (!message) {
+        break;
+      }
+
+      // A post since the clear scheduled the next drain; it starts after
+      // this one returns, which it does without yielding
+      handedOver = queue->drainScheduled.exchange(true);
+    }
+
+    try {
+      message->procedure();
+    } catch (...) {
+      // a throwing message must not take the ones queued behind it along
+    }
+
+    if (handedOver) {
+      break;
+    }
+
+    // Let the contexts the messages resumed or spawned run, rather than
+    // piling up all of a burst before any of it gets going
+    if (++count % DRAIN_BATCH_SIZE == 0) {
+      queue->dispatcher->yield();
+    }
+  }
+}
+
+}
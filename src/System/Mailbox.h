@@ -0,0 +1,69 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace System {
+
+class Dispatcher;
+
+/* Runs procedures posted from any thread on one dispatcher, in the order
+   they were posted.
+
+   post() is lock free: messages go on an intrusive multi producer single
+   consumer queue, and only the post that finds the mailbox idle wakes the
+   dispatcher through remoteSpawn(), so a burst of messages costs one wake up
+   rather than a mutex round trip and an eventfd write each.
+
+   Messages run one after another in a single context, so they should be
+   short and must not wait; one that has to can spawn a context of its own.
+   The mailbox must be created and destroyed on its dispatcher's thread, but
+   not from one of its messages. Messages still queued then are dropped. */
+class Mailbox {
+public:
+  explicit Mailbox(Dispatcher& dispatcher);
+  Mailbox(const Mailbox&) = delete;
+  ~Mailbox();
+  Mailbox& operator=(const Mailbox&) = delete;
+
+  Dispatcher& getDispatcher();
+
+  void post(std::function<void()>&& procedure);
+
+private:
+  struct Message {
+    std::atomic<Message*> next;
+    std::function<void()> procedure;
+  };
+
+  struct Queue {
+    Queue();
+    ~Queue();
+
+    void push(Message* message);
+    Message* pop();
+
+    std::atomic<Message*> head;
+    Message* tail;
+    Message stub;
+    std::atomic<bool> drainScheduled;
+
+    // Only touched on the dispatcher's thread, null once the mailbox is gone
+    Dispatcher* dispatcher;
+  };
+
+  static const size_t DRAIN_BATCH_SIZE = 64;
+
+  static void drain(const std::shared_ptr<Queue>& queue);
+
+  Dispatcher& dispatcher;
+  std::shared_ptr<Queue> queue;
+};
+
+}
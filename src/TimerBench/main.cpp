@@ -0,0 +1,355 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Common/JsonValue.h"
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/InterruptedException.h>
+#include <System/Timer.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <System/ErrorMessage.h>
+#endif
+
+using namespace System;
+using Common::JsonValue;
+
+namespace {
+
+/* How long each of the concurrent sleepers sleeps, short enough for the
+   timers themselves to be the work */
+const std::chrono::milliseconds EXPIRE_SLEEP(1);
+
+/* What a connection timeout looks like: far enough away that it is always
+   cancelled first */
+const std::chrono::hours CANCEL_SLEEP(1);
+
+struct Options {
+  bool json = false;
+  double seconds = 1.0;
+  size_t timers = 1000;
+  std::string filter;
+};
+
+struct Result {
+  std::string name;
+  uint64_t timeouts;
+  double timeoutsPerSecond;
+  // process CPU time, kernel included, spent per timeout
+  double cpuNanoseconds;
+};
+
+/* Sleeps the way System::Timer did before the timer wheel, a timerfd
+   armed with timerfd_settime for every sleep and waited on through the
+   dispatcher's epoll, to compare the wheel against */
+#ifdef __linux__
+class TimerfdTimer {
+public:
+  explicit TimerfdTimer(Dispatcher& dispatcher) : dispatcher(dispatcher) {
+    timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    epoll_event timerEvent;
+    timerEvent.events = EPOLLONESHOT;
+    timerEvent.data.ptr = nullptr;
+    if (timer == -1 || epoll_ctl(dispatcher.getEpoll(), EPOLL_CTL_ADD, timer, &timerEvent) == -1) {
+      throw std::runtime_error("timerfd_create failed, " + lastErrorMessage());
+    }
+  }
+
+  TimerfdTimer(const TimerfdTimer&) = delete;
+  TimerfdTimer& operator=(const TimerfdTimer&) = delete;
+
+  ~TimerfdTimer() {
+    close(timer);
+  }
+
+  void sleep(std::chrono::nanoseconds duration) {
+    if (dispatcher.interrupted()) {
+      throw InterruptedException();
+    }
+
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
+    itimerspec expires;
+    expires.it_interval.tv_nsec = expires.it_interval.tv_sec = 0;
+    expires.it_value.tv_sec = seconds.count();
+    expires.it_value.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(duration - seconds).count();
+    timerfd_settime(timer, 0, &expires, NULL);
+
+    ContextPair contextPair;
+    OperationContext timerContext;
+    timerContext.interrupted = false;
+    timerContext.context = dispatcher.getCurrentContext();
+    contextPair.writeContext = nullptr;
+    contextPair.readContext = &timerContext;
+
+    epoll_event timerEvent;
+    timerEvent.events = EPOLLIN | EPOLLONESHOT;
+    timerEvent.data.ptr = &contextPair;
+    if (epoll_ctl(dispatcher.getEpoll(), EPOLL_CTL_MOD, timer, &timerEvent) == -1) {
+      throw std::runtime_error("epoll_ctl failed, " + lastErrorMessage());
+    }
+
+    dispatcher.getCurrentContext()->interruptProcedure = [&]() {
+      if (!timerContext.interrupted) {
+        uint64_t value = 0;
+        if (::read(timer, &value, sizeof value) == -1) {
+          timerContext.interrupted = true;
+        }
+
+        dispatcher.pushContext(timerContext.context);
+
+        epoll_event timerEvent;
+        timerEvent.events = EPOLLONESHOT;
+        timerEvent.data.ptr = nullptr;
+        if (epoll_ctl(dispatcher.getEpoll(), EPOLL_CTL_MOD, timer, &timerEvent) == -1) {
+          throw std::runtime_error("epoll_ctl failed, " + lastErrorMessage());
+        }
+      }
+    };
+
+    dispatcher.dispatch();
+    dispatcher.getCurrentContext()->interruptProcedure = nullptr;
+    if (timerContext.interrupted) {
+      throw InterruptedException();
+    }
+  }
+
+private:
+  Dispatcher& dispatcher;
+  int timer;
+};
+#endif
+
+typedef std::function<void(std::chrono::nanoseconds)> Sleep;
+
+/* Makes the sleep function of one implementation, for the context it is
+   called on */
+struct Implementation {
+  std::string name;
+  std::function<Sleep(Dispatcher&)> makeSleep;
+};
+
+std::vector<Implementation> makeImplementations()
+{
+  std::vector<Implementation> implementations;
+
+  implementations.push_back({"wheel", [](Dispatcher& dispatcher) {
+    auto timer = std::make_shared<Timer>(dispatcher);
+    return Sleep([timer](std::chrono::nanoseconds duration) { timer->sleep(duration); });
+  }});
+
+#ifdef __linux__
+  implementations.push_back({"timerfd", [](Dispatcher& dispatcher) {
+    auto timer = std::make_shared<TimerfdTimer>(dispatcher);
+    return Sleep([timer](std::chrono::nanoseconds duration) { timer->sleep(duration); });
+  }});
+#endif
+
+  return implementations;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Result finish(std::string name, uint64_t timeouts, std::chrono::steady_clock::time_point start, std::clock_t cpuStart)
+{
+  const double seconds = secondsSince(start);
+  const double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  return {std::move(name), timeouts, timeouts / seconds, timeouts == 0 ? 0 : cpuSeconds * 1e9 / timeouts};
+}
+
+/* options.timers contexts sleeping EXPIRE_SLEEP in a loop, every sleep runs
+   to its timeout */
+Result runExpire(const std::string& name, const Implementation& implementation, const Options& options)
+{
+  Dispatcher dispatcher;
+  ContextGroup sleepers(dispatcher);
+  bool stop = false;
+  uint64_t timeouts = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::clock_t cpuStart = std::clock();
+  for (size_t i = 0; i < options.timers; i++)
+  {
+    sleepers.spawn([&] {
+      Sleep sleep = implementation.makeSleep(dispatcher);
+      while (!stop)
+      {
+        sleep(EXPIRE_SLEEP);
+        ++timeouts;
+      }
+    });
+  }
+
+  Timer(dispatcher).sleep(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(options.seconds)));
+  stop = true;
+  sleepers.wait();
+
+  return finish(name, timeouts, start, cpuStart);
+}
+
+/* One context arming a CANCEL_SLEEP timeout that is interrupted straight
+   away, again and again */
+Result runCancel(const std::string& name, const Implementation& implementation, const Options& options)
+{
+  Dispatcher dispatcher;
+  ContextGroup sleeper(dispatcher);
+  bool stop = false;
+  uint64_t timeouts = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::clock_t cpuStart = std::clock();
+  sleeper.spawn([&] {
+    Sleep sleep = implementation.makeSleep(dispatcher);
+    while (!stop)
+    {
+      try
+      {
+        sleep(CANCEL_SLEEP);
+      }
+      catch (InterruptedException&)
+      {
+        ++timeouts;
+      }
+    }
+  });
+
+  dispatcher.yield();
+  while (secondsSince(start) < options.seconds)
+  {
+    sleeper.interrupt();
+    dispatcher.yield();
+  }
+
+  stop = true;
+  sleeper.interrupt();
+  sleeper.wait();
+
+  return finish(name, timeouts, start, cpuStart);
+}
+
+void printText(const Result& result)
+{
+  std::cout << std::left << std::setw(26) << result.name << std::right << std::fixed << std::setprecision(0)
+    << std::setw(12) << result.timeoutsPerSecond << " timeouts/s"
+    << std::setw(10) << result.cpuNanoseconds << " cpu ns/timeout" << std::endl;
+}
+
+JsonValue toJson(const Result& result)
+{
+  JsonValue value(JsonValue::OBJECT);
+  value.insert("name", result.name);
+  value.insert("timeouts", static_cast<JsonValue::Integer>(result.timeouts));
+  value.insert("timeouts_per_second", result.timeoutsPerSecond);
+  value.insert("cpu_ns_per_timeout", result.cpuNanoseconds);
+  return value;
+}
+
+void printUsage()
+{
+  std::cout << "Usage: timerbench [options]\n\n"
+    << "  --json              Print the results as JSON\n"
+    << "  --timers <n>        Concurrent sleepers in the expire runs (default: 1000)\n"
+    << "  --seconds <s>       Time spent on each measurement (default: 1)\n"
+    << "  --filter <text>     Only run benchmarks whose name contains text\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+
+  try
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--json")
+      {
+        options.json = true;
+      }
+      else if (arg == "--timers" && hasValue)
+      {
+        options.timers = std::max(1, std::stoi(argv[++i]));
+      }
+      else if (arg == "--seconds" && hasValue)
+      {
+        options.seconds = std::stod(argv[++i]);
+      }
+      else if (arg == "--filter" && hasValue)
+      {
+        options.filter = argv[++i];
+      }
+      else
+      {
+        printUsage();
+        return arg == "--help" ? 0 : 1;
+      }
+    }
+
+    typedef Result (*Run)(const std::string&, const Implementation&, const Options&);
+    const std::pair<std::string, Run> runs[] = {
+      {"_expire_" + std::to_string(options.timers), runExpire},
+      {"_cancel", runCancel},
+    };
+
+    JsonValue results(JsonValue::ARRAY);
+
+    for (const auto& implementation : makeImplementations())
+    {
+      for (const auto& run : runs)
+      {
+        const std::string name = implementation.name + run.first;
+        if (name.find(options.filter) == std::string::npos)
+        {
+          continue;
+        }
+
+        const Result result = run.second(name, implementation, options);
+        if (options.json)
+        {
+          results.pushBack(toJson(result));
+        }
+        else
+        {
+          printText(result);
+        }
+      }
+    }
+
+    if (options.json)
+    {
+      JsonValue report(JsonValue::OBJECT);
+      report.insert("timers", static_cast<JsonValue::Integer>(options.timers));
+      report.insert("benchmarks", std::move(results));
+      std::cout << report << std::endl;
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::cout << "Something went terribly wrong...\n" << e.what() << "\n\n";
+    return 1;
+  }
+
+  return 0;
+}
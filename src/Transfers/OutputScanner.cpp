@@ -0,0 +1,142 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "OutputScanner.h"
+
+#include <cstring>
+#include <memory>
+
+#include "Common/Trace.h"
+#include "CryptoNoteCore/CryptoNoteBasic.h"
+
+using namespace Crypto;
+
+namespace CryptoNote {
+
+namespace {
+
+/* Keys are curve points, so their leading bytes are already well mixed */
+size_t slotHash(const PublicKey& key) {
+  uint64_t hash;
+  memcpy(&hash, key.data, sizeof(hash));
+  return static_cast<size_t>(hash);
+}
+
+struct ScannedOutput {
+  uint32_t transactionIndex;
+  uint32_t outputIndex;
+  PublicKey key;
+};
+
+}
+
+OutputScanner::OutputScanner(const SecretKey& viewSecretKey, const std::unordered_set<PublicKey>& spendKeys) :
+  m_viewSecretKey(viewSecretKey), m_spendKeys(spendKeys.begin(), spendKeys.end()) {
+
+  // keep the load factor at or below one half
+  size_t size = 2;
+  while (size < 2 * m_spendKeys.size()) {
+    size *= 2;
+  }
+
+  m_slots.assign(size, EMPTY_SLOT);
+  m_mask = size - 1;
+
+  for (uint32_t i = 0; i < m_spendKeys.size(); ++i) {
+    size_t slot = slotHash(m_spendKeys[i]) & m_mask;
+    while (m_slots[slot] != EMPTY_SLOT) {
+      slot = (slot + 1) & m_mask;
+    }
+
+    m_slots[slot] = i;
+  }
+}
+
+const PublicKey& OutputScanner::getSpendKey(uint32_t spendKeyIndex) const {
+  return m_spendKeys[spendKeyIndex];
+}
+
+uint32_t OutputScanner::findSpendKey(const PublicKey& key) const {
+  for (size_t slot = slotHash(key) & m_mask; m_slots[slot] != EMPTY_SLOT; slot = (slot + 1) & m_mask) {
+    if (m_spendKeys[m_slots[slot]] == key) {
+      return m_slots[slot];
+    }
+  }
+
+  return EMPTY_SLOT;
+}
+
+void OutputScanner::scan(const ITransactionReader* const* transactions, size_t count, std::vector<Match>& matches,
+                         std::vector<uint32_t>& failedTransactions) const {
+  TRACE_SPAN("OutputScanner::scan");
+  std::vector<PublicKey> transactionKeys;
+  std::vector<ScannedOutput> outputs;
+  transactionKeys.reserve(count);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const ITransactionReader& tx = *transactions[i];
+    size_t firstOutput = outputs.size();
+
+    try {
+      transactionKeys.push_back(tx.getTransactionPublicKey());
+
+      size_t outputCount = tx.getOutputCount();
+      for (size_t idx = 0; idx < outputCount; ++idx) {
+        if (tx.getOutputType(idx) == TransactionTypes::OutputType::Key) {
+          uint64_t amount;
+          KeyOutput out;
+          tx.getOutput(idx, out, amount);
+          outputs.push_back({i, static_cast<uint32_t>(idx), out.key});
+        }
+      }
+    } catch (const std::exception&) {
+      transactionKeys.resize(i);
+      transactionKeys.push_back(NULL_PUBLIC_KEY);
+      outputs.resize(firstOutput);
+      failedTransactions.push_back(i);
+    }
+  }
+
+  std::vector<KeyDerivation> derivations(count);
+  std::unique_ptr<bool[]> derivationValid(new bool[count]);
+  generate_key_derivations(transactionKeys.data(), count, m_viewSecretKey, derivations.data(), derivationValid.get());
+
+  // the key index only counts key outputs, as in derive_public_key on the sending side
+  std::vector<UnderiveInput> inputs;
+  std::vector<uint32_t> inputOutputs;
+  inputs.reserve(outputs.size());
+  inputOutputs.reserve(outputs.size());
+
+  size_t keyIndex = 0;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    if (i == 0 || outputs[i].transactionIndex != outputs[i - 1].transactionIndex) {
+      keyIndex = 0;
+    }
+
+    if (derivationValid[outputs[i].transactionIndex]) {
+      inputs.push_back({&derivations[outputs[i].transactionIndex], keyIndex, &outputs[i].key});
+      inputOutputs.push_back(static_cast<uint32_t>(i));
+    }
+
+    ++keyIndex;
+  }
+
+  std::vector<PublicKey> spendKeys(inputs.size());
+  std::unique_ptr<bool[]> spendKeyValid(new bool[inputs.size()]);
+  underive_public_keys(inputs.data(), inputs.size(), spendKeys.data(), spendKeyValid.get());
+
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (!spendKeyValid[i]) {
+      continue;
+    }
+
+    uint32_t spendKeyIndex = findSpendKey(spendKeys[i]);
+    if (spendKeyIndex != EMPTY_SLOT) {
+      const ScannedOutput& output = outputs[inputOutputs[i]];
+      matches.push_back({output.transactionIndex, output.outputIndex, spendKeyIndex});
+    }
+  }
+}
+
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "ITransaction.h"
+#include "crypto/crypto.h"
+
+namespace CryptoNote {
+
+/* Finds the outputs paying to any of a set of spend keys that share one view
+   key. Works on a whole batch of transactions at a time, so the derivations
+   and the underived spend keys can be computed with batched inversions. */
+class OutputScanner {
+public:
+  struct Match {
+    uint32_t transactionIndex; // position in the scanned batch
+    uint32_t outputIndex;      // position in the transaction outputs
+    uint32_t spendKeyIndex;    // see getSpendKey
+  };
+
+  OutputScanner(const Crypto::SecretKey& viewSecretKey, const std::unordered_set<Crypto::PublicKey>& spendKeys);
+
+  const Crypto::PublicKey& getSpendKey(uint32_t spendKeyIndex) const;
+
+  /* Matches are ordered by transaction, then output. Transactions whose outputs
+     cannot be read are skipped and their indexes added to failedTransactions. */
+  void scan(const ITransactionReader* const* transactions, size_t count, std::vector<Match>& matches,
+            std::vector<uint32_t>& failedTransactions) const;
+
+private:
+  static const uint32_t EMPTY_SLOT = UINT32_MAX;
+
+  uint32_t findSpendKey(const Crypto::PublicKey& key) const;
+
+  Crypto::SecretKey m_viewSecretKey;
+  std::vector<Crypto::PublicKey> m_spendKeys;
+  // open addressing table of indexes into m_spendKeys, sized to a power of two
+  std::vector<uint32_t> m_slots;
+  size_t m_mask;
+};
+
+}
@@ -11,7 +11,7 @@
 #include <future>
 
 #include "CommonTypes.h"
-#include "Common/BlockingQueue.h"
+#include "Common/Trace.h"
 #include "CryptoNoteCore/CryptoNoteBasicImpl.h"
 #include "CryptoNoteCore/CryptoNoteFormatUtils.h"
 #include "CryptoNoteCore/TransactionApi.h"
@@ -46,55 +46,6 @@ private:
     Crypto::Hash m_txHash;
 };
 
-void checkOutputKey(
-  const KeyDerivation& derivation,
-  const PublicKey& key,
-  size_t keyIndex,
-  size_t outputIndex,
-  const std::unordered_set<PublicKey>& spendKeys,
-  std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
-
-  PublicKey spendKey;
-  underive_public_key(derivation, keyIndex, key, spendKey);
-
-  if (spendKeys.find(spendKey) != spendKeys.end()) {
-    outputs[spendKey].push_back(static_cast<uint32_t>(outputIndex));
-  }
-
-}
-
-void findMyOutputs(
-  const ITransactionReader& tx,
-  const SecretKey& viewSecretKey,
-  const std::unordered_set<PublicKey>& spendKeys,
-  std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
-
-  auto txPublicKey = tx.getTransactionPublicKey();
-  KeyDerivation derivation;
-
-  if (!generate_key_derivation( txPublicKey, viewSecretKey, derivation)) {
-    return;
-  }
-
-  size_t keyIndex = 0;
-  size_t outputCount = tx.getOutputCount();
-
-  for (size_t idx = 0; idx < outputCount; ++idx) {
-
-    auto outType = tx.getOutputType(size_t(idx));
-
-    if (outType == TransactionTypes::OutputType::Key) {
-
-      uint64_t amount;
-      KeyOutput out;
-      tx.getOutput(idx, out, amount);
-      checkOutputKey(derivation, out.key, keyIndex, idx, spendKeys, outputs);
-      ++keyIndex;
-
-    }
-  }
-}
-
 std::vector<Crypto::Hash> getBlockHashes(const CryptoNote::CompleteBlock* blocks, size_t count) {
   std::vector<Crypto::Hash> result;
   result.reserve(count);
@@ -111,7 +62,7 @@ std::vector<Crypto::Hash> getBlockHashes(const CryptoNote::CompleteBlock* blocks
 namespace CryptoNote {
 
 TransfersConsumer::TransfersConsumer(const CryptoNote::Currency& currency, INode& node, Logging::ILogger& logger, const SecretKey& viewSecret) :
-  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer") {
+  m_node(node), m_viewSecret(viewSecret), m_scanner(viewSecret, m_spendKeys), m_currency(currency), m_logger(logger, "TransfersConsumer") {
   updateSyncStart();
 }
 
@@ -125,6 +76,7 @@ ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscrip
   if (res.get() == nullptr) {
     res.reset(new TransfersSubscription(m_currency, m_logger.getLogger(), subscription));
     m_spendKeys.insert(subscription.keys.address.spendPublicKey);
+    m_scanner = OutputScanner(m_viewSecret, m_spendKeys);
 
     if (m_subscriptions.size() == 1) {
       m_syncStart = res->getSyncStart();
@@ -141,6 +93,7 @@ ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscrip
 bool TransfersConsumer::removeSubscription(const AccountPublicAddress& address) {
   m_subscriptions.erase(address.spendPublicKey);
   m_spendKeys.erase(address.spendPublicKey);
+  m_scanner = OutputScanner(m_viewSecret, m_spendKeys);
   updateSyncStart();
   return m_subscriptions.empty();
 }
@@ -197,6 +150,7 @@ void TransfersConsumer::onBlockchainDetach(uint32_t height) {
 }
 
 uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) {
+  TRACE_SPAN("TransfersConsumer::onNewBlocks");
   assert(blocks);
   assert(count > 0);
 
@@ -209,77 +163,92 @@ uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t st
   struct PreprocessedTx : Tx, PreprocessInfo {};
 
   std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
+  uint32_t emptyBlockCount = 0;
 
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& block = blocks[i].block;
 
-  BlockingQueue<Tx> inputQueue(workers * 2);
+    if (!block.is_initialized()) {
+      ++emptyBlockCount;
+      continue;
+    }
 
-  std::atomic<bool> stopProcessing(false);
-  std::atomic<size_t> emptyBlockCount(0);
+    // filter by syncStartTimestamp
+    if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+      ++emptyBlockCount;
+      continue;
+    }
 
-  auto pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < count && !stopProcessing; ++i) {
-      const auto& block = blocks[i].block;
+    TransactionBlockInfo blockInfo;
+    blockInfo.height = startHeight + i;
+    blockInfo.timestamp = block->timestamp;
+    blockInfo.transactionIndex = 0; // position in block
 
-      if (!block.is_initialized()) {
-        ++emptyBlockCount;
+    for (const auto& tx : blocks[i].transactions) {
+      auto pubKey = tx->getTransactionPublicKey();
+      if (pubKey == NULL_PUBLIC_KEY) {
+        ++blockInfo.transactionIndex;
         continue;
       }
 
-      // filter by syncStartTimestamp
-      if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
-        ++emptyBlockCount;
-        continue;
-      }
+      bool isLastTransactionInBlock = blockInfo.transactionIndex + 1 == blocks[i].transactions.size();
+      preprocessedTransactions.emplace_back();
+      static_cast<Tx&>(preprocessedTransactions.back()) = { blockInfo, tx.get(), isLastTransactionInBlock };
+      ++blockInfo.transactionIndex;
+    }
+  }
 
-      TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
-      blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
+  size_t workers = std::thread::hardware_concurrency();
+  if (workers == 0) {
+    workers = 2;
+  }
 
-      for (const auto& tx : blocks[i].transactions) {
-        auto pubKey = tx->getTransactionPublicKey();
-        if (pubKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
-          continue;
-        }
+  std::atomic<bool> stopProcessing(false);
 
-        bool isLastTransactionInBlock = blockInfo.transactionIndex + 1 == blocks[i].transactions.size();
-        Tx item = { blockInfo, tx.get(), isLastTransactionInBlock };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
-      }
+  // each worker scans a contiguous range of the batch, then preprocesses the transactions that have outputs for us
+  auto processingFunction = [&](size_t begin, size_t end) {
+    TRACE_SPAN("TransfersConsumer::preprocessBlocks");
+    std::vector<const ITransactionReader*> transactions;
+    transactions.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      transactions.push_back(preprocessedTransactions[i].tx);
     }
 
-    inputQueue.close();
-  });
+    std::vector<OutputScanner::Match> matches;
+    std::vector<uint32_t> failedTransactions;
+    m_scanner.scan(transactions.data(), transactions.size(), matches, failedTransactions);
+
+    for (auto index : failedTransactions) {
+      m_logger(WARNING, BRIGHT_RED) << "Failed to process transaction, transaction hash " << Common::podToHex(transactions[index]->getTransactionHash());
+    }
 
-  auto processingFunction = [&] {
-    Tx item;
     std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
+    auto match = matches.begin();
+    for (size_t i = begin; i < end && !stopProcessing; ++i) {
+      auto first = match;
+      while (match != matches.end() && match->transactionIndex == i - begin) {
+        ++match;
+      }
+
+      if (first == match) {
+        continue;
+      }
 
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
+      auto& output = preprocessedTransactions[i];
+      ec = preprocessOutputs(output.blockInfo, *output.tx, &*first, match - first, output);
       if (ec) {
         stopProcessing = true;
         break;
       }
-
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
     }
     return ec;
   };
 
+  size_t chunkSize = (preprocessedTransactions.size() + workers - 1) / workers;
   std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
+  for (size_t begin = 0; begin < preprocessedTransactions.size(); begin += chunkSize) {
+    size_t end = std::min(begin + chunkSize, preprocessedTransactions.size());
+    processingThreads.push_back(std::async(std::launch::async, processingFunction, begin, end));
   }
 
   std::error_code processingError;
@@ -307,12 +276,8 @@ uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t st
   std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
   m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-  // sort by block height and transaction index in block
-  std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-    return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-  });
-
-  uint32_t processedBlockCount = static_cast<uint32_t>(emptyBlockCount);
+  // collected in block height and transaction index order
+  uint32_t processedBlockCount = emptyBlockCount;
   try {
     for (const auto& tx : preprocessedTransactions) {
       processTransaction(tx.blockInfo, *tx.tx, tx);
@@ -356,6 +321,7 @@ uint32_t TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t st
 }
 
 std::error_code TransfersConsumer::onPoolUpdated(const std::vector<std::unique_ptr<ITransactionReader>>& addedTransactions, const std::vector<Hash>& deletedTransactions) {
+  TRACE_SPAN("TransfersConsumer::onPoolUpdated");
   TransactionBlockInfo unconfirmedBlockInfo;
   unconfirmedBlockInfo.timestamp = 0;
   unconfirmedBlockInfo.height = WALLET_UNCONFIRMED_TRANSACTION_HEIGHT;
@@ -497,17 +463,28 @@ std::error_code createTransfers(
 }
 
 std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
-  std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
-  try
-  {
-    findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
-  }
-  catch (const std::exception& e)
+  const ITransactionReader* transactions[] = { &tx };
+  std::vector<OutputScanner::Match> matches;
+  std::vector<uint32_t> failedTransactions;
+  m_scanner.scan(transactions, 1, matches, failedTransactions);
+
+  if (!failedTransactions.empty())
   {
-    m_logger(WARNING, BRIGHT_RED) << "Failed to process transaction: " << e.what() << ", transaction hash " << Common::podToHex(tx.getTransactionHash());
+    m_logger(WARNING, BRIGHT_RED) << "Failed to process transaction, transaction hash " << Common::podToHex(tx.getTransactionHash());
     return std::error_code();
   }
 
+  return preprocessOutputs(blockInfo, tx, matches.data(), matches.size(), info);
+}
+
+std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+  const OutputScanner::Match* matches, size_t matchCount, PreprocessInfo& info) {
+  TRACE_SPAN("TransfersConsumer::preprocessOutputs");
+  std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
+  for (size_t i = 0; i < matchCount; ++i) {
+    outputs[m_scanner.getSpendKey(matches[i].spendKeyIndex)].push_back(matches[i].outputIndex);
+  }
+
   if (outputs.empty())
   {
     return std::error_code();
@@ -551,6 +528,7 @@ std::error_code TransfersConsumer::processTransaction(const TransactionBlockInfo
 }
 
 void TransfersConsumer::processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, const PreprocessInfo& info) {
+  TRACE_SPAN("TransfersConsumer::processTransaction");
   std::vector<TransactionOutputInformationIn> emptyOutputs;
   std::vector<ITransfersContainer*> transactionContainers;
 
@@ -9,6 +9,7 @@
 
 #include "IBlockchainSynchronizer.h"
 #include "ITransfersSynchronizer.h"
+#include "OutputScanner.h"
 #include "TransfersSubscription.h"
 #include "TypeHelpers.h"
 
@@ -62,6 +63,8 @@ private:
   };
 
   std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info);
+  std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+    const OutputScanner::Match* matches, size_t matchCount, PreprocessInfo& info);
   std::error_code processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx);
   void processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, const PreprocessInfo& info);
   void processOutputs(const TransactionBlockInfo& blockInfo, TransfersSubscription& sub, const ITransactionReader& tx,
@@ -76,6 +79,8 @@ private:
   // map { spend public key -> subscription }
   std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersSubscription>> m_subscriptions;
   std::unordered_set<Crypto::PublicKey> m_spendKeys;
+  // rebuilt whenever m_spendKeys changes
+  OutputScanner m_scanner;
   std::unordered_set<Crypto::Hash> m_poolTxs;
 
   INode& m_node;
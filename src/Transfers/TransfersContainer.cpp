@@ -98,6 +98,30 @@ namespace {
   TransferIteratorList<TIterator> createTransferIteratorList(const std::pair<TIterator, TIterator>& itPair) {
     return TransferIteratorList<TIterator>(itPair.first, itPair.second);
   }
+
+  template<typename TKey>
+  void updateAmount(std::map<TKey, uint64_t>& amounts, const TKey& key, uint64_t amount, bool add) {
+    if (add) {
+      amounts[key] += amount;
+      return;
+    }
+
+    auto it = amounts.find(key);
+    assert(it != amounts.end() && it->second >= amount);
+    it->second -= amount;
+    if (it->second == 0) {
+      amounts.erase(it);
+    }
+  }
+
+  uint64_t sumAbove(const std::map<uint64_t, uint64_t>& amounts, uint64_t key) {
+    uint64_t sum = 0;
+    for (auto it = amounts.upper_bound(key); it != amounts.end(); ++it) {
+      sum += it->second;
+    }
+
+    return sum;
+  }
 }
 
 
@@ -153,7 +177,9 @@ TransfersContainer::TransfersContainer(const Currency& currency, Logging::ILogge
   m_currentHeight(0),
   m_currency(currency),
   m_logger(logger, "TransfersContainer"),
-  m_transactionSpendableAge(transactionSpendableAge) {
+  m_transactionSpendableAge(transactionSpendableAge),
+  m_unconfirmedBalance(0),
+  m_availableBalance(0) {
 }
 
 bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const ITransactionReader& tx,
@@ -252,6 +278,7 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
     info.visible = true;
 
     if (transferIsUnconfirmed) {
+      updateBalance(info, true);
       auto result = m_unconfirmedTransfers.emplace(std::move(info));
       (void)result; // Disable unused warning
       assert(result.second);
@@ -282,6 +309,7 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
         }
       }
 
+      updateBalance(info, true);
       auto result = m_availableTransfers.emplace(std::move(info));
       (void)result; // Disable unused warning
       assert(result.second);
@@ -367,6 +395,7 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       assert(spendingTransferIt->keyImage == input.keyImage);
       copyToSpent(block, tx, i, *spendingTransferIt);
       // erase from available outputs
+      updateBalance(*spendingTransferIt, false);
       outputDescriptorIndex.erase(spendingTransferIt);
       updateTransfersVisibility(input.keyImage);
 
@@ -430,10 +459,13 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
         throw std::invalid_argument(message);
       }
 
+      updateBalance(*transferIt, false);
+
       transfer.blockHeight = block.height;
       transfer.transactionIndex = block.transactionIndex;
       transfer.globalOutputIndex = globalIndices[transfer.outputInTransaction];
 
+      updateBalance(transfer, true);
       auto result = m_availableTransfers.emplace(std::move(transfer));
       (void)result; // Disable unused warning
       assert(result.second);
@@ -468,10 +500,12 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
       TransactionOutputInformationEx unconfirmedTransfer = *transferIt;
       assert(unconfirmedTransfer.blockHeight != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT);
       assert(unconfirmedTransfer.globalOutputIndex != UNCONFIRMED_TRANSACTION_GLOBAL_OUTPUT_INDEX);
+      updateBalance(unconfirmedTransfer, false);
       unconfirmedTransfer.blockHeight = WALLET_UNCONFIRMED_TRANSACTION_HEIGHT;
       unconfirmedTransfer.transactionIndex = 0;
       unconfirmedTransfer.globalOutputIndex = UNCONFIRMED_TRANSACTION_GLOBAL_OUTPUT_INDEX;
 
+      updateBalance(unconfirmedTransfer, true);
       auto result = m_unconfirmedTransfers.emplace(std::move(unconfirmedTransfer));
       (void)result; // Disable unused warning
       assert(result.second);
@@ -512,6 +546,7 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
 
     auto result = m_availableTransfers.emplace(static_cast<const TransactionOutputInformationEx&>(*it));
     assert(result.second);
+    updateBalance(*result.first, true);
     it = spendingTransactionIndex.erase(it);
 
     if (result.first->type == TransactionTypes::OutputType::Key) {
@@ -521,6 +556,7 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
 
   auto unconfirmedTransfersRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
   for (auto it = unconfirmedTransfersRange.first; it != unconfirmedTransfersRange.second;) {
+    updateBalance(*it, false);
     if (it->type == TransactionTypes::OutputType::Key) {
       KeyImage keyImage = it->keyImage;
       it = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(it);
@@ -533,6 +569,7 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
   auto& transactionTransfersIndex = m_availableTransfers.get<ContainingTransactionIndex>();
   auto transactionTransfersRange = transactionTransfersIndex.equal_range(transactionHash);
   for (auto it = transactionTransfersRange.first; it != transactionTransfersRange.second;) {
+    updateBalance(*it, false);
     if (it->type == TransactionTypes::OutputType::Key) {
       KeyImage keyImage = it->keyImage;
       it = transactionTransfersIndex.erase(it);
@@ -631,6 +668,15 @@ void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
   size_t spentCount = std::distance(spentRange.first, spentRange.second);
   assert(spentCount == 0 || spentCount == 1);
 
+  // visibility isn't part of any key, the ranges stay valid across the updates
+  for (auto it = unconfirmedRange.first; it != unconfirmedRange.second; ++it) {
+    updateBalance(*it, false);
+  }
+
+  for (auto it = availableRange.first; it != availableRange.second; ++it) {
+    updateBalance(*it, false);
+  }
+
   if (spentCount > 0) {
     updateVisibility(unconfirmedIndex, unconfirmedRange, false);
     updateVisibility(availableIndex, availableRange, false);
@@ -649,6 +695,14 @@ void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
   } else {
     updateVisibility(unconfirmedIndex, unconfirmedRange, unconfirmedCount == 1);
   }
+
+  for (auto it = unconfirmedRange.first; it != unconfirmedRange.second; ++it) {
+    updateBalance(*it, true);
+  }
+
+  for (auto it = availableRange.first; it != availableRange.second; ++it) {
+    updateBalance(*it, true);
+  }
 }
 
 bool TransfersContainer::advanceHeight(uint32_t height) {
@@ -674,6 +728,52 @@ size_t TransfersContainer::transactionsCount() const {
 
 uint64_t TransfersContainer::balance(uint32_t flags) const {
   std::lock_guard<std::mutex> lk(m_mutex);
+
+  if ((flags & IncludeTypeKey) == 0) {
+    return 0;
+  }
+
+  uint64_t locked = sumAbove(m_lockedUntilHeight, m_currentHeight);
+  uint64_t notUnlocked = sumAbove(m_notUnlockedUntilHeight, m_currentHeight);
+
+  for (const auto& kv : m_lockedUntilTime) {
+    if (!isSpendTimeUnlocked(kv.first.first)) {
+      locked += kv.second;
+      notUnlocked += kv.second;
+    } else if (m_currentHeight < kv.first.second) {
+      notUnlocked += kv.second;
+    }
+  }
+
+  uint64_t amount = 0;
+  if ((flags & IncludeStateUnlocked) != 0) {
+    amount += m_availableBalance - notUnlocked;
+  }
+
+  if ((flags & IncludeStateSoftLocked) != 0) {
+    amount += notUnlocked - locked;
+  }
+
+  if ((flags & IncludeStateLocked) != 0) {
+    amount += locked + m_unconfirmedBalance;
+  }
+
+#if !defined(NDEBUG)
+  uint64_t scannedAmount = scanBalance(flags);
+  if (amount != scannedAmount) {
+    m_logger(ERROR, BRIGHT_RED) << "Balance counters disagree with transfers, flags " << flags <<
+      ", counted " << m_currency.formatAmount(amount) << ", scanned " << m_currency.formatAmount(scannedAmount);
+    assert(false);
+  }
+#endif
+
+  return amount;
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+uint64_t TransfersContainer::scanBalance(uint32_t flags) const {
   uint64_t amount = 0;
 
   for (const auto& t : m_availableTransfers) {
@@ -883,6 +983,8 @@ void TransfersContainer::load(std::istream& in) {
   m_availableTransfers = std::move(availableTransfers);
   m_spentTransfers = std::move(spentTransfers);
 
+  rebuildBalance();
+
   // Repair the container if it was broken while handling addTransaction() in previous version of the code
   // Hope it isn't necessary anymore
   //repair();
@@ -972,6 +1074,8 @@ void TransfersContainer::repair() {
     }
   }
 
+  rebuildBalance();
+
   if (deletedInputCount + deletedUnconfirmedOutputCount + deletedAvailableOutputCount > 0) {
     m_logger(WARNING, BRIGHT_YELLOW) << "Repair finished:\n" <<
       "    Deleted inputs " << deletedInputCount << ", total inputs " << m_spentTransfers.size() << '\n' <<
@@ -1019,4 +1123,51 @@ bool TransfersContainer::isIncluded(TransactionTypes::OutputType type, uint32_t
     ((flags & state) != 0);
 }
 
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::updateBalance(const TransactionOutputInformationEx& transfer, bool add) {
+  if (!transfer.visible || transfer.type != TransactionTypes::OutputType::Key) {
+    return;
+  }
+
+  if (transfer.blockHeight == WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
+    m_unconfirmedBalance = add ? m_unconfirmedBalance + transfer.amount : m_unconfirmedBalance - transfer.amount;
+    return;
+  }
+
+  m_availableBalance = add ? m_availableBalance + transfer.amount : m_availableBalance - transfer.amount;
+
+  // the heights isIncluded() compares m_currentHeight against
+  uint64_t softLockedUntil = static_cast<uint64_t>(transfer.blockHeight) + m_transactionSpendableAge;
+  if (transfer.unlockTime < m_currency.maxBlockHeight()) {
+    uint64_t lockedUntil = transfer.unlockTime > m_currency.lockedTxAllowedDeltaBlocks() ?
+      transfer.unlockTime - m_currency.lockedTxAllowedDeltaBlocks() : 0;
+
+    updateAmount(m_lockedUntilHeight, lockedUntil, transfer.amount, add);
+    updateAmount(m_notUnlockedUntilHeight, std::max(lockedUntil, softLockedUntil), transfer.amount, add);
+  } else {
+    updateAmount(m_lockedUntilTime, std::make_pair(transfer.unlockTime, softLockedUntil), transfer.amount, add);
+  }
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::rebuildBalance() {
+  m_unconfirmedBalance = 0;
+  m_availableBalance = 0;
+  m_lockedUntilHeight.clear();
+  m_notUnlockedUntilHeight.clear();
+  m_lockedUntilTime.clear();
+
+  for (const auto& t : m_unconfirmedTransfers) {
+    updateBalance(t, true);
+  }
+
+  for (const auto& t : m_availableTransfers) {
+    updateBalance(t, true);
+  }
+}
+
 }
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <unordered_map>
 #include <mutex>
 
@@ -266,6 +267,9 @@ private:
   bool isIncluded(const TransactionOutputInformationEx& info, uint32_t flags) const;
   static bool isIncluded(TransactionTypes::OutputType type, uint32_t state, uint32_t flags);
   void updateTransfersVisibility(const Crypto::KeyImage& keyImage);
+  void updateBalance(const TransactionOutputInformationEx& transfer, bool add);
+  void rebuildBalance();
+  uint64_t scanBalance(uint32_t flags) const;
 
   void copyToSpent(const TransactionBlockInfo& block, const ITransactionReader& tx, size_t inputIndex, const TransactionOutputInformationEx& output);
   void repair();
@@ -281,6 +285,17 @@ private:
   const CryptoNote::Currency& m_currency;
   mutable std::mutex m_mutex;
   Logging::LoggerRef m_logger;
+
+  // Running totals of the visible key outputs, so balance() doesn't have to
+  // scan every transfer. Whether an available output is locked or soft locked
+  // depends on the current height, so its amount is also kept under the
+  // height up to which it stays locked; balance() only visits heights above
+  // the current one. Outputs locked until a timestamp are rare and kept apart.
+  uint64_t m_unconfirmedBalance;
+  uint64_t m_availableBalance;
+  std::map<uint64_t, uint64_t> m_lockedUntilHeight;
+  std::map<uint64_t, uint64_t> m_notUnlockedUntilHeight;
+  std::map<std::pair<uint64_t, uint64_t>, uint64_t> m_lockedUntilTime; // (unlock time, soft locked until height) -> amount
 };
 
 }
@@ -0,0 +1,139 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "BlockHashChain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+namespace CryptoNote {
+
+namespace {
+
+const uint32_t EMPTY_SLOT = UINT32_MAX;
+
+/* Block hashes are uniformly distributed, their first bytes are hash enough */
+size_t getSlot(const Crypto::Hash& hash, size_t mask) {
+  return std::hash<Crypto::Hash>()(hash) & mask;
+}
+
+}
+
+BlockHashChain::BlockHashChain() : m_indexUsed(0) {
+}
+
+bool BlockHashChain::empty() const {
+  return m_hashes.empty();
+}
+
+size_t BlockHashChain::size() const {
+  return m_hashes.size();
+}
+
+const Crypto::Hash& BlockHashChain::operator[](size_t index) const {
+  assert(index < m_hashes.size());
+  return m_hashes[index];
+}
+
+std::vector<Crypto::Hash> BlockHashChain::getHashes(size_t index, size_t count) const {
+  if (index >= m_hashes.size()) {
+    return std::vector<Crypto::Hash>();
+  }
+
+  auto start = m_hashes.begin() + index;
+  return std::vector<Crypto::Hash>(start, start + std::min(count, m_hashes.size() - index));
+}
+
+bool BlockHashChain::find(const Crypto::Hash& hash, uint32_t& index) const {
+  if (m_hashes.empty()) {
+    return false;
+  }
+
+  if (m_index.empty()) {
+    rebuildIndex();
+  }
+
+  size_t mask = m_index.size() - 1;
+  for (size_t slot = getSlot(hash, mask); m_index[slot] != EMPTY_SLOT; slot = (slot + 1) & mask) {
+    uint32_t position = m_index[slot];
+    if (position < m_hashes.size() && m_hashes[position] == hash) {
+      index = position;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void BlockHashChain::push_back(const Crypto::Hash& hash) {
+  m_hashes.push_back(hash);
+
+  if (!m_index.empty()) {
+    insertIntoIndex(static_cast<uint32_t>(m_hashes.size() - 1));
+  }
+}
+
+void BlockHashChain::append(const std::vector<Crypto::Hash>& hashes) {
+  size_t first = m_hashes.size();
+  m_hashes.insert(m_hashes.end(), hashes.begin(), hashes.end());
+
+  if (!m_index.empty()) {
+    for (size_t i = first; i < m_hashes.size(); ++i) {
+      insertIntoIndex(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+void BlockHashChain::truncate(size_t index) {
+  if (index < m_hashes.size()) {
+    m_hashes.resize(index);
+  }
+}
+
+void BlockHashChain::clear() {
+  m_hashes.clear();
+  m_index.clear();
+  m_indexUsed = 0;
+}
+
+void BlockHashChain::insertIntoIndex(uint32_t index) const {
+  // keep the table at most half full so probe runs stay short
+  if ((m_indexUsed + 1) * 2 > m_index.size()) {
+    rebuildIndex();
+    return;
+  }
+
+  size_t mask = m_index.size() - 1;
+  size_t slot = getSlot(m_hashes[index], mask);
+  while (m_index[slot] != EMPTY_SLOT) {
+    slot = (slot + 1) & mask;
+  }
+
+  m_index[slot] = index;
+  ++m_indexUsed;
+}
+
+void BlockHashChain::rebuildIndex() const {
+  size_t slots = 16;
+  while (slots < m_hashes.size() * 2) {
+    slots *= 2;
+  }
+
+  m_index.assign(slots, EMPTY_SLOT);
+  m_indexUsed = 0;
+
+  size_t mask = slots - 1;
+  for (size_t i = 0; i < m_hashes.size(); ++i) {
+    size_t slot = getSlot(m_hashes[i], mask);
+    while (m_index[slot] != EMPTY_SLOT) {
+      slot = (slot + 1) & mask;
+    }
+
+    m_index[slot] = static_cast<uint32_t>(i);
+    ++m_indexUsed;
+  }
+}
+
+}
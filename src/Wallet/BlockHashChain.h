@@ -0,0 +1,50 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace CryptoNote {
+
+/* Hashes of the blocks the wallet has seen, stored back to back. Lookups by
+   hash go through a table of block indexes that is only built the first time
+   one is needed, so a wallet that never asks for a block by hash pays 32 bytes
+   per block and nothing else. */
+class BlockHashChain {
+public:
+  BlockHashChain();
+
+  bool empty() const;
+  size_t size() const;
+
+  const Crypto::Hash& operator[](size_t index) const;
+  std::vector<Crypto::Hash> getHashes(size_t index, size_t count) const;
+
+  bool find(const Crypto::Hash& hash, uint32_t& index) const;
+
+  void push_back(const Crypto::Hash& hash);
+  void append(const std::vector<Crypto::Hash>& hashes);
+
+  /* Drops the blocks from index on, as on a blockchain detach */
+  void truncate(size_t index);
+  void clear();
+
+private:
+  void insertIntoIndex(uint32_t index) const;
+  void rebuildIndex() const;
+
+  std::vector<Crypto::Hash> m_hashes;
+
+  // Open addressing table of positions in m_hashes, empty until the first find().
+  // Truncating leaves stale slots behind; they never match because the
+  // position they hold is checked against m_hashes, and go on the next rebuild.
+  mutable std::vector<uint32_t> m_index;
+  mutable size_t m_indexUsed;
+};
+
+}
@@ -37,6 +37,7 @@
 #include "CryptoNoteCore/CryptoNoteSerialization.h"
 #include "CryptoNoteCore/CryptoNoteTools.h"
 #include "CryptoNoteCore/TransactionApi.h"
+#include "CryptoNoteCore/TransactionExtra.h"
 #include "crypto/crypto.h"
 #include "Transfers/TransfersContainer.h"
 #include "WalletSerializationV2.h"
@@ -50,6 +51,10 @@ using namespace Logging;
 
 namespace {
 
+// Blocks synced since the last full save, which a wallet loaded from its
+// journal has to scan again, after which save() writes a full save
+const uint32_t JOURNAL_MAX_BLOCKS = 1000;
+
 void asyncRequestCompletion(System::Event& requestFinished) {
   requestFinished.set();
 }
@@ -134,7 +139,11 @@ WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currenc
   m_state(WalletState::NOT_INITIALIZED),
   m_actualBalance(0),
   m_pendingBalance(0),
-  m_transactionSoftLockTime(transactionSoftLockTime)
+  m_transactionSoftLockTime(transactionSoftLockTime),
+  m_fullSaveRequired(true),
+  m_journalBaseSize(0),
+  m_journalSize(0),
+  m_journalBaseBlockCount(0)
 {
   m_readyEvent.set();
 }
@@ -234,9 +243,13 @@ void WalletGreen::clearCacheAndShutdown()
 }
 
 void WalletGreen::clearCaches(bool clearTransactions, bool clearCachedData) {
+  m_fullSaveRequired = true;
+
   if (clearTransactions) {
     m_transactions.clear();
     m_transfers.clear();
+    m_addressTransactions.clear();
+    m_paymentIdTransactions.clear();
   }
 
   if (clearCachedData) {
@@ -389,10 +402,28 @@ void WalletGreen::save(WalletSaveLevel saveLevel, const std::string& extra) {
   throwIfNotInitialized();
   throwIfStopped();
 
+  // A journal record holds no synchronizer state, so it can be written
+  // without stopping the synchronizer; once the journal outgrows half of
+  // the full save it follows, or the synchronizer state of that save is too
+  // far behind, the next save compacts both into one
+  if (saveLevel == WalletSaveLevel::SAVE_ALL && !m_fullSaveRequired && m_journalSize <= m_journalBaseSize / 2 &&
+      m_blockchain.size() < m_journalBaseBlockCount + JOURNAL_MAX_BLOCKS) {
+    try {
+      saveWalletChanges(extra);
+    } catch (const std::exception& e) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to save container changes: " << e.what();
+      throw;
+    }
+
+    m_logger(INFO, BRIGHT_WHITE) << "Container saved";
+    return;
+  }
+
   stopBlockchainSynchronizer();
 
   try {
     saveWalletCache(m_containerStorage, m_key, saveLevel, extra);
+    resetContainerJournal();
   } catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to save container: " << e.what();
     startBlockchainSynchronizer();
@@ -497,6 +528,7 @@ void WalletGreen::load(const std::string& path, const std::string& password, std
 
         if (!addedSpendKeys.empty() || !deletedSpendKeys.empty()) {
           saveWalletCache(m_containerStorage, m_key, WalletSaveLevel::SAVE_ALL, extra);
+          resetContainerJournal();
         }
       } catch (const std::exception& e) {
         m_logger(ERROR, BRIGHT_RED) << "Failed to load cache: " << e.what() << ", reset wallet data";
@@ -590,6 +622,9 @@ void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKe
   BinaryArray contanerData;
   loadAndDecryptContainerData(m_containerStorage, m_key, contanerData);
 
+  std::vector<BinaryArray> journal;
+  loadAndDecryptContainerJournal(m_containerStorage, m_key, journal, m_journalBaseSize, m_journalSize);
+
   WalletSerializerV2 s(
     *this,
     m_viewPublicKey,
@@ -611,6 +646,37 @@ void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKe
   addedKeys = std::move(s.addedKeys());
   deletedKeys = std::move(s.deletedKeys());
 
+  uint32_t knownBlockCount = static_cast<uint32_t>(m_synchronizer.getViewKeyKnownBlocks(m_viewPublicKey).size());
+  if (!journal.empty()) {
+    // Blocks the synchronizer state doesn't know yet will be scanned again,
+    // so transactions the journal has in them go back to unconfirmed
+    size_t transactionCount = m_transactions.size();
+
+    for (const BinaryArray& record : journal) {
+      Common::MemoryInputStream recordStream(record.data(), record.size());
+      s.loadChanges(recordStream);
+    }
+
+    auto& transactions = m_transactions.get<RandomAccessIndex>();
+    for (auto it = transactions.begin(); it != transactions.end(); ++it) {
+      if (it->blockHeight != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT && it->blockHeight >= knownBlockCount) {
+        transactions.modify(it, [](WalletTransaction& tx) {
+          tx.blockHeight = WALLET_UNCONFIRMED_TRANSACTION_HEIGHT;
+        });
+      }
+    }
+
+    m_logger(DEBUGGING) << "Container journal loaded, records " << journal.size() <<
+      ", transactions added " << m_transactions.size() - transactionCount;
+  }
+
+  m_unsavedTransactions.clear();
+  // A torn record at the end of the journal was dropped, new records can't go after it
+  m_fullSaveRequired = m_journalBaseSize + m_journalSize != m_containerStorage.suffixSize();
+  m_journalBaseBlockCount = knownBlockCount;
+
+  rebuildTransactionIndexes();
+
   m_logger(DEBUGGING) << "Container cache loaded";
 }
 
@@ -666,6 +732,54 @@ void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chach
   m_logger(DEBUGGING) << "Container saving finished";
 }
 
+void WalletGreen::saveWalletChanges(const std::string& extra) {
+  if (m_unsavedTransactions.empty() && extra == m_extra) {
+    m_logger(DEBUGGING) << "No container changes to save";
+    return;
+  }
+
+  m_logger(DEBUGGING) << "Saving changes of " << m_unsavedTransactions.size() << " transactions...";
+
+  std::string containerData;
+  Common::StringOutputStream containerStream(containerData);
+
+  WalletSerializerV2 s(
+    *this,
+    m_viewPublicKey,
+    m_viewSecretKey,
+    m_actualBalance,
+    m_pendingBalance,
+    m_walletsContainer,
+    m_synchronizer,
+    m_unlockTransactionsJob,
+    m_transactions,
+    m_transfers,
+    m_uncommitedTransactions,
+    const_cast<std::string&>(extra),
+    m_transactionSoftLockTime
+  );
+
+  s.saveChanges(containerStream, m_unsavedTransactions);
+
+  uint64_t suffixSize = m_containerStorage.suffixSize();
+  encryptAndAppendContainerData(m_containerStorage, m_key, containerData.data(), containerData.size());
+  m_containerStorage.flush();
+
+  m_journalSize += m_containerStorage.suffixSize() - suffixSize;
+  m_unsavedTransactions.clear();
+  m_extra = extra;
+
+  m_logger(DEBUGGING) << "Container changes saved, journal size " << m_journalSize;
+}
+
+void WalletGreen::resetContainerJournal() {
+  m_unsavedTransactions.clear();
+  m_fullSaveRequired = false;
+  m_journalBaseSize = m_containerStorage.suffixSize();
+  m_journalSize = 0;
+  m_journalBaseBlockCount = static_cast<uint32_t>(m_blockchain.size());
+}
+
 void WalletGreen::copyContainerStorageKeys(ContainerStorage& src, const chacha8_key& srcKey, ContainerStorage& dst, const chacha8_key& dstKey) {
   m_logger(DEBUGGING) << "Copying wallet keys...";
   dst.reserve(src.size());
@@ -745,6 +859,67 @@ void WalletGreen::loadAndDecryptContainerData(ContainerStorage& storage, const C
   chacha8(encryptedContainer.data(), encryptedContainer.size(), key, suffixIv, reinterpret_cast<char*>(containerData.data()));
 }
 
+void WalletGreen::encryptAndAppendContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize) {
+  ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(storage.prefix());
+
+  Crypto::chacha8_iv recordIv = prefix->nextIv;
+  incIv(prefix->nextIv);
+
+  BinaryArray encryptedRecord;
+  encryptedRecord.resize(containerDataSize);
+  chacha8(containerData, containerDataSize, key, recordIv, reinterpret_cast<char*>(encryptedRecord.data()));
+
+  Crypto::Hash recordHash = Crypto::cn_fast_hash(encryptedRecord.data(), encryptedRecord.size());
+
+  std::string record;
+  Common::StringOutputStream recordStream(record);
+  BinaryOutputStreamSerializer recordSerializer(recordStream);
+  recordSerializer(recordIv, "recordIv");
+  recordSerializer(encryptedRecord, "encryptedRecord");
+  recordSerializer(recordHash, "recordHash");
+
+  storage.appendSuffix(reinterpret_cast<const uint8_t*>(record.data()), record.size());
+}
+
+void WalletGreen::loadAndDecryptContainerJournal(ContainerStorage& storage, const Crypto::chacha8_key& key, std::vector<BinaryArray>& records,
+  uint64_t& baseSize, uint64_t& journalSize) {
+  Common::MemoryInputStream suffixStream(storage.suffix(), storage.suffixSize());
+  BinaryInputStreamSerializer suffixSerializer(suffixStream);
+
+  // the full save the journal follows
+  Crypto::chacha8_iv suffixIv;
+  BinaryArray encryptedContainer;
+  suffixSerializer(suffixIv, "suffixIv");
+  suffixSerializer(encryptedContainer, "encryptedContainer");
+
+  baseSize = suffixStream.getPosition();
+  journalSize = 0;
+
+  while (!suffixStream.endOfStream()) {
+    Crypto::chacha8_iv recordIv;
+    BinaryArray encryptedRecord;
+    Crypto::Hash recordHash;
+
+    try {
+      suffixSerializer(recordIv, "recordIv");
+      suffixSerializer(encryptedRecord, "encryptedRecord");
+      suffixSerializer(recordHash, "recordHash");
+    } catch (const std::exception&) {
+      return;
+    }
+
+    if (Crypto::cn_fast_hash(encryptedRecord.data(), encryptedRecord.size()) != recordHash) {
+      return;
+    }
+
+    BinaryArray record(encryptedRecord.size());
+    chacha8(encryptedRecord.data(), encryptedRecord.size(), key, recordIv, reinterpret_cast<char*>(record.data()));
+
+    records.emplace_back(std::move(record));
+    journalSize = suffixStream.getPosition() - baseSize;
+  }
+}
+
 void WalletGreen::initTransactionPool() {
   std::unordered_set<Crypto::Hash> uncommitedTransactionsSet;
   std::transform(m_uncommitedTransactions.begin(), m_uncommitedTransactions.end(), std::inserter(uncommitedTransactionsSet, uncommitedTransactionsSet.end()),
@@ -865,6 +1040,14 @@ void WalletGreen::changePassword(const std::string& oldPassword, const std::stri
       BinaryArray containerData;
       loadAndDecryptContainerData(m_containerStorage, m_key, containerData);
       encryptAndSaveContainerData(newStorage, newKey, containerData.data(), containerData.size());
+
+      std::vector<BinaryArray> journal;
+      uint64_t baseSize;
+      uint64_t journalSize;
+      loadAndDecryptContainerJournal(m_containerStorage, m_key, journal, baseSize, journalSize);
+      for (const BinaryArray& record : journal) {
+        encryptAndAppendContainerData(newStorage, newKey, record.data(), record.size());
+      }
     }
   });
 
@@ -1056,6 +1239,9 @@ std::vector<std::string> WalletGreen::doCreateAddressList(const std::vector<NewA
 
     m_containerStorage.setAutoFlush(true);
 
+    // the wallet list lives in the full save only
+    m_fullSaveRequired = true;
+
     if (resetRequired)
     {
       m_logger(DEBUGGING) << "A reset is required to scan from this new lower "
@@ -1319,6 +1505,7 @@ void WalletGreen::deleteAddress(const std::string& address) {
   m_containerStorage.erase(std::next(m_containerStorage.begin(), addressIndex));
 
   m_synchronizer.removeSubscription(pubAddr);
+  m_fullSaveRequired = true;
 
   deleteContainerFromUnlockTransactionJobs(it->container);
   std::vector<size_t> deletedTransactions;
@@ -1941,6 +2128,7 @@ void WalletGreen::pushBackOutgoingTransfers(size_t txId, const std::vector<Walle
     d.amount = dest.amount;
 
     m_transfers.emplace_back(txId, std::move(d));
+    indexTransactionAddress(txId, dest.address);
   }
 }
 
@@ -1959,6 +2147,7 @@ size_t WalletGreen::insertOutgoingTransactionAndPushEvent(const Hash& transactio
 
   size_t txId = m_transactions.get<RandomAccessIndex>().size();
   m_transactions.get<RandomAccessIndex>().push_back(std::move(insertTx));
+  indexTransactionPaymentId(txId, m_transactions.get<RandomAccessIndex>()[txId].extra);
 
   pushEvent(makeTransactionCreatedEvent(txId));
 
@@ -2026,6 +2215,9 @@ bool WalletGreen::updateWalletTransactionInfo(size_t transactionId, const Crypto
   if (r) {}
   assert(r);
 
+  // also picks up extra filled in above
+  reindexTransaction(transactionId);
+
   if (updated) {
     m_logger(DEBUGGING) << "Transaction updated, ID " << transactionId <<
       ", hash " << it->hash <<
@@ -2058,6 +2250,7 @@ size_t WalletGreen::insertBlockchainTransaction(const TransactionInformation& in
 
   size_t txId = index.size();
   index.push_back(std::move(tx));
+  indexTransactionPaymentId(txId, index[txId].extra);
 
   m_logger(DEBUGGING) << "Transaction added, ID " << txId <<
     ", hash " << tx.hash <<
@@ -2194,6 +2387,7 @@ void WalletGreen::appendTransfer(size_t transactionId, size_t firstTransferIdx,
 
   WalletTransfer transfer{ WalletTransferType::USUAL, address, amount };
   m_transfers.emplace(insertIt, std::piecewise_construct, std::forward_as_tuple(transactionId), std::forward_as_tuple(transfer));
+  indexTransactionAddress(transactionId, address);
 }
 
 bool WalletGreen::adjustTransfer(size_t transactionId, size_t firstTransferIdx, const std::string& address, int64_t amount) {
@@ -2227,6 +2421,7 @@ bool WalletGreen::adjustTransfer(size_t transactionId, size_t firstTransferIdx,
   if (!firstAddressTransferFound) {
     WalletTransfer transfer{ WalletTransferType::USUAL, address, amount };
     m_transfers.emplace(it, std::piecewise_construct, std::forward_as_tuple(transactionId), std::forward_as_tuple(transfer));
+    indexTransactionAddress(transactionId, address);
     updated = true;
   }
 
@@ -2619,15 +2814,11 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactions(const Crypto::
   throwIfNotInitialized();
   throwIfStopped();
 
-  auto& hashIndex = m_blockchain.get<BlockHashIndex>();
-  auto it = hashIndex.find(blockHash);
-  if (it == hashIndex.end()) {
+  uint32_t blockIndex;
+  if (!m_blockchain.find(blockHash, blockIndex)) {
     return std::vector<TransactionsInBlockInfo>();
   }
 
-  auto heightIt = m_blockchain.project<BlockHeightIndex>(it);
-
-  uint32_t blockIndex = static_cast<uint32_t>(std::distance(m_blockchain.get<BlockHeightIndex>().begin(), heightIt));
   return getTransactionsInBlocks(blockIndex, count);
 }
 
@@ -2638,19 +2829,72 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactions(uint32_t block
   return getTransactionsInBlocks(blockIndex, count);
 }
 
-std::vector<Crypto::Hash> WalletGreen::getBlockHashes(uint32_t blockIndex, size_t count) const {
+TransactionsQueryResult WalletGreen::queryTransactions(const TransactionsQuery& query) const {
   throwIfNotInitialized();
   throwIfStopped();
 
-  auto& index = m_blockchain.get<BlockHeightIndex>();
+  if (query.blockCount == 0) {
+    m_logger(ERROR, BRIGHT_RED) << "Bad argument: block count must be greater than zero";
+    throw std::system_error(make_error_code(error::WRONG_PARAMETERS), "blocks count must be greater than zero");
+  }
+
+  if (query.blockIndex == 0) {
+    m_logger(ERROR, BRIGHT_RED) << "Bad argument: blockIndex must be greater than zero";
+    throw std::system_error(make_error_code(error::WRONG_PARAMETERS), "blockIndex must be greater than zero");
+  }
+
+  TransactionsQueryResult result;
 
-  if (blockIndex >= index.size()) {
-    return std::vector<Crypto::Hash>();
+  if (query.blockIndex >= m_blockchain.size()) {
+    return result;
   }
 
-  auto start = std::next(index.begin(), blockIndex);
-  auto end = std::next(index.begin(), std::min(index.size(), blockIndex + count));
-  return std::vector<Crypto::Hash>(start, end);
+  uint32_t stopIndex = static_cast<uint32_t>(std::min<size_t>(m_blockchain.size(), query.blockIndex + query.blockCount));
+  std::vector<TransactionKey> matches = query.addresses.empty() && !query.havePaymentId ?
+    queryAllTransactions(query, stopIndex) : queryIndexedTransactions(query, stopIndex);
+
+  if (query.limit != 0 && matches.size() > query.limit) {
+    matches.resize(query.limit);
+    result.truncated = true;
+    result.lastBlockIndex = matches.back().first;
+    result.lastTransactionId = matches.back().second;
+  }
+
+  auto& transactionIdIndex = m_transactions.get<RandomAccessIndex>();
+  uint32_t currentBlockIndex = 0;
+  for (const auto& match : matches) {
+    if (result.blocks.empty() || currentBlockIndex != match.first) {
+      currentBlockIndex = match.first;
+      result.blocks.emplace_back();
+      result.blocks.back().blockHash = m_blockchain[currentBlockIndex - 1];
+    }
+
+    WalletTransactionWithTransfers transaction;
+    transaction.transaction = transactionIdIndex[match.second];
+
+    auto bounds = getTransactionTransfersRange(match.second);
+    for (auto it = bounds.first; it != bounds.second; ++it) {
+      transaction.transfers.emplace_back(it->second);
+    }
+
+    result.blocks.back().transactions.emplace_back(std::move(transaction));
+  }
+
+  return result;
+}
+
+bool WalletGreen::getBlockIndex(const Crypto::Hash& blockHash, uint32_t& blockIndex) const {
+  throwIfNotInitialized();
+  throwIfStopped();
+
+  return m_blockchain.find(blockHash, blockIndex);
+}
+
+std::vector<Crypto::Hash> WalletGreen::getBlockHashes(uint32_t blockIndex, size_t count) const {
+  throwIfNotInitialized();
+  throwIfStopped();
+
+  return m_blockchain.getHashes(blockIndex, count);
 }
 
 uint32_t WalletGreen::getBlockCount() const {
@@ -2785,7 +3029,7 @@ void WalletGreen::blocksAdded(const std::vector<Crypto::Hash>& blockHashes) {
     return;
   }
 
-  m_blockchain.insert(m_blockchain.end(), blockHashes.begin(), blockHashes.end());
+  m_blockchain.append(blockHashes);
 }
 
 void WalletGreen::onBlockchainDetach(const Crypto::PublicKey& viewPublicKey, uint32_t blockIndex) {
@@ -2801,8 +3045,7 @@ void WalletGreen::blocksRollback(uint32_t blockIndex) {
     return;
   }
 
-  auto& blockHeightIndex = m_blockchain.get<BlockHeightIndex>();
-  blockHeightIndex.erase(std::next(blockHeightIndex.begin(), blockIndex), blockHeightIndex.end());
+  m_blockchain.truncate(blockIndex);
 }
 
 void WalletGreen::onTransactionDeleteBegin(const Crypto::PublicKey& viewPublicKey, Crypto::Hash transactionHash) {
@@ -2938,6 +3181,12 @@ void WalletGreen::transactionUpdated(const TransactionInformation& transactionIn
 }
 
 void WalletGreen::pushEvent(const WalletEvent& event) {
+  if (event.type == WalletEventType::TRANSACTION_CREATED) {
+    m_unsavedTransactions.insert(event.transactionCreated.transactionIndex);
+  } else if (event.type == WalletEventType::TRANSACTION_UPDATED) {
+    m_unsavedTransactions.insert(event.transactionUpdated.transactionIndex);
+  }
+
   m_events.push(event);
   m_eventOccurred.set();
 }
@@ -3498,7 +3747,7 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactionsInBlocks(uint32
 
 Crypto::Hash WalletGreen::getBlockHashByIndex(uint32_t blockIndex) const {
   assert(blockIndex < m_blockchain.size());
-  return m_blockchain.get<BlockHeightIndex>()[blockIndex];
+  return m_blockchain[blockIndex];
 }
 
 std::vector<WalletTransfer> WalletGreen::getTransactionTransfers(const WalletTransaction& transaction) const {
@@ -3520,6 +3769,164 @@ std::vector<WalletTransfer> WalletGreen::getTransactionTransfers(const WalletTra
   return result;
 }
 
+// Both return the first limit + 1 matches in key order, the one past the limit only tells the query it was cut short
+std::vector<WalletGreen::TransactionKey> WalletGreen::queryAllTransactions(const TransactionsQuery& query, uint32_t stopIndex) const {
+  auto& transactionIdIndex = m_transactions.get<RandomAccessIndex>();
+  auto& blockHeightIndex = m_transactions.get<BlockHeightIndex>();
+  auto it = blockHeightIndex.lower_bound(query.blockIndex);
+  auto end = blockHeightIndex.lower_bound(stopIndex);
+
+  std::vector<TransactionKey> matches;
+  std::vector<size_t> blockTransactions;
+  while (it != end && (query.limit == 0 || matches.size() <= query.limit)) {
+    // the height index does not order the transactions of a block by id
+    uint32_t blockIndex = it->blockHeight;
+    blockTransactions.clear();
+    for (; it != end && it->blockHeight == blockIndex; ++it) {
+      if (it->state == WalletTransactionState::SUCCEEDED) {
+        blockTransactions.push_back(std::distance(transactionIdIndex.begin(), m_transactions.project<RandomAccessIndex>(it)));
+      }
+    }
+
+    std::sort(blockTransactions.begin(), blockTransactions.end());
+    for (size_t transactionId : blockTransactions) {
+      if (blockIndex == query.blockIndex && query.afterTransactionId != WALLET_INVALID_TRANSACTION_ID && transactionId <= query.afterTransactionId) {
+        continue;
+      }
+
+      matches.emplace_back(blockIndex, transactionId);
+      if (query.limit != 0 && matches.size() > query.limit) {
+        break;
+      }
+    }
+  }
+
+  return matches;
+}
+
+std::vector<WalletGreen::TransactionKey> WalletGreen::queryIndexedTransactions(const TransactionsQuery& query, uint32_t stopIndex) const {
+  const std::set<TransactionKey>* paymentIdTransactions = nullptr;
+  if (query.havePaymentId) {
+    auto it = m_paymentIdTransactions.find(query.paymentId);
+    if (it == m_paymentIdTransactions.end()) {
+      return std::vector<TransactionKey>();
+    }
+
+    paymentIdTransactions = &it->second;
+  }
+
+  std::vector<const std::set<TransactionKey>*> addressTransactions;
+  size_t addressTransactionCount = 0;
+  for (const std::string& address : query.addresses) {
+    auto it = m_addressTransactions.find(address);
+    if (it != m_addressTransactions.end()) {
+      addressTransactions.push_back(&it->second);
+      addressTransactionCount += it->second.size();
+    }
+  }
+
+  // walk the smaller index, the payment id of the other is looked up by key
+  bool walkPaymentId = paymentIdTransactions != nullptr && (query.addresses.empty() || paymentIdTransactions->size() <= addressTransactionCount);
+  TransactionKey first(query.blockIndex, query.afterTransactionId == WALLET_INVALID_TRANSACTION_ID ? 0 : query.afterTransactionId + 1);
+  std::vector<std::pair<std::set<TransactionKey>::const_iterator, std::set<TransactionKey>::const_iterator>> ranges;
+  if (walkPaymentId) {
+    ranges.emplace_back(paymentIdTransactions->lower_bound(first), paymentIdTransactions->end());
+  } else {
+    for (const std::set<TransactionKey>* transactions : addressTransactions) {
+      ranges.emplace_back(transactions->lower_bound(first), transactions->end());
+    }
+  }
+
+  std::unordered_set<std::string> addresses(query.addresses.begin(), query.addresses.end());
+  auto& transactionIdIndex = m_transactions.get<RandomAccessIndex>();
+  std::vector<TransactionKey> matches;
+  while (query.limit == 0 || matches.size() <= query.limit) {
+    // merge the address indexes, a transaction in several of them is taken once
+    auto next = std::min_element(ranges.begin(), ranges.end(), [] (const decltype(ranges)::value_type& a, const decltype(ranges)::value_type& b) {
+      return a.first != a.second && (b.first == b.second || *a.first < *b.first);
+    });
+
+    if (next == ranges.end() || next->first == next->second || next->first->first >= stopIndex) {
+      break;
+    }
+
+    TransactionKey key = *next->first;
+    for (auto& range : ranges) {
+      if (range.first != range.second && *range.first == key) {
+        ++range.first;
+      }
+    }
+
+    const WalletTransaction& transaction = transactionIdIndex[key.second];
+    if (transaction.blockHeight != key.first || transaction.state != WalletTransactionState::SUCCEEDED) {
+      continue;
+    }
+
+    if (!walkPaymentId && paymentIdTransactions != nullptr && paymentIdTransactions->count(key) == 0) {
+      continue;
+    }
+
+    if (!addresses.empty() && !hasTransferForAddress(key.second, addresses)) {
+      continue;
+    }
+
+    matches.push_back(key);
+  }
+
+  return matches;
+}
+
+bool WalletGreen::hasTransferForAddress(size_t transactionId, const std::unordered_set<std::string>& addresses) const {
+  auto bounds = getTransactionTransfersRange(transactionId);
+  return std::any_of(bounds.first, bounds.second, [&addresses] (const TransactionTransferPair& transfer) {
+    return addresses.count(transfer.second.address) != 0;
+  });
+}
+
+void WalletGreen::indexTransactionAddress(size_t transactionId, const std::string& address) {
+  uint32_t blockIndex = m_transactions.get<RandomAccessIndex>()[transactionId].blockHeight;
+  m_addressTransactions[address].emplace(blockIndex, transactionId);
+}
+
+void WalletGreen::indexTransactionPaymentId(size_t transactionId, const std::string& extra) {
+  Crypto::Hash paymentId;
+
+  try {
+    if (!getPaymentIdFromTxExtra(Common::asBinaryArray(extra), paymentId)) {
+      return;
+    }
+  } catch (std::exception&) {
+    return;
+  }
+
+  uint32_t blockIndex = m_transactions.get<RandomAccessIndex>()[transactionId].blockHeight;
+  m_paymentIdTransactions[paymentId].emplace(blockIndex, transactionId);
+}
+
+// Indexes the transaction again under its current block index
+void WalletGreen::reindexTransaction(size_t transactionId) {
+  auto bounds = getTransactionTransfersRange(transactionId);
+  for (auto it = bounds.first; it != bounds.second; ++it) {
+    indexTransactionAddress(transactionId, it->second.address);
+  }
+
+  indexTransactionPaymentId(transactionId, m_transactions.get<RandomAccessIndex>()[transactionId].extra);
+}
+
+void WalletGreen::rebuildTransactionIndexes() {
+  m_addressTransactions.clear();
+  m_paymentIdTransactions.clear();
+
+  for (const auto& transfer : m_transfers) {
+    indexTransactionAddress(transfer.first, transfer.second.address);
+  }
+
+  auto& transactionIdIndex = m_transactions.get<RandomAccessIndex>();
+  for (size_t transactionId = 0; transactionId < transactionIdIndex.size(); ++transactionId) {
+    indexTransactionPaymentId(transactionId, transactionIdIndex[transactionId].extra);
+  }
+}
+
 void WalletGreen::filterOutTransactions(WalletTransactions& transactions, WalletTransfers& transfers, std::function<bool (const WalletTransaction&)>&& pred) const {
   size_t cancelledTransactions = 0;
 
@@ -3550,7 +3957,7 @@ void WalletGreen::filterOutTransactions(WalletTransactions& transactions, Wallet
 
 void WalletGreen::initBlockchain(const Crypto::PublicKey& viewPublicKey) {
   std::vector<Crypto::Hash> blockchain = m_synchronizer.getViewKeyKnownBlocks(m_viewPublicKey);
-  m_blockchain.insert(m_blockchain.end(), blockchain.begin(), blockchain.end());
+  m_blockchain.append(blockchain);
 }
 
 ///pre: changeDestinationAddress belongs to current container
@@ -20,9 +20,11 @@
 #include "IWallet.h"
 
 #include <queue>
+#include <set>
 #include <unordered_map>
 
 #include "IFusionManager.h"
+#include "BlockHashChain.h"
 #include "WalletIndices.h"
 
 #include "Logging/LoggerRef.h"
@@ -87,6 +89,8 @@ public:
   virtual WalletTransactionWithTransfers getTransaction(const Crypto::Hash& transactionHash) const override;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t count) const override;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const override;
+  virtual TransactionsQueryResult queryTransactions(const TransactionsQuery& query) const override;
+  virtual bool getBlockIndex(const Crypto::Hash& blockHash, uint32_t& blockIndex) const override;
   virtual std::vector<Crypto::Hash> getBlockHashes(uint32_t blockIndex, size_t count) const override;
   virtual uint32_t getBlockCount() const override;
   virtual std::vector<WalletTransactionWithTransfers> getUnconfirmedTransactions() const override;
@@ -174,6 +178,8 @@ protected:
   };
 
   typedef std::pair<WalletTransfers::const_iterator, WalletTransfers::const_iterator> TransfersRange;
+  // (block index, transaction id), in the order queries return transactions
+  typedef std::pair<uint32_t, size_t> TransactionKey;
 
   struct AddressAmounts {
     int64_t input = 0;
@@ -318,11 +324,16 @@ protected:
   void deleteOrphanTransactions(const std::unordered_set<Crypto::PublicKey>& deletedKeys);
   static void encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize);
   static void loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData);
+  static void encryptAndAppendContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize);
+  static void loadAndDecryptContainerJournal(ContainerStorage& storage, const Crypto::chacha8_key& key, std::vector<BinaryArray>& records,
+    uint64_t& baseSize, uint64_t& journalSize);
   void initTransactionPool();
   void loadSpendKeys();
   void loadContainerStorage(const std::string& path);
   void loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra);
   void saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra);
+  void saveWalletChanges(const std::string& extra);
+  void resetContainerJournal();
   void subscribeWallets();
 
   std::vector<OutputToTransfer> pickRandomFusionInputs(const std::vector<std::string>& addresses,
@@ -344,6 +355,13 @@ protected:
 
   TransfersRange getTransactionTransfersRange(size_t transactionIndex) const;
   std::vector<TransactionsInBlockInfo> getTransactionsInBlocks(uint32_t blockIndex, size_t count) const;
+  std::vector<TransactionKey> queryAllTransactions(const TransactionsQuery& query, uint32_t stopIndex) const;
+  std::vector<TransactionKey> queryIndexedTransactions(const TransactionsQuery& query, uint32_t stopIndex) const;
+  bool hasTransferForAddress(size_t transactionId, const std::unordered_set<std::string>& addresses) const;
+  void indexTransactionAddress(size_t transactionId, const std::string& address);
+  void indexTransactionPaymentId(size_t transactionId, const std::string& extra);
+  void reindexTransaction(size_t transactionId);
+  void rebuildTransactionIndexes();
   Crypto::Hash getBlockHashByIndex(uint32_t blockIndex) const;
 
   std::vector<WalletTransfer> getTransactionTransfers(const WalletTransaction& transaction) const;
@@ -367,6 +385,12 @@ protected:
   UnlockTransactionJobs m_unlockTransactionsJob;
   WalletTransactions m_transactions;
   WalletTransfers m_transfers; //sorted
+  // Transactions by transfer address and by payment id, keyed by the block
+  // index they had when indexed. Only ever grow until the transactions are
+  // cleared, so queries skip keys whose block index is no longer the
+  // transaction's and check the transfers of the rest
+  std::unordered_map<std::string, std::set<TransactionKey>> m_addressTransactions;
+  std::unordered_map<Crypto::Hash, std::set<TransactionKey>> m_paymentIdTransactions;
   mutable std::unordered_map<size_t, bool> m_fusionTxsCache; // txIndex -> isFusion
   UncommitedTransactions m_uncommitedTransactions;
 
@@ -393,7 +417,17 @@ protected:
 
   uint32_t m_transactionSoftLockTime;
 
-  BlockHashesContainer m_blockchain;
+  BlockHashChain m_blockchain;
+
+  // save() appends the transactions changed since the last save to the
+  // container suffix as a journal record instead of rewriting the suffix,
+  // until the journal grows past half of the full save it follows or the
+  // wallet has synced JOURNAL_MAX_BLOCKS past it
+  std::set<size_t> m_unsavedTransactions;
+  bool m_fullSaveRequired;
+  uint64_t m_journalBaseSize;
+  uint64_t m_journalSize;
+  uint32_t m_journalBaseBlockCount;
 
   friend std::ostream& operator<<(std::ostream& os, CryptoNote::WalletGreen::WalletState state);
   friend std::ostream& operator<<(std::ostream& os, CryptoNote::WalletGreen::WalletTrackingMode mode);
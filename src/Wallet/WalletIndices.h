@@ -64,7 +64,6 @@ struct BlockHeightIndex {};
 
 struct TransactionHashIndex {};
 struct TransactionIndex {};
-struct BlockHashIndex {};
 
 typedef boost::multi_index_container <
   WalletRecord,
@@ -113,17 +112,4 @@ typedef std::pair<size_t, CryptoNote::WalletTransfer> TransactionTransferPair;
 typedef std::vector<TransactionTransferPair> WalletTransfers;
 typedef std::map<size_t, CryptoNote::Transaction> UncommitedTransactions;
 
-typedef boost::multi_index_container<
-  Crypto::Hash,
-  boost::multi_index::indexed_by <
-    boost::multi_index::random_access<
-      boost::multi_index::tag<BlockHeightIndex>
-    >,
-    boost::multi_index::hashed_unique<
-      boost::multi_index::tag<BlockHashIndex>,
-      boost::multi_index::identity<Crypto::Hash>
-    >
-  >
-> BlockHashesContainer;
-
 }
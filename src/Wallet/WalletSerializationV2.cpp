@@ -109,6 +109,31 @@ void serialize(WalletTransferDtoV2& value, CryptoNote::ISerializer& serializer)
   serializer(value.type, "type");
 }
 
+CryptoNote::WalletTransaction fromDto(const WalletTransactionDtoV2& dto) {
+  CryptoNote::WalletTransaction tx;
+  tx.state = dto.state;
+  tx.timestamp = dto.timestamp;
+  tx.blockHeight = dto.blockHeight;
+  tx.hash = dto.hash;
+  tx.totalAmount = dto.totalAmount;
+  tx.fee = dto.fee;
+  tx.creationTime = dto.creationTime;
+  tx.unlockTime = dto.unlockTime;
+  tx.extra = dto.extra;
+  tx.isBase = dto.isBase;
+
+  return tx;
+}
+
+CryptoNote::WalletTransfer fromDto(const WalletTransferDtoV2& dto) {
+  CryptoNote::WalletTransfer tr;
+  tr.address = dto.address;
+  tr.amount = dto.amount;
+  tr.type = static_cast<CryptoNote::WalletTransferType>(dto.type);
+
+  return tr;
+}
+
 }
 
 namespace CryptoNote {
@@ -187,6 +212,108 @@ void WalletSerializerV2::save(Common::IOutputStream& destination, WalletSaveLeve
   s(m_extra, "extra");
 }
 
+void WalletSerializerV2::loadChanges(Common::IInputStream& source) {
+  CryptoNote::BinaryInputStreamSerializer s(source);
+
+  auto& transactions = m_transactions.get<RandomAccessIndex>();
+  auto& hashIndex = m_transactions.get<TransactionIndex>();
+
+  uint64_t count = 0;
+  s(count, "transactionCount");
+
+  for (uint64_t i = 0; i < count; ++i) {
+    WalletTransactionDtoV2 dto;
+    s(dto, "transaction");
+
+    size_t transactionId;
+    auto it = hashIndex.find(dto.hash);
+    if (it == hashIndex.end()) {
+      transactionId = transactions.size();
+      transactions.emplace_back(fromDto(dto));
+    } else {
+      transactionId = std::distance(transactions.begin(), m_transactions.project<RandomAccessIndex>(it));
+      hashIndex.replace(it, fromDto(dto));
+    }
+
+    auto bounds = std::equal_range(m_transfers.begin(), m_transfers.end(), std::make_pair(transactionId, WalletTransfer()),
+      [] (const TransactionTransferPair& a, const TransactionTransferPair& b) { return a.first < b.first; });
+    auto position = m_transfers.erase(bounds.first, bounds.second);
+
+    uint64_t transferCount = 0;
+    s(transferCount, "transferCount");
+
+    std::vector<TransactionTransferPair> transfers;
+    transfers.reserve(transferCount);
+    for (uint64_t j = 0; j < transferCount; ++j) {
+      WalletTransferDtoV2 transferDto;
+      s(transferDto, "transfer");
+      transfers.emplace_back(transactionId, fromDto(transferDto));
+    }
+
+    m_transfers.insert(position, transfers.begin(), transfers.end());
+  }
+
+  uint64_t uncommitedCount = 0;
+  s(uncommitedCount, "uncommitedTransactionCount");
+
+  m_uncommitedTransactions.clear();
+  for (uint64_t i = 0; i < uncommitedCount; ++i) {
+    Hash transactionHash;
+    CryptoNote::Transaction transaction;
+    s(transactionHash, "transactionHash");
+    s(transaction, "transaction");
+
+    auto it = hashIndex.find(transactionHash);
+    if (it != hashIndex.end()) {
+      size_t transactionId = std::distance(transactions.begin(), m_transactions.project<RandomAccessIndex>(it));
+      m_uncommitedTransactions.emplace(transactionId, std::move(transaction));
+    }
+  }
+
+  m_unlockTransactions.clear();
+  loadUnlockTransactionsJobs(s);
+
+  s(m_extra, "extra");
+}
+
+void WalletSerializerV2::saveChanges(Common::IOutputStream& destination, const std::set<size_t>& transactionIds) {
+  CryptoNote::BinaryOutputStreamSerializer s(destination);
+
+  auto& transactions = m_transactions.get<RandomAccessIndex>();
+
+  uint64_t count = transactionIds.size();
+  s(count, "transactionCount");
+
+  for (size_t transactionId : transactionIds) {
+    WalletTransactionDtoV2 dto(transactions[transactionId]);
+    s(dto, "transaction");
+
+    auto bounds = std::equal_range(m_transfers.begin(), m_transfers.end(), std::make_pair(transactionId, WalletTransfer()),
+      [] (const TransactionTransferPair& a, const TransactionTransferPair& b) { return a.first < b.first; });
+
+    uint64_t transferCount = std::distance(bounds.first, bounds.second);
+    s(transferCount, "transferCount");
+
+    for (auto it = bounds.first; it != bounds.second; ++it) {
+      WalletTransferDtoV2 transferDto(it->second);
+      s(transferDto, "transfer");
+    }
+  }
+
+  uint64_t uncommitedCount = m_uncommitedTransactions.size();
+  s(uncommitedCount, "uncommitedTransactionCount");
+
+  for (auto& kv : m_uncommitedTransactions) {
+    Hash transactionHash = transactions[kv.first].hash;
+    s(transactionHash, "transactionHash");
+    s(kv.second, "transaction");
+  }
+
+  saveUnlockTransactionsJobs(s);
+
+  s(m_extra, "extra");
+}
+
 std::unordered_set<Crypto::PublicKey>& WalletSerializerV2::addedKeys() {
   return m_addedKeys;
 }
@@ -262,19 +389,7 @@ void WalletSerializerV2::loadTransactions(CryptoNote::ISerializer& serializer) {
     WalletTransactionDtoV2 dto;
     serializer(dto, "transaction");
 
-    WalletTransaction tx;
-    tx.state = dto.state;
-    tx.timestamp = dto.timestamp;
-    tx.blockHeight = dto.blockHeight;
-    tx.hash = dto.hash;
-    tx.totalAmount = dto.totalAmount;
-    tx.fee = dto.fee;
-    tx.creationTime = dto.creationTime;
-    tx.unlockTime = dto.unlockTime;
-    tx.extra = dto.extra;
-    tx.isBase = dto.isBase;
-
-    m_transactions.get<RandomAccessIndex>().emplace_back(std::move(tx));
+    m_transactions.get<RandomAccessIndex>().emplace_back(fromDto(dto));
   }
 }
 
@@ -301,12 +416,7 @@ void WalletSerializerV2::loadTransfers(CryptoNote::ISerializer& serializer) {
     WalletTransferDtoV2 dto;
     serializer(dto, "transfer");
 
-    WalletTransfer tr;
-    tr.address = dto.address;
-    tr.amount = dto.amount;
-    tr.type = static_cast<WalletTransferType>(dto.type);
-
-    m_transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(std::move(tr)));
+    m_transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(fromDto(dto)));
   }
 }
 
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <set>
+
 #include "Common/IInputStream.h"
 #include "Common/IOutputStream.h"
 #include "Serialization/ISerializer.h"
@@ -46,6 +48,13 @@ public:
   void load(Common::IInputStream& source, uint8_t version);
   void save(Common::IOutputStream& destination, WalletSaveLevel saveLevel);
 
+  /* Journal records: the given transactions with their transfers, the
+     uncommited transactions, the unlock jobs and extra. Loading one on top
+     of a full save replaces transactions with the same hash and appends
+     the rest. */
+  void loadChanges(Common::IInputStream& source);
+  void saveChanges(Common::IOutputStream& destination, const std::set<size_t>& transactionIds);
+
   std::unordered_set<Crypto::PublicKey>& addedKeys();
   std::unordered_set<Crypto::PublicKey>& deletedKeys();
 
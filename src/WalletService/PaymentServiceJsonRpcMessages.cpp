@@ -169,10 +169,13 @@ void GetTransactionHashes::Request::serialize(CryptoNote::ISerializer& serialize
   }
 
   serializer(paymentId, "paymentId");
+  serializer(cursor, "cursor");
+  serializer(limit, "limit");
 }
 
 void GetTransactionHashes::Response::serialize(CryptoNote::ISerializer& serializer) {
   serializer(items, "items");
+  serializer(nextCursor, "nextCursor");
 }
 
 void TransferRpcInfo::serialize(CryptoNote::ISerializer& serializer) {
@@ -222,10 +225,13 @@ void GetTransactions::Request::serialize(CryptoNote::ISerializer& serializer) {
   }
 
   serializer(paymentId, "paymentId");
+  serializer(cursor, "cursor");
+  serializer(limit, "limit");
 }
 
 void GetTransactions::Response::serialize(CryptoNote::ISerializer& serializer) {
   serializer(items, "items");
+  serializer(nextCursor, "nextCursor");
 }
 
 void GetUnconfirmedTransactionHashes::Request::serialize(CryptoNote::ISerializer& serializer) {
@@ -223,12 +223,18 @@ struct GetTransactionHashes {
     uint32_t firstBlockIndex = std::numeric_limits<uint32_t>::max();
     uint32_t blockCount;
     std::string paymentId;
+    // Set to the nextCursor of the previous response to get the following page
+    std::string cursor;
+    // Maximum number of transactions per page, 0 for no limit
+    uint32_t limit = 0;
 
     void serialize(CryptoNote::ISerializer& serializer);
   };
 
   struct Response {
     std::vector<TransactionHashesInBlockRpcInfo> items;
+    // Empty once there are no more transactions in the range
+    std::string nextCursor;
 
     void serialize(CryptoNote::ISerializer& serializer);
   };
@@ -286,12 +292,18 @@ struct GetTransactions {
     uint32_t firstBlockIndex = std::numeric_limits<uint32_t>::max();
     uint32_t blockCount;
     std::string paymentId;
+    // Set to the nextCursor of the previous response to get the following page
+    std::string cursor;
+    // Maximum number of transactions per page, 0 for no limit
+    uint32_t limit = 0;
 
     void serialize(CryptoNote::ISerializer& serializer);
   };
 
   struct Response {
     std::vector<TransactionsInBlockRpcInfo> items;
+    // Empty once there are no more transactions in the range
+    std::string nextCursor;
 
     void serialize(CryptoNote::ISerializer& serializer);
   };
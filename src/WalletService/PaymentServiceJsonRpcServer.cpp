@@ -162,17 +162,21 @@ std::error_code PaymentServiceJsonRpcServer::handleGetBlockHashes(const GetBlock
 
 std::error_code PaymentServiceJsonRpcServer::handleGetTransactionHashes(const GetTransactionHashes::Request& request, GetTransactionHashes::Response& response) {
   if (!request.blockHash.empty()) {
-    return service.getTransactionHashes(request.addresses, request.blockHash, request.blockCount, request.paymentId, response.items);
+    return service.getTransactionHashes(request.addresses, request.blockHash, request.blockCount, request.paymentId,
+      request.cursor, request.limit, response.items, response.nextCursor);
   } else {
-    return service.getTransactionHashes(request.addresses, request.firstBlockIndex, request.blockCount, request.paymentId, response.items);
+    return service.getTransactionHashes(request.addresses, request.firstBlockIndex, request.blockCount, request.paymentId,
+      request.cursor, request.limit, response.items, response.nextCursor);
   }
 }
 
 std::error_code PaymentServiceJsonRpcServer::handleGetTransactions(const GetTransactions::Request& request, GetTransactions::Response& response) {
   if (!request.blockHash.empty()) {
-    return service.getTransactions(request.addresses, request.blockHash, request.blockCount, request.paymentId, response.items);
+    return service.getTransactions(request.addresses, request.blockHash, request.blockCount, request.paymentId,
+      request.cursor, request.limit, response.items, response.nextCursor);
   } else {
-    return service.getTransactions(request.addresses, request.firstBlockIndex, request.blockCount, request.paymentId, response.items);
+    return service.getTransactions(request.addresses, request.firstBlockIndex, request.blockCount, request.paymentId,
+      request.cursor, request.limit, response.items, response.nextCursor);
   }
 }
 
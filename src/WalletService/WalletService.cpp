@@ -176,28 +176,23 @@ Crypto::Hash parseHash(const std::string& hashString, Logging::LoggerRef logger)
   return hash;
 }
 
-std::vector<CryptoNote::TransactionsInBlockInfo> filterTransactions(
-  const std::vector<CryptoNote::TransactionsInBlockInfo>& blocks,
-  const TransactionsInBlockInfoFilter& filter) {
+/* Paged queries resume from "<block index>:<transaction id>:<end block index>",
+   the last transaction returned and the end of the requested range */
+std::string formatTransactionsCursor(uint32_t blockIndex, size_t transactionId, uint32_t endBlockIndex) {
+  return std::to_string(blockIndex) + ":" + std::to_string(transactionId) + ":" + std::to_string(endBlockIndex);
+}
 
-  std::vector<CryptoNote::TransactionsInBlockInfo> result;
+void parseTransactionsCursor(const std::string& cursor, uint32_t& blockIndex, size_t& transactionId, uint32_t& endBlockIndex, Logging::LoggerRef logger) {
+  std::istringstream stream(cursor);
+  char firstSeparator = 0;
+  char secondSeparator = 0;
 
-  for (const auto& block: blocks) {
-    CryptoNote::TransactionsInBlockInfo item;
-    item.blockHash = block.blockHash;
+  stream >> blockIndex >> firstSeparator >> transactionId >> secondSeparator >> endBlockIndex;
 
-    for (const auto& transaction: block.transactions) {
-      if (transaction.transaction.state != CryptoNote::WalletTransactionState::DELETED && filter.checkTransaction(transaction)) {
-        item.transactions.push_back(transaction);
-      }
-    }
-
-    if (!block.transactions.empty()) {
-      result.push_back(std::move(item));
-    }
+  if (stream.fail() || !stream.eof() || firstSeparator != ':' || secondSeparator != ':' || blockIndex >= endBlockIndex) {
+    logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Can't parse cursor " << cursor;
+    throw std::system_error(make_error_code(CryptoNote::error::WalletServiceErrorCode::WRONG_CURSOR_FORMAT));
   }
-
-  return result;
 }
 
 PaymentService::TransactionRpcInfo convertTransactionWithTransfersToTransactionRpcInfo(
@@ -453,7 +448,9 @@ WalletService::WalletService(const CryptoNote::Currency& currency, System::Dispa
     logger(logger, "WalletService"),
     dispatcher(sys),
     readyEvent(dispatcher),
-    refreshContext(dispatcher)
+    refreshContext(dispatcher),
+    currentSnapshot(std::make_shared<WalletSnapshot>()),
+    snapshotUpdateScheduled(false)
 {
   readyEvent.set();
 }
@@ -469,6 +466,7 @@ WalletService::~WalletService() {
 void WalletService::init() {
   loadWallet();
   loadTransactionIdIndex();
+  updateSnapshot();
 
   getNodeFee();
   refreshContext.spawn([this] { refresh(); });
@@ -586,6 +584,7 @@ std::error_code WalletService::resetWallet(const uint64_t scanHeight) {
     }
 
     reset(scanHeight);
+    updateSnapshot();
     logger(Logging::INFO, Logging::BRIGHT_WHITE) << "Wallet has been reset";
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while resetting wallet: " << x.what();
@@ -611,6 +610,7 @@ std::error_code WalletService::createAddress(const std::string& spendSecretKeyTe
     }
 
     address = wallet.createAddress(secretKey, scanHeight, newAddress);
+    updateSnapshot();
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while creating address: " << x.what();
     return x.code();
@@ -648,6 +648,7 @@ std::error_code WalletService::createAddressList(const std::vector<std::string>&
     }
 
     addresses = wallet.createAddressList(secretKeys, scanHeight, newAddress);
+    updateSnapshot();
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while creating addresses: " << x.what();
     return x.code();
@@ -665,6 +666,7 @@ std::error_code WalletService::createAddress(std::string& address) {
     logger(Logging::DEBUGGING) << "Creating address";
 
     address = wallet.createAddress();
+    updateSnapshot();
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while creating address: " << x.what();
     return x.code();
@@ -688,6 +690,7 @@ std::error_code WalletService::createTrackingAddress(const std::string& spendPub
     }
 
     address = wallet.createAddress(publicKey, scanHeight, true);
+    updateSnapshot();
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while creating tracking address: " << x.what();
     return x.code();
@@ -703,6 +706,7 @@ std::error_code WalletService::deleteAddress(const std::string& address) {
 
     logger(Logging::DEBUGGING) << "Delete address request came";
     wallet.deleteAddress(address);
+    updateSnapshot();
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while deleting address: " << x.what();
     return x.code();
@@ -731,11 +735,18 @@ std::error_code WalletService::getSpendkeys(const std::string& address, std::str
 
 std::error_code WalletService::getBalance(const std::string& address, uint64_t& availableBalance, uint64_t& lockedAmount) {
   try {
-    System::EventLock lk(readyEvent);
     logger(Logging::DEBUGGING) << "Getting balance for address " << address;
 
-    availableBalance = wallet.getActualBalance(address);
-    lockedAmount = wallet.getPendingBalance(address);
+    auto current = getSnapshot();
+    auto it = current->balances.find(address);
+    if (it != current->balances.end()) {
+      availableBalance = it->second.actual;
+      lockedAmount = it->second.pending;
+    } else {
+      // not one of ours or added since the snapshot, let the wallet decide
+      availableBalance = wallet.getActualBalance(address);
+      lockedAmount = wallet.getPendingBalance(address);
+    }
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while getting balance: " << x.what();
     return x.code();
@@ -747,11 +758,11 @@ std::error_code WalletService::getBalance(const std::string& address, uint64_t&
 
 std::error_code WalletService::getBalance(uint64_t& availableBalance, uint64_t& lockedAmount) {
   try {
-    System::EventLock lk(readyEvent);
     logger(Logging::DEBUGGING) << "Getting wallet balance";
 
-    availableBalance = wallet.getActualBalance();
-    lockedAmount = wallet.getPendingBalance();
+    auto current = getSnapshot();
+    availableBalance = current->actualBalance;
+    lockedAmount = current->pendingBalance;
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while getting balance: " << x.what();
     return x.code();
@@ -821,7 +832,8 @@ std::error_code WalletService::getMnemonicSeed(const std::string& address, std::
 }
 
 std::error_code WalletService::getTransactionHashes(const std::vector<std::string>& addresses, const std::string& blockHashString,
-  uint32_t blockCount, const std::string& paymentId, std::vector<TransactionHashesInBlockRpcInfo>& transactionHashes) {
+  uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit,
+  std::vector<TransactionHashesInBlockRpcInfo>& transactionHashes, std::string& nextCursor) {
   try {
     System::EventLock lk(readyEvent);
     validateAddresses(addresses, currency, logger);
@@ -830,10 +842,9 @@ std::error_code WalletService::getTransactionHashes(const std::vector<std::strin
       validatePaymentId(paymentId, logger);
     }
 
-    TransactionsInBlockInfoFilter transactionFilter(addresses, paymentId);
-    Crypto::Hash blockHash = parseHash(blockHashString, logger);
-
-    transactionHashes = getRpcTransactionHashes(blockHash, blockCount, transactionFilter);
+    uint32_t firstBlockIndex = getBlockIndex(blockHashString);
+    auto blocks = queryTransactions(addresses, firstBlockIndex, blockCount, paymentId, cursor, limit, nextCursor);
+    transactionHashes = convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(blocks);
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while getting transactions: " << x.what();
     return x.code();
@@ -846,7 +857,8 @@ std::error_code WalletService::getTransactionHashes(const std::vector<std::strin
 }
 
 std::error_code WalletService::getTransactionHashes(const std::vector<std::string>& addresses, uint32_t firstBlockIndex,
-  uint32_t blockCount, const std::string& paymentId, std::vector<TransactionHashesInBlockRpcInfo>& transactionHashes) {
+  uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit,
+  std::vector<TransactionHashesInBlockRpcInfo>& transactionHashes, std::string& nextCursor) {
   try {
     System::EventLock lk(readyEvent);
     validateAddresses(addresses, currency, logger);
@@ -855,9 +867,8 @@ std::error_code WalletService::getTransactionHashes(const std::vector<std::strin
       validatePaymentId(paymentId, logger);
     }
 
-    TransactionsInBlockInfoFilter transactionFilter(addresses, paymentId);
-    transactionHashes = getRpcTransactionHashes(firstBlockIndex, blockCount, transactionFilter);
-
+    auto blocks = queryTransactions(addresses, firstBlockIndex, blockCount, paymentId, cursor, limit, nextCursor);
+    transactionHashes = convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(blocks);
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while getting transactions: " << x.what();
     return x.code();
@@ -870,7 +881,8 @@ std::error_code WalletService::getTransactionHashes(const std::vector<std::strin
 }
 
 std::error_code WalletService::getTransactions(const std::vector<std::string>& addresses, const std::string& blockHashString,
-  uint32_t blockCount, const std::string& paymentId, std::vector<TransactionsInBlockRpcInfo>& transactions) {
+  uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit,
+  std::vector<TransactionsInBlockRpcInfo>& transactions, std::string& nextCursor) {
   try {
     System::EventLock lk(readyEvent);
     validateAddresses(addresses, currency, logger);
@@ -879,11 +891,9 @@ std::error_code WalletService::getTransactions(const std::vector<std::string>& a
       validatePaymentId(paymentId, logger);
     }
 
-    TransactionsInBlockInfoFilter transactionFilter(addresses, paymentId);
-
-    Crypto::Hash blockHash = parseHash(blockHashString, logger);
-
-    transactions = getRpcTransactions(blockHash, blockCount, transactionFilter);
+    uint32_t firstBlockIndex = getBlockIndex(blockHashString);
+    auto blocks = queryTransactions(addresses, firstBlockIndex, blockCount, paymentId, cursor, limit, nextCursor);
+    transactions = convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(blocks);
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while getting transactions: " << x.what();
     return x.code();
@@ -896,7 +906,8 @@ std::error_code WalletService::getTransactions(const std::vector<std::string>& a
 }
 
 std::error_code WalletService::getTransactions(const std::vector<std::string>& addresses, uint32_t firstBlockIndex,
-  uint32_t blockCount, const std::string& paymentId, std::vector<TransactionsInBlockRpcInfo>& transactions) {
+  uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit,
+  std::vector<TransactionsInBlockRpcInfo>& transactions, std::string& nextCursor) {
   try {
     System::EventLock lk(readyEvent);
     validateAddresses(addresses, currency, logger);
@@ -905,9 +916,8 @@ std::error_code WalletService::getTransactions(const std::vector<std::string>& a
       validatePaymentId(paymentId, logger);
     }
 
-    TransactionsInBlockInfoFilter transactionFilter(addresses, paymentId);
-
-    transactions = getRpcTransactions(firstBlockIndex, blockCount, transactionFilter);
+    auto blocks = queryTransactions(addresses, firstBlockIndex, blockCount, paymentId, cursor, limit, nextCursor);
+    transactions = convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(blocks);
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while getting transactions: " << x.what();
     return x.code();
@@ -944,20 +954,7 @@ std::error_code WalletService::getTransaction(const std::string& transactionHash
 }
 
 std::error_code WalletService::getAddresses(std::vector<std::string>& addresses) {
-  try {
-    System::EventLock lk(readyEvent);
-
-    addresses.clear();
-    addresses.reserve(wallet.getAddressCount());
-
-    for (size_t i = 0; i < wallet.getAddressCount(); ++i) {
-      addresses.push_back(wallet.getAddress(i));
-    }
-  } catch (std::exception& e) {
-    logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Can't get addresses: " << e.what();
-    return make_error_code(CryptoNote::error::INTERNAL_WALLET_ERROR);
-  }
-
+  addresses = getSnapshot()->addresses;
   return std::error_code();
 }
 
@@ -1256,8 +1253,6 @@ std::error_code WalletService::getUnconfirmedTransactionHashes(const std::vector
 /* blockCount = the blocks the wallet has synced. knownBlockCount = the top block the daemon knows of. localDaemonBlockCount = the blocks the daemon has synced. */
 std::error_code WalletService::getStatus(uint32_t& blockCount, uint32_t& knownBlockCount, uint64_t& localDaemonBlockCount, std::string& lastBlockHash, uint32_t& peerCount) {
   try {
-    System::EventLock lk(readyEvent);
-
     System::RemoteContext<std::tuple<uint32_t, uint64_t, uint32_t>> remoteContext(dispatcher, [this] () {
       /* Daemon remote height, daemon local height, peer count */
       return std::make_tuple(node.getKnownBlockCount(), node.getNodeHeight(), static_cast<uint32_t>(node.getPeerCount()));
@@ -1265,10 +1260,9 @@ std::error_code WalletService::getStatus(uint32_t& blockCount, uint32_t& knownBl
 
     std::tie(knownBlockCount, localDaemonBlockCount, peerCount) = remoteContext.get();
 
-    blockCount = wallet.getBlockCount();
-
-    auto lastHashes = wallet.getBlockHashes(blockCount - 1, 1);
-    lastBlockHash = Common::podToHex(lastHashes.back());
+    auto current = getSnapshot();
+    blockCount = current->blockCount;
+    lastBlockHash = current->lastBlockHash;
   } catch (std::system_error& x) {
     logger(Logging::WARNING, Logging::BRIGHT_YELLOW) << "Error while getting status: " << x.what();
     return x.code();
@@ -1383,6 +1377,8 @@ void WalletService::refresh() {
         size_t transactionId = event.transactionCreated.transactionIndex;
         transactionIdIndex.emplace(Common::podToHex(wallet.getTransaction(transactionId).hash), transactionId);
       }
+
+      scheduleSnapshotUpdate();
     }
   } catch (std::system_error& e) {
     logger(Logging::DEBUGGING) << "refresh is stopped: " << e.what();
@@ -1395,46 +1391,92 @@ void WalletService::reset(const uint64_t scanHeight) {
   wallet.reset(scanHeight);
 }
 
-std::vector<CryptoNote::TransactionsInBlockInfo> WalletService::getTransactions(const Crypto::Hash& blockHash, size_t blockCount) const {
-  std::vector<CryptoNote::TransactionsInBlockInfo> result = wallet.getTransactions(blockHash, blockCount);
-  if (result.empty()) {
-    throw std::system_error(make_error_code(CryptoNote::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
+void WalletService::updateSnapshot() {
+  auto snapshot = std::make_shared<WalletSnapshot>();
+
+  size_t addressCount = wallet.getAddressCount();
+  snapshot->addresses.reserve(addressCount);
+  snapshot->balances.reserve(addressCount);
+
+  for (size_t i = 0; i < addressCount; ++i) {
+    std::string address = wallet.getAddress(i);
+    snapshot->balances.emplace(address, WalletSnapshot::Balance{wallet.getActualBalance(address), wallet.getPendingBalance(address)});
+    snapshot->addresses.push_back(std::move(address));
   }
 
-  return result;
-}
+  snapshot->actualBalance = wallet.getActualBalance();
+  snapshot->pendingBalance = wallet.getPendingBalance();
 
-std::vector<CryptoNote::TransactionsInBlockInfo> WalletService::getTransactions(uint32_t firstBlockIndex, size_t blockCount) const {
-  std::vector<CryptoNote::TransactionsInBlockInfo> result = wallet.getTransactions(firstBlockIndex, blockCount);
-  if (result.empty()) {
-    throw std::system_error(make_error_code(CryptoNote::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
+  snapshot->blockCount = wallet.getBlockCount();
+  if (snapshot->blockCount != 0) {
+    snapshot->lastBlockHash = Common::podToHex(wallet.getBlockHashes(snapshot->blockCount - 1, 1).back());
   }
 
-  return result;
+  std::atomic_store(&currentSnapshot, std::shared_ptr<const WalletSnapshot>(std::move(snapshot)));
 }
 
-std::vector<TransactionHashesInBlockRpcInfo> WalletService::getRpcTransactionHashes(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<CryptoNote::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount);
-  std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
-  return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(filteredTransactions);
+void WalletService::scheduleSnapshotUpdate() {
+  if (snapshotUpdateScheduled) {
+    return;
+  }
+
+  // getEvent() only yields once no events are queued, so the update runs
+  // once for all of them rather than after each
+  snapshotUpdateScheduled = true;
+  refreshContext.spawn([this] {
+    snapshotUpdateScheduled = false;
+    try {
+      updateSnapshot();
+    } catch (std::exception& e) {
+      logger(Logging::DEBUGGING) << "snapshot update failed: " << e.what();
+    }
+  });
 }
 
-std::vector<TransactionHashesInBlockRpcInfo> WalletService::getRpcTransactionHashes(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<CryptoNote::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount);
-  std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
-  return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(filteredTransactions);
+std::shared_ptr<const WalletSnapshot> WalletService::getSnapshot() const {
+  return std::atomic_load(&currentSnapshot);
 }
 
-std::vector<TransactionsInBlockRpcInfo> WalletService::getRpcTransactions(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<CryptoNote::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount);
-  std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
-  return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(filteredTransactions);
+uint32_t WalletService::getBlockIndex(const std::string& blockHashString) const {
+  uint32_t blockIndex;
+  if (!wallet.getBlockIndex(parseHash(blockHashString, logger), blockIndex)) {
+    throw std::system_error(make_error_code(CryptoNote::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
+  }
+
+  return blockIndex;
 }
 
-std::vector<TransactionsInBlockRpcInfo> WalletService::getRpcTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<CryptoNote::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount);
-  std::vector<CryptoNote::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
-  return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(filteredTransactions);
+std::vector<CryptoNote::TransactionsInBlockInfo> WalletService::queryTransactions(const std::vector<std::string>& addresses, uint32_t firstBlockIndex,
+  uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit, std::string& nextCursor) const {
+
+  CryptoNote::TransactionsQuery query;
+  query.blockIndex = firstBlockIndex;
+  query.blockCount = blockCount;
+  query.addresses = addresses;
+  query.limit = limit;
+
+  if (!paymentId.empty()) {
+    query.paymentId = parsePaymentId(paymentId);
+    query.havePaymentId = true;
+  }
+
+  uint32_t endBlockIndex = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(firstBlockIndex) + blockCount, std::numeric_limits<uint32_t>::max()));
+  if (!cursor.empty()) {
+    parseTransactionsCursor(cursor, query.blockIndex, query.afterTransactionId, endBlockIndex, logger);
+    query.blockCount = endBlockIndex - query.blockIndex;
+  }
+
+  CryptoNote::TransactionsQueryResult result = wallet.queryTransactions(query);
+  if (result.blocks.empty() && cursor.empty() && query.blockIndex >= wallet.getBlockCount()) {
+    throw std::system_error(make_error_code(CryptoNote::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
+  }
+
+  nextCursor.clear();
+  if (result.truncated) {
+    nextCursor = formatTransactionsCursor(result.lastBlockIndex, result.lastTransactionId, endBlockIndex);
+  }
+
+  return std::move(result.blocks);
 }
 
 } //namespace PaymentService
@@ -18,6 +18,7 @@
 
 #include <fstream>
 #include <memory>
+#include <unordered_map>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/hashed_index.hpp>
@@ -40,7 +41,22 @@ struct WalletConfiguration {
 
 void generateNewWallet(const CryptoNote::Currency& currency, const WalletConfiguration& conf, Logging::ILogger& logger, System::Dispatcher& dispatcher);
 
-struct TransactionsInBlockInfoFilter;
+/* What the cheap queries need, rebuilt once the wallet events queued so far
+   are handled and swapped in whole so they can be answered while a send
+   holds readyEvent */
+struct WalletSnapshot {
+  struct Balance {
+    uint64_t actual;
+    uint64_t pending;
+  };
+
+  std::vector<std::string> addresses;
+  std::unordered_map<std::string, Balance> balances;
+  uint64_t actualBalance = 0;
+  uint64_t pendingBalance = 0;
+  uint32_t blockCount = 0;
+  std::string lastBlockHash;
+};
 
 class WalletService {
 public:
@@ -66,13 +82,17 @@ public:
   std::error_code getViewKey(std::string& viewSecretKey);
   std::error_code getMnemonicSeed(const std::string& address, std::string& mnemonicSeed);
   std::error_code getTransactionHashes(const std::vector<std::string>& addresses, const std::string& blockHash,
-    uint32_t blockCount, const std::string& paymentId, std::vector<TransactionHashesInBlockRpcInfo>& transactionHashes);
+    uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit,
+    std::vector<TransactionHashesInBlockRpcInfo>& transactionHashes, std::string& nextCursor);
   std::error_code getTransactionHashes(const std::vector<std::string>& addresses, uint32_t firstBlockIndex,
-    uint32_t blockCount, const std::string& paymentId, std::vector<TransactionHashesInBlockRpcInfo>& transactionHashes);
+    uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit,
+    std::vector<TransactionHashesInBlockRpcInfo>& transactionHashes, std::string& nextCursor);
   std::error_code getTransactions(const std::vector<std::string>& addresses, const std::string& blockHash,
-    uint32_t blockCount, const std::string& paymentId, std::vector<TransactionsInBlockRpcInfo>& transactionHashes);
+    uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit,
+    std::vector<TransactionsInBlockRpcInfo>& transactionHashes, std::string& nextCursor);
   std::error_code getTransactions(const std::vector<std::string>& addresses, uint32_t firstBlockIndex,
-    uint32_t blockCount, const std::string& paymentId, std::vector<TransactionsInBlockRpcInfo>& transactionHashes);
+    uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit,
+    std::vector<TransactionsInBlockRpcInfo>& transactionHashes, std::string& nextCursor);
   std::error_code getTransaction(const std::string& transactionHash, TransactionRpcInfo& transaction);
   std::error_code getAddresses(std::vector<std::string>& addresses);
   std::error_code sendTransaction(SendTransaction::Request& request, std::string& transactionHash);
@@ -96,16 +116,14 @@ private:
 
   void loadWallet();
   void loadTransactionIdIndex();
+  void updateSnapshot();
+  void scheduleSnapshotUpdate();
+  std::shared_ptr<const WalletSnapshot> getSnapshot() const;
   void getNodeFee();
 
-  std::vector<CryptoNote::TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t blockCount) const;
-  std::vector<CryptoNote::TransactionsInBlockInfo> getTransactions(uint32_t firstBlockIndex, size_t blockCount) const;
-
-  std::vector<TransactionHashesInBlockRpcInfo> getRpcTransactionHashes(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const;
-  std::vector<TransactionHashesInBlockRpcInfo> getRpcTransactionHashes(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const;
-
-  std::vector<TransactionsInBlockRpcInfo> getRpcTransactions(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const;
-  std::vector<TransactionsInBlockRpcInfo> getRpcTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const;
+  uint32_t getBlockIndex(const std::string& blockHashString) const;
+  std::vector<CryptoNote::TransactionsInBlockInfo> queryTransactions(const std::vector<std::string>& addresses, uint32_t firstBlockIndex,
+    uint32_t blockCount, const std::string& paymentId, const std::string& cursor, uint32_t limit, std::string& nextCursor) const;
 
   const CryptoNote::Currency& currency;
   CryptoNote::IWallet& wallet;
@@ -121,6 +139,8 @@ private:
   uint32_t m_node_fee;
 
   std::map<std::string, size_t> transactionIdIndex;
+  std::shared_ptr<const WalletSnapshot> currentSnapshot;
+  bool snapshotUpdateScheduled;
 };
 
 } //namespace PaymentService
@@ -30,6 +30,7 @@ enum class WalletServiceErrorCode {
   OBJECT_NOT_FOUND,
   DUPLICATE_KEY,
   KEYS_NOT_DETERMINISTIC,
+  WRONG_CURSOR_FORMAT,
 };
 
 // custom category:
@@ -55,6 +56,7 @@ public:
       case WalletServiceErrorCode::OBJECT_NOT_FOUND: return "Requested object not found";
       case WalletServiceErrorCode::DUPLICATE_KEY: return "Duplicate key";
       case WalletServiceErrorCode::KEYS_NOT_DETERMINISTIC: return "Keys not deterministic";
+      case WalletServiceErrorCode::WRONG_CURSOR_FORMAT: return "Wrong cursor format";
       default: return "Unknown error";
     }
   }
@@ -213,7 +213,11 @@ const uint8_t  BLOCK_MINOR_VERSION_1                         =  1;
 
 const size_t   BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT        =  10000;  //by default, blocks ids count in synchronizing
 const size_t   BLOCKS_SYNCHRONIZING_DEFAULT_COUNT            =  100;    //by default, blocks count in blocks downloading
+const size_t   BLOCKS_SYNCHRONIZING_MIN_COUNT                =  20;     //smallest batch requested from a slow peer
+const size_t   BLOCKS_SYNCHRONIZING_MAX_COUNT                =  500;    //largest batch requested from a fast peer
+const size_t   BLOCKS_SYNCHRONIZING_WINDOW_COUNT             =  2000;   //blocks downloaded ahead of the last added block
 const size_t   COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT         =  1000;
+const size_t   TRANSACTION_SIGNATURE_CACHE_SIZE              =  100000; //transactions remembered as correctly signed
 
 const int      P2P_DEFAULT_PORT                              =  11897;
 const int      RPC_DEFAULT_PORT                              =  11898;
@@ -0,0 +1,99 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crypto-ops.h"
+#include "crypto-ops-fe51.h"
+#include "initializer.h"
+
+#if CRYPTO_OPS_HAVE_FE51
+
+int crypto_ops_use_fe51 = 0;
+static int fe51_supported = 0;
+
+#if defined(__x86_64__)
+static void crypto_ops_cpuid(uint32_t info[4], uint32_t leaf)
+{
+  __asm__ __volatile__("cpuid" : "=a" (info[0]), "=b" (info[1]), "=c" (info[2]), "=d" (info[3]) : "a" (leaf), "c" (0));
+}
+
+/**
+ * @brief the backend is built with -mavx2 -mbmi2, so the CPU has to support
+ * both and the OS has to preserve the ymm registers
+ */
+static int check_fe51_hw(void)
+{
+  uint32_t info[4];
+  uint32_t xcr0_lo, xcr0_hi;
+
+  crypto_ops_cpuid(info, 0);
+  if (info[0] < 7)
+    return 0;
+
+  crypto_ops_cpuid(info, 1);
+  if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)))
+    return 0;
+
+  __asm__ __volatile__("xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+  if ((xcr0_lo & 6) != 6)
+    return 0;
+
+  crypto_ops_cpuid(info, 7);
+  return (info[1] & (1 << 5)) && (info[1] & (1 << 8));
+}
+#else
+static int check_fe51_hw(void)
+{
+  return 1;
+}
+#endif
+
+static int force_ref10(void)
+{
+  const char *env = getenv("TURTLECOIN_USE_REF10");
+  return env && strcmp(env, "0") && strcmp(env, "no");
+}
+
+INITIALIZER(crypto_ops_select_backend)
+{
+  if (check_fe51_hw())
+  {
+    ge51_init();
+    fe51_supported = 1;
+    crypto_ops_use_fe51 = !force_ref10();
+  }
+}
+
+#endif
+
+int crypto_ops_get_backend(void)
+{
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51)
+    return CRYPTO_OPS_BACKEND_FE51;
+#endif
+  return CRYPTO_OPS_BACKEND_REF10;
+}
+
+int crypto_ops_set_backend(int backend)
+{
+  if (backend == CRYPTO_OPS_BACKEND_REF10)
+  {
+#if CRYPTO_OPS_HAVE_FE51
+    crypto_ops_use_fe51 = 0;
+#endif
+    return 0;
+  }
+#if CRYPTO_OPS_HAVE_FE51
+  if (backend == CRYPTO_OPS_BACKEND_FE51 && fe51_supported)
+  {
+    crypto_ops_use_fe51 = 1;
+    return 0;
+  }
+#endif
+  return -1;
+}
@@ -0,0 +1,1072 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "crypto-ops.h"
+#include "crypto-ops-fe51.h"
+
+#if CRYPTO_OPS_HAVE_FE51
+
+/* Field elements are five unsigned 51 bit limbs held in 64 bit words.
+   Every operation below leaves its result carried, i.e. each limb is
+   below 2^51 + 2^18, which keeps every product below 2^113. */
+
+typedef unsigned __int128 uint128_t;
+typedef uint64_t fe51[5];
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+} ge51_p2;
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+  fe51 T;
+} ge51_p3;
+
+typedef struct {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+  fe51 T;
+} ge51_p1p1;
+
+typedef struct {
+  fe51 yplusx;
+  fe51 yminusx;
+  fe51 xy2d;
+} ge51_precomp;
+
+typedef struct {
+  fe51 YplusX;
+  fe51 YminusX;
+  fe51 Z;
+  fe51 T2d;
+} ge51_cached;
+
+#define FE51_MASK 0x7ffffffffffffULL
+
+static ge51_precomp ge51_base[32][8];
+static ge51_precomp ge51_Bi[8];
+static fe51 fe51_d;
+static fe51 fe51_d2;
+static fe51 fe51_sqrtm1;
+static fe51 fe51_ma2;
+static fe51 fe51_ma;
+static fe51 fe51_fffb1;
+static fe51 fe51_fffb2;
+static fe51 fe51_fffb3;
+static fe51 fe51_fffb4;
+
+/* Field arithmetic */
+
+static uint64_t load_8(const unsigned char *in) {
+  uint64_t result = 0;
+  int i;
+  for (i = 7; i >= 0; --i) {
+    result = (result << 8) | in[i];
+  }
+  return result;
+}
+
+static void store_8(unsigned char *out, uint64_t in) {
+  int i;
+  for (i = 0; i < 8; ++i) {
+    out[i] = (unsigned char) in;
+    in >>= 8;
+  }
+}
+
+static void fe51_0(fe51 h) {
+  h[0] = 0;
+  h[1] = 0;
+  h[2] = 0;
+  h[3] = 0;
+  h[4] = 0;
+}
+
+static void fe51_1(fe51 h) {
+  h[0] = 1;
+  h[1] = 0;
+  h[2] = 0;
+  h[3] = 0;
+  h[4] = 0;
+}
+
+static void fe51_copy(fe51 h, const fe51 f) {
+  h[0] = f[0];
+  h[1] = f[1];
+  h[2] = f[2];
+  h[3] = f[3];
+  h[4] = f[4];
+}
+
+static void fe51_carry(fe51 h) {
+  uint64_t c;
+  c = h[0] >> 51; h[0] &= FE51_MASK; h[1] += c;
+  c = h[1] >> 51; h[1] &= FE51_MASK; h[2] += c;
+  c = h[2] >> 51; h[2] &= FE51_MASK; h[3] += c;
+  c = h[3] >> 51; h[3] &= FE51_MASK; h[4] += c;
+  c = h[4] >> 51; h[4] &= FE51_MASK; h[0] += c * 19;
+}
+
+static void fe51_add(fe51 h, const fe51 f, const fe51 g) {
+  h[0] = f[0] + g[0];
+  h[1] = f[1] + g[1];
+  h[2] = f[2] + g[2];
+  h[3] = f[3] + g[3];
+  h[4] = f[4] + g[4];
+  fe51_carry(h);
+}
+
+/* 4 * p is added first so that no limb can underflow */
+static void fe51_sub(fe51 h, const fe51 f, const fe51 g) {
+  h[0] = (f[0] + 0x1fffffffffffb4ULL) - g[0];
+  h[1] = (f[1] + 0x1ffffffffffffcULL) - g[1];
+  h[2] = (f[2] + 0x1ffffffffffffcULL) - g[2];
+  h[3] = (f[3] + 0x1ffffffffffffcULL) - g[3];
+  h[4] = (f[4] + 0x1ffffffffffffcULL) - g[4];
+  fe51_carry(h);
+}
+
+static void fe51_neg(fe51 h, const fe51 f) {
+  fe51 zero;
+  fe51_0(zero);
+  fe51_sub(h, zero, f);
+}
+
+static void fe51_cmov(fe51 f, const fe51 g, unsigned int b) {
+  uint64_t mask = (uint64_t) 0 - (uint64_t) b;
+  f[0] ^= mask & (f[0] ^ g[0]);
+  f[1] ^= mask & (f[1] ^ g[1]);
+  f[2] ^= mask & (f[2] ^ g[2]);
+  f[3] ^= mask & (f[3] ^ g[3]);
+  f[4] ^= mask & (f[4] ^ g[4]);
+}
+
+static void fe51_reduce(fe51 h, uint128_t r0, uint128_t r1, uint128_t r2, uint128_t r3, uint128_t r4) {
+  uint64_t c;
+  r1 += (uint64_t) (r0 >> 51); h[0] = (uint64_t) r0 & FE51_MASK;
+  r2 += (uint64_t) (r1 >> 51); h[1] = (uint64_t) r1 & FE51_MASK;
+  r3 += (uint64_t) (r2 >> 51); h[2] = (uint64_t) r2 & FE51_MASK;
+  r4 += (uint64_t) (r3 >> 51); h[3] = (uint64_t) r3 & FE51_MASK;
+  c = (uint64_t) (r4 >> 51); h[4] = (uint64_t) r4 & FE51_MASK;
+  h[0] += c * 19;
+  h[1] += h[0] >> 51;
+  h[0] &= FE51_MASK;
+}
+
+/*
+h = f * g
+Can overlap h with f or g.
+*/
+
+static void fe51_mul(fe51 h, const fe51 f, const fe51 g) {
+  uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  uint64_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+  uint64_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+  uint128_t r0, r1, r2, r3, r4;
+
+  r0 = (uint128_t) f0 * g0 + (uint128_t) f1 * g4_19 + (uint128_t) f2 * g3_19 + (uint128_t) f3 * g2_19 + (uint128_t) f4 * g1_19;
+  r1 = (uint128_t) f0 * g1 + (uint128_t) f1 * g0 + (uint128_t) f2 * g4_19 + (uint128_t) f3 * g3_19 + (uint128_t) f4 * g2_19;
+  r2 = (uint128_t) f0 * g2 + (uint128_t) f1 * g1 + (uint128_t) f2 * g0 + (uint128_t) f3 * g4_19 + (uint128_t) f4 * g3_19;
+  r3 = (uint128_t) f0 * g3 + (uint128_t) f1 * g2 + (uint128_t) f2 * g1 + (uint128_t) f3 * g0 + (uint128_t) f4 * g4_19;
+  r4 = (uint128_t) f0 * g4 + (uint128_t) f1 * g3 + (uint128_t) f2 * g2 + (uint128_t) f3 * g1 + (uint128_t) f4 * g0;
+
+  fe51_reduce(h, r0, r1, r2, r3, r4);
+}
+
+/*
+h = f * f
+Can overlap h with f.
+*/
+
+static void fe51_sq(fe51 h, const fe51 f) {
+  uint64_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+  uint64_t f0_2 = 2 * f0, f1_2 = 2 * f1, f2_38 = 38 * f2, f3_19 = 19 * f3, f4_19 = 19 * f4, f4_38 = 38 * f4;
+  uint128_t r0, r1, r2, r3, r4;
+
+  r0 = (uint128_t) f0 * f0 + (uint128_t) f4_38 * f1 + (uint128_t) f2_38 * f3;
+  r1 = (uint128_t) f0_2 * f1 + (uint128_t) f4_38 * f2 + (uint128_t) f3_19 * f3;
+  r2 = (uint128_t) f0_2 * f2 + (uint128_t) f1 * f1 + (uint128_t) f4_38 * f3;
+  r3 = (uint128_t) f0_2 * f3 + (uint128_t) f1_2 * f2 + (uint128_t) f4_19 * f4;
+  r4 = (uint128_t) f0_2 * f4 + (uint128_t) f1_2 * f3 + (uint128_t) f2 * f2;
+
+  fe51_reduce(h, r0, r1, r2, r3, r4);
+}
+
+/*
+h = 2 * f * f
+Can overlap h with f.
+*/
+
+static void fe51_sq2(fe51 h, const fe51 f) {
+  fe51_sq(h, f);
+  h[0] <<= 1;
+  h[1] <<= 1;
+  h[2] <<= 1;
+  h[3] <<= 1;
+  h[4] <<= 1;
+  fe51_carry(h);
+}
+
+static void fe51_sqn(fe51 h, const fe51 f, int n) {
+  fe51_sq(h, f);
+  while (--n > 0) {
+    fe51_sq(h, h);
+  }
+}
+
+/* Same addition chain as ref10 fe_invert: z^(p - 2) */
+static void fe51_invert(fe51 out, const fe51 z) {
+  fe51 t0, t1, t2, t3;
+
+  fe51_sq(t0, z);
+  fe51_sqn(t1, t0, 2);
+  fe51_mul(t1, z, t1);
+  fe51_mul(t0, t0, t1);
+  fe51_sq(t2, t0);
+  fe51_mul(t1, t1, t2);
+  fe51_sqn(t2, t1, 5);
+  fe51_mul(t1, t2, t1);
+  fe51_sqn(t2, t1, 10);
+  fe51_mul(t2, t2, t1);
+  fe51_sqn(t3, t2, 20);
+  fe51_mul(t2, t3, t2);
+  fe51_sqn(t2, t2, 10);
+  fe51_mul(t1, t2, t1);
+  fe51_sqn(t2, t1, 50);
+  fe51_mul(t2, t2, t1);
+  fe51_sqn(t3, t2, 100);
+  fe51_mul(t2, t3, t2);
+  fe51_sqn(t2, t2, 50);
+  fe51_mul(t1, t2, t1);
+  fe51_sqn(t1, t1, 5);
+  fe51_mul(out, t1, t0);
+}
+
+/* r = uv^3(uv^7)^((q-5)/8), see fe_divpowm1 */
+static void fe51_divpowm1(fe51 r, const fe51 u, const fe51 v) {
+  fe51 v3, uv7, t0, t1, t2;
+
+  fe51_sq(v3, v);
+  fe51_mul(v3, v3, v); /* v3 = v^3 */
+  fe51_sq(uv7, v3);
+  fe51_mul(uv7, uv7, v);
+  fe51_mul(uv7, uv7, u); /* uv7 = uv^7 */
+
+  /* pow22523 */
+  fe51_sq(t0, uv7);
+  fe51_sqn(t1, t0, 2);
+  fe51_mul(t1, uv7, t1);
+  fe51_mul(t0, t0, t1);
+  fe51_sq(t0, t0);
+  fe51_mul(t0, t1, t0);
+  fe51_sqn(t1, t0, 5);
+  fe51_mul(t0, t1, t0);
+  fe51_sqn(t1, t0, 10);
+  fe51_mul(t1, t1, t0);
+  fe51_sqn(t2, t1, 20);
+  fe51_mul(t1, t2, t1);
+  fe51_sqn(t1, t1, 10);
+  fe51_mul(t0, t1, t0);
+  fe51_sqn(t1, t0, 50);
+  fe51_mul(t1, t1, t0);
+  fe51_sqn(t2, t1, 100);
+  fe51_mul(t1, t2, t1);
+  fe51_sqn(t1, t1, 50);
+  fe51_mul(t0, t1, t0);
+  fe51_sqn(t0, t0, 2);
+  fe51_mul(t0, t0, uv7);
+
+  /* t0 = (uv^7)^((q-5)/8) */
+  fe51_mul(t0, t0, v3);
+  fe51_mul(r, t0, u); /* u^(m+1)v^(-(m+1)) */
+}
+
+/* Fully reduces f into [0, p) */
+static void fe51_contract(uint64_t t[5], const fe51 f) {
+  uint64_t c;
+
+  t[0] = f[0];
+  t[1] = f[1];
+  t[2] = f[2];
+  t[3] = f[3];
+  t[4] = f[4];
+  fe51_carry(t);
+  fe51_carry(t);
+
+  /* now t is between 0 and 2^255-1, properly carried */
+  t[0] += 19;
+  fe51_carry(t);
+
+  /* now between 19 and 2^255-1 in both cases, and offset by 19 */
+  t[0] += 0x8000000000000ULL - 19;
+  t[1] += 0x8000000000000ULL - 1;
+  t[2] += 0x8000000000000ULL - 1;
+  t[3] += 0x8000000000000ULL - 1;
+  t[4] += 0x8000000000000ULL - 1;
+
+  /* now between 2^255 and 2^256-20, and offset by 2^255 */
+  c = t[0] >> 51; t[0] &= FE51_MASK; t[1] += c;
+  c = t[1] >> 51; t[1] &= FE51_MASK; t[2] += c;
+  c = t[2] >> 51; t[2] &= FE51_MASK; t[3] += c;
+  c = t[3] >> 51; t[3] &= FE51_MASK; t[4] += c;
+  t[4] &= FE51_MASK;
+}
+
+static void fe51_tobytes(unsigned char *s, const fe51 f) {
+  uint64_t t[5];
+  fe51_contract(t, f);
+  store_8(s, t[0] | (t[1] << 51));
+  store_8(s + 8, (t[1] >> 13) | (t[2] << 38));
+  store_8(s + 16, (t[2] >> 26) | (t[3] << 25));
+  store_8(s + 24, (t[3] >> 39) | (t[4] << 12));
+}
+
+/* Ignores the top bit, like fe_frombytes */
+static void fe51_frombytes(fe51 h, const unsigned char *s) {
+  uint64_t x0 = load_8(s), x1 = load_8(s + 8), x2 = load_8(s + 16), x3 = load_8(s + 24);
+  h[0] = x0 & FE51_MASK;
+  h[1] = ((x0 >> 51) | (x1 << 13)) & FE51_MASK;
+  h[2] = ((x1 >> 38) | (x2 << 26)) & FE51_MASK;
+  h[3] = ((x2 >> 25) | (x3 << 39)) & FE51_MASK;
+  h[4] = (x3 >> 12) & FE51_MASK;
+}
+
+/* Keeps the top bit, as the inlined fe_frombytes in ge_fromfe_frombytes_vartime does */
+static void fe51_frombytes_full(fe51 h, const unsigned char *s) {
+  uint64_t x0 = load_8(s), x1 = load_8(s + 8), x2 = load_8(s + 16), x3 = load_8(s + 24);
+  h[0] = x0 & FE51_MASK;
+  h[1] = ((x0 >> 51) | (x1 << 13)) & FE51_MASK;
+  h[2] = ((x1 >> 38) | (x2 << 26)) & FE51_MASK;
+  h[3] = ((x2 >> 25) | (x3 << 39)) & FE51_MASK;
+  h[4] = x3 >> 12;
+  fe51_carry(h);
+}
+
+static int fe51_isnegative(const fe51 f) {
+  uint64_t t[5];
+  fe51_contract(t, f);
+  return (int) (t[0] & 1);
+}
+
+static int fe51_isnonzero(const fe51 f) {
+  uint64_t t[5];
+  fe51_contract(t, f);
+  return (t[0] | t[1] | t[2] | t[3] | t[4]) != 0;
+}
+
+/* Conversion from and to the ref10 representation. The 25.5 bit limbs of
+   ref10 pair up exactly with the 51 bit limbs used here. */
+
+static void fe51_from_fe(fe51 h, const fe f) {
+  int i;
+  for (i = 0; i < 5; ++i) {
+    /* |f[2i] + 2^26 f[2i+1]| < 2^53, so adding 8 * p keeps every limb positive */
+    int64_t t = (int64_t) f[2 * i] + (int64_t) f[2 * i + 1] * ((int64_t) 1 << 26);
+    h[i] = (uint64_t) (t + (i == 0 ? 0x3fffffffffff68LL : 0x3ffffffffffff8LL));
+  }
+  fe51_carry(h);
+}
+
+/* The output is balanced the same way fe_frombytes does it, ref10 relies on
+   those limb bounds */
+static void fe51_to_fe(fe h, const fe51 f) {
+  uint64_t t[5];
+  int64_t h0, h1, h2, h3, h4, h5, h6, h7, h8, h9;
+  int64_t carry0, carry1, carry2, carry3, carry4, carry5, carry6, carry7, carry8, carry9;
+
+  fe51_contract(t, f);
+  h0 = (int64_t) (t[0] & 0x3ffffff); h1 = (int64_t) (t[0] >> 26);
+  h2 = (int64_t) (t[1] & 0x3ffffff); h3 = (int64_t) (t[1] >> 26);
+  h4 = (int64_t) (t[2] & 0x3ffffff); h5 = (int64_t) (t[2] >> 26);
+  h6 = (int64_t) (t[3] & 0x3ffffff); h7 = (int64_t) (t[3] >> 26);
+  h8 = (int64_t) (t[4] & 0x3ffffff); h9 = (int64_t) (t[4] >> 26);
+
+  carry9 = (h9 + (int64_t) (1<<24)) >> 25; h0 += carry9 * 19; h9 -= carry9 << 25;
+  carry1 = (h1 + (int64_t) (1<<24)) >> 25; h2 += carry1; h1 -= carry1 << 25;
+  carry3 = (h3 + (int64_t) (1<<24)) >> 25; h4 += carry3; h3 -= carry3 << 25;
+  carry5 = (h5 + (int64_t) (1<<24)) >> 25; h6 += carry5; h5 -= carry5 << 25;
+  carry7 = (h7 + (int64_t) (1<<24)) >> 25; h8 += carry7; h7 -= carry7 << 25;
+
+  carry0 = (h0 + (int64_t) (1<<25)) >> 26; h1 += carry0; h0 -= carry0 << 26;
+  carry2 = (h2 + (int64_t) (1<<25)) >> 26; h3 += carry2; h2 -= carry2 << 26;
+  carry4 = (h4 + (int64_t) (1<<25)) >> 26; h5 += carry4; h4 -= carry4 << 26;
+  carry6 = (h6 + (int64_t) (1<<25)) >> 26; h7 += carry6; h6 -= carry6 << 26;
+  carry8 = (h8 + (int64_t) (1<<25)) >> 26; h9 += carry8; h8 -= carry8 << 26;
+
+  h[0] = (int32_t) h0;
+  h[1] = (int32_t) h1;
+  h[2] = (int32_t) h2;
+  h[3] = (int32_t) h3;
+  h[4] = (int32_t) h4;
+  h[5] = (int32_t) h5;
+  h[6] = (int32_t) h6;
+  h[7] = (int32_t) h7;
+  h[8] = (int32_t) h8;
+  h[9] = (int32_t) h9;
+}
+
+/* Group arithmetic, see the ref10 functions of the same name */
+
+static void ge51_from_p2(ge51_p2 *r, const ge_p2 *p) {
+  fe51_from_fe(r->X, p->X);
+  fe51_from_fe(r->Y, p->Y);
+  fe51_from_fe(r->Z, p->Z);
+}
+
+static void ge51_from_p3(ge51_p3 *r, const ge_p3 *p) {
+  fe51_from_fe(r->X, p->X);
+  fe51_from_fe(r->Y, p->Y);
+  fe51_from_fe(r->Z, p->Z);
+  fe51_from_fe(r->T, p->T);
+}
+
+static void ge51_from_cached(ge51_cached *r, const ge_cached *p) {
+  fe51_from_fe(r->YplusX, p->YplusX);
+  fe51_from_fe(r->YminusX, p->YminusX);
+  fe51_from_fe(r->Z, p->Z);
+  fe51_from_fe(r->T2d, p->T2d);
+}
+
+static void ge51_from_precomp(ge51_precomp *r, const ge_precomp *p) {
+  fe51_from_fe(r->yplusx, p->yplusx);
+  fe51_from_fe(r->yminusx, p->yminusx);
+  fe51_from_fe(r->xy2d, p->xy2d);
+}
+
+static void ge51_to_p2(ge_p2 *r, const ge51_p2 *p) {
+  fe51_to_fe(r->X, p->X);
+  fe51_to_fe(r->Y, p->Y);
+  fe51_to_fe(r->Z, p->Z);
+}
+
+static void ge51_to_p3(ge_p3 *r, const ge51_p3 *p) {
+  fe51_to_fe(r->X, p->X);
+  fe51_to_fe(r->Y, p->Y);
+  fe51_to_fe(r->Z, p->Z);
+  fe51_to_fe(r->T, p->T);
+}
+
+static void ge51_p2_0(ge51_p2 *h) {
+  fe51_0(h->X);
+  fe51_1(h->Y);
+  fe51_1(h->Z);
+}
+
+static void ge51_p3_0(ge51_p3 *h) {
+  fe51_0(h->X);
+  fe51_1(h->Y);
+  fe51_1(h->Z);
+  fe51_0(h->T);
+}
+
+static void ge51_add(ge51_p1p1 *r, const ge51_p3 *p, const ge51_cached *q) {
+  fe51 t0;
+  fe51_add(r->X, p->Y, p->X);
+  fe51_sub(r->Y, p->Y, p->X);
+  fe51_mul(r->Z, r->X, q->YplusX);
+  fe51_mul(r->Y, r->Y, q->YminusX);
+  fe51_mul(r->T, q->T2d, p->T);
+  fe51_mul(r->X, p->Z, q->Z);
+  fe51_add(t0, r->X, r->X);
+  fe51_sub(r->X, r->Z, r->Y);
+  fe51_add(r->Y, r->Z, r->Y);
+  fe51_add(r->Z, t0, r->T);
+  fe51_sub(r->T, t0, r->T);
+}
+
+static void ge51_sub(ge51_p1p1 *r, const ge51_p3 *p, const ge51_cached *q) {
+  fe51 t0;
+  fe51_add(r->X, p->Y, p->X);
+  fe51_sub(r->Y, p->Y, p->X);
+  fe51_mul(r->Z, r->X, q->YminusX);
+  fe51_mul(r->Y, r->Y, q->YplusX);
+  fe51_mul(r->T, q->T2d, p->T);
+  fe51_mul(r->X, p->Z, q->Z);
+  fe51_add(t0, r->X, r->X);
+  fe51_sub(r->X, r->Z, r->Y);
+  fe51_add(r->Y, r->Z, r->Y);
+  fe51_sub(r->Z, t0, r->T);
+  fe51_add(r->T, t0, r->T);
+}
+
+static void ge51_madd(ge51_p1p1 *r, const ge51_p3 *p, const ge51_precomp *q) {
+  fe51 t0;
+  fe51_add(r->X, p->Y, p->X);
+  fe51_sub(r->Y, p->Y, p->X);
+  fe51_mul(r->Z, r->X, q->yplusx);
+  fe51_mul(r->Y, r->Y, q->yminusx);
+  fe51_mul(r->T, q->xy2d, p->T);
+  fe51_add(t0, p->Z, p->Z);
+  fe51_sub(r->X, r->Z, r->Y);
+  fe51_add(r->Y, r->Z, r->Y);
+  fe51_add(r->Z, t0, r->T);
+  fe51_sub(r->T, t0, r->T);
+}
+
+static void ge51_msub(ge51_p1p1 *r, const ge51_p3 *p, const ge51_precomp *q) {
+  fe51 t0;
+  fe51_add(r->X, p->Y, p->X);
+  fe51_sub(r->Y, p->Y, p->X);
+  fe51_mul(r->Z, r->X, q->yminusx);
+  fe51_mul(r->Y, r->Y, q->yplusx);
+  fe51_mul(r->T, q->xy2d, p->T);
+  fe51_add(t0, p->Z, p->Z);
+  fe51_sub(r->X, r->Z, r->Y);
+  fe51_add(r->Y, r->Z, r->Y);
+  fe51_sub(r->Z, t0, r->T);
+  fe51_add(r->T, t0, r->T);
+}
+
+static void ge51_p1p1_to_p2(ge51_p2 *r, const ge51_p1p1 *p) {
+  fe51_mul(r->X, p->X, p->T);
+  fe51_mul(r->Y, p->Y, p->Z);
+  fe51_mul(r->Z, p->Z, p->T);
+}
+
+static void ge51_p1p1_to_p3(ge51_p3 *r, const ge51_p1p1 *p) {
+  fe51_mul(r->X, p->X, p->T);
+  fe51_mul(r->Y, p->Y, p->Z);
+  fe51_mul(r->Z, p->Z, p->T);
+  fe51_mul(r->T, p->X, p->Y);
+}
+
+static void ge51_p2_dbl(ge51_p1p1 *r, const ge51_p2 *p) {
+  fe51 t0;
+  fe51_sq(r->X, p->X);
+  fe51_sq(r->Z, p->Y);
+  fe51_sq2(r->T, p->Z);
+  fe51_add(r->Y, p->X, p->Y);
+  fe51_sq(t0, r->Y);
+  fe51_add(r->Y, r->Z, r->X);
+  fe51_sub(r->Z, r->Z, r->X);
+  fe51_sub(r->X, t0, r->Y);
+  fe51_sub(r->T, r->T, r->Z);
+}
+
+static void ge51_p3_to_p2(ge51_p2 *r, const ge51_p3 *p) {
+  fe51_copy(r->X, p->X);
+  fe51_copy(r->Y, p->Y);
+  fe51_copy(r->Z, p->Z);
+}
+
+static void ge51_p3_dbl(ge51_p1p1 *r, const ge51_p3 *p) {
+  ge51_p2 q;
+  ge51_p3_to_p2(&q, p);
+  ge51_p2_dbl(r, &q);
+}
+
+static void ge51_p3_to_cached(ge51_cached *r, const ge51_p3 *p) {
+  fe51_add(r->YplusX, p->Y, p->X);
+  fe51_sub(r->YminusX, p->Y, p->X);
+  fe51_copy(r->Z, p->Z);
+  fe51_mul(r->T2d, p->T, fe51_d2);
+}
+
+static void ge51_dsm_precomp(ge51_cached r[8], const ge51_p3 *s) {
+  ge51_p1p1 t;
+  ge51_p3 s2, u;
+  int i;
+  ge51_p3_to_cached(&r[0], s);
+  ge51_p3_dbl(&t, s); ge51_p1p1_to_p3(&s2, &t);
+  for (i = 0; i < 7; ++i) {
+    ge51_add(&t, &s2, &r[i]); ge51_p1p1_to_p3(&u, &t); ge51_p3_to_cached(&r[i + 1], &u);
+  }
+}
+
+static unsigned char equal(signed char b, signed char c) {
+  unsigned char ub = b;
+  unsigned char uc = c;
+  unsigned char x = ub ^ uc; /* 0: yes; 1..255: no */
+  uint32_t y = x; /* 0: yes; 1..255: no */
+  y -= 1; /* 4294967295: yes; 0..254: no */
+  y >>= 31; /* 1: yes; 0: no */
+  return y;
+}
+
+static unsigned char negative(signed char b) {
+  unsigned long long x = b; /* 18446744073709551361..18446744073709551615: yes; 0..255: no */
+  x >>= 63; /* 1: yes; 0: no */
+  return (unsigned char) x;
+}
+
+static void ge51_precomp_cmov(ge51_precomp *t, const ge51_precomp *u, unsigned char b) {
+  fe51_cmov(t->yplusx, u->yplusx, b);
+  fe51_cmov(t->yminusx, u->yminusx, b);
+  fe51_cmov(t->xy2d, u->xy2d, b);
+}
+
+static void ge51_cached_cmov(ge51_cached *t, const ge51_cached *u, unsigned char b) {
+  fe51_cmov(t->YplusX, u->YplusX, b);
+  fe51_cmov(t->YminusX, u->YminusX, b);
+  fe51_cmov(t->Z, u->Z, b);
+  fe51_cmov(t->T2d, u->T2d, b);
+}
+
+static void ge51_select(ge51_precomp *t, int pos, signed char b) {
+  ge51_precomp minust;
+  unsigned char bnegative = negative(b);
+  unsigned char babs = b - (((-bnegative) & b) << 1);
+  int i;
+
+  fe51_1(t->yplusx);
+  fe51_1(t->yminusx);
+  fe51_0(t->xy2d);
+  for (i = 0; i < 8; ++i) {
+    ge51_precomp_cmov(t, &ge51_base[pos][i], equal(babs, i + 1));
+  }
+  fe51_copy(minust.yplusx, t->yminusx);
+  fe51_copy(minust.yminusx, t->yplusx);
+  fe51_neg(minust.xy2d, t->xy2d);
+  ge51_precomp_cmov(t, &minust, bnegative);
+}
+
+static void slide(signed char *r, const unsigned char *a) {
+  int i;
+  int b;
+  int k;
+
+  for (i = 0; i < 256; ++i) {
+    r[i] = 1 & (a[i >> 3] >> (i & 7));
+  }
+
+  for (i = 0; i < 256; ++i) {
+    if (r[i]) {
+      for (b = 1; b <= 6 && i + b < 256; ++b) {
+        if (r[i + b]) {
+          if (r[i] + (r[i + b] << b) <= 15) {
+            r[i] += r[i + b] << b; r[i + b] = 0;
+          } else if (r[i] - (r[i + b] << b) >= -15) {
+            r[i] -= r[i + b] << b;
+            for (k = i + b; k < 256; ++k) {
+              if (!r[k]) {
+                r[k] = 1;
+                break;
+              }
+              r[k] = 0;
+            }
+          } else
+            break;
+        }
+      }
+    }
+  }
+}
+
+/* Entry points */
+
+void ge51_init(void) {
+  int i, j;
+  for (i = 0; i < 32; ++i) {
+    for (j = 0; j < 8; ++j) {
+      ge51_from_precomp(&ge51_base[i][j], &ge_base[i][j]);
+    }
+  }
+  for (i = 0; i < 8; ++i) {
+    ge51_from_precomp(&ge51_Bi[i], &ge_Bi[i]);
+  }
+  fe51_from_fe(fe51_d, fe_d);
+  fe51_from_fe(fe51_d2, fe_d2);
+  fe51_from_fe(fe51_sqrtm1, fe_sqrtm1);
+  fe51_from_fe(fe51_ma2, fe_ma2);
+  fe51_from_fe(fe51_ma, fe_ma);
+  fe51_from_fe(fe51_fffb1, fe_fffb1);
+  fe51_from_fe(fe51_fffb2, fe_fffb2);
+  fe51_from_fe(fe51_fffb3, fe_fffb3);
+  fe51_from_fe(fe51_fffb4, fe_fffb4);
+}
+
+int ge51_frombytes_vartime(ge_p3 *h, const unsigned char *s) {
+  ge51_p3 r;
+  fe51 u;
+  fe51 v;
+  fe51 vxx;
+  fe51 check;
+  int i;
+
+  /* Validate the number to be canonical, i.e. reject 2^255 - 19 <= y < 2^255 */
+  if ((s[31] & 0x7f) == 0x7f && s[0] >= 0xed) {
+    for (i = 30; i > 0 && s[i] == 0xff; --i) {
+    }
+    if (i == 0) {
+      return -1;
+    }
+  }
+
+  fe51_frombytes(r.Y, s);
+  fe51_1(r.Z);
+  fe51_sq(u, r.Y);
+  fe51_mul(v, u, fe51_d);
+  fe51_sub(u, u, r.Z);       /* u = y^2-1 */
+  fe51_add(v, v, r.Z);       /* v = dy^2+1 */
+
+  fe51_divpowm1(r.X, u, v); /* x = uv^3(uv^7)^((q-5)/8) */
+
+  fe51_sq(vxx, r.X);
+  fe51_mul(vxx, vxx, v);
+  fe51_sub(check, vxx, u);    /* vx^2-u */
+  if (fe51_isnonzero(check)) {
+    fe51_add(check, vxx, u);  /* vx^2+u */
+    if (fe51_isnonzero(check)) {
+      return -1;
+    }
+    fe51_mul(r.X, r.X, fe51_sqrtm1);
+  }
+
+  if (fe51_isnegative(r.X) != (s[31] >> 7)) {
+    /* If x = 0, the sign must be positive */
+    if (!fe51_isnonzero(r.X)) {
+      return -1;
+    }
+    fe51_neg(r.X, r.X);
+  }
+
+  fe51_mul(r.T, r.X, r.Y);
+  ge51_to_p3(h, &r);
+  return 0;
+}
+
+void ge51_fromfe_frombytes_vartime(ge_p2 *out, const unsigned char *s) {
+  ge51_p2 r;
+  fe51 u, v, w, x, y, z;
+  unsigned char sign;
+
+  fe51_frombytes_full(u, s);
+
+  fe51_sq2(v, u); /* 2 * u^2 */
+  fe51_1(w);
+  fe51_add(w, v, w); /* w = 2 * u^2 + 1 */
+  fe51_sq(x, w); /* w^2 */
+  fe51_mul(y, fe51_ma2, v); /* -2 * A^2 * u^2 */
+  fe51_add(x, x, y); /* x = w^2 - 2 * A^2 * u^2 */
+  fe51_divpowm1(r.X, w, x); /* (w / x)^(m + 1) */
+  fe51_sq(y, r.X);
+  fe51_mul(x, y, x);
+  fe51_sub(y, w, x);
+  fe51_copy(z, fe51_ma);
+  if (fe51_isnonzero(y)) {
+    fe51_add(y, w, x);
+    if (fe51_isnonzero(y)) {
+      goto negative;
+    } else {
+      fe51_mul(r.X, r.X, fe51_fffb1);
+    }
+  } else {
+    fe51_mul(r.X, r.X, fe51_fffb2);
+  }
+  fe51_mul(r.X, r.X, u); /* u * sqrt(2 * A * (A + 2) * w / x) */
+  fe51_mul(z, z, v); /* -2 * A * u^2 */
+  sign = 0;
+  goto setsign;
+negative:
+  fe51_mul(x, x, fe51_sqrtm1);
+  fe51_sub(y, w, x);
+  if (fe51_isnonzero(y)) {
+    assert((fe51_add(y, w, x), !fe51_isnonzero(y)));
+    fe51_mul(r.X, r.X, fe51_fffb3);
+  } else {
+    fe51_mul(r.X, r.X, fe51_fffb4);
+  }
+  /* r.X = sqrt(A * (A + 2) * w / x) */
+  /* z = -A */
+  sign = 1;
+setsign:
+  if (fe51_isnegative(r.X) != sign) {
+    assert(fe51_isnonzero(r.X));
+    fe51_neg(r.X, r.X);
+  }
+  fe51_add(r.Z, z, w);
+  fe51_sub(r.Y, z, w);
+  fe51_mul(r.X, r.X, r.Z);
+  ge51_to_p2(out, &r);
+}
+
+void ge51_tobytes(unsigned char *s, const ge_p2 *h) {
+  ge51_p2 p;
+  fe51 recip;
+  fe51 x;
+  fe51 y;
+
+  ge51_from_p2(&p, h);
+  fe51_invert(recip, p.Z);
+  fe51_mul(x, p.X, recip);
+  fe51_mul(y, p.Y, recip);
+  fe51_tobytes(s, y);
+  s[31] ^= fe51_isnegative(x) << 7;
+}
+
+void ge51_tobytes_batch_vartime(unsigned char *s, const ge_p2 *h, size_t count) {
+  ge51_p2 p[GE_TOBYTES_BATCH];
+  fe51 acc[GE_TOBYTES_BATCH];
+  fe51 inv;
+  fe51 recip;
+  fe51 x;
+  fe51 y;
+  size_t i, n;
+
+  while (count > 0) {
+    n = count < GE_TOBYTES_BATCH ? count : GE_TOBYTES_BATCH;
+    for (i = 0; i < n; i++) {
+      ge51_from_p2(&p[i], &h[i]);
+      if (i == 0) {
+        fe51_1(acc[0]);
+      } else {
+        fe51_copy(acc[i], acc[i - 1]);
+      }
+      if (fe51_isnonzero(p[i].Z)) {
+        fe51_mul(acc[i], acc[i], p[i].Z);
+      }
+    }
+    fe51_invert(inv, acc[n - 1]);
+    for (i = n; i-- > 0;) {
+      if (!fe51_isnonzero(p[i].Z)) {
+        fe51_0(recip);
+      } else if (i == 0) {
+        fe51_copy(recip, inv);
+      } else {
+        fe51_mul(recip, inv, acc[i - 1]);
+        fe51_mul(inv, inv, p[i].Z);
+      }
+      fe51_mul(x, p[i].X, recip);
+      fe51_mul(y, p[i].Y, recip);
+      fe51_tobytes(s + 32 * i, y);
+      s[32 * i + 31] ^= fe51_isnegative(x) << 7;
+    }
+    s += 32 * n;
+    h += n;
+    count -= n;
+  }
+}
+
+void ge51_p3_tobytes(unsigned char *s, const ge_p3 *h) {
+  fe51 X;
+  fe51 Y;
+  fe51 Z;
+  fe51 recip;
+
+  fe51_from_fe(X, h->X);
+  fe51_from_fe(Y, h->Y);
+  fe51_from_fe(Z, h->Z);
+  fe51_invert(recip, Z);
+  fe51_mul(X, X, recip);
+  fe51_mul(Y, Y, recip);
+  fe51_tobytes(s, Y);
+  s[31] ^= fe51_isnegative(X) << 7;
+}
+
+/* Assumes that a[31] <= 127 */
+void ge51_scalarmult_base(ge_p3 *out, const unsigned char *a) {
+  signed char e[64];
+  signed char carry;
+  ge51_p1p1 r;
+  ge51_p2 s;
+  ge51_p3 h;
+  ge51_precomp t;
+  int i;
+
+  for (i = 0; i < 32; ++i) {
+    e[2 * i + 0] = (a[i] >> 0) & 15;
+    e[2 * i + 1] = (a[i] >> 4) & 15;
+  }
+  /* each e[i] is between 0 and 15 */
+  /* e[63] is between 0 and 7 */
+
+  carry = 0;
+  for (i = 0; i < 63; ++i) {
+    e[i] += carry;
+    carry = e[i] + 8;
+    carry >>= 4;
+    e[i] -= carry << 4;
+  }
+  e[63] += carry;
+  /* each e[i] is between -8 and 8 */
+
+  ge51_p3_0(&h);
+  for (i = 1; i < 64; i += 2) {
+    ge51_select(&t, i / 2, e[i]);
+    ge51_madd(&r, &h, &t); ge51_p1p1_to_p3(&h, &r);
+  }
+
+  ge51_p3_dbl(&r, &h);  ge51_p1p1_to_p2(&s, &r);
+  ge51_p2_dbl(&r, &s); ge51_p1p1_to_p2(&s, &r);
+  ge51_p2_dbl(&r, &s); ge51_p1p1_to_p2(&s, &r);
+  ge51_p2_dbl(&r, &s); ge51_p1p1_to_p3(&h, &r);
+
+  for (i = 0; i < 64; i += 2) {
+    ge51_select(&t, i / 2, e[i]);
+    ge51_madd(&r, &h, &t); ge51_p1p1_to_p3(&h, &r);
+  }
+
+  ge51_to_p3(out, &h);
+}
+
+/* Assumes that a[31] <= 127 */
+void ge51_scalarmult(ge_p2 *out, const unsigned char *a, const ge_p3 *in) {
+  signed char e[64];
+  int carry, carry2, i;
+  ge51_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
+  ge51_p1p1 t;
+  ge51_p2 r;
+  ge51_p3 A;
+  ge51_p3 u;
+
+  carry = 0; /* 0..1 */
+  for (i = 0; i < 31; i++) {
+    carry += a[i]; /* 0..256 */
+    carry2 = (carry + 8) >> 4; /* 0..16 */
+    e[2 * i] = carry - (carry2 << 4); /* -8..7 */
+    carry = (carry2 + 8) >> 4; /* 0..1 */
+    e[2 * i + 1] = carry2 - (carry << 4); /* -8..7 */
+  }
+  carry += a[31]; /* 0..128 */
+  carry2 = (carry + 8) >> 4; /* 0..8 */
+  e[62] = carry - (carry2 << 4); /* -8..7 */
+  e[63] = carry2; /* 0..8 */
+
+  ge51_from_p3(&A, in);
+  ge51_p3_to_cached(&Ai[0], &A);
+  for (i = 0; i < 7; i++) {
+    ge51_add(&t, &A, &Ai[i]);
+    ge51_p1p1_to_p3(&u, &t);
+    ge51_p3_to_cached(&Ai[i + 1], &u);
+  }
+
+  ge51_p2_0(&r);
+  for (i = 63; i >= 0; i--) {
+    signed char b = e[i];
+    unsigned char bnegative = negative(b);
+    unsigned char babs = b - (((-bnegative) & b) << 1);
+    ge51_cached cur, minuscur;
+    int j;
+    ge51_p2_dbl(&t, &r);
+    ge51_p1p1_to_p2(&r, &t);
+    ge51_p2_dbl(&t, &r);
+    ge51_p1p1_to_p2(&r, &t);
+    ge51_p2_dbl(&t, &r);
+    ge51_p1p1_to_p2(&r, &t);
+    ge51_p2_dbl(&t, &r);
+    ge51_p1p1_to_p3(&u, &t);
+    fe51_1(cur.YplusX);
+    fe51_1(cur.YminusX);
+    fe51_1(cur.Z);
+    fe51_0(cur.T2d);
+    for (j = 0; j < 8; ++j) {
+      ge51_cached_cmov(&cur, &Ai[j], equal(babs, j + 1));
+    }
+    fe51_copy(minuscur.YplusX, cur.YminusX);
+    fe51_copy(minuscur.YminusX, cur.YplusX);
+    fe51_copy(minuscur.Z, cur.Z);
+    fe51_neg(minuscur.T2d, cur.T2d);
+    ge51_cached_cmov(&cur, &minuscur, bnegative);
+    ge51_add(&t, &u, &cur);
+    ge51_p1p1_to_p2(&r, &t);
+  }
+
+  ge51_to_p2(out, &r);
+}
+
+void ge51_double_scalarmult_base_vartime(ge_p2 *out, const unsigned char *a, const ge_p3 *in, const unsigned char *b) {
+  signed char aslide[256];
+  signed char bslide[256];
+  ge51_cached Ai[8]; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+  ge51_p1p1 t;
+  ge51_p2 r;
+  ge51_p3 A;
+  ge51_p3 u;
+  int i;
+
+  slide(aslide, a);
+  slide(bslide, b);
+  ge51_from_p3(&A, in);
+  ge51_dsm_precomp(Ai, &A);
+
+  ge51_p2_0(&r);
+
+  for (i = 255; i >= 0; --i) {
+    if (aslide[i] || bslide[i]) break;
+  }
+
+  for (; i >= 0; --i) {
+    ge51_p2_dbl(&t, &r);
+
+    if (aslide[i] > 0) {
+      ge51_p1p1_to_p3(&u, &t);
+      ge51_add(&t, &u, &Ai[aslide[i]/2]);
+    } else if (aslide[i] < 0) {
+      ge51_p1p1_to_p3(&u, &t);
+      ge51_sub(&t, &u, &Ai[(-aslide[i])/2]);
+    }
+
+    if (bslide[i] > 0) {
+      ge51_p1p1_to_p3(&u, &t);
+      ge51_madd(&t, &u, &ge51_Bi[bslide[i]/2]);
+    } else if (bslide[i] < 0) {
+      ge51_p1p1_to_p3(&u, &t);
+      ge51_msub(&t, &u, &ge51_Bi[(-bslide[i])/2]);
+    }
+
+    ge51_p1p1_to_p2(&r, &t);
+  }
+
+  ge51_to_p2(out, &r);
+}
+
+void ge51_double_scalarmult_precomp_vartime(ge_p2 *out, const unsigned char *a, const ge_p3 *in, const unsigned char *b, const ge_dsmp Bin) {
+  signed char aslide[256];
+  signed char bslide[256];
+  ge51_cached Ai[8]; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+  ge51_cached Bi[8];
+  ge51_p1p1 t;
+  ge51_p2 r;
+  ge51_p3 A;
+  ge51_p3 u;
+  int i;
+
+  slide(aslide, a);
+  slide(bslide, b);
+  ge51_from_p3(&A, in);
+  ge51_dsm_precomp(Ai, &A);
+  for (i = 0; i < 8; ++i) {
+    ge51_from_cached(&Bi[i], &Bin[i]);
+  }
+
+  ge51_p2_0(&r);
+
+  for (i = 255; i >= 0; --i) {
+    if (aslide[i] || bslide[i]) break;
+  }
+
+  for (; i >= 0; --i) {
+    ge51_p2_dbl(&t, &r);
+
+    if (aslide[i] > 0) {
+      ge51_p1p1_to_p3(&u, &t);
+      ge51_add(&t, &u, &Ai[aslide[i]/2]);
+    } else if (aslide[i] < 0) {
+      ge51_p1p1_to_p3(&u, &t);
+      ge51_sub(&t, &u, &Ai[(-aslide[i])/2]);
+    }
+
+    if (bslide[i] > 0) {
+      ge51_p1p1_to_p3(&u, &t);
+      ge51_add(&t, &u, &Bi[bslide[i]/2]);
+    } else if (bslide[i] < 0) {
+      ge51_p1p1_to_p3(&u, &t);
+      ge51_sub(&t, &u, &Bi[(-bslide[i])/2]);
+    }
+
+    ge51_p1p1_to_p2(&r, &t);
+  }
+
+  ge51_to_p2(out, &r);
+}
+
+#endif
@@ -0,0 +1,40 @@
+// Copyright (c) 2018, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#pragma once
+
+/* Radix 2^51 backend for the hot group operations in crypto-ops.c.
+   Needs a 64-bit target with a native 128-bit multiply; on x86_64 it is
+   compiled for AVX2/BMI2 and only selected when cpuid reports both. */
+
+#if defined(__SIZEOF_INT128__) && (defined(__x86_64__) || defined(__aarch64__))
+#define CRYPTO_OPS_HAVE_FE51 1
+#else
+#define CRYPTO_OPS_HAVE_FE51 0
+#endif
+
+/* Points per shared inversion in ge_tobytes_batch_vartime */
+#define GE_TOBYTES_BATCH 32
+
+#if CRYPTO_OPS_HAVE_FE51
+
+/* Set by crypto-ops-backend.c, checked by the ref10 entry points */
+extern int crypto_ops_use_fe51;
+
+/* Converts the constant tables, must run once before any other ge51_ call */
+void ge51_init(void);
+
+/* Drop-in replacements for the ref10 functions of the same name; inputs and
+   outputs stay in the ref10 representation so callers can mix backends */
+int ge51_frombytes_vartime(ge_p3 *, const unsigned char *);
+void ge51_fromfe_frombytes_vartime(ge_p2 *, const unsigned char *);
+void ge51_tobytes(unsigned char *, const ge_p2 *);
+void ge51_p3_tobytes(unsigned char *, const ge_p3 *);
+void ge51_tobytes_batch_vartime(unsigned char *, const ge_p2 *, size_t);
+void ge51_scalarmult_base(ge_p3 *, const unsigned char *);
+void ge51_scalarmult(ge_p2 *, const unsigned char *, const ge_p3 *);
+void ge51_double_scalarmult_base_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *);
+void ge51_double_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *, const ge_dsmp);
+
+#endif
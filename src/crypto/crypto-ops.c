@@ -19,6 +19,7 @@
 #include <stdint.h>
 
 #include "crypto-ops.h"
+#include "crypto-ops-fe51.h"
 
 /* Predeclarations */
 
@@ -1179,6 +1180,13 @@ B is the Ed25519 base point (x,4/5) with x positive.
 */
 
 void ge_double_scalarmult_base_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    ge51_double_scalarmult_base_vartime(r, a, A, b);
+    return;
+  }
+#endif
+
   signed char aslide[256];
   signed char bslide[256];
   ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
@@ -1222,6 +1230,12 @@ void ge_double_scalarmult_base_vartime(ge_p2 *r, const unsigned char *a, const g
 /* From ge_frombytes.c, modified */
 
 int ge_frombytes_vartime(ge_p3 *h, const unsigned char *s) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    return ge51_frombytes_vartime(h, s);
+  }
+#endif
+
   fe u;
   fe v;
   fe vxx;
@@ -1454,6 +1468,13 @@ void ge_p3_to_p2(ge_p2 *r, const ge_p3 *p) {
 /* From ge_p3_tobytes.c */
 
 void ge_p3_tobytes(unsigned char *s, const ge_p3 *h) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    ge51_p3_tobytes(s, h);
+    return;
+  }
+#endif
+
   fe recip;
   fe x;
   fe y;
@@ -1527,6 +1548,13 @@ Preconditions:
 */
 
 void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    ge51_scalarmult_base(h, a);
+    return;
+  }
+#endif
+
   signed char e[64];
   signed char carry;
   ge_p1p1 r;
@@ -1592,6 +1620,13 @@ void ge_sub(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q) {
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char *s, const ge_p2 *h) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    ge51_tobytes(s, h);
+    return;
+  }
+#endif
+
   fe recip;
   fe x;
   fe y;
@@ -1603,6 +1638,56 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+void ge_tobytes_batch_vartime(unsigned char *s, const ge_p2 *h, size_t count) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    ge51_tobytes_batch_vartime(s, h, count);
+    return;
+  }
+#endif
+
+  /* Points are converted in chunks so the scratch space stays on the stack */
+  fe acc[GE_TOBYTES_BATCH];
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  size_t i, n;
+
+  while (count > 0) {
+    n = count < GE_TOBYTES_BATCH ? count : GE_TOBYTES_BATCH;
+    /* acc[i] = Z[0] * ... * Z[i], skipping zeros which ge_tobytes maps to zero */
+    for (i = 0; i < n; i++) {
+      if (i == 0) {
+        fe_1(acc[0]);
+      } else {
+        fe_copy(acc[i], acc[i - 1]);
+      }
+      if (fe_isnonzero(h[i].Z)) {
+        fe_mul(acc[i], acc[i], h[i].Z);
+      }
+    }
+    fe_invert(inv, acc[n - 1]);
+    for (i = n; i-- > 0;) {
+      if (!fe_isnonzero(h[i].Z)) {
+        fe_0(recip);
+      } else if (i == 0) {
+        fe_copy(recip, inv);
+      } else {
+        fe_mul(recip, inv, acc[i - 1]);
+        fe_mul(inv, inv, h[i].Z);
+      }
+      fe_mul(x, h[i].X, recip);
+      fe_mul(y, h[i].Y, recip);
+      fe_tobytes(s + 32 * i, y);
+      s[32 * i + 31] ^= fe_isnegative(x) << 7;
+    }
+    s += 32 * n;
+    h += n;
+    count -= n;
+  }
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -1926,6 +2011,13 @@ static void ge_cached_cmov(ge_cached *t, const ge_cached *u, unsigned char b) {
 
 /* Assumes that a[31] <= 127 */
 void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    ge51_scalarmult(r, a, A);
+    return;
+  }
+#endif
+
   signed char e[64];
   int carry, carry2, i;
   ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
@@ -1986,6 +2078,13 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
 }
 
 void ge_double_scalarmult_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b, const ge_dsmp Bi) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    ge51_double_scalarmult_precomp_vartime(r, a, A, b, Bi);
+    return;
+  }
+#endif
+
   signed char aslide[256];
   signed char bslide[256];
   ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
@@ -2588,6 +2687,13 @@ void ge_mul8(ge_p1p1 *r, const ge_p2 *t) {
 }
 
 void ge_fromfe_frombytes_vartime(ge_p2 *r, const unsigned char *s) {
+#if CRYPTO_OPS_HAVE_FE51
+  if (crypto_ops_use_fe51) {
+    ge51_fromfe_frombytes_vartime(r, s);
+    return;
+  }
+#endif
+
   fe u, v, w, x, y, z;
   unsigned char sign;
 
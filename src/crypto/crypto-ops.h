@@ -1,5 +1,22 @@
 #pragma once
 
+#if !defined(__cplusplus)
+#include <stddef.h>
+#endif
+
+/* Backend selection. The radix 2^51 backend is picked at startup when the
+   CPU supports it, TURTLECOIN_USE_REF10=1 forces the reference code. Both
+   produce identical results. */
+
+enum {
+  CRYPTO_OPS_BACKEND_REF10 = 0,
+  CRYPTO_OPS_BACKEND_FE51 = 1
+};
+
+int crypto_ops_get_backend(void);
+/* Returns 0 on success, -1 if the backend is not available on this machine */
+int crypto_ops_set_backend(int);
+
 /* From fe.h */
 
 typedef int32_t fe[10];
@@ -93,6 +110,9 @@ void ge_sub(ge_p1p1 *, const ge_p3 *, const ge_cached *);
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char *, const ge_p2 *);
+/* Same as calling ge_tobytes on each point, but shares one field inversion
+   between the points (Montgomery's trick). Not constant time. */
+void ge_tobytes_batch_vartime(unsigned char *, const ge_p2 *, size_t);
 
 /* From sc_reduce.c */
 
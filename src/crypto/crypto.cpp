@@ -13,6 +13,8 @@
 #include <cstring>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "Common/Varint.h"
 #include "crypto.h"
@@ -112,6 +114,35 @@ namespace Crypto {
     return true;
   }
 
+  void crypto_ops::generate_key_derivations(const PublicKey *keys, size_t count, const SecretKey &sec,
+    KeyDerivation *derivations, bool *valid) {
+    std::vector<ge_p2> points;
+    std::vector<KeyDerivation> encoded;
+    size_t i, j;
+    assert(sc_check(reinterpret_cast<const unsigned char*>(&sec)) == 0);
+    points.reserve(count);
+    for (i = 0; i < count; i++) {
+      ge_p3 point;
+      ge_p2 point2;
+      ge_p1p1 point3;
+      valid[i] = ge_frombytes_vartime(&point, reinterpret_cast<const unsigned char*>(&keys[i])) == 0;
+      if (!valid[i]) {
+        continue;
+      }
+      ge_scalarmult(&point2, reinterpret_cast<const unsigned char*>(&sec), &point);
+      ge_mul8(&point3, &point2);
+      points.emplace_back();
+      ge_p1p1_to_p2(&points.back(), &point3);
+    }
+    encoded.resize(points.size());
+    ge_tobytes_batch_vartime(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), points.size());
+    for (i = 0, j = 0; i < count; i++) {
+      if (valid[i]) {
+        derivations[i] = encoded[j++];
+      }
+    }
+  }
+
   static void derivation_to_scalar(const KeyDerivation &derivation, size_t output_index, EllipticCurveScalar &res) {
     struct {
       KeyDerivation derivation;
@@ -235,6 +266,37 @@ namespace Crypto {
     return true;
   }
 
+  void crypto_ops::underive_public_keys(const UnderiveInput *inputs, size_t count, PublicKey *bases, bool *valid) {
+    std::vector<ge_p2> points;
+    std::vector<PublicKey> encoded;
+    size_t i, j;
+    points.reserve(count);
+    for (i = 0; i < count; i++) {
+      EllipticCurveScalar scalar;
+      ge_p3 point1;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      valid[i] = ge_frombytes_vartime(&point1, reinterpret_cast<const unsigned char*>(inputs[i].derivedKey)) == 0;
+      if (!valid[i]) {
+        continue;
+      }
+      derivation_to_scalar(*inputs[i].derivation, inputs[i].outputIndex, scalar);
+      ge_scalarmult_base(&point2, reinterpret_cast<unsigned char*>(&scalar));
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      points.emplace_back();
+      ge_p1p1_to_p2(&points.back(), &point4);
+    }
+    encoded.resize(points.size());
+    ge_tobytes_batch_vartime(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), points.size());
+    for (i = 0, j = 0; i < count; i++) {
+      if (valid[i]) {
+        bases[i] = encoded[j++];
+      }
+    }
+  }
+
   bool crypto_ops::underive_public_key(const KeyDerivation &derivation, size_t output_index,
     const PublicKey &derived_key, const uint8_t* suffix, size_t suffixLength, PublicKey &base) {
     EllipticCurveScalar scalar;
@@ -474,4 +536,101 @@ namespace Crypto {
     sc_sub(reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&sum));
     return sc_isnonzero(reinterpret_cast<unsigned char*>(&h)) == 0;
   }
+
+  bool crypto_ops::check_ring_signatures(const RingSignatureInput *inputs, size_t inputs_count, size_t &failed_index) {
+    struct ring_key {
+      ge_p3 point;
+      ge_p3 hashed;
+    };
+    struct ring_image {
+      ge_dsmp pre;
+    };
+    std::unordered_map<PublicKey, size_t> key_indexes;
+    std::vector<ring_key> keys;
+    std::vector<ring_image> images(inputs_count);
+    std::vector<size_t> members;
+    std::vector<size_t> offsets(inputs_count + 1, 0);
+    size_t checked = inputs_count;
+    size_t i, j;
+
+    failed_index = inputs_count;
+
+    /* Everything that can be rejected without group operations, plus one
+       decompression and hash_to_ec per distinct public key. Nothing after the
+       first input rejected here is needed, but the inputs before it can still
+       fail the signature check below and take precedence. */
+    for (i = 0; i < inputs_count && checked == inputs_count; i++) {
+      const RingSignatureInput &in = inputs[i];
+      ge_p3 image_unp;
+      offsets[i + 1] = offsets[i];
+      if (ge_frombytes_vartime(&image_unp, reinterpret_cast<const unsigned char*>(in.image)) != 0) {
+        checked = i;
+        break;
+      }
+      ge_dsm_precomp(images[i].pre, &image_unp);
+      if (in.checkKeyImage && ge_check_subgroup_precomp_vartime(images[i].pre) != 0) {
+        checked = i;
+        break;
+      }
+      for (j = 0; j < in.pubs_count; j++) {
+        if (sc_check(reinterpret_cast<const unsigned char*>(&in.sig[j])) != 0 || sc_check(reinterpret_cast<const unsigned char*>(&in.sig[j]) + 32) != 0) {
+          checked = i;
+          break;
+        }
+        auto ins = key_indexes.emplace(*in.pubs[j], keys.size());
+        if (ins.second) {
+          keys.emplace_back();
+          if (ge_frombytes_vartime(&keys.back().point, reinterpret_cast<const unsigned char*>(in.pubs[j])) != 0) {
+            abort();
+          }
+          hash_to_ec(*in.pubs[j], keys.back().hashed);
+        }
+        members.push_back(ins.first->second);
+      }
+      offsets[i + 1] = members.size();
+    }
+
+    /* The commitments a = c*P + r*G and b = r*Hp(P) + c*I of every ring
+       member, laid out pairwise like rs_comm::ab */
+    std::vector<ge_p2> points(2 * offsets[checked]);
+    for (i = 0; i < checked; i++) {
+      const RingSignatureInput &in = inputs[i];
+      for (j = 0; j < in.pubs_count; j++) {
+        const ring_key &key = keys[members[offsets[i] + j]];
+        const unsigned char *c = reinterpret_cast<const unsigned char*>(&in.sig[j]);
+        ge_double_scalarmult_base_vartime(&points[2 * (offsets[i] + j)], c, &key.point, c + 32);
+        ge_double_scalarmult_precomp_vartime(&points[2 * (offsets[i] + j) + 1], c + 32, &key.hashed, c, images[i].pre);
+      }
+    }
+    std::vector<EllipticCurvePoint> encoded(points.size());
+    ge_tobytes_batch_vartime(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), points.size());
+
+    /* Heap buffer rather than alloca, a whole block of rings can be checked here */
+    std::vector<uint8_t> comm;
+    for (i = 0; i < checked; i++) {
+      const RingSignatureInput &in = inputs[i];
+      EllipticCurveScalar sum, h;
+      comm.resize(rs_comm_size(in.pubs_count));
+      rs_comm *const buf = reinterpret_cast<rs_comm *>(comm.data());
+      buf->h = *in.prefix_hash;
+      if (in.pubs_count > 0) {
+        memcpy(buf->ab, &encoded[2 * offsets[i]], 2 * in.pubs_count * sizeof(EllipticCurvePoint));
+      }
+      sc_0(reinterpret_cast<unsigned char*>(&sum));
+      for (j = 0; j < in.pubs_count; j++) {
+        sc_add(reinterpret_cast<unsigned char*>(&sum), reinterpret_cast<unsigned char*>(&sum), reinterpret_cast<const unsigned char*>(&in.sig[j]));
+      }
+      hash_to_scalar(buf, rs_comm_size(in.pubs_count), h);
+      sc_sub(reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&h), reinterpret_cast<unsigned char*>(&sum));
+      if (sc_isnonzero(reinterpret_cast<unsigned char*>(&h)) != 0) {
+        failed_index = i;
+        return false;
+      }
+    }
+    if (checked != inputs_count) {
+      failed_index = checked;
+      return false;
+    }
+    return true;
+  }
 }
@@ -34,6 +34,25 @@ struct EllipticCurveScalar {
   uint8_t data[32];
 };
 
+  /* One entry of a check_ring_signatures batch, same arguments as
+     check_ring_signature. Only pointers are kept, the caller owns the data.
+   */
+  struct RingSignatureInput {
+    const Hash *prefix_hash;
+    const KeyImage *image;
+    const PublicKey *const *pubs;
+    size_t pubs_count;
+    const Signature *sig;
+    bool checkKeyImage;
+  };
+
+  /* One output of an underive_public_keys batch */
+  struct UnderiveInput {
+    const KeyDerivation *derivation;
+    size_t outputIndex;
+    const PublicKey *derivedKey;
+  };
+
   class crypto_ops {
     crypto_ops();
     crypto_ops(const crypto_ops &);
@@ -52,6 +71,8 @@ struct EllipticCurveScalar {
     friend bool secret_key_to_public_key(const SecretKey &, PublicKey &);
     static bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
     friend bool generate_key_derivation(const PublicKey &, const SecretKey &, KeyDerivation &);
+    static void generate_key_derivations(const PublicKey *, size_t, const SecretKey &, KeyDerivation *, bool *);
+    friend void generate_key_derivations(const PublicKey *, size_t, const SecretKey &, KeyDerivation *, bool *);
     static bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool derive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
@@ -68,6 +89,8 @@ struct EllipticCurveScalar {
     friend void derive_secret_key(const KeyDerivation &, size_t, const SecretKey &, const uint8_t*, size_t, SecretKey &);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
+    static void underive_public_keys(const UnderiveInput *, size_t, PublicKey *, bool *);
+    friend void underive_public_keys(const UnderiveInput *, size_t, PublicKey *, bool *);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     static void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
@@ -88,6 +111,8 @@ struct EllipticCurveScalar {
       const PublicKey *const *, size_t, const Signature *, bool);
     friend bool check_ring_signature(const Hash &, const KeyImage &,
       const PublicKey *const *, size_t, const Signature *, bool);
+    static bool check_ring_signatures(const RingSignatureInput *, size_t, size_t &);
+    friend bool check_ring_signatures(const RingSignatureInput *, size_t, size_t &);
   };
 
   /* Generate a value filled with random bytes.
@@ -165,6 +190,14 @@ struct EllipticCurveScalar {
     return crypto_ops::generate_key_derivation(key1, key2, derivation);
   }
 
+  /* Same as generate_key_derivation for each of count keys, valid[i] is set
+     to its result. The derivations are encoded with one batched inversion.
+   */
+  inline void generate_key_derivations(const PublicKey *keys, size_t count, const SecretKey &sec,
+    KeyDerivation *derivations, bool *valid) {
+    crypto_ops::generate_key_derivations(keys, count, sec, derivations, valid);
+  }
+
   inline bool derive_public_key(const KeyDerivation &derivation, size_t output_index,
     const PublicKey &base, const uint8_t* prefix, size_t prefixLength, PublicKey &derived_key) {
     return crypto_ops::derive_public_key(derivation, output_index, base, prefix, prefixLength, derived_key);
@@ -204,6 +237,12 @@ struct EllipticCurveScalar {
     return crypto_ops::underive_public_key(derivation, output_index, derived_key, base);
   }
 
+  /* Same as underive_public_key for each input, valid[i] is set to its result.
+   */
+  inline void underive_public_keys(const UnderiveInput *inputs, size_t count, PublicKey *bases, bool *valid) {
+    crypto_ops::underive_public_keys(inputs, count, bases, valid);
+  }
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const Hash &prefix_hash, const PublicKey &pub, const SecretKey &sec, Signature &sig) {
@@ -257,6 +296,19 @@ struct EllipticCurveScalar {
     return check_ring_signature(prefix_hash, image, pubs.data(), pubs.size(), sig, checkKeyImage);
   }
 
+  /* Checks several ring signatures at once. Public keys shared between rings
+     are only decompressed and hashed to the curve once, and all the
+     commitments are encoded with a single batched inversion. On failure,
+     failedIndex is set to the lowest index that check_ring_signature would
+     reject.
+   */
+  inline bool check_ring_signatures(const RingSignatureInput *inputs, size_t inputs_count, size_t &failedIndex) {
+    return crypto_ops::check_ring_signatures(inputs, inputs_count, failedIndex);
+  }
+  inline bool check_ring_signatures(const std::vector<RingSignatureInput> &inputs, size_t &failedIndex) {
+    return check_ring_signatures(inputs.data(), inputs.size(), failedIndex);
+  }
+
 }
 
 CRYPTO_MAKE_HASHABLE(PublicKey)
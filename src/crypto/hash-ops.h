@@ -60,13 +60,29 @@ enum {
   HASH_SIZE = 32,
   HASH_DATA_AREA = 136,
   SLOW_HASH_CONTEXT_SIZE = 2097552,
-  SLOW_HASH_CONTEXT_LITE_SIZE = 1048976  // Suml: Unused for now but this is the right size for 1MB scratchpads.
+  SLOW_HASH_CONTEXT_LITE_SIZE = 1048976,  // Suml: Unused for now but this is the right size for 1MB scratchpads.
+  SLOW_HASH_MAX_WAYS = 4
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
 
 void cn_slow_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed);
 
+/* Scratchpads for up to SLOW_HASH_MAX_WAYS hashes computed together. Owning
+   one avoids mapping a fresh scratchpad on every cn_slow_hash call. */
+typedef struct cn_slow_hash_ctx cn_slow_hash_ctx;
+
+/* Returns NULL if ways is out of range or the memory could not be allocated */
+cn_slow_hash_ctx *cn_slow_hash_alloc(size_t ways);
+void cn_slow_hash_free(cn_slow_hash_ctx *ctx);
+size_t cn_slow_hash_ways(const cn_slow_hash_ctx *ctx);
+
+/* Hashes count (at most the context's ways) inputs with the same light/variant
+   flags, interleaving their main loops. Gives the same results as calling
+   cn_slow_hash on each input. */
+void cn_slow_hash_multi(cn_slow_hash_ctx *ctx, const void *const *data, const size_t *length, char (*hash)[HASH_SIZE],
+                        size_t count, int light, int variant, int prehashed);
+
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
 void hash_extra_jh(const void *data, size_t length, char *hash);
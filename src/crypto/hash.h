@@ -9,6 +9,8 @@
 
 #include <stddef.h>
 
+#include <stdexcept>
+
 #include <CryptoTypes.h>
 #include "generic-ops.h"
 
@@ -56,6 +58,42 @@ namespace Crypto {
     cn_slow_hash(data, length, reinterpret_cast<char *>(&hash), 1, 2, 0);
   }
 
+  /* Owns the scratchpads for up to `ways` slow hashes computed together.
+     Keeping one around avoids mapping a scratchpad on every hash.
+   */
+  class SlowHashContext {
+  public:
+    explicit SlowHashContext(size_t ways = 1) : m_ctx(cn_slow_hash_alloc(ways)) {
+      if (m_ctx == nullptr) {
+        throw std::runtime_error("Failed to allocate slow hash scratchpads");
+      }
+    }
+
+    ~SlowHashContext() {
+      cn_slow_hash_free(m_ctx);
+    }
+
+    SlowHashContext(const SlowHashContext &) = delete;
+    SlowHashContext &operator=(const SlowHashContext &) = delete;
+
+    size_t ways() const {
+      return cn_slow_hash_ways(m_ctx);
+    }
+
+    cn_slow_hash_ctx *get() const {
+      return m_ctx;
+    }
+
+  private:
+    cn_slow_hash_ctx *m_ctx;
+  };
+
+  /* Hashes count <= context.ways() inputs of one variant together, see cn_slow_hash_multi */
+  inline void cn_slow_hash_multi(SlowHashContext &context, const void *const *data, const size_t *length,
+    Hash *hashes, size_t count, int light, int variant) {
+    cn_slow_hash_multi(context.get(), data, length, reinterpret_cast<char (*)[HASH_SIZE]>(hashes), count, light, variant, 0);
+  }
+
   inline void tree_hash(const Hash *hashes, size_t count, Hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
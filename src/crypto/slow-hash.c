@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -587,46 +588,77 @@ BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
 #endif
 
 /**
- * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
+ * @brief allocates a scratchpad using OS support for huge pages, if available
  *
- * This function tries to allocate the 2MB scratch buffer using a single
- * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
+ * A 2MB "huge page" (instead of the usual 4KB page sizes) reduces TLB misses
  * during the random accesses to the scratch buffer.  This is one of the
  * important speed optimizations needed to make CryptoNight faster.
  *
- * No parameters.  Updates a thread-local pointer, hp_state, to point to
- * the allocated buffer.
+ * @param size the size of the buffer, a multiple of MEMORY
+ * @param huge set to 1 if the buffer must be released with free_scratchpad's
+ *        page unmapping, 0 if it came from malloc
+ * @return the buffer, or NULL if it could not be allocated
  */
 
-void slow_hash_allocate_state(void)
+STATIC uint8_t *allocate_scratchpad(size_t size, int *huge)
 {
-    if(hp_state != NULL)
-        return;
+    uint8_t *scratchpad = NULL;
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
     SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
-    hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
-                                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    scratchpad = (uint8_t *) VirtualAlloc(NULL, size, MEM_LARGE_PAGES |
+                                          MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 #else
 #if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
   defined(__DragonFly__) || defined(__NetBSD__)
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANON, 0, 0);
+    scratchpad = mmap(0, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANON, 0, 0);
 #else
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
+    scratchpad = mmap(0, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
 #endif
-    if(hp_state == MAP_FAILED)
-        hp_state = NULL;
+    if(scratchpad == MAP_FAILED)
+        scratchpad = NULL;
 #endif
-    hp_allocated = 1;
-    if(hp_state == NULL)
+    *huge = 1;
+    if(scratchpad == NULL)
     {
-        hp_allocated = 0;
-        hp_state = (uint8_t *) malloc(MEMORY);
+        *huge = 0;
+        scratchpad = (uint8_t *) malloc(size);
+    }
+
+    return scratchpad;
+}
+
+STATIC void free_scratchpad(uint8_t *scratchpad, size_t size, int huge)
+{
+    if(!huge)
+        free(scratchpad);
+    else
+    {
+#if defined(_MSC_VER) || defined(__MINGW32__)
+        VirtualFree(scratchpad, 0, MEM_RELEASE);
+#else
+        munmap(scratchpad, size);
+#endif
     }
 }
 
+/**
+ * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
+ *
+ * No parameters.  Updates a thread-local pointer, hp_state, to point to
+ * the allocated buffer.
+ */
+
+void slow_hash_allocate_state(void)
+{
+    if(hp_state != NULL)
+        return;
+
+    hp_state = allocate_scratchpad(MEMORY, &hp_allocated);
+}
+
 /**
  *@brief frees the state allocated by slow_hash_allocate_state
  */
@@ -636,70 +668,147 @@ void slow_hash_free_state(void)
     if(hp_state == NULL)
         return;
 
-    if(!hp_allocated)
-        free(hp_state);
-    else
-    {
-#if defined(_MSC_VER) || defined(__MINGW32__)
-        VirtualFree(hp_state, 0, MEM_RELEASE);
-#else
-        munmap(hp_state, MEMORY);
-#endif
-    }
+    free_scratchpad(hp_state, MEMORY, hp_allocated);
 
     hp_state = NULL;
     hp_allocated = 0;
 }
 
-/**
- * @brief the hash function implementing CryptoNight, used for the Monero proof-of-work
- *
- * Computes the hash of <data> (which consists of <length> bytes), returning the
- * hash in <hash>.  The CryptoNight hash operates by first using Keccak 1600,
- * the 1600 bit variant of the Keccak hash used in SHA-3, to create a 200 byte
- * buffer of pseudorandom data by hashing the supplied data.  It then uses this
- * random data to fill a large 2MB buffer with pseudorandom data by iteratively
- * encrypting it using 10 rounds of AES per entry.  After this initialization,
- * it executes 524,288 rounds of mixing through the random 2MB buffer using
- * AES (typically provided in hardware on modern CPUs) and a 64 bit multiply.
- * Finally, it re-mixes this large buffer back into
- * the 200 byte "text" buffer, and then hashes this buffer using one of four
- * pseudorandomly selected hash functions (Blake, Groestl, JH, or Skein)
- * to populate the output.
- *
- * The 2MB buffer and choice of functions for mixing are designed to make the
- * algorithm "CPU-friendly" (and thus, reduce the advantage of GPU, FPGA,
- * or ASIC-based implementations):  the functions used are fast on modern
- * CPUs, and the 2MB size matches the typical amount of L3 cache available per
- * core on 2013-era CPUs.  When available, this implementation will use hardware
- * AES support on x86 CPUs.
- *
- * A diagram of the inner loop of this function can be found at
- * https://www.cs.cmu.edu/~dga/crypto/xmr/cryptonight.png
- *
- * @param data the data to hash
- * @param length the length in bytes of the data
- * @param hash a pointer to a buffer in which the final 256 bit hash will be stored
- */
-void cn_slow_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed)
+struct cn_slow_hash_ctx
 {
-	size_t init_rounds = (light ? CN_LIGHT_INIT : CN_INIT);
-	size_t aes_rounds = (light ? ITER_Light_Divided : ITER_Divided);
-	size_t lightFlag = (light ? 2 : 1);
+    uint8_t *scratchpads;
+    size_t ways;
+    int huge;
+};
 
-    RDATA_ALIGN16 uint8_t expandedKey[240];  /* These buffers are aligned to use later with SSE functions */
+cn_slow_hash_ctx *cn_slow_hash_alloc(size_t ways)
+{
+    cn_slow_hash_ctx *ctx;
 
-    uint8_t text[INIT_SIZE_BYTE];
+    if(ways == 0 || ways > SLOW_HASH_MAX_WAYS)
+        return NULL;
+
+    ctx = (cn_slow_hash_ctx *) malloc(sizeof(cn_slow_hash_ctx));
+    if(ctx == NULL)
+        return NULL;
+
+    ctx->ways = ways;
+    ctx->scratchpads = allocate_scratchpad(ways * MEMORY, &ctx->huge);
+    if(ctx->scratchpads == NULL)
+    {
+        free(ctx);
+        return NULL;
+    }
+
+    return ctx;
+}
+
+void cn_slow_hash_free(cn_slow_hash_ctx *ctx)
+{
+    if(ctx == NULL)
+        return;
+
+    free_scratchpad(ctx->scratchpads, ctx->ways * MEMORY, ctx->huge);
+    free(ctx);
+}
+
+size_t cn_slow_hash_ways(const cn_slow_hash_ctx *ctx)
+{
+    return ctx->ways;
+}
+
+/*
+ * Everything one CryptoNight computation carries between the steps below.
+ * Several lanes are advanced in lockstep by cn_slow_hash_lanes so that the
+ * AES, multiply and scratchpad latencies of one input overlap with the others.
+ */
+struct cn_lane
+{
     RDATA_ALIGN16 uint64_t a[2];
     RDATA_ALIGN16 uint64_t b[4];
     RDATA_ALIGN16 uint64_t c[2];
+    __m128i _b, _b1;
+    uint64_t tweak1_2;
+    uint64_t division_result;
+    uint64_t sqrt_result;
+    uint8_t *hp_state;
+    oaes_ctx *aes_ctx;
+    uint8_t text[INIT_SIZE_BYTE];
     union cn_slow_hash_state state;
-    __m128i _a, _b, _b1, _c;
-    uint64_t hi, lo;
+};
 
-    size_t i, j;
+/* CryptoNight Step 1:  Use Keccak1600 to initialize the 'state' (and 'text') buffers from the data. */
+STATIC INLINE void cn_lane_init(struct cn_lane *lane, const void *data, size_t length, int variant, int prehashed)
+{
+    if (prehashed) {
+        memcpy(&lane->state.hs, data, length);
+    } else {
+        hash_process(&lane->state.hs, data, length);
+    }
+    memcpy(lane->text, lane->state.init, INIT_SIZE_BYTE);
+
+    lane->tweak1_2 = 0;
+    if (variant == 1)
+    {
+        VARIANT1_CHECK();
+        lane->tweak1_2 = lane->state.hs.w[24] ^ (*((const uint64_t*)NONCE_POINTER));
+    }
+
+    lane->division_result = 0;
+    lane->sqrt_result = 0;
+    if (variant == 2)
+    {
+        U64(lane->b)[2] = lane->state.hs.w[8] ^ lane->state.hs.w[10];
+        U64(lane->b)[3] = lane->state.hs.w[9] ^ lane->state.hs.w[11];
+        lane->division_result = lane->state.hs.w[12];
+        lane->sqrt_result = lane->state.hs.w[13];
+    }
+}
+
+/* One iteration of CryptoNight Step 3, see pre_aes and post_aes */
+STATIC INLINE void cn_lane_round(struct cn_lane *lane, int useAes, int variant, size_t lightFlag)
+{
+    uint8_t *hp_state = lane->hp_state;
+    uint64_t *a = lane->a;
+    uint64_t *b = lane->b;
+    uint64_t *c = lane->c;
+    const uint64_t tweak1_2 = lane->tweak1_2;
+    uint64_t division_result = lane->division_result;
+    uint64_t sqrt_result = lane->sqrt_result;
+    __m128i _a, _b = lane->_b, _b1 = lane->_b1, _c;
+    uint64_t hi, lo;
     uint64_t *p = NULL;
-    oaes_ctx *aes_ctx = NULL;
+    size_t j;
+
+    pre_aes();
+    if(useAes)
+        _c = _mm_aesenc_si128(_c, _a);
+    else
+        aesb_single_round((uint8_t *) &_c, (uint8_t *) &_c, (uint8_t *) &_a);
+    post_aes();
+
+    lane->_b = _b;
+    lane->_b1 = _b1;
+    lane->division_result = division_result;
+    lane->sqrt_result = sqrt_result;
+}
+
+/*
+ * Hashes count inputs with one scratchpad each.  The single input case is
+ * the plain CryptoNight described at cn_slow_hash; with more inputs every
+ * step is run for all lanes before moving on to the next one.
+ */
+STATIC INLINE void cn_slow_hash_lanes(uint8_t *const *scratchpads, size_t count, const void *const *data,
+                                      const size_t *length, char (*hash)[HASH_SIZE], int light, int variant, int prehashed)
+{
+    size_t init_rounds = (light ? CN_LIGHT_INIT : CN_INIT);
+    size_t aes_rounds = (light ? ITER_Light_Divided : ITER_Divided);
+    size_t lightFlag = (light ? 2 : 1);
+
+    RDATA_ALIGN16 uint8_t expandedKey[SLOW_HASH_MAX_WAYS][240];  /* These buffers are aligned to use later with SSE functions */
+    struct cn_lane lanes[SLOW_HASH_MAX_WAYS];
+
+    size_t i, j, l;
     int useAes = !force_software_aes() && check_aes_hw();
 
     static void (*const extra_hashes[4])(const void *, size_t, char *) =
@@ -707,18 +816,11 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
         hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
     };
 
-    slow_hash_allocate_state();
-
-    /* CryptoNight Step 1:  Use Keccak1600 to initialize the 'state' (and 'text') buffers from the data. */
-    if (prehashed) {
-        memcpy(&state.hs, data, length);
-    } else {
-        hash_process(&state.hs, data, length);
+    for(l = 0; l < count; l++)
+    {
+        lanes[l].hp_state = scratchpads[l];
+        cn_lane_init(&lanes[l], data[l], length[l], variant, prehashed);
     }
-    memcpy(text, state.init, INIT_SIZE_BYTE);
-
-    VARIANT1_INIT64();
-    VARIANT2_INIT64();
 
     /* CryptoNight Step 2:  Iteratively encrypt the results from Keccak to fill
      * the 2MB large random access buffer.
@@ -726,100 +828,176 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
 
     if(useAes)
     {
-        aes_expand_key(state.hs.b, expandedKey);
+        for(l = 0; l < count; l++)
+            aes_expand_key(lanes[l].state.hs.b, expandedKey[l]);
+
         for(i = 0; i < init_rounds; i++)
         {
-            aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
-            memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+            for(l = 0; l < count; l++)
+            {
+                aes_pseudo_round(lanes[l].text, lanes[l].text, expandedKey[l], INIT_SIZE_BLK);
+                memcpy(&lanes[l].hp_state[i * INIT_SIZE_BYTE], lanes[l].text, INIT_SIZE_BYTE);
+            }
         }
     }
     else
     {
-        aes_ctx = (oaes_ctx *) oaes_alloc();
-        oaes_key_import_data(aes_ctx, state.hs.b, AES_KEY_SIZE);
-        for(i = 0; i < init_rounds; i++)
+        for(l = 0; l < count; l++)
         {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
+            lanes[l].aes_ctx = (oaes_ctx *) oaes_alloc();
+            oaes_key_import_data(lanes[l].aes_ctx, lanes[l].state.hs.b, AES_KEY_SIZE);
+            for(i = 0; i < init_rounds; i++)
+            {
+                for(j = 0; j < INIT_SIZE_BLK; j++)
+                    aesb_pseudo_round(&lanes[l].text[AES_BLOCK_SIZE * j], &lanes[l].text[AES_BLOCK_SIZE * j], lanes[l].aes_ctx->key->exp_data);
 
-            memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+                memcpy(&lanes[l].hp_state[i * INIT_SIZE_BYTE], lanes[l].text, INIT_SIZE_BYTE);
+            }
         }
     }
 
-    U64(a)[0] = U64(&state.k[0])[0] ^ U64(&state.k[32])[0];
-    U64(a)[1] = U64(&state.k[0])[1] ^ U64(&state.k[32])[1];
-    U64(b)[0] = U64(&state.k[16])[0] ^ U64(&state.k[48])[0];
-    U64(b)[1] = U64(&state.k[16])[1] ^ U64(&state.k[48])[1];
+    for(l = 0; l < count; l++)
+    {
+        struct cn_lane *lane = &lanes[l];
+        U64(lane->a)[0] = U64(&lane->state.k[0])[0] ^ U64(&lane->state.k[32])[0];
+        U64(lane->a)[1] = U64(&lane->state.k[0])[1] ^ U64(&lane->state.k[32])[1];
+        U64(lane->b)[0] = U64(&lane->state.k[16])[0] ^ U64(&lane->state.k[48])[0];
+        U64(lane->b)[1] = U64(&lane->state.k[16])[1] ^ U64(&lane->state.k[48])[1];
+        lane->_b = _mm_load_si128(R128(lane->b));
+        lane->_b1 = _mm_load_si128(R128(lane->b) + 1);
+    }
 
     /* CryptoNight Step 3:  Bounce randomly 1,048,576 times (1<<20) through the mixing buffer,
      * using 524,288 iterations of the following mixing function.  Each execution
      * performs two reads and writes from the mixing buffer.
      */
 
-    _b = _mm_load_si128(R128(b));
-    _b1 = _mm_load_si128(R128(b) + 1);
     // Two independent versions, one with AES, one without, to ensure that
     // the useAes test is only performed once, not every iteration.
     if(useAes)
     {
         for(i = 0; i < aes_rounds; i++)
-        {
-            pre_aes();
-            _c = _mm_aesenc_si128(_c, _a);
-            post_aes();
-        }
+            for(l = 0; l < count; l++)
+                cn_lane_round(&lanes[l], 1, variant, lightFlag);
     }
     else
     {
         for(i = 0; i < aes_rounds; i++)
-        {
-            pre_aes();
-            aesb_single_round((uint8_t *) &_c, (uint8_t *) &_c, (uint8_t *) &_a);
-            post_aes();
-        }
+            for(l = 0; l < count; l++)
+                cn_lane_round(&lanes[l], 0, variant, lightFlag);
     }
 
     /* CryptoNight Step 4:  Sequentially pass through the mixing buffer and use 10 rounds
      * of AES encryption to mix the random data back into the 'text' buffer.  'text'
      * was originally created with the output of Keccak1600. */
 
-    memcpy(text, state.init, INIT_SIZE_BYTE);
-    if(useAes)
+    for(l = 0; l < count; l++)
     {
-        aes_expand_key(&state.hs.b[32], expandedKey);
-        for(i = 0; i < init_rounds; i++)
+        struct cn_lane *lane = &lanes[l];
+
+        memcpy(lane->text, lane->state.init, INIT_SIZE_BYTE);
+        if(useAes)
         {
-            // add the xor to the pseudo round
-            aes_pseudo_round_xor(text, text, expandedKey, &hp_state[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+            aes_expand_key(&lane->state.hs.b[32], expandedKey[l]);
+            for(i = 0; i < init_rounds; i++)
+            {
+                // add the xor to the pseudo round
+                aes_pseudo_round_xor(lane->text, lane->text, expandedKey[l], &lane->hp_state[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+            }
         }
-    }
-    else
-    {
-        oaes_key_import_data(aes_ctx, &state.hs.b[32], AES_KEY_SIZE);
-        for(i = 0; i < init_rounds; i++)
+        else
         {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
+            oaes_key_import_data(lane->aes_ctx, &lane->state.hs.b[32], AES_KEY_SIZE);
+            for(i = 0; i < init_rounds; i++)
             {
-                xor_blocks(&text[j * AES_BLOCK_SIZE], &hp_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
-                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
+                for(j = 0; j < INIT_SIZE_BLK; j++)
+                {
+                    xor_blocks(&lane->text[j * AES_BLOCK_SIZE], &lane->hp_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
+                    aesb_pseudo_round(&lane->text[AES_BLOCK_SIZE * j], &lane->text[AES_BLOCK_SIZE * j], lane->aes_ctx->key->exp_data);
+                }
             }
+            oaes_free((OAES_CTX **) &lane->aes_ctx);
         }
-        oaes_free((OAES_CTX **) &aes_ctx);
-    }
 
-    /* CryptoNight Step 5:  Apply Keccak to the state again, and then
-     * use the resulting data to select which of four finalizer
-     * hash functions to apply to the data (Blake, Groestl, JH, or Skein).
-     * Use this hash to squeeze the state array down
-     * to the final 256 bit hash output.
-     */
+        /* CryptoNight Step 5:  Apply Keccak to the state again, and then
+         * use the resulting data to select which of four finalizer
+         * hash functions to apply to the data (Blake, Groestl, JH, or Skein).
+         * Use this hash to squeeze the state array down
+         * to the final 256 bit hash output.
+         */
 
-    memcpy(state.init, text, INIT_SIZE_BYTE);
-    hash_permutation(&state.hs);
-    extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
+        memcpy(lane->state.init, lane->text, INIT_SIZE_BYTE);
+        hash_permutation(&lane->state.hs);
+        extra_hashes[lane->state.hs.b[0] & 3](&lane->state, 200, hash[l]);
+    }
+}
+
+/**
+ * @brief the hash function implementing CryptoNight, used for the Monero proof-of-work
+ *
+ * Computes the hash of <data> (which consists of <length> bytes), returning the
+ * hash in <hash>.  The CryptoNight hash operates by first using Keccak 1600,
+ * the 1600 bit variant of the Keccak hash used in SHA-3, to create a 200 byte
+ * buffer of pseudorandom data by hashing the supplied data.  It then uses this
+ * random data to fill a large 2MB buffer with pseudorandom data by iteratively
+ * encrypting it using 10 rounds of AES per entry.  After this initialization,
+ * it executes 524,288 rounds of mixing through the random 2MB buffer using
+ * AES (typically provided in hardware on modern CPUs) and a 64 bit multiply.
+ * Finally, it re-mixes this large buffer back into
+ * the 200 byte "text" buffer, and then hashes this buffer using one of four
+ * pseudorandomly selected hash functions (Blake, Groestl, JH, or Skein)
+ * to populate the output.
+ *
+ * The 2MB buffer and choice of functions for mixing are designed to make the
+ * algorithm "CPU-friendly" (and thus, reduce the advantage of GPU, FPGA,
+ * or ASIC-based implementations):  the functions used are fast on modern
+ * CPUs, and the 2MB size matches the typical amount of L3 cache available per
+ * core on 2013-era CPUs.  When available, this implementation will use hardware
+ * AES support on x86 CPUs.
+ *
+ * A diagram of the inner loop of this function can be found at
+ * https://www.cs.cmu.edu/~dga/crypto/xmr/cryptonight.png
+ *
+ * @param data the data to hash
+ * @param length the length in bytes of the data
+ * @param hash a pointer to a buffer in which the final 256 bit hash will be stored
+ */
+void cn_slow_hash(const void *data, size_t length, char *hash, int light, int variant, int prehashed)
+{
+    slow_hash_allocate_state();
+    cn_slow_hash_lanes(&hp_state, 1, &data, &length, (char (*)[HASH_SIZE]) hash, light, variant, prehashed);
     slow_hash_free_state();
 }
 
+void cn_slow_hash_multi(cn_slow_hash_ctx *ctx, const void *const *data, const size_t *length, char (*hash)[HASH_SIZE],
+                        size_t count, int light, int variant, int prehashed)
+{
+    uint8_t *scratchpads[SLOW_HASH_MAX_WAYS];
+    size_t l;
+
+    assert(count > 0 && count <= ctx->ways);
+
+    for(l = 0; l < count; l++)
+        scratchpads[l] = ctx->scratchpads + l * MEMORY;
+
+    /* Separate calls so the lane loops are unrolled for the common widths */
+    switch(count)
+    {
+    case 1:
+        cn_slow_hash_lanes(scratchpads, 1, data, length, hash, light, variant, prehashed);
+        break;
+    case 2:
+        cn_slow_hash_lanes(scratchpads, 2, data, length, hash, light, variant, prehashed);
+        break;
+    case 4:
+        cn_slow_hash_lanes(scratchpads, 4, data, length, hash, light, variant, prehashed);
+        break;
+    default:
+        cn_slow_hash_lanes(scratchpads, count, data, length, hash, light, variant, prehashed);
+        break;
+    }
+}
+
 #elif !defined NO_AES && (defined(__arm__) || defined(__aarch64__))
 void slow_hash_allocate_state(void)
 {
@@ -1578,4 +1756,49 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int light, int va
 #endif
 }
 
-#endif
\ No newline at end of file
+#endif
+
+#if !(!defined NO_AES && (defined(__x86_64__) || (defined(_MSC_VER) && defined(_WIN64))))
+// No interleaved implementation on these platforms, the inputs are hashed one by one
+
+struct cn_slow_hash_ctx
+{
+  size_t ways;
+};
+
+cn_slow_hash_ctx *cn_slow_hash_alloc(size_t ways)
+{
+  cn_slow_hash_ctx *ctx;
+
+  if (ways == 0 || ways > SLOW_HASH_MAX_WAYS)
+    return NULL;
+
+  ctx = (cn_slow_hash_ctx *) malloc(sizeof(cn_slow_hash_ctx));
+  if (ctx != NULL)
+    ctx->ways = ways;
+
+  return ctx;
+}
+
+void cn_slow_hash_free(cn_slow_hash_ctx *ctx)
+{
+  free(ctx);
+}
+
+size_t cn_slow_hash_ways(const cn_slow_hash_ctx *ctx)
+{
+  return ctx->ways;
+}
+
+void cn_slow_hash_multi(cn_slow_hash_ctx *ctx, const void *const *data, const size_t *length, char (*hash)[HASH_SIZE],
+                        size_t count, int light, int variant, int prehashed)
+{
+  size_t i;
+
+  assert(count > 0 && count <= ctx->ways);
+
+  for (i = 0; i < count; i++)
+    cn_slow_hash(data[i], length[i], hash[i], light, variant, prehashed);
+}
+
+#endif